@@ -0,0 +1,15 @@
+CREATE TABLE subsonic_albums (
+  id TEXT PRIMARY KEY NOT NULL,
+  fingerprint TEXT NOT NULL
+);
+
+CREATE TABLE subsonic_album_songs (
+  album_id TEXT NOT NULL,
+  url TEXT NOT NULL
+);
+
+CREATE INDEX idx_subsonic_album_songs_album ON subsonic_album_songs (album_id);
+
+CREATE INDEX idx_subsonic_songs_filename ON subsonic_songs (filename);
+
+UPDATE schema_version SET version=51;
@@ -0,0 +1,3 @@
+CREATE INDEX idx_playlist_items_playlist ON playlist_items (playlist);
+
+UPDATE schema_version SET version=52;
@@ -0,0 +1,85 @@
+CREATE TABLE song_groups (
+  group_by TEXT NOT NULL,
+  group_key NOT NULL,
+  compilation INTEGER NOT NULL,
+  song_count INTEGER NOT NULL,
+  first_song_id INTEGER,
+
+  PRIMARY KEY (group_by, group_key, compilation)
+);
+
+CREATE INDEX idx_song_groups_first_song ON song_groups (first_song_id);
+
+INSERT INTO song_groups (group_by, group_key, compilation, song_count, first_song_id)
+  SELECT 'artist', ifnull(artist, ''), ifnull(effective_compilation, 0), count(*),
+         min(ROWID)
+  FROM songs WHERE unavailable = 0
+  GROUP BY 2, 3;
+
+INSERT INTO song_groups (group_by, group_key, compilation, song_count, first_song_id)
+  SELECT 'album', ifnull(album, ''), ifnull(effective_compilation, 0), count(*),
+         min(ROWID)
+  FROM songs WHERE unavailable = 0
+  GROUP BY 2, 3;
+
+INSERT INTO song_groups (group_by, group_key, compilation, song_count, first_song_id)
+  SELECT 'effective_albumartist', ifnull(effective_albumartist, ''), ifnull(effective_compilation, 0), count(*),
+         min(ROWID)
+  FROM songs WHERE unavailable = 0
+  GROUP BY 2, 3;
+
+INSERT INTO song_groups (group_by, group_key, compilation, song_count, first_song_id)
+  SELECT 'composer', ifnull(composer, ''), ifnull(effective_compilation, 0), count(*),
+         min(ROWID)
+  FROM songs WHERE unavailable = 0
+  GROUP BY 2, 3;
+
+INSERT INTO song_groups (group_by, group_key, compilation, song_count, first_song_id)
+  SELECT 'performer', ifnull(performer, ''), ifnull(effective_compilation, 0), count(*),
+         min(ROWID)
+  FROM songs WHERE unavailable = 0
+  GROUP BY 2, 3;
+
+INSERT INTO song_groups (group_by, group_key, compilation, song_count, first_song_id)
+  SELECT 'grouping', ifnull(grouping, ''), ifnull(effective_compilation, 0), count(*),
+         min(ROWID)
+  FROM songs WHERE unavailable = 0
+  GROUP BY 2, 3;
+
+INSERT INTO song_groups (group_by, group_key, compilation, song_count, first_song_id)
+  SELECT 'genre', ifnull(genre, ''), ifnull(effective_compilation, 0), count(*),
+         min(ROWID)
+  FROM songs WHERE unavailable = 0
+  GROUP BY 2, 3;
+
+INSERT INTO song_groups (group_by, group_key, compilation, song_count, first_song_id)
+  SELECT 'year', ifnull(year, -1), ifnull(effective_compilation, 0), count(*),
+         min(ROWID)
+  FROM songs WHERE unavailable = 0
+  GROUP BY 2, 3;
+
+INSERT INTO song_groups (group_by, group_key, compilation, song_count, first_song_id)
+  SELECT 'effective_originalyear', ifnull(effective_originalyear, -1), ifnull(effective_compilation, 0), count(*),
+         min(ROWID)
+  FROM songs WHERE unavailable = 0
+  GROUP BY 2, 3;
+
+INSERT INTO song_groups (group_by, group_key, compilation, song_count, first_song_id)
+  SELECT 'disc', ifnull(disc, -1), ifnull(effective_compilation, 0), count(*),
+         min(ROWID)
+  FROM songs WHERE unavailable = 0
+  GROUP BY 2, 3;
+
+INSERT INTO song_groups (group_by, group_key, compilation, song_count, first_song_id)
+  SELECT 'bitrate', ifnull(bitrate, -1), ifnull(effective_compilation, 0), count(*),
+         min(ROWID)
+  FROM songs WHERE unavailable = 0
+  GROUP BY 2, 3;
+
+INSERT INTO song_groups (group_by, group_key, compilation, song_count, first_song_id)
+  SELECT 'filetype', ifnull(filetype, -1), ifnull(effective_compilation, 0), count(*),
+         min(ROWID)
+  FROM songs WHERE unavailable = 0
+  GROUP BY 2, 3;
+
+UPDATE schema_version SET version=53;
@@ -0,0 +1,7 @@
+CREATE TABLE tag_writeback (
+  song_id INTEGER PRIMARY KEY,
+  statistics INTEGER NOT NULL DEFAULT 0,
+  rating INTEGER NOT NULL DEFAULT 0
+);
+
+UPDATE schema_version SET version=54;
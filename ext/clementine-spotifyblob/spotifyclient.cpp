@@ -48,6 +48,10 @@ SpotifyClient::SpotifyClient(QObject* parent)
       events_timer_(new QTimer(this)) {
   SetDevice(protocol_socket_);
 
+  // Images and search results are sent through shared memory.  Clementine
+  // always connects to us over localhost.
+  SetSharedMemoryThreshold(kDefaultSharedMemoryThreshold);
+
   memset(&spotify_callbacks_, 0, sizeof(spotify_callbacks_));
   memset(&spotify_config_, 0, sizeof(spotify_config_));
   memset(&playlistcontainer_callbacks_, 0,
@@ -22,10 +22,16 @@
 #include <QFileInfo>
 #include <QNetworkAccessManager>
 #include <QTextCodec>
+#include <QThread>
 #include <QUrl>
 
 TagReaderWorker::TagReaderWorker(QIODevice* socket, QObject* parent)
-    : AbstractMessageHandler<pb::tagreader::Message>(socket, parent) {}
+    : AbstractMessageHandler<pb::tagreader::Message>(socket, parent),
+      // TagReaderClient starts one worker for each core.
+      art_cache_(&tag_reader_, QThread::idealThreadCount()) {
+  // Embedded art can be big, and Clementine is always on the same machine.
+  SetSharedMemoryThreshold(kDefaultSharedMemoryThreshold);
+}
 
 void TagReaderWorker::MessageArrived(const pb::tagreader::Message& message) {
   pb::tagreader::Message reply;
@@ -62,10 +68,8 @@ void TagReaderWorker::MessageArrived(const pb::tagreader::Message& message) {
     reply.mutable_is_media_file_response()->set_success(tag_reader_.IsMediaFile(
         QStringFromStdString(message.is_media_file_request().filename())));
   } else if (message.has_load_embedded_art_request()) {
-    QByteArray data = tag_reader_.LoadEmbeddedArt(
-        QStringFromStdString(message.load_embedded_art_request().filename()));
-    reply.mutable_load_embedded_art_response()->set_data(data.constData(),
-                                                         data.size());
+    LoadEmbeddedArt(message.load_embedded_art_request(),
+                    reply.mutable_load_embedded_art_response());
   } else if (message.has_read_cloud_file_request()) {
 #ifdef HAVE_GOOGLE_DRIVE
     const pb::tagreader::ReadCloudFileRequest& req =
@@ -85,6 +89,26 @@ void TagReaderWorker::MessageArrived(const pb::tagreader::Message& message) {
   SendReply(message, &reply);
 }
 
+void TagReaderWorker::LoadEmbeddedArt(
+    const pb::tagreader::LoadEmbeddedArtRequest& request,
+    pb::tagreader::LoadEmbeddedArtResponse* response) {
+  const QString filename = QStringFromStdString(request.filename());
+
+  if (request.max_size() <= 0) {
+    const QByteArray data = art_cache_.Data(filename);
+    response->set_data(data.constData(), data.size());
+    return;
+  }
+
+  const QImage image = art_cache_.ScaledImage(filename, request.max_size());
+  if (!image.isNull()) {
+    response->set_data(reinterpret_cast<const char*>(image.constBits()),
+                       image.byteCount());
+    response->set_width(image.width());
+    response->set_height(image.height());
+  }
+}
+
 void TagReaderWorker::DeviceClosed() {
   AbstractMessageHandler<pb::tagreader::Message>::DeviceClosed();
 
@@ -19,6 +19,7 @@
 #define TAGREADERWORKER_H
 
 #include "config.h"
+#include "embeddedartcache.h"
 #include "tagreader.h"
 #include "tagreadermessages.pb.h"
 #include "core/messagehandler.h"
@@ -32,7 +33,11 @@ class TagReaderWorker : public AbstractMessageHandler<pb::tagreader::Message> {
   void DeviceClosed();
 
  private:
+  void LoadEmbeddedArt(const pb::tagreader::LoadEmbeddedArtRequest& request,
+                       pb::tagreader::LoadEmbeddedArtResponse* response);
+
   TagReader tag_reader_;
+  EmbeddedArtCache art_cache_;
 };
 
 #endif  // TAGREADERWORKER_H
@@ -21,8 +21,33 @@
 #include "messagehandler.h"
 #include "core/logging.h"
 
+#include <cstring>
+
 #include <QAbstractSocket>
 #include <QLocalSocket>
+#include <QtEndian>
+
+const int _MessageHandlerBase::kDefaultSharedMemoryThreshold = 64 * 1024;
+const int _MessageHandlerBase::kHeaderSize = sizeof(quint32);
+
+namespace {
+
+const quint32 kFrameTypeShift = 30;
+const quint32 kLengthMask = (1u << kFrameTypeShift) - 1;
+
+// Enough for most messages without reallocating.  The buffer only grows, but
+// very big ones are freed again once the message has been handled.
+const int kReadBufferSize = 64 * 1024;
+const int kMaxRetainedReadBufferSize = 1024 * 1024;
+
+// Segments are rounded up to this size so they can be reused for messages of
+// similar sizes.
+const int kSharedMemoryGranularity = 64 * 1024;
+const int kMaxFreeSegments = 2;
+
+}  // namespace
+
+const int _MessageHandlerBase::kMaxMessageSize = kLengthMask;
 
 _MessageHandlerBase::_MessageHandlerBase(QIODevice* device, QObject* parent)
     : QObject(parent),
@@ -30,18 +55,23 @@ _MessageHandlerBase::_MessageHandlerBase(QIODevice* device, QObject* parent)
       flush_abstract_socket_(nullptr),
       flush_local_socket_(nullptr),
       reading_protobuf_(false),
+      frame_type_(Frame_Message),
       expected_length_(0),
-      is_device_closed_(false) {
+      bytes_read_(0),
+      is_device_closed_(false),
+      shared_memory_threshold_(0) {
+  buffer_.resize(kReadBufferSize);
+
   if (device) {
     SetDevice(device);
   }
 }
 
+_MessageHandlerBase::~_MessageHandlerBase() { DeleteSharedMemory(); }
+
 void _MessageHandlerBase::SetDevice(QIODevice* device) {
   device_ = device;
 
-  buffer_.open(QIODevice::ReadWrite);
-
   connect(device, SIGNAL(readyRead()), SLOT(DeviceReadyRead()));
 
   // Yeah I know.
@@ -57,41 +87,221 @@ void _MessageHandlerBase::SetDevice(QIODevice* device) {
 }
 
 void _MessageHandlerBase::DeviceReadyRead() {
+  TRACE_SPAN_CATEGORY("MessageHandler::DeviceReadyRead", "ipc");
   while (device_->bytesAvailable()) {
     if (!reading_protobuf_) {
-      // Read the length of the next message
-      QDataStream s(device_);
-      s >> expected_length_;
+      // Read the length of the next message, once all of it has arrived.
+      if (device_->bytesAvailable() < kHeaderSize) {
+        return;
+      }
 
+      uchar header[sizeof(quint32)];
+      device_->read(reinterpret_cast<char*>(header), kHeaderSize);
+      const quint32 value = qFromBigEndian<quint32>(header);
+
+      frame_type_ = FrameType(value >> kFrameTypeShift);
+      expected_length_ = value & kLengthMask;
+      bytes_read_ = 0;
+      if (quint32(buffer_.size()) < expected_length_) {
+        buffer_.resize(expected_length_);
+      }
       reading_protobuf_ = true;
     }
 
-    // Read some of the message
-    buffer_.write(device_->read(expected_length_ - buffer_.size()));
+    // Read some of the message straight into the buffer
+    const qint64 bytes_read = device_->read(buffer_.data() + bytes_read_,
+                                            expected_length_ - bytes_read_);
+    if (bytes_read == -1) {
+      qLog(Error) << "Failed to read from socket:" << device_->errorString();
+      device_->close();
+      return;
+    }
+    bytes_read_ += bytes_read;
 
     // Did we get everything?
-    if (buffer_.size() == expected_length_) {
+    if (bytes_read_ == expected_length_) {
+      reading_protobuf_ = false;
+
       // Parse the message
-      if (!RawMessageArrived(buffer_.data())) {
+      if (!FrameArrived()) {
         qLog(Error) << "Malformed protobuf message";
         device_->close();
         return;
       }
 
-      // Clear the buffer
-      buffer_.close();
-      buffer_.setData(QByteArray());
-      buffer_.open(QIODevice::ReadWrite);
-      reading_protobuf_ = false;
+      if (buffer_.size() > kMaxRetainedReadBufferSize) {
+        buffer_ = QByteArray();
+        buffer_.resize(kReadBufferSize);
+      }
+    }
+  }
+}
+
+bool _MessageHandlerBase::FrameArrived() {
+  switch (frame_type_) {
+    case Frame_Message:
+      return RawMessageArrived(buffer_.constData(), expected_length_);
+
+    case Frame_SharedMemory:
+      return SharedMemoryMessageArrived();
+
+    case Frame_ReleaseSharedMemory:
+      ReleaseSharedMemory(
+          QString::fromUtf8(buffer_.constData(), expected_length_));
+      return true;
+
+    case Frame_DeleteSharedMemory:
+      delete peer_segments_.take(
+          QString::fromUtf8(buffer_.constData(), expected_length_));
+      return true;
+  }
+
+  return false;
+}
+
+bool _MessageHandlerBase::SharedMemoryMessageArrived() {
+  TRACE_SPAN_CATEGORY("MessageHandler::SharedMemoryMessageArrived", "ipc");
+
+  // The frame contains the size of the message followed by the segment's key.
+  if (expected_length_ < quint32(kHeaderSize)) {
+    return false;
+  }
+
+  const quint32 size =
+      qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(buffer_.data()));
+  const QString key = QString::fromUtf8(buffer_.constData() + kHeaderSize,
+                                        expected_length_ - kHeaderSize);
+
+  // Segments are mapped the first time they're used, and stay mapped until
+  // the sender deletes them.
+  SharedMemorySegment* segment = peer_segments_.value(key);
+  if (!segment) {
+    segment = SharedMemorySegment::Open(key);
+    if (!segment) {
+      return false;
+    }
+    peer_segments_[key] = segment;
+  }
+
+  bool ret = false;
+  if (quint32(segment->size()) >= size) {
+    ret = RawMessageArrived(segment->constData(), size);
+  }
+
+  // Tell the sender it can have the segment back.
+  WriteKeyFrame(Frame_ReleaseSharedMemory, key);
+
+  return ret;
+}
+
+void _MessageHandlerBase::WriteKeyFrame(FrameType type, const QString& key) {
+  if (is_device_closed_) {
+    return;
+  }
+
+  const QByteArray key_data = key.toUtf8();
+  QByteArray frame = NewFrame(type, key_data.size());
+  memcpy(frame.data() + kHeaderSize, key_data.constData(), key_data.size());
+  WriteRawFrame(frame);
+}
+
+QByteArray _MessageHandlerBase::NewFrame(FrameType type, int size) {
+  Q_ASSERT(quint32(size) <= kLengthMask);
+
+  QByteArray frame;
+  frame.resize(kHeaderSize + size);
+  qToBigEndian<quint32>((quint32(type) << kFrameTypeShift) | quint32(size),
+                        reinterpret_cast<uchar*>(frame.data()));
+  return frame;
+}
+
+QByteArray _MessageHandlerBase::NewMessageFrame(int size) {
+  return NewFrame(Frame_Message, size);
+}
+
+SharedMemorySegment* _MessageHandlerBase::AcquireSharedMemory(int size) {
+  if (shared_memory_threshold_ <= 0 || size < shared_memory_threshold_) {
+    return nullptr;
+  }
+
+  for (int i = 0; i < free_segments_.count(); ++i) {
+    if (free_segments_[i]->size() >= size) {
+      SharedMemorySegment* segment = free_segments_.takeAt(i);
+      busy_segments_[segment->key()] = segment;
+      return segment;
     }
   }
+
+  const int segment_size =
+      (size / kSharedMemoryGranularity + 1) * kSharedMemoryGranularity;
+
+  SharedMemorySegment* segment = SharedMemorySegment::Create(segment_size);
+  if (!segment) {
+    // Fall back to sending it through the socket.
+    return nullptr;
+  }
+
+  busy_segments_[segment->key()] = segment;
+  return segment;
+}
+
+void _MessageHandlerBase::WriteSharedMemoryFrame(SharedMemorySegment* segment,
+                                                 int size) {
+  const QByteArray key = segment->key().toUtf8();
+
+  QByteArray frame = NewFrame(Frame_SharedMemory, kHeaderSize + key.size());
+  qToBigEndian<quint32>(size,
+                        reinterpret_cast<uchar*>(frame.data() + kHeaderSize));
+  memcpy(frame.data() + kHeaderSize * 2, key.constData(), key.size());
+  WriteRawFrame(frame);
+}
+
+void _MessageHandlerBase::ReleaseSharedMemory(const QString& key) {
+  SharedMemorySegment* segment = busy_segments_.take(key);
+  if (!segment) {
+    qLog(Warning) << "Peer released unknown shared memory" << key;
+    return;
+  }
+
+  free_segments_.prepend(segment);
+  while (free_segments_.count() > kMaxFreeSegments) {
+    // Let the peer unmap it too.
+    SharedMemorySegment* old_segment = free_segments_.takeLast();
+    WriteKeyFrame(Frame_DeleteSharedMemory, old_segment->key());
+    delete old_segment;
+  }
+}
+
+void _MessageHandlerBase::DeleteSharedMemory() {
+  qDeleteAll(busy_segments_);
+  qDeleteAll(free_segments_);
+  qDeleteAll(peer_segments_);
+  busy_segments_.clear();
+  free_segments_.clear();
+  peer_segments_.clear();
 }
 
-void _MessageHandlerBase::WriteMessage(const QByteArray& data) {
-  QDataStream s(device_);
-  s << quint32(data.length());
-  s.writeRawData(data.data(), data.length());
+void _MessageHandlerBase::WriteFrame(const QByteArray& frame) {
+  TRACE_SPAN_CATEGORY("MessageHandler::WriteFrame", "ipc");
+
+  // Messages from SendMessageAsync() are serialised on another thread, so they
+  // only get moved into shared memory now.
+  const int size = frame.size() - kHeaderSize;
+  if (SharedMemorySegment* segment = AcquireSharedMemory(size)) {
+    memcpy(segment->data(), frame.constData() + kHeaderSize, size);
+    WriteSharedMemoryFrame(segment, size);
+    return;
+  }
+
+  WriteRawFrame(frame);
+}
+
+void _MessageHandlerBase::WriteRawFrame(const QByteArray& frame) {
+  device_->write(frame);
+  Flush();
+}
 
+void _MessageHandlerBase::Flush() {
   // Sorry.
   if (flush_abstract_socket_) {
     ((static_cast<QAbstractSocket*>(device_))->*(flush_abstract_socket_))();
@@ -103,4 +313,5 @@ void _MessageHandlerBase::WriteMessage(const QByteArray& data) {
 void _MessageHandlerBase::DeviceClosed() {
   is_device_closed_ = true;
   AbortAll();
+  DeleteSharedMemory();
 }
@@ -21,7 +21,8 @@
 #ifndef MESSAGEHANDLER_H
 #define MESSAGEHANDLER_H
 
-#include <QBuffer>
+#include <QByteArray>
+#include <QList>
 #include <QMap>
 #include <QMutex>
 #include <QMutexLocker>
@@ -31,6 +32,8 @@
 
 #include "core/logging.h"
 #include "core/messagereply.h"
+#include "core/sharedmemorysegment.h"
+#include "core/tracing.h"
 
 class QAbstractSocket;
 class QIODevice;
@@ -42,6 +45,14 @@ class QLocalSocket;
 // Reads and writes uint32 length encoded protobufs to a socket.
 // This base QObject is separate from AbstractMessageHandler because moc can't
 // handle templated classes.  Use AbstractMessageHandler instead.
+//
+// The top two bits of the length say what sort of frame follows.  Most frames
+// contain a serialised message, but if the peer has a shared memory threshold
+// set, larger messages are written into a shared memory segment instead and
+// only the segment's key goes through the socket.  The receiver parses the
+// message straight out of the segment and sends a release frame back when
+// it's done, after which the sender can reuse the segment.  The receiver
+// keeps segments mapped until the sender says it has deleted them.
 class _MessageHandlerBase : public QObject {
   Q_OBJECT
 
@@ -49,21 +60,67 @@ class _MessageHandlerBase : public QObject {
   // device can be NULL, in which case you must call SetDevice before writing
   // any messages.
   _MessageHandlerBase(QIODevice* device, QObject* parent);
+  ~_MessageHandlerBase();
+
+  static const int kDefaultSharedMemoryThreshold;
 
   void SetDevice(QIODevice* device);
 
+  // Messages of at least this many bytes are sent through shared memory.  0
+  // (the default) sends everything through the socket.  Only set this when
+  // the peer is on the same machine.  The receiving side doesn't need any
+  // setup.
+  void SetSharedMemoryThreshold(int bytes) { shared_memory_threshold_ = bytes; }
+
   // After this is true, messages cannot be sent to the handler any more.
   bool is_device_closed() const { return is_device_closed_; }
 
  protected slots:
-  void WriteMessage(const QByteArray& data);
+  // Writes a frame from NewMessageFrame(), through shared memory if it's big
+  // enough.
+  void WriteFrame(const QByteArray& frame);
   void DeviceReadyRead();
   virtual void DeviceClosed();
 
  protected:
-  virtual bool RawMessageArrived(const QByteArray& data) = 0;
+  virtual bool RawMessageArrived(const char* data, int size) = 0;
   virtual void AbortAll() = 0;
 
+  // Returns an uninitialised frame with room for a message of size bytes
+  // after kHeaderSize bytes of header.
+  static QByteArray NewMessageFrame(int size);
+
+  // Returns a shared memory segment to serialise a message of size bytes into,
+  // or NULL if the message should go through the socket instead.  Must be
+  // called from my thread, and followed by WriteSharedMemoryFrame().
+  SharedMemorySegment* AcquireSharedMemory(int size);
+  void WriteSharedMemoryFrame(SharedMemorySegment* segment, int size);
+
+  // Writes any frame to the socket as it is.
+  void WriteRawFrame(const QByteArray& frame);
+
+  static const int kHeaderSize;
+
+  // The biggest message that fits in a frame.  Bigger ones can't be sent.
+  static const int kMaxMessageSize;
+
+ private:
+  enum FrameType {
+    Frame_Message = 0,
+    Frame_SharedMemory = 1,
+    Frame_ReleaseSharedMemory = 2,
+    Frame_DeleteSharedMemory = 3,
+  };
+
+  static QByteArray NewFrame(FrameType type, int size);
+  void Flush();
+
+  bool FrameArrived();
+  bool SharedMemoryMessageArrived();
+  void ReleaseSharedMemory(const QString& key);
+  void WriteKeyFrame(FrameType type, const QString& key);
+  void DeleteSharedMemory();
+
  protected:
   typedef bool (QAbstractSocket::*FlushAbstractSocket)();
   typedef bool (QLocalSocket::*FlushLocalSocket)();
@@ -72,11 +129,20 @@ class _MessageHandlerBase : public QObject {
   FlushAbstractSocket flush_abstract_socket_;
   FlushLocalSocket flush_local_socket_;
 
+  // The frame being read.  buffer_ is kept between frames so it doesn't need
+  // to be allocated again for every message.
   bool reading_protobuf_;
+  FrameType frame_type_;
   quint32 expected_length_;
-  QBuffer buffer_;
+  quint32 bytes_read_;
+  QByteArray buffer_;
 
   bool is_device_closed_;
+
+  int shared_memory_threshold_;
+  QMap<QString, SharedMemorySegment*> busy_segments_;  // Waiting for release.
+  QList<SharedMemorySegment*> free_segments_;
+  QMap<QString, SharedMemorySegment*> peer_segments_;  // Created by the peer.
 };
 
 // Reads and writes uint32 length encoded MessageType messages to a socket.
@@ -93,15 +159,17 @@ class AbstractMessageHandler : public _MessageHandlerBase {
 
   // Serialises the message and writes it to the socket.  This version MUST be
   // called from the thread in which the AbstractMessageHandler was created.
-  void SendMessage(const MessageType& message);
+  // Returns false if the message is too big to send.
+  bool SendMessage(const MessageType& message);
 
   // Serialises the message and writes it to the socket.  This version may be
-  // called from any thread.
-  void SendMessageAsync(const MessageType& message);
+  // called from any thread.  Returns false if the message is too big to send.
+  bool SendMessageAsync(const MessageType& message);
 
   // Sends the request message inside and takes ownership of the MessageReply.
   // The MessageReply's Finished() signal will be emitted when a reply arrives
-  // with the same ID.  Must be called from my thread.
+  // with the same ID, or straight away if the request can't be sent.  Must be
+  // called from my thread.
   void SendRequest(ReplyType* reply);
 
   // Sets the "id" field of reply to the same as the request, and sends the
@@ -113,7 +181,7 @@ class AbstractMessageHandler : public _MessageHandlerBase {
   virtual void MessageArrived(const MessageType& message) {}
 
   // _MessageHandlerBase
-  bool RawMessageArrived(const QByteArray& data);
+  bool RawMessageArrived(const char* data, int size);
   void AbortAll();
 
  private:
@@ -126,25 +194,54 @@ AbstractMessageHandler<MT>::AbstractMessageHandler(QIODevice* device,
     : _MessageHandlerBase(device, parent) {}
 
 template <typename MT>
-void AbstractMessageHandler<MT>::SendMessage(const MessageType& message) {
+bool AbstractMessageHandler<MT>::SendMessage(const MessageType& message) {
   Q_ASSERT(QThread::currentThread() == thread());
 
-  std::string data = message.SerializeAsString();
-  WriteMessage(QByteArray(data.data(), data.size()));
+  const int size = message.ByteSize();
+  if (size > kMaxMessageSize) {
+    qLog(Error) << "Can't send a message of" << size << "bytes";
+    return false;
+  }
+
+  // Serialise large messages straight into shared memory if we can.
+  if (SharedMemorySegment* segment = AcquireSharedMemory(size)) {
+    message.SerializeWithCachedSizesToArray(
+        reinterpret_cast<uchar*>(segment->data()));
+    WriteSharedMemoryFrame(segment, size);
+    return true;
+  }
+
+  QByteArray frame = NewMessageFrame(size);
+  message.SerializeWithCachedSizesToArray(
+      reinterpret_cast<uchar*>(frame.data() + kHeaderSize));
+  WriteRawFrame(frame);
+  return true;
 }
 
 template <typename MT>
-void AbstractMessageHandler<MT>::SendMessageAsync(const MessageType& message) {
-  std::string data = message.SerializeAsString();
-  metaObject()->invokeMethod(
-      this, "WriteMessage", Qt::QueuedConnection,
-      Q_ARG(QByteArray, QByteArray(data.data(), data.size())));
+bool AbstractMessageHandler<MT>::SendMessageAsync(const MessageType& message) {
+  const int size = message.ByteSize();
+  if (size > kMaxMessageSize) {
+    qLog(Error) << "Can't send a message of" << size << "bytes";
+    return false;
+  }
+
+  QByteArray frame = NewMessageFrame(size);
+  message.SerializeWithCachedSizesToArray(
+      reinterpret_cast<uchar*>(frame.data() + kHeaderSize));
+  metaObject()->invokeMethod(this, "WriteFrame", Qt::QueuedConnection,
+                             Q_ARG(QByteArray, frame));
+  return true;
 }
 
 template <typename MT>
 void AbstractMessageHandler<MT>::SendRequest(ReplyType* reply) {
+  TRACE_FLOW_BEGIN("MessageHandler request", reply->id());
   pending_replies_[reply->id()] = reply;
-  SendMessage(reply->request_message());
+  if (!SendMessage(reply->request_message())) {
+    pending_replies_.remove(reply->id());
+    reply->Abort();
+  }
 }
 
 template <typename MT>
@@ -155,9 +252,10 @@ void AbstractMessageHandler<MT>::SendReply(const MessageType& request,
 }
 
 template <typename MT>
-bool AbstractMessageHandler<MT>::RawMessageArrived(const QByteArray& data) {
+bool AbstractMessageHandler<MT>::RawMessageArrived(const char* data,
+                                                   int size) {
   MessageType message;
-  if (!message.ParseFromArray(data.constData(), data.size())) {
+  if (!message.ParseFromArray(data, size)) {
     return false;
   }
 
@@ -165,6 +263,7 @@ bool AbstractMessageHandler<MT>::RawMessageArrived(const QByteArray& data) {
 
   if (reply) {
     // This is a reply to a message that we created earlier.
+    TRACE_FLOW_END("MessageHandler request", reply->id());
     reply->SetReply(message);
   } else {
     MessageArrived(message);
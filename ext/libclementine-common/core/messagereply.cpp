@@ -27,6 +27,14 @@ bool _MessageReplyBase::WaitForFinished() {
   return success_;
 }
 
+bool _MessageReplyBase::WaitForFinished(int timeout_msec) {
+  if (!semaphore_.tryAcquire(1, timeout_msec)) {
+    qLog(Debug) << "Timed out waiting on ID" << id();
+    return false;
+  }
+  return success_;
+}
+
 void _MessageReplyBase::Abort() {
   Q_ASSERT(!finished_);
   finished_ = true;
@@ -40,6 +40,9 @@ class _MessageReplyBase : public QObject {
   // from the MessageHandler's thread or it will block forever.
   // Returns true if the call was successful.
   bool WaitForFinished();
+  // Like WaitForFinished(), but gives up after timeout_msec.  Returns false if
+  // the call failed or didn't finish in time.
+  bool WaitForFinished(int timeout_msec);
 
   void Abort();
 
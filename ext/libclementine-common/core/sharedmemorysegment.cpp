@@ -0,0 +1,130 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// Note: this file is licensed under the Apache License instead of GPL because
+// it is used by the Spotify blob which links against libspotify and is not GPL
+// compatible.
+
+#include "sharedmemorysegment.h"
+#include "core/logging.h"
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QFile>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+QAtomicInt sNextSegmentId(0);
+
+}  // namespace
+
+SharedMemorySegment::SharedMemorySegment(const QString& key, char* data,
+                                         int size, bool created)
+    : key_(key), data_(data), size_(size), created_(created) {}
+
+SharedMemorySegment::~SharedMemorySegment() {
+#ifdef Q_OS_UNIX
+  munmap(data_, size_);
+
+  // The name is normally gone already, but not if the peer never opened it.
+  if (created_) {
+    shm_unlink(QFile::encodeName(key_).constData());
+  }
+#endif
+}
+
+SharedMemorySegment* SharedMemorySegment::Create(int size) {
+#ifdef Q_OS_UNIX
+  // Mac OS X doesn't allow names longer than 31 characters.
+  const QString key = QString("/clem-%1-%2")
+                          .arg(QCoreApplication::applicationPid())
+                          .arg(sNextSegmentId.fetchAndAddRelaxed(1));
+  const QByteArray name = QFile::encodeName(key);
+
+  const int fd = shm_open(name.constData(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd == -1) {
+    qLog(Warning) << "Failed to create shared memory" << key << ":"
+                  << strerror(errno);
+    return nullptr;
+  }
+
+  void* data = MAP_FAILED;
+  if (ftruncate(fd, size) == 0) {
+    data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  const int error = errno;
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    qLog(Warning) << "Failed to map shared memory" << key << ":"
+                  << strerror(error);
+    shm_unlink(name.constData());
+    return nullptr;
+  }
+
+  return new SharedMemorySegment(key, static_cast<char*>(data), size, true);
+#else
+  Q_UNUSED(size);
+  return nullptr;
+#endif
+}
+
+SharedMemorySegment* SharedMemorySegment::Open(const QString& key) {
+#ifdef Q_OS_UNIX
+  const QByteArray name = QFile::encodeName(key);
+
+  const int fd = shm_open(name.constData(), O_RDONLY, 0);
+  if (fd == -1) {
+    qLog(Error) << "Failed to open shared memory" << key << ":"
+                << strerror(errno);
+    return nullptr;
+  }
+
+  // Both processes have it now, so nothing else needs to find it by name.
+  shm_unlink(name.constData());
+
+  void* data = MAP_FAILED;
+  struct stat info;
+  if (fstat(fd, &info) == 0 && info.st_size > 0 && info.st_size <= INT_MAX) {
+    data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  const int error = errno;
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    qLog(Error) << "Failed to map shared memory" << key << ":"
+                << strerror(error);
+    return nullptr;
+  }
+
+  return new SharedMemorySegment(key, static_cast<char*>(data),
+                                 int(info.st_size), false);
+#else
+  Q_UNUSED(key);
+  return nullptr;
+#endif
+}
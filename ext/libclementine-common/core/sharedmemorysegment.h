@@ -0,0 +1,60 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// Note: this file is licensed under the Apache License instead of GPL because
+// it is used by the Spotify blob which links against libspotify and is not GPL
+// compatible.
+
+#ifndef SHAREDMEMORYSEGMENT_H
+#define SHAREDMEMORYSEGMENT_H
+
+#include <QString>
+
+// A block of memory shared with another process on the same machine.
+//
+// Segments are POSIX shared memory objects.  The process that opens a segment
+// removes its name straight away, so the memory goes away once both processes
+// have unmapped it, even if one of them crashes.  System V segments (which
+// QSharedMemory uses) are left behind until the machine is rebooted.
+//
+// Shared memory isn't supported on Windows - Create() and Open() always fail.
+class SharedMemorySegment {
+ public:
+  ~SharedMemorySegment();
+
+  // Creates and maps a new segment of size bytes.  Returns NULL on failure.
+  static SharedMemorySegment* Create(int size);
+
+  // Maps a segment created by another process read-only and removes its name.
+  // Returns NULL on failure.
+  static SharedMemorySegment* Open(const QString& key);
+
+  const QString& key() const { return key_; }
+  int size() const { return size_; }
+  char* data() { return data_; }
+  const char* constData() const { return data_; }
+
+ private:
+  SharedMemorySegment(const QString& key, char* data, int size, bool created);
+  Q_DISABLE_COPY(SharedMemorySegment)
+
+  QString key_;
+  char* data_;
+  int size_;
+  bool created_;
+};
+
+#endif  // SHAREDMEMORYSEGMENT_H
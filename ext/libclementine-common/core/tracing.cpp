@@ -0,0 +1,395 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// Note: this file is licensed under the Apache License instead of GPL because
+// it is used by the Spotify blob which links against libspotify and is not GPL
+// compatible.
+
+#include "tracing.h"
+
+#include <cstdio>
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadStorage>
+
+#include "core/logging.h"
+
+#ifdef Q_CC_MSVC
+#define TRACING_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACING_THREAD_LOCAL __thread
+#endif
+
+namespace tracing {
+
+namespace {
+
+const char* kDefaultCategory = "clementine";
+
+// Each thread gets a linked list of fixed size chunks.  Only the owning thread
+// ever writes to a chunk, and it publishes each event by bumping the chunk's
+// count with release semantics, so readers can walk the list at any time
+// without locking.
+//
+// Writing the trace out frees the chunks that the owning thread has moved on
+// from, and the number of chunks across all threads is capped so leaving
+// tracing on doesn't use more and more memory.  Events recorded while the
+// cap is reached are dropped.  When a thread exits its buffer is handed over
+// to the writer, which frees it along with its last chunk once the events in
+// it have been written out.
+const int kEventsPerChunk = 1024;
+const int kMaxChunks = 1024;  // About 40MB.
+
+struct Event {
+  const char* name;
+  const char* category;
+  qint64 timestamp_ns;
+  qint64 value;  // Duration for spans, the value for counters, id for flows.
+  char phase;
+};
+
+struct Chunk {
+  Chunk() : count(0), next(nullptr) {}
+
+  Event events[kEventsPerChunk];
+  QAtomicInt count;
+  QAtomicPointer<Chunk> next;
+};
+
+QAtomicInt sChunkCount(0);
+
+struct ThreadBuffer {
+  ThreadBuffer(int _tid, const QString& _name)
+      : tid(_tid),
+        name(_name),
+        first(new Chunk),
+        read(0),
+        exited(false),
+        current(first),
+        dropped(0) {
+    sChunkCount.ref();
+  }
+
+  const int tid;
+  const QString name;
+
+  // Only used with sRegistryMutex held.  read is the number of events in the
+  // first chunk that were already written, and exited is set when the owning
+  // thread has finished and won't record anything else.
+  Chunk* first;
+  int read;
+  bool exited;
+
+  // Only used by the owning thread.
+  Chunk* current;
+
+  QAtomicInt dropped;
+};
+
+QAtomicInt sEnabled(0);
+QElapsedTimer sClock;
+
+// Only locked when a thread records its first event and when the trace is
+// written out.
+QMutex sRegistryMutex;
+QList<ThreadBuffer*> sBuffers;
+int sNextTid = 1;
+
+TRACING_THREAD_LOCAL ThreadBuffer* tBuffer = nullptr;
+
+void DeleteBuffer(ThreadBuffer* buffer) {
+  sBuffers.removeOne(buffer);
+  delete buffer->first;
+  sChunkCount.deref();
+  delete buffer;
+}
+
+// Called on a thread when it finishes.  If everything it recorded has been
+// written out already its buffer is freed straight away, otherwise the writer
+// frees it next time.
+void ReleaseThread(ThreadBuffer* buffer) {
+  if (tBuffer == buffer) {
+    tBuffer = nullptr;
+  }
+
+  QMutexLocker l(&sRegistryMutex);
+  Chunk* chunk = buffer->first;
+  if (!chunk->next.fetchAndAddAcquire(0) &&
+      chunk->count.fetchAndAddAcquire(0) == buffer->read &&
+      buffer->dropped.fetchAndAddRelaxed(0) == 0) {
+    DeleteBuffer(buffer);
+  } else {
+    buffer->exited = true;
+  }
+}
+
+// QThreadStorage deletes this when the thread it was set on finishes, which
+// __thread variables can't do.
+struct ThreadExitHook {
+  explicit ThreadExitHook(ThreadBuffer* _buffer) : buffer(_buffer) {}
+  ~ThreadExitHook() { ReleaseThread(buffer); }
+
+  ThreadBuffer* const buffer;
+};
+
+Q_GLOBAL_STATIC(QThreadStorage<ThreadExitHook*>, sExitHooks)
+
+ThreadBuffer* RegisterThread() {
+  QThread* thread = QThread::currentThread();
+  QString name = thread ? thread->objectName() : QString();
+  if (name.isEmpty() && QCoreApplication::instance() &&
+      thread == QCoreApplication::instance()->thread()) {
+    name = "Main thread";
+  }
+
+  ThreadBuffer* buffer = nullptr;
+  {
+    QMutexLocker l(&sRegistryMutex);
+    buffer = new ThreadBuffer(sNextTid++, name);
+    sBuffers << buffer;
+  }
+
+  QThreadStorage<ThreadExitHook*>* exit_hooks = sExitHooks();
+  if (exit_hooks) {
+    exit_hooks->setLocalData(new ThreadExitHook(buffer));
+  }
+  return buffer;
+}
+
+void Record(const char* name, const char* category, char phase,
+            qint64 timestamp_ns, qint64 value) {
+  ThreadBuffer* buffer = tBuffer;
+  if (!buffer) {
+    buffer = tBuffer = RegisterThread();
+  }
+
+  Chunk* chunk = buffer->current;
+  int count = chunk->count;
+  if (count == kEventsPerChunk) {
+    if (sChunkCount.fetchAndAddRelaxed(1) >= kMaxChunks) {
+      sChunkCount.deref();
+      buffer->dropped.ref();
+      return;
+    }
+
+    Chunk* next = new Chunk;
+    chunk->next.fetchAndStoreRelease(next);
+    buffer->current = chunk = next;
+    count = 0;
+  }
+
+  Event* event = &chunk->events[count];
+  event->name = name;
+  event->category = category ? category : kDefaultCategory;
+  event->timestamp_ns = timestamp_ns;
+  event->value = value;
+  event->phase = phase;
+
+  chunk->count.fetchAndStoreRelease(count + 1);
+}
+
+inline bool Enabled() { return sEnabled; }
+
+inline qint64 Now() { return sClock.nsecsElapsed(); }
+
+void AppendString(const char* str, QByteArray* out) {
+  out->append('"');
+  for (const char* p = str; *p; ++p) {
+    switch (*p) {
+      case '"':  out->append("\\\""); break;
+      case '\\': out->append("\\\\"); break;
+      case '\n': out->append("\\n"); break;
+      case '\t': out->append("\\t"); break;
+      default:
+        if (uchar(*p) < 0x20) {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", uchar(*p));
+          out->append(escaped);
+        } else {
+          out->append(*p);
+        }
+        break;
+    }
+  }
+  out->append('"');
+}
+
+QByteArray Microseconds(qint64 ns) {
+  return QByteArray::number(double(ns) / 1000.0, 'f', 3);
+}
+
+void AppendEvent(const Event& event, const QByteArray& pid_tid,
+                 QByteArray* out) {
+  out->append(",\n{\"name\":");
+  AppendString(event.name, out);
+  out->append(",\"cat\":");
+  AppendString(event.category, out);
+  out->append(",\"ph\":\"");
+  out->append(event.phase);
+  out->append("\",\"ts\":");
+  out->append(Microseconds(event.timestamp_ns));
+  out->append(pid_tid);
+
+  switch (event.phase) {
+    case 'X':
+      out->append(",\"dur\":");
+      out->append(Microseconds(event.value));
+      break;
+    case 'C':
+      out->append(",\"args\":{\"value\":");
+      out->append(QByteArray::number(event.value));
+      out->append('}');
+      break;
+    case 'f':
+      // Bind to the enclosing span rather than the next one to start.
+      out->append(",\"bp\":\"e\"");
+      // fallthrough
+    case 's':
+      out->append(",\"id\":");
+      out->append(QByteArray::number(event.value));
+      break;
+  }
+
+  out->append('}');
+}
+
+}  // namespace
+
+void SetEnabled(bool enabled) {
+  if (enabled) {
+    QMutexLocker l(&sRegistryMutex);
+    if (!sClock.isValid()) {
+      sClock.start();
+    }
+  }
+
+  sEnabled.fetchAndStoreOrdered(enabled ? 1 : 0);
+}
+
+bool IsEnabled() { return Enabled(); }
+
+QByteArray ChromeTraceJson() {
+  const QByteArray pid =
+      QByteArray::number(QCoreApplication::applicationPid());
+
+  QByteArray ret = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  ret.append("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + pid +
+             ",\"args\":{\"name\":");
+  AppendString(QCoreApplication::applicationName().toUtf8().constData(), &ret);
+  ret.append("}}");
+
+  QMutexLocker l(&sRegistryMutex);
+  for (ThreadBuffer* buffer : QList<ThreadBuffer*>(sBuffers)) {
+    const QByteArray pid_tid =
+        ",\"pid\":" + pid + ",\"tid\":" + QByteArray::number(buffer->tid);
+
+    if (!buffer->name.isEmpty()) {
+      ret.append(",\n{\"name\":\"thread_name\",\"ph\":\"M\"" + pid_tid +
+                 ",\"args\":{\"name\":");
+      AppendString(buffer->name.toUtf8().constData(), &ret);
+      ret.append("}}");
+    }
+
+    forever {
+      // Once a chunk has a next one the owning thread won't touch it again,
+      // so it's full and can be freed after it's written out.
+      Chunk* chunk = buffer->first;
+      Chunk* next = chunk->next.fetchAndAddAcquire(0);
+      const int count = chunk->count.fetchAndAddAcquire(0);
+      for (int i = buffer->read; i < count; ++i) {
+        AppendEvent(chunk->events[i], pid_tid, &ret);
+      }
+
+      if (!next) {
+        buffer->read = count;
+        break;
+      }
+
+      buffer->first = next;
+      buffer->read = 0;
+      delete chunk;
+      sChunkCount.deref();
+    }
+
+    const int dropped = buffer->dropped.fetchAndStoreRelaxed(0);
+    if (dropped) {
+      qLog(Warning) << "Thread" << buffer->tid << "dropped" << dropped
+                    << "trace events because the trace buffers were full";
+    }
+
+    if (buffer->exited) {
+      DeleteBuffer(buffer);
+    }
+  }
+
+  ret.append("\n]}\n");
+  return ret;
+}
+
+bool WriteChromeTrace(const QString& filename) {
+  QFile file(filename);
+  if (!file.open(QIODevice::WriteOnly)) {
+    qLog(Error) << "Failed to open trace file" << filename << "for writing:"
+                << file.errorString();
+    return false;
+  }
+
+  if (file.write(ChromeTraceJson()) == -1) {
+    qLog(Error) << "Failed to write trace file" << filename << ":"
+                << file.errorString();
+    return false;
+  }
+
+  qLog(Info) << "Wrote trace to" << filename;
+  return true;
+}
+
+ScopedSpan::ScopedSpan(const char* name, const char* category)
+    : name_(name), category_(category), start_ns_(Enabled() ? Now() : -1) {}
+
+ScopedSpan::~ScopedSpan() {
+  if (start_ns_ != -1) {
+    Record(name_, category_, 'X', start_ns_, Now() - start_ns_);
+  }
+}
+
+void Counter(const char* name, qint64 value) {
+  if (Enabled()) {
+    Record(name, nullptr, 'C', Now(), value);
+  }
+}
+
+void FlowBegin(const char* name, quint64 id) {
+  if (Enabled()) {
+    Record(name, nullptr, 's', Now(), qint64(id));
+  }
+}
+
+void FlowEnd(const char* name, quint64 id) {
+  if (Enabled()) {
+    Record(name, nullptr, 'f', Now(), qint64(id));
+  }
+}
+
+}  // namespace tracing
@@ -0,0 +1,104 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// Note: this file is licensed under the Apache License instead of GPL because
+// it is used by the Spotify blob which links against libspotify and is not GPL
+// compatible.
+
+#ifndef CORE_TRACING_H_
+#define CORE_TRACING_H_
+
+#include <QByteArray>
+#include <QString>
+
+// Lightweight tracing of hot code paths.  Events are recorded into per-thread
+// buffers that don't take any locks, and can be written out in the Chrome
+// trace event format to be viewed in chrome://tracing or Perfetto.
+//
+// Recording is off until tracing::SetEnabled(true) is called, and costs a
+// single atomic load per event while it's off.  Building with
+// -DCLEMENTINE_NO_TRACING (the ENABLE_TRACING cmake option) compiles all the
+// TRACE_* macros away entirely.
+//
+// Names and categories must be string literals (or otherwise outlive the
+// trace) - only the pointers are stored.
+//
+//   void LibraryWatcher::ScanSubdirectory(...) {
+//     TRACE_SPAN("LibraryWatcher::ScanSubdirectory");
+//     ...
+//     TRACE_COUNTER("LibraryWatcher new songs", new_songs.count());
+//   }
+
+namespace tracing {
+
+void SetEnabled(bool enabled);
+bool IsEnabled();
+
+// Returns everything recorded since the last call as Chrome trace event JSON.
+// The events that were returned are removed from the buffers.
+QByteArray ChromeTraceJson();
+
+// Writes ChromeTraceJson() to a file.  Returns false on error.
+bool WriteChromeTrace(const QString& filename);
+
+// Records a complete ("X") event covering the lifetime of this object.
+class ScopedSpan {
+ public:
+  explicit ScopedSpan(const char* name, const char* category = nullptr);
+  ~ScopedSpan();
+
+ private:
+  Q_DISABLE_COPY(ScopedSpan)
+
+  const char* name_;
+  const char* category_;
+  qint64 start_ns_;
+};
+
+// Records the current value of a counter ("C" event).
+void Counter(const char* name, qint64 value);
+
+// Flow events connect the enclosing spans of two (possibly different) threads
+// with an arrow.  The begin and end must use the same name and id.
+void FlowBegin(const char* name, quint64 id);
+void FlowEnd(const char* name, quint64 id);
+
+}  // namespace tracing
+
+#ifdef CLEMENTINE_NO_TRACING
+
+#define TRACE_SPAN(name) (void)0
+#define TRACE_SPAN_CATEGORY(name, category) (void)0
+#define TRACE_COUNTER(name, value) (void)0
+#define TRACE_FLOW_BEGIN(name, id) (void)0
+#define TRACE_FLOW_END(name, id) (void)0
+
+#else  // CLEMENTINE_NO_TRACING
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#define TRACE_SPAN(name) \
+  tracing::ScopedSpan TRACE_CONCAT(trace_span_, __LINE__)(name)
+#define TRACE_SPAN_CATEGORY(name, category) \
+  tracing::ScopedSpan TRACE_CONCAT(trace_span_, __LINE__)(name, category)
+#define TRACE_COUNTER(name, value) tracing::Counter(name, value)
+#define TRACE_FLOW_BEGIN(name, id) tracing::FlowBegin(name, id)
+#define TRACE_FLOW_END(name, id) tracing::FlowEnd(name, id)
+
+#endif  // CLEMENTINE_NO_TRACING
+
+#endif  // CORE_TRACING_H_
@@ -0,0 +1,112 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "embeddedartcache.h"
+
+#include <QBuffer>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+#include "tagreader.h"
+
+namespace {
+
+// Returns the file's modification time as precisely as the platform records
+// it, so a file that is rewritten within the same second gets a new key.
+qint64 ModificationTimeNsec(const QString& filename) {
+#if defined(Q_OS_DARWIN)
+  struct stat info;
+  if (stat(QFile::encodeName(filename).constData(), &info) != 0) return 0;
+  return qint64(info.st_mtimespec.tv_sec) * 1000000000 +
+         info.st_mtimespec.tv_nsec;
+#elif defined(Q_OS_UNIX)
+  struct stat info;
+  if (stat(QFile::encodeName(filename).constData(), &info) != 0) return 0;
+  return qint64(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#else
+  return QFileInfo(filename).lastModified().toMSecsSinceEpoch() * 1000000;
+#endif
+}
+
+}  // namespace
+
+const int EmbeddedArtCache::kArtDataBudget = 32 * 1024 * 1024;
+const int EmbeddedArtCache::kScaledArtBudget = 16 * 1024 * 1024;
+
+EmbeddedArtCache::EmbeddedArtCache(const TagReader* tag_reader,
+                                   int worker_count)
+    : tag_reader_(tag_reader),
+      art_data_cache_(kArtDataBudget / qMax(1, worker_count)),
+      scaled_art_cache_(kScaledArtBudget / qMax(1, worker_count)) {}
+
+QString EmbeddedArtCache::Key(const QString& filename) {
+  return QString::number(ModificationTimeNsec(filename)) + ":" +
+         QString::number(QFileInfo(filename).size()) + ":" + filename;
+}
+
+QByteArray EmbeddedArtCache::Data(const QString& filename) {
+  return CachedData(filename, Key(filename));
+}
+
+QByteArray EmbeddedArtCache::CachedData(const QString& filename,
+                                        const QString& key) {
+  if (QByteArray* data = art_data_cache_.object(key)) {
+    return *data;
+  }
+
+  const QByteArray data = LoadArt(filename);
+  art_data_cache_.insert(key, new QByteArray(data), qMax(1, data.size()));
+  return data;
+}
+
+QImage EmbeddedArtCache::ScaledImage(const QString& filename, int max_size) {
+  const QString key = Key(filename);
+  const QString scaled_key = QString::number(max_size) + ":" + key;
+
+  if (QImage* image = scaled_art_cache_.object(scaled_key)) {
+    return *image;
+  }
+
+  QByteArray data = CachedData(filename, key);
+  QBuffer buffer(&data);
+  buffer.open(QIODevice::ReadOnly);
+  QImageReader reader(&buffer);
+
+  // Let the decoder do the scaling - for JPEGs this skips most of the work.
+  const QSize size = reader.size();
+  const QSize desired(max_size, max_size);
+  if (size.isValid() &&
+      (size.width() > desired.width() || size.height() > desired.height())) {
+    reader.setScaledSize(size.scaled(desired, Qt::KeepAspectRatio));
+  }
+
+  const QImage image = reader.read().convertToFormat(QImage::Format_ARGB32);
+  scaled_art_cache_.insert(scaled_key, new QImage(image),
+                           qMax(1, image.byteCount()));
+  return image;
+}
+
+QByteArray EmbeddedArtCache::LoadArt(const QString& filename) {
+  return tag_reader_->LoadEmbeddedArt(filename);
+}
@@ -0,0 +1,67 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef EMBEDDEDARTCACHE_H
+#define EMBEDDEDARTCACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QImage>
+#include <QString>
+
+class TagReader;
+
+// Caches the embedded album art a tagreader worker has read, both as it was
+// stored in the file and decoded at the sizes that were asked for.  Entries
+// are keyed by filename, modification time and size, so they are dropped when
+// the file changes.  Songs without any art are cached too so we don't keep
+// opening them.
+class EmbeddedArtCache {
+ public:
+  // How many bytes the caches of all the workers may use between them.
+  static const int kArtDataBudget;
+  static const int kScaledArtBudget;
+
+  // Each of the worker_count workers gets an equal share of the budgets.
+  EmbeddedArtCache(const TagReader* tag_reader, int worker_count);
+  virtual ~EmbeddedArtCache() {}
+
+  // Returns the art as it is stored in the file.
+  QByteArray Data(const QString& filename);
+
+  // Returns the art decoded and scaled down to fit in max_size x max_size.
+  QImage ScaledImage(const QString& filename, int max_size);
+
+  int art_data_cache_size() const { return art_data_cache_.maxCost(); }
+  int scaled_art_cache_size() const { return scaled_art_cache_.maxCost(); }
+
+ protected:
+  virtual QByteArray LoadArt(const QString& filename);
+
+ private:
+  static QString Key(const QString& filename);
+  QByteArray CachedData(const QString& filename, const QString& key);
+
+  const TagReader* tag_reader_;
+
+  // Costs are in bytes.
+  QCache<QString, QByteArray> art_data_cache_;
+  QCache<QString, QImage> scaled_art_cache_;
+};
+
+#endif  // EMBEDDEDARTCACHE_H
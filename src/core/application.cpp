@@ -44,6 +44,7 @@
 #include "internet/podcasts/podcastdeleter.h"
 #include "internet/podcasts/podcastdownloader.h"
 #include "internet/podcasts/podcastupdater.h"
+#include "transcoder/transcodecache.h"
 
 #ifdef HAVE_LIBLASTFM
 #include "internet/lastfm/lastfmservice.h"
@@ -51,13 +52,16 @@
 
 #ifdef HAVE_MOODBAR
 #include "moodbar/moodbarcontroller.h"
+#include "moodbar/moodbarimagecache.h"
 #include "moodbar/moodbarloader.h"
 #endif
 
 bool Application::kIsPortable = false;
 
-Application::Application(QObject* parent)
+Application::Application(QObject* parent, Mode mode,
+                         const QString& database_file)
     : QObject(parent),
+      mode_(mode),
       tag_reader_client_(nullptr),
       database_(nullptr),
       album_cover_loader_(nullptr),
@@ -79,16 +83,28 @@ Application::Application(QObject* parent)
       gpodder_sync_(nullptr),
       moodbar_loader_(nullptr),
       moodbar_controller_(nullptr),
+      moodbar_image_cache_(nullptr),
       network_remote_(nullptr),
       network_remote_helper_(nullptr),
-      scrobbler_(nullptr) {
+      scrobbler_(nullptr),
+      transcode_cache_(nullptr) {
   tag_reader_client_ = new TagReaderClient(this);
   MoveToNewThread(tag_reader_client_);
   tag_reader_client_->Start();
 
-  database_ = new Database(this, this);
+  database_ = new Database(this, this, database_file);
   MoveToNewThread(database_);
 
+  if (mode_ == Mode_Headless) {
+    task_manager_ = new TaskManager(this);
+    library_ = new Library(this, this);
+#ifdef HAVE_MOODBAR
+    moodbar_loader_ = new MoodbarLoader(this, this);
+#endif
+    library_->Init();
+    return;
+  }
+
   album_cover_loader_ = new AlbumCoverLoader(this);
   MoveToNewThread(album_cover_loader_);
 
@@ -119,8 +135,13 @@ Application::Application(QObject* parent)
 #ifdef HAVE_MOODBAR
   moodbar_loader_ = new MoodbarLoader(this, this);
   moodbar_controller_ = new MoodbarController(this, this);
+  moodbar_image_cache_ = new MoodbarImageCache(this, this);
+  connect(moodbar_loader_, SIGNAL(MoodbarGenerated(QUrl)),
+          moodbar_image_cache_, SLOT(MoodbarGenerated(QUrl)));
 #endif
 
+  transcode_cache_ = new TranscodeCache(this);
+
   // Network Remote
   network_remote_ = new NetworkRemote(this);
   MoveToNewThread(network_remote_);
@@ -142,6 +163,9 @@ Application::Application(QObject* parent)
 }
 
 Application::~Application() {
+  // The tagreader and the database need to be running for this.
+  if (library_) library_->WritePendingStatisticsToFiles();
+
   // It's important that the device manager is deleted before the database.
   // Deleting the database deletes all objects that have been created in its
   // thread, including some device library backends.
@@ -39,6 +39,7 @@ class Library;
 class LibraryBackend;
 class LibraryModel;
 class MoodbarController;
+class MoodbarImageCache;
 class MoodbarLoader;
 class NetworkRemote;
 class NetworkRemoteHelper;
@@ -52,6 +53,7 @@ class PodcastUpdater;
 class Scrobbler;
 class TagReaderClient;
 class TaskManager;
+class TranscodeCache;
 
 class Application : public QObject {
   Q_OBJECT
@@ -59,9 +61,23 @@ class Application : public QObject {
  public:
   static bool kIsPortable;
 
-  explicit Application(QObject* parent = nullptr);
+  enum Mode {
+    Mode_Gui,
+
+    // Only creates what's needed to build and analyse a library without a
+    // QApplication: the tagreader workers, the database, the task manager, the
+    // library and the moodbar loader.  Everything else is null.
+    Mode_Headless,
+  };
+
+  // If database_file is empty the usual database in the config directory is
+  // used.
+  explicit Application(QObject* parent = nullptr, Mode mode = Mode_Gui,
+                       const QString& database_file = QString());
   ~Application();
 
+  bool is_headless() const { return mode_ == Mode_Headless; }
+
   const QString& language_name() const { return language_name_; }
   // Same as language_name, but remove the region code at the end if there is
   // one
@@ -89,11 +105,15 @@ class Application : public QObject {
   GPodderSync* gpodder_sync() const { return gpodder_sync_; }
   MoodbarLoader* moodbar_loader() const { return moodbar_loader_; }
   MoodbarController* moodbar_controller() const { return moodbar_controller_; }
+  MoodbarImageCache* moodbar_image_cache() const {
+    return moodbar_image_cache_;
+  }
   NetworkRemote* network_remote() const { return network_remote_; }
   NetworkRemoteHelper* network_remote_helper() const {
     return network_remote_helper_;
   }
   Scrobbler* scrobbler() const { return scrobbler_; }
+  TranscodeCache* transcode_cache() const { return transcode_cache_; }
 
   LibraryBackend* library_backend() const;
   LibraryModel* library_model() const;
@@ -112,6 +132,7 @@ class Application : public QObject {
   void SettingsDialogRequested(SettingsDialog::Page page);
 
  private:
+  Mode mode_;
   QString language_name_;
 
   TagReaderClient* tag_reader_client_;
@@ -135,9 +156,11 @@ class Application : public QObject {
   GPodderSync* gpodder_sync_;
   MoodbarLoader* moodbar_loader_;
   MoodbarController* moodbar_controller_;
+  MoodbarImageCache* moodbar_image_cache_;
   NetworkRemote* network_remote_;
   NetworkRemoteHelper* network_remote_helper_;
   Scrobbler* scrobbler_;
+  TranscodeCache* transcode_cache_;
 
   QList<QObject*> objects_in_threads_;
   QList<QThread*> threads_;
@@ -65,7 +65,14 @@ const char* CommandlineOptions::kHelpText =
     "      --quiet               %27\n"
     "      --verbose             %28\n"
     "      --log-levels <levels> %29\n"
-    "      --version             %30\n";
+    "      --trace <file>        %30\n"
+    "      --version             %31\n"
+    "\n"
+    "%32:\n"
+    "      --scan <directory>    %33\n"
+    "      --db <file>           %34\n"
+    "      --precompute-moodbars %35\n"
+    "      --export-stats <file> %36\n";
 
 const char* CommandlineOptions::kVersionText = "Clementine %1";
 
@@ -81,7 +88,8 @@ CommandlineOptions::CommandlineOptions(int argc, char** argv)
       play_track_at_(-1),
       show_osd_(false),
       toggle_pretty_osd_(false),
-      log_levels_(logging::kDefaultLogLevels) {
+      log_levels_(logging::kDefaultLogLevels),
+      precompute_moodbars_(false) {
 #ifdef Q_OS_DARWIN
   // Remove -psn_xxx option that Mac passes when opened from Finder.
   RemoveArg("-psn", 1);
@@ -130,7 +138,12 @@ bool CommandlineOptions::Parse() {
       {"quiet", no_argument, 0, Quiet},
       {"verbose", no_argument, 0, Verbose},
       {"log-levels", required_argument, 0, LogLevels},
+      {"trace", required_argument, 0, Trace},
       {"version", no_argument, 0, Version},
+      {"scan", required_argument, 0, Scan},
+      {"db", required_argument, 0, DatabaseFile},
+      {"precompute-moodbars", no_argument, 0, PrecomputeMoodbars},
+      {"export-stats", required_argument, 0, ExportStats},
       {0, 0, 0, 0}};
 
   // Parse the arguments
@@ -173,7 +186,17 @@ bool CommandlineOptions::Parse() {
                      tr("Equivalent to --log-levels *:1"),
                      tr("Equivalent to --log-levels *:3"),
                      tr("Comma separated list of class:level, level is 0-3"))
-                .arg(tr("Print out version information"));
+                .arg(tr("Record a performance trace and write it to <file> "
+                        "on exit"),
+                     tr("Print out version information"),
+                     tr("Headless options"),
+                     tr("Add <directory> to the library and scan it without "
+                        "starting the GUI (can be repeated)"),
+                     tr("Use <file> as the library database"),
+                     tr("Generate moodbar data for every song in the "
+                        "library"))
+                .arg(tr("Write library statistics and timings as JSON to "
+                        "<file>, or - for standard output"));
 
         std::cout << translated_help_text.toLocal8Bit().constData();
         return false;
@@ -227,6 +250,21 @@ bool CommandlineOptions::Parse() {
       case LogLevels:
         log_levels_ = QString(optarg);
         break;
+      case Trace:
+        trace_file_ = QFile::decodeName(optarg);
+        break;
+      case Scan:
+        scan_directories_ << QFile::decodeName(optarg);
+        break;
+      case DatabaseFile:
+        database_file_ = QFile::decodeName(optarg);
+        break;
+      case PrecomputeMoodbars:
+        precompute_moodbars_ = true;
+        break;
+      case ExportStats:
+        export_stats_file_ = QFile::decodeName(optarg);
+        break;
       case Version: {
         QString version_text =
             QString(kVersionText).arg(CLEMENTINE_VERSION_DISPLAY);
@@ -293,6 +331,11 @@ bool CommandlineOptions::is_empty() const {
          toggle_pretty_osd_ == false && urls_.isEmpty();
 }
 
+bool CommandlineOptions::is_headless() const {
+  return !scan_directories_.isEmpty() || !database_file_.isEmpty() ||
+         precompute_moodbars_ || !export_stats_file_.isEmpty();
+}
+
 QByteArray CommandlineOptions::Serialize() const {
   QBuffer buf;
   buf.open(QIODevice::WriteOnly);
@@ -25,6 +25,7 @@
 #define CORE_COMMANDLINEOPTIONS_H_
 
 #include <QList>
+#include <QStringList>
 #include <QUrl>
 #include <QDataStream>
 
@@ -60,6 +61,10 @@ class CommandlineOptions {
 
   bool is_empty() const;
 
+  // True if any of the batch options were given - Clementine should work on
+  // the library without a GUI and exit when it's done.
+  bool is_headless() const;
+
   UrlListAction url_list_action() const { return url_list_action_; }
   PlayerAction player_action() const { return player_action_; }
   int set_volume() const { return set_volume_; }
@@ -72,6 +77,11 @@ class CommandlineOptions {
   QList<QUrl> urls() const { return urls_; }
   QString language() const { return language_; }
   QString log_levels() const { return log_levels_; }
+  QString trace_file() const { return trace_file_; }
+  QStringList scan_directories() const { return scan_directories_; }
+  QString database_file() const { return database_file_; }
+  bool precompute_moodbars() const { return precompute_moodbars_; }
+  QString export_stats_file() const { return export_stats_file_; }
 
   QByteArray Serialize() const;
   void Load(const QByteArray& serialized);
@@ -90,7 +100,12 @@ class CommandlineOptions {
     Version,
     VolumeIncreaseBy,
     VolumeDecreaseBy,
-    RestartOrPrevious
+    RestartOrPrevious,
+    Trace,
+    Scan,
+    DatabaseFile,
+    PrecomputeMoodbars,
+    ExportStats
   };
 
   QString tr(const char* source_text);
@@ -113,6 +128,13 @@ class CommandlineOptions {
   bool toggle_pretty_osd_;
   QString language_;
   QString log_levels_;
+  // Not serialised - only the instance that was started with it records.
+  QString trace_file_;
+  // Not serialised - headless instances never talk to a running one.
+  QStringList scan_directories_;
+  QString database_file_;
+  bool precompute_moodbars_;
+  QString export_stats_file_;
 
   QList<QUrl> urls_;
 };
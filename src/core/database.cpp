@@ -29,6 +29,7 @@
 #include "utilities.h"
 #include "core/application.h"
 #include "core/logging.h"
+#include "core/preparedstatementcache.h"
 #include "core/taskmanager.h"
 
 #include <boost/scope_exit.hpp>
@@ -47,7 +48,7 @@
 #include <QVariant>
 
 const char* Database::kDatabaseFilename = "clementine.db";
-const int Database::kSchemaVersion = 50;
+const int Database::kSchemaVersion = 54;
 const char* Database::kMagicAllSongsTables = "%allsongstables";
 
 int Database::sNextConnectionId = 1;
@@ -212,6 +213,7 @@ Database::Database(Application* app, QObject* parent,
     : QObject(parent),
       app_(app),
       mutex_(QMutex::Recursive),
+      statement_cache_generation_(0),
       injected_database_name_(database_name),
       query_hash_(0),
       startup_schema_version_(-1) {
@@ -230,6 +232,8 @@ Database::Database(Application* app, QObject* parent,
   Connect();
 }
 
+Database::~Database() { ClearStatementCaches(); }
+
 QSqlDatabase Database::Connect() {
   QMutexLocker l(&connect_mutex_);
 
@@ -348,6 +352,31 @@ void Database::UpdateMainSchema(QSqlDatabase* db) {
   }
 }
 
+PreparedStatementCache* Database::StatementCache(const QSqlDatabase& db) {
+  QMutexLocker l(&statement_caches_mutex_);
+
+  StatementCacheEntry& entry = statement_caches_[db.connectionName()];
+  if (entry.cache_ && entry.generation_ != statement_cache_generation_) {
+    // The connection this cache was made for has been closed since.  We're on
+    // the thread that owns it, so it's safe to delete now.
+    delete entry.cache_;
+    entry.cache_ = nullptr;
+  }
+  if (!entry.cache_) {
+    entry.cache_ = new PreparedStatementCache(db);
+    entry.generation_ = statement_cache_generation_;
+  }
+  return entry.cache_;
+}
+
+void Database::ClearStatementCaches() {
+  QMutexLocker l(&statement_caches_mutex_);
+  for (const StatementCacheEntry& entry : statement_caches_) {
+    delete entry.cache_;
+  }
+  statement_caches_.clear();
+}
+
 void Database::RecreateAttachedDb(const QString& database_name) {
   if (!attached_databases_.contains(database_name)) {
     qLog(Warning) << "Attached database does not exist:" << database_name;
@@ -374,7 +403,12 @@ void Database::RecreateAttachedDb(const QString& database_name) {
 
   // We can't just re-attach the database now because it needs to be done for
   // each thread.  Close all the database connections, so each thread will
-  // re-attach it when they next connect.
+  // re-attach it when they next connect.  Their statement caches belong to
+  // the old connections, so mark them as stale.
+  {
+    QMutexLocker l(&statement_caches_mutex_);
+    statement_cache_generation_++;
+  }
   for (const QString& name : QSqlDatabase::connectionNames()) {
     QSqlDatabase::removeDatabase(name);
   }
@@ -690,3 +724,39 @@ void Database::BackupFile(const QString& filename) {
 
   sqlite3_backup_finish(backup);
 }
+
+DatabaseInterrupter::DatabaseInterrupter()
+    : handle_(nullptr), interrupted_(false) {}
+
+void DatabaseInterrupter::Attach(QSqlDatabase db) {
+  QVariant v = db.driver()->handle();
+  if (!v.isValid() || qstrcmp(v.typeName(), "sqlite3*") != 0) {
+    qLog(Warning) << "Can't interrupt queries on a" << v.typeName()
+                  << "connection";
+    return;
+  }
+
+  QMutexLocker l(&mutex_);
+  handle_ = *static_cast<sqlite3**>(v.data());
+  if (interrupted_) {
+    sqlite3_interrupt(handle_);
+  }
+}
+
+void DatabaseInterrupter::Detach() {
+  QMutexLocker l(&mutex_);
+  handle_ = nullptr;
+}
+
+void DatabaseInterrupter::Interrupt() {
+  QMutexLocker l(&mutex_);
+  interrupted_ = true;
+  if (handle_) {
+    sqlite3_interrupt(handle_);
+  }
+}
+
+bool DatabaseInterrupter::is_interrupted() const {
+  QMutexLocker l(&mutex_);
+  return interrupted_;
+}
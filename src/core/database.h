@@ -42,6 +42,7 @@ struct sqlite3_tokenizer_module;
 }
 
 class Application;
+class PreparedStatementCache;
 
 class Database : public QObject {
   Q_OBJECT
@@ -49,6 +50,7 @@ class Database : public QObject {
  public:
   Database(Application* app, QObject* parent = nullptr,
            const QString& database_name = QString());
+  ~Database();
 
   struct AttachedDatabase {
     AttachedDatabase() {}
@@ -69,6 +71,10 @@ class Database : public QObject {
   bool CheckErrors(const QSqlQuery& query);
   QMutex* Mutex() { return &mutex_; }
 
+  // Returns the prepared statement cache for a connection returned by
+  // Connect().  Use it with CachedQuery for statements that are run often.
+  PreparedStatementCache* StatementCache(const QSqlDatabase& db);
+
   void RecreateAttachedDb(const QString& database_name);
   void ExecSchemaCommands(QSqlDatabase& db, const QString& schema,
                           int schema_version, bool in_transaction = false);
@@ -83,6 +89,11 @@ class Database : public QObject {
                                     QSqlDatabase& db);
   void DetachDatabase(const QString& database_name);
 
+ protected:
+  // Deletes the caches of every thread, so it must only be called when no
+  // other thread is using the database any more.
+  void ClearStatementCaches();
+
  signals:
   void Error(const QString& message);
 
@@ -114,6 +125,20 @@ class Database : public QObject {
   QMutex connect_mutex_;
   QMutex mutex_;
 
+  // Connection name -> cache.  A cache can only be deleted by the thread that
+  // owns its connection, so when the connections are closed the generation is
+  // bumped instead and each thread replaces its stale cache the next time it
+  // asks for it.
+  struct StatementCacheEntry {
+    StatementCacheEntry() : cache_(nullptr), generation_(0) {}
+
+    PreparedStatementCache* cache_;
+    int generation_;
+  };
+  QMutex statement_caches_mutex_;
+  QMap<QString, StatementCacheEntry> statement_caches_;
+  int statement_cache_generation_;
+
   // This ID makes the QSqlDatabase name unique to the object as well as the
   // thread
   int connection_id_;
@@ -178,12 +203,36 @@ class Database : public QObject {
   };
 };
 
+// Lets a statement that is running on one thread's connection be aborted from
+// another thread.  The thread running the query calls Attach() with its
+// connection before executing it and Detach() once it has finished reading the
+// results.  Interrupt() can be called from any thread at any time - the
+// running statement then fails with SQLITE_INTERRUPT.
+class DatabaseInterrupter {
+ public:
+  DatabaseInterrupter();
+
+  void Attach(QSqlDatabase db);
+  void Detach();
+
+  void Interrupt();
+  bool is_interrupted() const;
+
+ private:
+  Q_DISABLE_COPY(DatabaseInterrupter)
+
+  mutable QMutex mutex_;
+  sqlite3* handle_;
+  bool interrupted_;
+};
+
 class MemoryDatabase : public Database {
  public:
   explicit MemoryDatabase(Application* app, QObject* parent = nullptr)
       : Database(app, parent, ":memory:") {}
   ~MemoryDatabase() {
     // Make sure Qt doesn't reuse the same database
+    ClearStatementCaches();
     QSqlDatabase::removeDatabase(Connect().connectionName());
   }
 };
@@ -0,0 +1,131 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "fileexistencechecker.h"
+
+#include <functional>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QMap>
+#include <QSet>
+#include <QThreadPool>
+
+#include "core/closure.h"
+#include "core/concurrentrun.h"
+
+const int FileExistenceChecker::kMaxConcurrentDirectories = 8;
+const int FileExistenceChecker::kMinFilesForListing = 4;
+
+FileExistenceChecker::FileExistenceChecker(QObject* parent)
+    : QObject(parent), pending_directories_(0) {}
+
+FileExistenceChecker* FileExistenceChecker::Check(const QStringList& filenames,
+                                                  QObject* parent) {
+  FileExistenceChecker* ret = new FileExistenceChecker(parent);
+  ret->Start(filenames);
+  return ret;
+}
+
+QThreadPool* FileExistenceChecker::ThreadPool() {
+  // Shared by every checker so that checking lots of playlists at once still
+  // only keeps a bounded number of requests in flight to the filesystem.
+  static QThreadPool* pool = nullptr;
+  if (!pool) {
+    pool = new QThreadPool;
+    pool->setMaxThreadCount(kMaxConcurrentDirectories);
+  }
+  return pool;
+}
+
+void FileExistenceChecker::Start(const QStringList& filenames) {
+  QMap<QString, QStringList> files_by_directory;
+  for (const QString& filename : filenames) {
+    files_by_directory[QFileInfo(filename).path()] << filename;
+  }
+
+  if (files_by_directory.isEmpty()) {
+    // Emit Finished after the caller's had a chance to connect to it
+    QMetaObject::invokeMethod(this, "Finished", Qt::QueuedConnection);
+    deleteLater();
+    return;
+  }
+
+  pending_directories_ = files_by_directory.count();
+
+  std::function<Result(QString, QStringList)> function(&CheckDirectory);
+  for (auto it = files_by_directory.constBegin();
+       it != files_by_directory.constEnd(); ++it) {
+    QFuture<Result> future =
+        ConcurrentRun::Run<Result, QString, QStringList>(
+            ThreadPool(), function, it.key(), it.value());
+    QFutureWatcher<Result>* watcher = new QFutureWatcher<Result>(this);
+    watcher->setFuture(future);
+    NewClosure(watcher, SIGNAL(finished()), [=]() {
+      DirectoryChecked(future);
+      watcher->deleteLater();
+    });
+  }
+}
+
+FileExistenceChecker::Result FileExistenceChecker::CheckDirectory(
+    const QString& directory, const QStringList& filenames) {
+  Result ret;
+
+  if (filenames.count() < kMinFilesForListing) {
+    for (const QString& filename : filenames) {
+      if (QFile::exists(filename))
+        ret.existing << filename;
+      else
+        ret.missing << filename;
+    }
+    return ret;
+  }
+
+  // Read the directory listing once rather than stat()ing every file.
+  const QDir dir(directory);
+  const QSet<QString> entries = dir.exists()
+      ? dir.entryList(QDir::Files | QDir::Dirs | QDir::Hidden | QDir::System |
+                      QDir::NoDotAndDotDot).toSet()
+      : QSet<QString>();
+
+  for (const QString& filename : filenames) {
+    // The listing can spell a name differently to the playlist - on case
+    // insensitive filesystems, or with NFC and NFD forms of the same name - so
+    // anything that isn't in it gets a stat() before it's reported missing.
+    if (entries.contains(QFileInfo(filename).fileName()) ||
+        QFile::exists(filename))
+      ret.existing << filename;
+    else
+      ret.missing << filename;
+  }
+  return ret;
+}
+
+void FileExistenceChecker::DirectoryChecked(QFuture<Result> future) {
+  const Result result = future.result();
+  pending_directories_--;
+
+  missing_ << result.missing;
+  emit FilesChecked(result.existing, result.missing);
+
+  if (pending_directories_ == 0) {
+    emit Finished();
+    deleteLater();
+  }
+}
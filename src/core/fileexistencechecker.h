@@ -0,0 +1,72 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORE_FILEEXISTENCECHECKER_H_
+#define CORE_FILEEXISTENCECHECKER_H_
+
+#include <QFuture>
+#include <QObject>
+#include <QStringList>
+
+class QThreadPool;
+
+// Checks whether a large number of local files exist, without calling stat()
+// on each one in turn.  Files are grouped by directory, and each directory's
+// listing is read once.  Directories are checked in parallel on a thread pool
+// shared by all checkers, and FilesChecked is emitted for each directory as
+// soon as its results are available.
+class FileExistenceChecker : public QObject {
+  Q_OBJECT
+
+ public:
+  // Starts checking the given files.  The checker deletes itself after it
+  // emits Finished.
+  static FileExistenceChecker* Check(const QStringList& filenames,
+                                     QObject* parent = nullptr);
+
+  static const int kMaxConcurrentDirectories;
+  // Directories that contain fewer files than this are checked with one
+  // stat() per file instead of reading the directory listing.
+  static const int kMinFilesForListing;
+
+  // The files that were found not to exist so far.
+  const QStringList& missing() const { return missing_; }
+
+ signals:
+  void FilesChecked(const QStringList& existing, const QStringList& missing);
+  void Finished();
+
+ private:
+  struct Result {
+    QStringList existing;
+    QStringList missing;
+  };
+
+  FileExistenceChecker(QObject* parent);
+
+  static QThreadPool* ThreadPool();
+  static Result CheckDirectory(const QString& directory,
+                               const QStringList& filenames);
+
+  void Start(const QStringList& filenames);
+  void DirectoryChecked(QFuture<Result> future);
+
+  int pending_directories_;
+  QStringList missing_;
+};
+
+#endif  // CORE_FILEEXISTENCECHECKER_H_
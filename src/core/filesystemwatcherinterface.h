@@ -21,6 +21,7 @@
 #define CORE_FILESYSTEMWATCHERINTERFACE_H_
 
 #include <QObject>
+#include <QStringList>
 
 class FileSystemWatcherInterface : public QObject {
   Q_OBJECT
@@ -30,11 +31,17 @@ class FileSystemWatcherInterface : public QObject {
   virtual void AddPath(const QString& path) = 0;
   virtual void RemovePath(const QString& path) = 0;
   virtual void Clear() = 0;
+  // How long to collect changes for before reporting them.  Only used by
+  // listeners that coalesce events.
+  virtual void SetCoalesceInterval(int /*msec*/) {}
 
   static FileSystemWatcherInterface* Create(QObject* parent = nullptr);
 
  signals:
   void PathChanged(const QString& path);
+  // Emitted by listeners that can tell which files changed, instead of
+  // PathChanged for their directories.
+  void FilesChanged(const QStringList& paths);
 };
 
 #endif  // CORE_FILESYSTEMWATCHERINTERFACE_H_
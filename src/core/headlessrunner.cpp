@@ -0,0 +1,257 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "headlessrunner.h"
+
+#include <iostream>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QSettings>
+#include <QThread>
+
+#include <qjson/serializer.h>
+
+#include "config.h"
+#include "core/application.h"
+#include "core/database.h"
+#include "core/logging.h"
+#include "core/qhash_qurl.h"
+#include "core/utilities.h"
+#include "library/library.h"
+#include "library/librarybackend.h"
+
+#ifdef HAVE_MOODBAR
+#include <gst/gst.h>
+
+#include "gst/moodbar/plugin.h"
+#include "moodbar/moodbarloader.h"
+#include "moodbar/moodbarpipeline.h"
+#endif
+
+const int HeadlessRunner::kMaxPendingMoodbars = 64;
+
+HeadlessRunner::HeadlessRunner(Application* app,
+                               const CommandlineOptions& options,
+                               QObject* parent)
+    : QObject(parent),
+      app_(app),
+      options_(options),
+      moodbars_pending_(0),
+      moodbars_generated_(0),
+      moodbars_existing_(0),
+      moodbars_failed_(0),
+      exit_code_(0) {
+  connect(app_, SIGNAL(ErrorAdded(QString)), SLOT(ErrorAdded(QString)));
+}
+
+void HeadlessRunner::Start() {
+  metaObject()->invokeMethod(this, "Run", Qt::QueuedConnection);
+}
+
+void HeadlessRunner::ErrorAdded(const QString& message) {
+  qLog(Error) << message;
+  errors_ << message;
+  exit_code_ = 1;
+}
+
+void HeadlessRunner::Run() {
+  total_timer_.start();
+
+  LibraryBackend* backend = app_->library_backend();
+  const int songs_before = backend->GetAllSongs().count();
+
+  if (!AddDirectories()) {
+    Finish();
+    return;
+  }
+
+  // This also waits for the incremental scan of directories that were already
+  // in the library.
+  QElapsedTimer scan_timer;
+  scan_timer.start();
+  app_->library()->WaitForScansToFinish();
+  const qint64 scan_msec = scan_timer.elapsed();
+
+  const int songs = backend->GetAllSongs().count();
+  timings_["scan"] = scan_msec;
+  report_["directories"] = backend->GetAllDirectories().count();
+  report_["songs"] = songs;
+  report_["songs_added"] = songs - songs_before;
+  report_["artists"] = backend->GetAllArtists().count();
+  report_["albums"] = backend->GetAllAlbums().count();
+  report_["tagreader_workers"] = QThread::idealThreadCount();
+  if (scan_msec > 0) {
+    report_["songs_per_second"] = (songs - songs_before) * 1000.0 / scan_msec;
+  }
+
+  if (options_.precompute_moodbars()) {
+    StartMoodbars();
+  } else {
+    Finish();
+  }
+}
+
+bool HeadlessRunner::AddDirectories() {
+  LibraryBackend* backend = app_->library_backend();
+
+  QSet<QString> existing;
+  for (const Directory& dir : backend->GetAllDirectories()) {
+    existing << dir.path;
+  }
+
+  for (const QString& path : options_.scan_directories()) {
+    const QFileInfo info(path);
+    if (!info.isDir()) {
+      ErrorAdded(tr("%1 is not a directory").arg(path));
+      return false;
+    }
+
+    // Directories that are already in the library get an incremental scan
+    // when it loads.
+    const QString canonical_path = info.canonicalFilePath();
+    if (!existing.contains(canonical_path)) {
+      qLog(Info) << "Adding" << canonical_path << "to the library";
+      backend->AddDirectory(canonical_path);
+    }
+  }
+
+  return true;
+}
+
+void HeadlessRunner::StartMoodbars() {
+#ifdef HAVE_MOODBAR
+  // There's no Player to set GStreamer up in a headless run.
+  gst_init(nullptr, nullptr);
+  gstfastspectrum_register_static();
+
+  QSettings s;
+  s.beginGroup("Moodbar");
+  if (!s.value("calculate", true).toBool()) {
+    ErrorAdded(tr("Moodbar calculation is disabled in the settings"));
+    Finish();
+    return;
+  }
+
+  // Cue sheets put many songs in one file, but they share a moodbar.
+  QSet<QUrl> seen;
+  for (const Song& song : app_->library_backend()->GetAllSongs()) {
+    if (song.url().scheme() == "file" && !seen.contains(song.url())) {
+      seen << song.url();
+      moodbar_queue_ << song.url();
+    }
+  }
+
+  moodbar_timer_.start();
+  TakeNextMoodbars();
+#else
+  ErrorAdded(tr("Clementine was built without moodbar support"));
+  Finish();
+#endif
+}
+
+void HeadlessRunner::TakeNextMoodbars() {
+#ifdef HAVE_MOODBAR
+  // MoodbarLoader only analyses a few files at a time itself, but creates a
+  // pipeline for everything it's given straight away.  Feed it gradually so
+  // large libraries don't have tens of thousands of those waiting around.
+  while (moodbars_pending_ < kMaxPendingMoodbars && !moodbar_queue_.isEmpty()) {
+    const QUrl url = moodbar_queue_.takeFirst();
+
+    QByteArray data;
+    MoodbarPipeline* pipeline = nullptr;
+    switch (app_->moodbar_loader()->Load(url, &data, &pipeline)) {
+      case MoodbarLoader::CannotLoad:
+        moodbars_failed_++;
+        break;
+
+      case MoodbarLoader::Loaded:
+        moodbars_existing_++;
+        break;
+
+      case MoodbarLoader::WillLoadAsync:
+        moodbars_pending_++;
+        connect(pipeline, SIGNAL(Finished(bool)), SLOT(MoodbarFinished(bool)));
+        break;
+    }
+  }
+
+  if (moodbars_pending_ == 0 && moodbar_queue_.isEmpty()) {
+    timings_["moodbars"] = moodbar_timer_.elapsed();
+
+    QVariantMap moodbars;
+    moodbars["generated"] = moodbars_generated_;
+    moodbars["existing"] = moodbars_existing_;
+    moodbars["failed"] = moodbars_failed_;
+    report_["moodbars"] = moodbars;
+
+    Finish();
+  }
+#endif
+}
+
+void HeadlessRunner::MoodbarFinished(bool success) {
+  moodbars_pending_--;
+  if (success) {
+    moodbars_generated_++;
+  } else {
+    moodbars_failed_++;
+  }
+
+  TakeNextMoodbars();
+}
+
+void HeadlessRunner::Finish() {
+  timings_["total"] = total_timer_.elapsed();
+
+  if (!WriteReport()) {
+    exit_code_ = 1;
+  }
+
+  emit Finished();
+}
+
+bool HeadlessRunner::WriteReport() {
+  QString database = options_.database_file();
+  if (database.isEmpty()) {
+    database = Utilities::GetConfigPath(Utilities::Path_Root) + "/" +
+               Database::kDatabaseFilename;
+  }
+
+  report_["database"] = database;
+  report_["timings_msec"] = timings_;
+  report_["errors"] = errors_;
+
+  QJson::Serializer serializer;
+  const QByteArray json = serializer.serialize(report_);
+
+  const QString filename = options_.export_stats_file();
+  if (filename.isEmpty() || filename == "-") {
+    std::cout << json.constData() << std::endl;
+    return true;
+  }
+
+  QFile file(filename);
+  if (!file.open(QIODevice::WriteOnly) || file.write(json + "\n") == -1) {
+    qLog(Error) << "Failed to write stats to" << filename << ":"
+                << file.errorString();
+    return false;
+  }
+  return true;
+}
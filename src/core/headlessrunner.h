@@ -0,0 +1,87 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CORE_HEADLESSRUNNER_H_
+#define CORE_HEADLESSRUNNER_H_
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+#include <QUrl>
+#include <QVariantMap>
+
+#include "core/commandlineoptions.h"
+
+class Application;
+
+// Runs the batch jobs given on the commandline against a headless Application
+// - scanning directories into the library and generating moodbars - then
+// prints what it did and how long each step took as JSON, so runs can be
+// compared by scripts.
+class HeadlessRunner : public QObject {
+  Q_OBJECT
+
+ public:
+  HeadlessRunner(Application* app, const CommandlineOptions& options,
+                 QObject* parent = nullptr);
+
+  static const int kMaxPendingMoodbars;
+
+  // Starts the jobs once the event loop is running.  Finished() is emitted
+  // when they're all done.
+  void Start();
+
+  int exit_code() const { return exit_code_; }
+
+ signals:
+  void Finished();
+
+ private slots:
+  void Run();
+  void ErrorAdded(const QString& message);
+  void MoodbarFinished(bool success);
+
+ private:
+  bool AddDirectories();
+  void StartMoodbars();
+  void TakeNextMoodbars();
+  void Finish();
+  bool WriteReport();
+
+ private:
+  Application* app_;
+  CommandlineOptions options_;
+
+  QElapsedTimer total_timer_;
+  QElapsedTimer moodbar_timer_;
+
+  QVariantMap report_;
+  QVariantMap timings_;
+  QStringList errors_;
+
+  QList<QUrl> moodbar_queue_;
+  int moodbars_pending_;
+  int moodbars_generated_;
+  int moodbars_existing_;
+  int moodbars_failed_;
+
+  int exit_code_;
+};
+
+#endif  // CORE_HEADLESSRUNNER_H_
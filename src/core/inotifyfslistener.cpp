@@ -0,0 +1,216 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "inotifyfslistener.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <QFile>
+#include <QSocketNotifier>
+#include <QStringList>
+
+#include "core/logging.h"
+
+namespace {
+
+// Directory changes (subdirectories created, deleted or moved) make the
+// library rescan the directory.  Changes to files are reported individually.
+const uint32_t kWatchMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                            IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF |
+                            IN_MOVE_SELF | IN_ONLYDIR;
+
+// Enough for a few hundred events with reasonably long filenames.
+const int kReadBufferSize = 64 * 1024;
+
+}  // namespace
+
+const int InotifyFSListener::kDefaultCoalesceIntervalMsec = 1000;
+
+InotifyFSListener::InotifyFSListener(QObject* parent)
+    : FileSystemWatcherInterface(parent),
+      fd_(-1),
+      notifier_(nullptr),
+      warned_about_watch_limit_(false) {
+  coalesce_timer_.setSingleShot(true);
+  coalesce_timer_.setInterval(kDefaultCoalesceIntervalMsec);
+  connect(&coalesce_timer_, SIGNAL(timeout()), SLOT(EmitChanges()));
+}
+
+InotifyFSListener::~InotifyFSListener() {
+  if (fd_ != -1) close(fd_);
+}
+
+void InotifyFSListener::Init() {
+  fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd_ == -1) {
+    qLog(Error) << "Failed to initialise inotify:" << strerror(errno);
+    return;
+  }
+
+  notifier_ = new QSocketNotifier(fd_, QSocketNotifier::Read, this);
+  connect(notifier_, SIGNAL(activated(int)), SLOT(ReadEvents()));
+}
+
+void InotifyFSListener::SetCoalesceInterval(int msec) {
+  coalesce_timer_.setInterval(msec);
+}
+
+void InotifyFSListener::AddPath(const QString& path) {
+  if (fd_ == -1 || watches_by_path_.contains(path)) return;
+
+  const int wd = inotify_add_watch(fd_, QFile::encodeName(path).constData(),
+                                   kWatchMask);
+  if (wd == -1) {
+    if (errno == ENOSPC) {
+      if (!warned_about_watch_limit_) {
+        qLog(Warning) << "Reached the inotify watch limit, some directories"
+                      << "will not be monitored for changes.  Increase"
+                      << "fs.inotify.max_user_watches to watch more.";
+        warned_about_watch_limit_ = true;
+      }
+    } else {
+      qLog(Warning) << "Failed to watch" << path << strerror(errno);
+    }
+    return;
+  }
+
+  // inotify returns the same descriptor if this inode is already watched
+  // under a different name (e.g. through a symlink).
+  watches_by_path_.remove(paths_by_watch_.value(wd));
+  paths_by_watch_[wd] = path;
+  watches_by_path_[path] = wd;
+}
+
+void InotifyFSListener::RemovePath(const QString& path) {
+  QHash<QString, int>::iterator it = watches_by_path_.find(path);
+  if (it == watches_by_path_.end()) return;
+
+  inotify_rm_watch(fd_, it.value());
+  paths_by_watch_.remove(it.value());
+  watches_by_path_.erase(it);
+}
+
+void InotifyFSListener::Clear() {
+  for (int wd : paths_by_watch_.keys()) {
+    inotify_rm_watch(fd_, wd);
+  }
+  paths_by_watch_.clear();
+  watches_by_path_.clear();
+  changed_paths_.clear();
+  changed_files_.clear();
+  coalesce_timer_.stop();
+}
+
+void InotifyFSListener::ReadEvents() {
+  char buffer[kReadBufferSize]
+      __attribute__((aligned(__alignof__(struct inotify_event))));
+
+  forever {
+    const ssize_t len = read(fd_, buffer, sizeof(buffer));
+    if (len <= 0) break;
+
+    for (char* p = buffer; p < buffer + len;) {
+      const struct inotify_event* event =
+          reinterpret_cast<const struct inotify_event*>(p);
+      p += sizeof(struct inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        // We lost some events, so we don't know what changed any more.
+        qLog(Warning) << "inotify queue overflowed, rescanning everything";
+        for (const QString& path : watches_by_path_.keys()) {
+          PathEvent(path);
+        }
+        continue;
+      }
+
+      const QString dir = paths_by_watch_.value(event->wd);
+      if (dir.isEmpty()) continue;
+
+      if (event->mask & IN_IGNORED) {
+        // The watch was removed, either by us or because the directory was
+        // deleted.
+        paths_by_watch_.remove(event->wd);
+        watches_by_path_.remove(dir);
+        continue;
+      }
+
+      if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+        // A moved directory keeps its watches, so they'd go on reporting
+        // changes under the old path.  The parent gets rescanned and adds
+        // watches for wherever the directory went.
+        RemoveTree(dir);
+        PathEvent(dir);
+        continue;
+      }
+
+      if (event->len == 0) continue;
+      const QString path = dir + "/" + QFile::decodeName(event->name);
+
+      if (event->mask & IN_ISDIR) {
+        PathEvent(dir);
+      } else if (event->mask & (IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM |
+                                IN_MOVED_TO)) {
+        // IN_CREATE on its own isn't interesting for files - the file is
+        // reported when it's closed after being written.
+        FileEvent(path);
+      }
+    }
+  }
+}
+
+void InotifyFSListener::RemoveTree(const QString& path) {
+  const QString prefix = path + "/";
+  for (const QString& watched : watches_by_path_.keys()) {
+    if (watched == path || watched.startsWith(prefix)) {
+      RemovePath(watched);
+    }
+  }
+}
+
+void InotifyFSListener::PathEvent(const QString& path) {
+  changed_paths_.insert(path);
+  if (!coalesce_timer_.isActive()) coalesce_timer_.start();
+}
+
+void InotifyFSListener::FileEvent(const QString& path) {
+  changed_files_.insert(path);
+  if (!coalesce_timer_.isActive()) coalesce_timer_.start();
+}
+
+void InotifyFSListener::EmitChanges() {
+  // Files in directories that are going to be rescanned anyway don't need to
+  // be reported.
+  QStringList files;
+  for (const QString& file : changed_files_) {
+    if (!changed_paths_.contains(file.section('/', 0, -2))) files << file;
+  }
+
+  for (const QString& path : changed_paths_) {
+    qLog(Debug) << "Something changed at:" << path;
+    emit PathChanged(path);
+  }
+  if (!files.isEmpty()) {
+    qLog(Debug) << files.count() << "files changed";
+    emit FilesChanged(files);
+  }
+
+  changed_paths_.clear();
+  changed_files_.clear();
+}
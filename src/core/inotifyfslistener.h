@@ -0,0 +1,77 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORE_INOTIFYFSLISTENER_H_
+#define CORE_INOTIFYFSLISTENER_H_
+
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+
+#include "filesystemwatcherinterface.h"
+
+class QSocketNotifier;
+
+// Watches directories with a single inotify file descriptor.  Unlike
+// QFileSystemWatcher this can tell which files in a directory changed, so
+// files that were written or moved are reported through FilesChanged instead
+// of causing a rescan of the whole directory.  Events are coalesced until the
+// coalesce interval has passed since the first one.
+//
+// inotify isn't recursive, so every directory added takes one watch out of
+// the user's fs.inotify.max_user_watches.  Directories added after that runs
+// out aren't monitored - a warning is logged once, and changes in them are
+// only picked up by a full rescan of the library.
+class InotifyFSListener : public FileSystemWatcherInterface {
+  Q_OBJECT
+
+ public:
+  explicit InotifyFSListener(QObject* parent = nullptr);
+  ~InotifyFSListener();
+
+  static const int kDefaultCoalesceIntervalMsec;
+
+  void Init();
+  void AddPath(const QString& path);
+  void RemovePath(const QString& path);
+  void Clear();
+  void SetCoalesceInterval(int msec);
+
+ private slots:
+  void ReadEvents();
+  void EmitChanges();
+
+ private:
+  // Stops watching path and every directory under it.
+  void RemoveTree(const QString& path);
+  void PathEvent(const QString& path);
+  void FileEvent(const QString& path);
+
+  int fd_;
+  QSocketNotifier* notifier_;
+  bool warned_about_watch_limit_;
+
+  // Watch descriptor <-> directory path
+  QHash<int, QString> paths_by_watch_;
+  QHash<QString, int> watches_by_path_;
+
+  QTimer coalesce_timer_;
+  QSet<QString> changed_paths_;
+  QSet<QString> changed_files_;
+};
+
+#endif  // CORE_INOTIFYFSLISTENER_H_
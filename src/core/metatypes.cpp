@@ -22,8 +22,10 @@
 
 #include "metatypes.h"
 
+#include <QMap>
 #include <QMetaType>
 #include <QNetworkCookie>
+#include <QSet>
 
 #include "config.h"
 #include "covers/albumcoverfetcher.h"
@@ -106,6 +108,8 @@ void RegisterMetaTypes() {
   qRegisterMetaType<SubdirectoryList>("SubdirectoryList");
   qRegisterMetaType<Subdirectory>("Subdirectory");
   qRegisterMetaType<QList<QUrl>>("QList<QUrl>");
+  qRegisterMetaType<QMap<QString, QString>>("QMap<QString,QString>");
+  qRegisterMetaType<QSet<QString>>("QSet<QString>");
 
 #ifdef HAVE_VK
   qRegisterMetaType<MusicOwner>("MusicOwner");
@@ -34,6 +34,7 @@
 #include "core/logging.h"
 #include "core/tagreaderclient.h"
 #include "core/utilities.h"
+#include "transcoder/transcodecache.h"
 
 using std::placeholders::_1;
 
@@ -47,7 +48,7 @@ Organise::Organise(TaskManager* task_manager,
                    const NewSongInfoList& songs_info, bool eject_after)
     : thread_(nullptr),
       task_manager_(task_manager),
-      transcoder_(new Transcoder(this)),
+      transcode_cache_(TranscodeCache::Instance()),
       destination_(destination),
       format_(format),
       copy_(copy),
@@ -55,7 +56,6 @@ Organise::Organise(TaskManager* task_manager,
       mark_as_listened_(mark_as_listened),
       eject_after_(eject_after),
       task_count_(songs_info.count()),
-      transcode_suffix_(1),
       tasks_complete_(0),
       started_(false),
       task_id_(0),
@@ -75,7 +75,7 @@ void Organise::Start() {
 
   thread_ = new QThread;
   connect(thread_, SIGNAL(started()), SLOT(ProcessSomeFiles()));
-  connect(transcoder_, SIGNAL(JobComplete(QString, QString, bool)),
+  connect(transcode_cache_, SIGNAL(Finished(QString, QString, bool)),
           SLOT(FileTranscoded(QString, QString, bool)));
 
   moveToThread(thread_);
@@ -84,8 +84,6 @@ void Organise::Start() {
 
 void Organise::ProcessSomeFiles() {
   if (!started_) {
-    transcode_temp_name_.open();
-
     if (!destination_->StartCopy(&supported_filetypes_)) {
       // Failed to start - mark everything as failed :(
       for (const Task& task : tasks_pending_)
@@ -160,21 +158,16 @@ void Organise::ProcessSomeFiles() {
         TranscoderPreset preset = Transcoder::PresetForFileType(dest_type);
         qLog(Debug) << "Transcoding with" << preset.name_;
 
-        // Get a temporary name for the transcoded file
-        task.transcoded_filename_ = transcode_temp_name_.fileName() + "-" +
-                                    QString::number(transcode_suffix_++);
         task.new_extension_ = preset.extension_;
         task.new_filetype_ = dest_type;
-        tasks_transcoding_[task.song_info_.song_.url().toLocalFile()] = task;
-
-        qLog(Debug) << "Transcoding to" << task.transcoded_filename_;
 
-        // Start the transcoding - this will happen in the background and
+        // Ask the transcode cache for the file - this will happen in the
+        // background (or not at all if the cache already has it) and
         // FileTranscoded() will get called when it's done.  At that point the
         // task will get re-added to the pending queue with the new filename.
-        transcoder_->AddJob(task.song_info_.song_.url().toLocalFile(), preset,
-                            task.transcoded_filename_);
-        transcoder_->Start();
+        task.transcode_key_ = transcode_cache_->Request(
+            task.song_info_.song_.url().toLocalFile(), preset);
+        tasks_transcoding_.insert(task.transcode_key_, task);
         continue;
       }
     }
@@ -187,7 +180,9 @@ void Organise::ProcessSomeFiles() {
     job.metadata_ = song;
     job.overwrite_ = overwrite_;
     job.mark_as_listened_ = mark_as_listened_;
-    job.remove_original_ = !copy_;
+    // The transcoded file belongs to the cache, so never let the storage move
+    // it away.
+    job.remove_original_ = !copy_ && task.transcoded_filename_.isEmpty();
     job.progress_ = std::bind(&Organise::SetSongProgress, this, _1,
                               !task.transcoded_filename_.isEmpty());
 
@@ -199,9 +194,9 @@ void Organise::ProcessSomeFiles() {
       }
     }
 
-    // Clean up the temporary transcoded file
-    if (!task.transcoded_filename_.isEmpty())
-      QFile::remove(task.transcoded_filename_);
+    // Let the cache know we're done with the transcoded file
+    if (!task.transcode_key_.isEmpty())
+      transcode_cache_->Release(task.transcode_key_);
 
     tasks_complete_++;
   }
@@ -250,11 +245,12 @@ void Organise::UpdateProgress() {
   const int total = task_count_ * 100;
 
   // Update transcoding progress
-  QMap<QString, float> transcode_progress = transcoder_->GetProgress();
-  for (const QString& filename : transcode_progress.keys()) {
-    if (!tasks_transcoding_.contains(filename)) continue;
-    tasks_transcoding_[filename].transcode_progress_ =
-        transcode_progress[filename];
+  QMap<QString, float> transcode_progress = transcode_cache_->GetProgress();
+  for (QMultiMap<QString, Task>::iterator it = tasks_transcoding_.begin();
+       it != tasks_transcoding_.end(); ++it) {
+    const QString filename = it->song_info_.song_.url().toLocalFile();
+    if (!transcode_progress.contains(filename)) continue;
+    it->transcode_progress_ = transcode_progress[filename];
   }
 
   // Count the progress of all tasks that are in the queue.  Files that need
@@ -275,16 +271,24 @@ void Organise::UpdateProgress() {
   task_manager_->SetTaskProgress(task_id_, progress, total);
 }
 
-void Organise::FileTranscoded(const QString& input, const QString& output, bool success) {
-  qLog(Info) << "File finished" << input << success;
+void Organise::FileTranscoded(const QString& key, const QString& output,
+                              bool success) {
+  if (!tasks_transcoding_.contains(key)) return;
   transcode_progress_timer_.stop();
 
-  Task task = tasks_transcoding_.take(input);
-  if (!success) {
-    files_with_errors_ << input;
-  } else {
-    tasks_pending_ << task;
+  for (Task task : tasks_transcoding_.values(key)) {
+    const QString input = task.song_info_.song_.url().toLocalFile();
+    qLog(Info) << "File finished" << input << success;
+
+    if (!success) {
+      files_with_errors_ << input;
+    } else {
+      task.transcoded_filename_ = output;
+      tasks_pending_ << task;
+    }
   }
+  tasks_transcoding_.remove(key);
+
   QTimer::singleShot(0, this, SLOT(ProcessSomeFiles()));
 }
 
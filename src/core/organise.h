@@ -25,14 +25,15 @@
 #include <memory>
 
 #include <QBasicTimer>
+#include <QMultiMap>
 #include <QObject>
-#include <QTemporaryFile>
 
 #include "organiseformat.h"
 #include "transcoder/transcoder.h"
 
 class MusicStorage;
 class TaskManager;
+class TranscodeCache;
 
 class Organise : public QObject {
   Q_OBJECT
@@ -66,7 +67,7 @@ class Organise : public QObject {
 
  private slots:
   void ProcessSomeFiles();
-  void FileTranscoded(const QString& input, const QString& output, bool success);
+  void FileTranscoded(const QString& key, const QString& output, bool success);
 
  private:
   void SetSongProgress(float progress, bool transcoded = false);
@@ -81,6 +82,7 @@ class Organise : public QObject {
     NewSongInfo song_info_;
 
     float transcode_progress_;
+    QString transcode_key_;
     QString transcoded_filename_;
     QString new_extension_;
     Song::FileType new_filetype_;
@@ -89,7 +91,7 @@ class Organise : public QObject {
   QThread* thread_;
   QThread* original_thread_;
   TaskManager* task_manager_;
-  Transcoder* transcoder_;
+  TranscodeCache* transcode_cache_;
   std::shared_ptr<MusicStorage> destination_;
   QList<Song::FileType> supported_filetypes_;
 
@@ -101,11 +103,9 @@ class Organise : public QObject {
   int task_count_;
 
   QBasicTimer transcode_progress_timer_;
-  QTemporaryFile transcode_temp_name_;
-  int transcode_suffix_;
 
   QList<Task> tasks_pending_;
-  QMap<QString, Task> tasks_transcoding_;
+  QMultiMap<QString, Task> tasks_transcoding_;  // Keyed by transcode cache key.
   int tasks_complete_;
 
   bool started_;
@@ -31,6 +31,7 @@
 
 #include <QSettings>
 #include <QSortFilterProxyModel>
+#include <QTimerEvent>
 #include <QtDebug>
 #include <QtConcurrentRun>
 
@@ -44,6 +45,7 @@
 #include "playlist/playlist.h"
 #include "playlist/playlistitem.h"
 #include "playlist/playlistmanager.h"
+#include "playlist/playlistsequence.h"
 
 #ifdef HAVE_LIBLASTFM
 #include "internet/lastfm/lastfmservice.h"
@@ -52,6 +54,7 @@
 using std::shared_ptr;
 
 const char* Player::kSettingsGroup = "Player";
+const int Player::kPrerollDelayMsec = 500;
 
 Player::Player(Application* app, QObject* parent)
     : PlayerInterface(parent),
@@ -89,6 +92,13 @@ void Player::Init() {
   connect(engine_.get(), SIGNAL(MetaData(Engine::SimpleMetaBundle)),
           SLOT(EngineMetadataReceived(Engine::SimpleMetaBundle)));
 
+  connect(app_->playlist_manager(), SIGNAL(ActiveChanged(Playlist*)),
+          SLOT(ActivePlaylistChanged(Playlist*)));
+  connect(app_->playlist_manager(), SIGNAL(PlaylistChanged(Playlist*)),
+          SLOT(PlaylistChanged(Playlist*)));
+  connect(app_->playlist_manager(), SIGNAL(CurrentSongChanged(Song)),
+          SLOT(SchedulePreroll()));
+
   engine_->SetVolume(settings_.value("volume", 50).toInt());
 
   ReloadSettings();
@@ -170,6 +180,7 @@ void Player::NextInternal(Engine::TrackChangeFlags change) {
 
   if (app_->playlist_manager()->active()->current_item()) {
     const QUrl url = app_->playlist_manager()->active()->current_item()->Url();
+    CreateLazyUrlHandler(url);
 
     if (url_handlers_.contains(url.scheme())) {
       // The next track is already being loaded
@@ -353,6 +364,7 @@ void Player::EngineStateChanged(Engine::State state) {
       break;
     case Engine::Playing:
       emit Playing();
+      SchedulePreroll();
       break;
     case Engine::Error:
     case Engine::Empty:
@@ -363,6 +375,73 @@ void Player::EngineStateChanged(Engine::State state) {
   last_state_ = state;
 }
 
+void Player::ActivePlaylistChanged(Playlist* playlist) {
+  // The sequence and the queue both change which track Next() would play.
+  connect(playlist, SIGNAL(QueueChanged()), SLOT(SchedulePreroll()),
+          Qt::UniqueConnection);
+  connect(playlist, SIGNAL(layoutChanged()), SLOT(SchedulePreroll()),
+          Qt::UniqueConnection);
+
+  PlaylistSequence* sequence = app_->playlist_manager()->sequence();
+  if (sequence) {
+    connect(sequence, SIGNAL(RepeatModeChanged(PlaylistSequence::RepeatMode)),
+            SLOT(SchedulePreroll()), Qt::UniqueConnection);
+    connect(sequence,
+            SIGNAL(ShuffleModeChanged(PlaylistSequence::ShuffleMode)),
+            SLOT(SchedulePreroll()), Qt::UniqueConnection);
+  }
+
+  SchedulePreroll();
+}
+
+void Player::PlaylistChanged(Playlist* playlist) {
+  if (playlist == app_->playlist_manager()->active()) SchedulePreroll();
+}
+
+void Player::SchedulePreroll() {
+  preroll_timer_.start(kPrerollDelayMsec, this);
+}
+
+void Player::timerEvent(QTimerEvent* e) {
+  if (e->timerId() == preroll_timer_.timerId()) {
+    preroll_timer_.stop();
+    PrerollNextItem();
+  } else {
+    PlayerInterface::timerEvent(e);
+  }
+}
+
+void Player::PrerollNextItem() {
+  Playlist* active_playlist = app_->playlist_manager()->active();
+  const Engine::State state = engine_->state();
+
+  // Only worth doing while something's playing - otherwise there's nothing to
+  // skip from.
+  if (!active_playlist || !current_item_ ||
+      (state != Engine::Playing && state != Engine::Paused)) {
+    engine_->StartPrerolling(QUrl(), false, 0, 0);
+    return;
+  }
+
+  // Manual track changes ignore "Repeat track", so that's the one to get
+  // ready.
+  const int i = active_playlist->next_row(true);
+  PlaylistItemPtr item;
+  if (i != -1) item = active_playlist->item_at(i);
+
+  // URL handlers might do all sorts of things (like fetching a new stream URL
+  // from a server) when they're asked to load a track, so leave those alone.
+  if (!item || url_handlers_.contains(item->Url().scheme()) ||
+      lazy_url_handlers_.contains(item->Url().scheme())) {
+    engine_->StartPrerolling(QUrl(), false, 0, 0);
+    return;
+  }
+
+  const Song song = item->Metadata();
+  engine_->StartPrerolling(item->Url(), song.has_cue(),
+                           song.beginning_nanosec(), song.end_nanosec());
+}
+
 void Player::SetVolume(int value) {
   int old_volume = engine_->volume();
 
@@ -404,6 +483,7 @@ void Player::PlayAt(int index, Engine::TrackChangeFlags change,
 
   current_item_ = app_->playlist_manager()->active()->current_item();
   const QUrl url = current_item_->Url();
+  CreateLazyUrlHandler(url);
 
   if (url_handlers_.contains(url.scheme())) {
     // It's already loading
@@ -581,6 +661,7 @@ void Player::TrackAboutToEnd() {
   QUrl url = next_item->Url();
 
   // Get the actual track URL rather than the stream URL.
+  CreateLazyUrlHandler(url);
   if (url_handlers_.contains(url.scheme())) {
     UrlHandler::LoadResult result = url_handlers_[url.scheme()]->LoadNext(url);
     switch (result.type_) {
@@ -626,6 +707,7 @@ void Player::RegisterUrlHandler(UrlHandler* handler) {
 
   qLog(Info) << "Registered URL handler for" << scheme;
   url_handlers_.insert(scheme, handler);
+  lazy_url_handlers_.remove(scheme);
   connect(handler, SIGNAL(destroyed(QObject*)),
           SLOT(UrlHandlerDestroyed(QObject*)));
   connect(handler, SIGNAL(AsyncLoadComplete(UrlHandler::LoadResult)),
@@ -648,6 +730,27 @@ void Player::UnregisterUrlHandler(UrlHandler* handler) {
              SLOT(HandleLoadResult(UrlHandler::LoadResult)));
 }
 
+void Player::RegisterLazyUrlHandler(const QString& scheme,
+                                    std::function<void()> create_handler) {
+  if (url_handlers_.contains(scheme) || lazy_url_handlers_.contains(scheme)) {
+    qLog(Warning) << "Tried to register a lazy URL handler for" << scheme
+                  << "but one was already registered";
+    return;
+  }
+
+  lazy_url_handlers_.insert(scheme, create_handler);
+}
+
+void Player::CreateLazyUrlHandler(const QUrl& url) {
+  if (url_handlers_.contains(url.scheme())) return;
+
+  std::function<void()> create_handler = lazy_url_handlers_.take(url.scheme());
+  if (create_handler) {
+    qLog(Info) << "Creating URL handler for" << url.scheme();
+    create_handler();
+  }
+}
+
 const UrlHandler* Player::HandlerForUrl(const QUrl& url) const {
   QMap<QString, UrlHandler*>::const_iterator it =
       url_handlers_.constFind(url.scheme());
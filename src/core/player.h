@@ -27,8 +27,10 @@
 #ifndef CORE_PLAYER_H_
 #define CORE_PLAYER_H_
 
+#include <functional>
 #include <memory>
 
+#include <QBasicTimer>
 #include <QDateTime>
 #include <QObject>
 #include <QSettings>
@@ -41,6 +43,7 @@
 #include "playlist/playlistitem.h"
 
 class Application;
+class Playlist;
 class Scrobbler;
 
 class PlayerInterface : public QObject {
@@ -140,6 +143,12 @@ class Player : public PlayerInterface {
   void RegisterUrlHandler(UrlHandler* handler);
   void UnregisterUrlHandler(UrlHandler* handler);
 
+  // Registers a function that is called the first time a URL with this scheme
+  // is played, for handlers that belong to something that is created on
+  // demand.  The function should register the real handler.
+  void RegisterLazyUrlHandler(const QString& scheme,
+                              std::function<void()> create_handler);
+
   const UrlHandler* HandlerForUrl(const QUrl& url) const;
 
   bool PreviousWouldRestartTrack() const;
@@ -188,10 +197,25 @@ class Player : public PlayerInterface {
   void UrlHandlerDestroyed(QObject* object);
   void HandleLoadResult(const UrlHandler::LoadResult& result);
 
+  void ActivePlaylistChanged(Playlist* playlist);
+  void PlaylistChanged(Playlist* playlist);
+  void SchedulePreroll();
+
+ protected:
+  void timerEvent(QTimerEvent* e);
+
  private:
+  // Asks the engine to get the track that Next() would play ready in the
+  // background.  Does nothing for URLs that need a URL handler.
+  void PrerollNextItem();
+
   // Returns true if we were supposed to stop after this track.
   bool HandleStopAfter();
 
+  // Calls the function registered with RegisterLazyUrlHandler for the URL's
+  // scheme, if there is one and it hasn't been called already.
+  void CreateLazyUrlHandler(const QUrl& url);
+
  private:
   Application* app_;
   Scrobbler* lastfm_;
@@ -205,6 +229,7 @@ class Player : public PlayerInterface {
   int nb_errors_received_;
 
   QMap<QString, UrlHandler*> url_handlers_;
+  QMap<QString, std::function<void()> > lazy_url_handlers_;
 
   QUrl loading_async_;
 
@@ -213,6 +238,11 @@ class Player : public PlayerInterface {
   QDateTime last_pressed_previous_;
   PreviousBehaviour menu_previousmode_;
   int seek_step_sec_;
+
+  // Playlist edits tend to come in bursts, so wait for them to settle down
+  // before prerolling.
+  static const int kPrerollDelayMsec;
+  QBasicTimer preroll_timer_;
 };
 
 #endif  // CORE_PLAYER_H_
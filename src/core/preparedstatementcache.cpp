@@ -0,0 +1,88 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "core/preparedstatementcache.h"
+
+const int PreparedStatementCache::kDefaultMaxSize = 64;
+
+PreparedStatementCache::PreparedStatementCache(const QSqlDatabase& db,
+                                               int max_size)
+    : db_(db), max_size_(max_size), hits_(0), misses_(0) {}
+
+QSqlQuery PreparedStatementCache::Acquire(const QString& sql) {
+  QHash<QString, Entry>::iterator it = entries_.find(sql);
+  if (it != entries_.end() && !it->in_use_) {
+    hits_++;
+    it->in_use_ = true;
+    lru_.removeOne(sql);
+    lru_.append(sql);
+    return it->query_;
+  }
+
+  misses_++;
+
+  QSqlQuery query(db_);
+  query.setForwardOnly(true);
+
+  // Don't cache statements that failed to prepare (the error is reported when
+  // the caller executes the query) or that are being used already.
+  if (!query.prepare(sql) || it != entries_.end()) {
+    return query;
+  }
+
+  if (entries_.count() >= max_size_) {
+    EvictLeastRecentlyUsed();
+  }
+
+  Entry entry;
+  entry.query_ = query;
+  entry.in_use_ = true;
+  entries_.insert(sql, entry);
+  lru_.append(sql);
+
+  return query;
+}
+
+void PreparedStatementCache::Release(const QString& sql,
+                                     const QSqlQuery& query) {
+  QHash<QString, Entry>::iterator it = entries_.find(sql);
+  if (it == entries_.end() || it->query_.result() != query.result()) {
+    // This wasn't the cached statement.
+    return;
+  }
+
+  // Reset the statement so it doesn't hold any locks on the database while
+  // it's sitting in the cache.
+  it->query_.finish();
+  it->in_use_ = false;
+}
+
+void PreparedStatementCache::EvictLeastRecentlyUsed() {
+  for (QList<QString>::iterator it = lru_.begin(); it != lru_.end(); ++it) {
+    if (!entries_[*it].in_use_) {
+      entries_.remove(*it);
+      lru_.erase(it);
+      return;
+    }
+  }
+}
+
+CachedQuery::CachedQuery(PreparedStatementCache* cache, const QString& sql)
+    : QSqlQuery(cache->Acquire(sql)), cache_(cache), sql_(sql) {}
+
+CachedQuery::~CachedQuery() { cache_->Release(sql_, *this); }
@@ -0,0 +1,91 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CORE_PREPAREDSTATEMENTCACHE_H_
+#define CORE_PREPAREDSTATEMENTCACHE_H_
+
+#include <QHash>
+#include <QList>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+
+// Keeps the most recently used prepared statements for one database
+// connection, keyed by their SQL text, so SQLite doesn't have to parse and
+// plan the same statement every time a backend method is called.
+//
+// Like the connection itself, a cache must only be used from the thread that
+// owns the connection.  Get one from Database::StatementCache() and use it
+// through CachedQuery.
+class PreparedStatementCache {
+ public:
+  explicit PreparedStatementCache(const QSqlDatabase& db,
+                                  int max_size = kDefaultMaxSize);
+
+  static const int kDefaultMaxSize;
+
+  int count() const { return entries_.count(); }
+  int hits() const { return hits_; }
+  int misses() const { return misses_; }
+
+ private:
+  Q_DISABLE_COPY(PreparedStatementCache)
+  friend class CachedQuery;
+
+  struct Entry {
+    QSqlQuery query_;
+    bool in_use_;
+  };
+
+  // Returns the prepared statement for sql and marks it as in use.  If it's
+  // already in use further up the stack a new statement is returned instead,
+  // which isn't cached.
+  QSqlQuery Acquire(const QString& sql);
+  void Release(const QString& sql, const QSqlQuery& query);
+
+  void EvictLeastRecentlyUsed();
+
+  QSqlDatabase db_;
+  const int max_size_;
+
+  QHash<QString, Entry> entries_;
+  QList<QString> lru_;  // Least recently used first.
+
+  int hits_;
+  int misses_;
+};
+
+// A query using a statement from a PreparedStatementCache.  Use it like a
+// QSqlQuery that has already been prepared: bind the values and exec() it.
+// The statement is reset and returned to the cache when this is destroyed.
+//
+// Cached queries are forward only, and values bound by a previous user of the
+// statement are still bound, so always bind every placeholder.
+class CachedQuery : public QSqlQuery {
+ public:
+  CachedQuery(PreparedStatementCache* cache, const QString& sql);
+  ~CachedQuery();
+
+ private:
+  Q_DISABLE_COPY(CachedQuery)
+
+  PreparedStatementCache* cache_;
+  const QString sql_;
+};
+
+#endif  // CORE_PREPAREDSTATEMENTCACHE_H_
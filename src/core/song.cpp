@@ -65,6 +65,7 @@
 #include "core/logging.h"
 #include "core/messagehandler.h"
 #include "core/mpris_common.h"
+#include "core/stringpool.h"
 #include "core/timeconstants.h"
 #include "core/utilities.h"
 #include "covers/albumcoverloader.h"
@@ -497,19 +498,19 @@ void Song::InitFromProtobuf(const pb::tagreader::SongMetadata& pb) {
   d->init_from_file_ = true;
   d->valid_ = pb.valid();
   d->title_ = QStringFromStdString(pb.title());
-  d->album_ = QStringFromStdString(pb.album());
-  d->artist_ = QStringFromStdString(pb.artist());
-  d->albumartist_ = QStringFromStdString(pb.albumartist());
-  d->composer_ = QStringFromStdString(pb.composer());
-  d->performer_ = QStringFromStdString(pb.performer());
-  d->grouping_ = QStringFromStdString(pb.grouping());
+  d->album_ = InternString(QStringFromStdString(pb.album()));
+  d->artist_ = InternString(QStringFromStdString(pb.artist()));
+  d->albumartist_ = InternString(QStringFromStdString(pb.albumartist()));
+  d->composer_ = InternString(QStringFromStdString(pb.composer()));
+  d->performer_ = InternString(QStringFromStdString(pb.performer()));
+  d->grouping_ = InternString(QStringFromStdString(pb.grouping()));
   d->lyrics_ = QStringFromStdString(pb.lyrics());
   d->track_ = pb.track();
   d->disc_ = pb.disc();
   d->bpm_ = pb.bpm();
   d->year_ = pb.year();
   d->originalyear_ = pb.originalyear();
-  d->genre_ = QStringFromStdString(pb.genre());
+  d->genre_ = InternString(QStringFromStdString(pb.genre()));
   d->comment_ = QStringFromStdString(pb.comment());
   d->compilation_ = pb.compilation();
   d->playcount_ = pb.playcount();
@@ -529,7 +530,8 @@ void Song::InitFromProtobuf(const pb::tagreader::SongMetadata& pb) {
   d->etag_ = QStringFromStdString(pb.etag());
 
   if (pb.has_art_automatic()) {
-    d->art_automatic_ = QStringFromStdString(pb.art_automatic());
+    d->art_automatic_ =
+        InternString(QStringFromStdString(pb.art_automatic()));
   }
 
   if (pb.has_rating()) {
@@ -582,22 +584,23 @@ void Song::InitFromQuery(const SqlRow& q, bool reliable_metadata, int col) {
   d->init_from_file_ = reliable_metadata;
 
 #define tostr(n) (q.value(n).isNull() ? QString::null : q.value(n).toString())
+#define tointernedstr(n) InternString(tostr(n))
 #define toint(n) (q.value(n).isNull() ? -1 : q.value(n).toInt())
 #define tolonglong(n) (q.value(n).isNull() ? -1 : q.value(n).toLongLong())
 #define tofloat(n) (q.value(n).isNull() ? -1 : q.value(n).toDouble())
 
   d->id_ = toint(col + 0);
   d->title_ = tostr(col + 1);
-  d->album_ = tostr(col + 2);
-  d->artist_ = tostr(col + 3);
-  d->albumartist_ = tostr(col + 4);
-  d->composer_ = tostr(col + 5);
+  d->album_ = tointernedstr(col + 2);
+  d->artist_ = tointernedstr(col + 3);
+  d->albumartist_ = tointernedstr(col + 4);
+  d->composer_ = tointernedstr(col + 5);
   d->track_ = toint(col + 6);
   d->disc_ = toint(col + 7);
   d->bpm_ = tofloat(col + 8);
   d->year_ = toint(col + 9);
   d->originalyear_ = toint(col + 41);
-  d->genre_ = tostr(col + 10);
+  d->genre_ = tointernedstr(col + 10);
   d->comment_ = tostr(col + 11);
   d->compilation_ = q.value(col + 12).toBool();
 
@@ -613,8 +616,8 @@ void Song::InitFromQuery(const SqlRow& q, bool reliable_metadata, int col) {
 
   d->sampler_ = q.value(col + 20).toBool();
 
-  d->art_automatic_ = q.value(col + 21).toString();
-  d->art_manual_ = q.value(col + 22).toString();
+  d->art_automatic_ = InternString(q.value(col + 21).toString());
+  d->art_manual_ = InternString(q.value(col + 22).toString());
 
   d->filetype_ = FileType(q.value(col + 23).toInt());
   d->playcount_ = q.value(col + 24).isNull() ? 0 : q.value(col + 24).toInt();
@@ -635,19 +638,20 @@ void Song::InitFromQuery(const SqlRow& q, bool reliable_metadata, int col) {
       q.value(col + 32).isNull() ? 0 : q.value(col + 32).toLongLong();
   set_length_nanosec(tolonglong(col + 33));
 
-  d->cue_path_ = tostr(col + 34);
+  d->cue_path_ = tointernedstr(col + 34);
   d->unavailable_ = q.value(col + 35).toBool();
 
   // effective_albumartist = 36
   // etag = 37
 
-  d->performer_ = tostr(col + 38);
-  d->grouping_ = tostr(col + 39);
+  d->performer_ = tointernedstr(col + 38);
+  d->grouping_ = tointernedstr(col + 39);
   d->lyrics_ = tostr(col + 40);
 
   InitArtManual();
 
 #undef tostr
+#undef tointernedstr
 #undef toint
 #undef tolonglong
 #undef tofloat
@@ -0,0 +1,104 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "core/stringpool.h"
+
+#include <QMutexLocker>
+
+#include "core/logging.h"
+#include "core/tracing.h"
+
+StringPool::StringPool() {}
+
+StringPool* StringPool::Global() {
+  static StringPool sPool;
+  return &sPool;
+}
+
+QString StringPool::Intern(const QString& str) {
+  // The null and empty strings are already shared.
+  if (str.isEmpty()) return str;
+
+  Shard* shard = &shards_[qHash(str) % kShardCount];
+  QMutexLocker l(&shard->mutex);
+
+  shard->lookups++;
+
+  QSet<QString>::const_iterator it = shard->strings.constFind(str);
+  if (it != shard->strings.constEnd()) {
+    shard->hits++;
+    if (it->constData() != str.constData()) {
+      shard->bytes_saved += str.size() * sizeof(QChar);
+    }
+    return *it;
+  }
+
+  // Purge once the number of new strings is comparable to the size of the
+  // shard, so the cost of purging is spread over the inserts.
+  if (++shard->inserts_since_purge >=
+      qMax(kMinInsertsBeforePurge, shard->strings.count())) {
+    PurgeShard(shard);
+  }
+
+  shard->strings.insert(str);
+  shard->bytes += str.size() * sizeof(QChar);
+  return str;
+}
+
+void StringPool::PurgeShard(Shard* shard) {
+  shard->inserts_since_purge = 0;
+
+  QMutableSetIterator<QString> it(shard->strings);
+  while (it.hasNext()) {
+    const QString& str = it.next();
+    if (str.isDetached()) {
+      // Nothing outside the pool refers to this string any more.
+      shard->bytes -= str.size() * sizeof(QChar);
+      it.remove();
+    }
+  }
+}
+
+void StringPool::Purge() {
+  TRACE_SPAN("StringPool::Purge");
+
+  for (int i = 0; i < kShardCount; ++i) {
+    QMutexLocker l(&shards_[i].mutex);
+    PurgeShard(&shards_[i]);
+  }
+
+  const Stats s = stats();
+  TRACE_COUNTER("StringPool bytes", s.bytes);
+  qLog(Debug) << "String pool holds" << s.strings << "strings," << s.bytes
+              << "bytes, saved" << s.bytes_saved << "bytes in" << s.hits
+              << "of" << s.lookups << "lookups";
+}
+
+StringPool::Stats StringPool::stats() const {
+  Stats ret;
+  for (int i = 0; i < kShardCount; ++i) {
+    const Shard& shard = shards_[i];
+    QMutexLocker l(&shard.mutex);
+    ret.strings += shard.strings.count();
+    ret.bytes += shard.bytes;
+    ret.lookups += shard.lookups;
+    ret.hits += shard.hits;
+    ret.bytes_saved += shard.bytes_saved;
+  }
+  return ret;
+}
@@ -0,0 +1,103 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CORE_STRINGPOOL_H_
+#define CORE_STRINGPOOL_H_
+
+#include <QMutex>
+#include <QSet>
+#include <QString>
+
+// Interns strings so that equal strings share a single implicitly shared
+// buffer.  Used for the Song fields that repeat across a whole library
+// (artist, album, genre, etc.) so that half a million Songs don't each hold
+// their own copy of "Various Artists".
+//
+// Equal interned strings also compare quickly - QString's operator== returns
+// as soon as it sees both sides point to the same data.
+//
+// The pool holds one reference to each string it contains.  Strings that
+// nothing else refers to any more are dropped by Purge(), which the pool also
+// runs on itself from time to time as new strings are added.
+class StringPool {
+ public:
+  StringPool();
+
+  struct Stats {
+    Stats() : strings(0), bytes(0), lookups(0), hits(0), bytes_saved(0) {}
+
+    // Strings currently in the pool and the size of their data.
+    int strings;
+    qint64 bytes;
+
+    // Calls to Intern() and how many of them found an existing string.
+    qint64 lookups;
+    qint64 hits;
+
+    // Bytes that would otherwise have been held by duplicate copies.
+    qint64 bytes_saved;
+  };
+
+  // The pool used by Song.
+  static StringPool* Global();
+
+  // Returns a string equal to str that shares its data with any other equal
+  // string interned in this pool.  Thread safe.
+  QString Intern(const QString& str);
+
+  // Removes the strings that are only referenced by the pool.
+  void Purge();
+
+  Stats stats() const;
+
+ private:
+  Q_DISABLE_COPY(StringPool)
+
+  // The pool is split into shards, each with their own lock, so that threads
+  // loading songs don't all wait on the same mutex.
+  static const int kShardCount = 16;
+  static const int kMinInsertsBeforePurge = 4096;
+
+  struct Shard {
+    Shard()
+        : bytes(0),
+          lookups(0),
+          hits(0),
+          bytes_saved(0),
+          inserts_since_purge(0) {}
+
+    mutable QMutex mutex;
+    QSet<QString> strings;
+    qint64 bytes;
+    qint64 lookups;
+    qint64 hits;
+    qint64 bytes_saved;
+    int inserts_since_purge;
+  };
+
+  static void PurgeShard(Shard* shard);
+
+  Shard shards_[kShardCount];
+};
+
+// Interns the string in the global pool.
+inline QString InternString(const QString& str) {
+  return StringPool::Global()->Intern(str);
+}
+
+#endif  // CORE_STRINGPOOL_H_
@@ -27,6 +27,8 @@
 #include <QThread>
 #include <QUrl>
 
+#include "core/tracing.h"
+
 const char* TagReaderClient::kWorkerExecutableName = "clementine-tagreader";
 TagReaderClient* TagReaderClient::sInstance = nullptr;
 
@@ -79,13 +81,6 @@ TagReaderReply* TagReaderClient::UpdateSongStatistics(const Song& metadata) {
   return worker_pool_->SendMessageWithReply(&message);
 }
 
-void TagReaderClient::UpdateSongsStatistics(const SongList& songs) {
-  for (const Song& song : songs) {
-    TagReaderReply* reply = UpdateSongStatistics(song);
-    connect(reply, SIGNAL(Finished(bool)), reply, SLOT(deleteLater()));
-  }
-}
-
 TagReaderReply* TagReaderClient::UpdateSongRating(const Song& metadata) {
   pb::tagreader::Message message;
   pb::tagreader::SaveSongRatingToFileRequest* req =
@@ -97,13 +92,6 @@ TagReaderReply* TagReaderClient::UpdateSongRating(const Song& metadata) {
   return worker_pool_->SendMessageWithReply(&message);
 }
 
-void TagReaderClient::UpdateSongsRating(const SongList& songs) {
-  for (const Song& song : songs) {
-    TagReaderReply* reply = UpdateSongRating(song);
-    connect(reply, SIGNAL(Finished(bool)), reply, SLOT(deleteLater()));
-  }
-}
-
 TagReaderReply* TagReaderClient::IsMediaFile(const QString& filename) {
   pb::tagreader::Message message;
   pb::tagreader::IsMediaFileRequest* req =
@@ -114,12 +102,16 @@ TagReaderReply* TagReaderClient::IsMediaFile(const QString& filename) {
   return worker_pool_->SendMessageWithReply(&message);
 }
 
-TagReaderReply* TagReaderClient::LoadEmbeddedArt(const QString& filename) {
+TagReaderReply* TagReaderClient::LoadEmbeddedArt(const QString& filename,
+                                                 int max_size) {
   pb::tagreader::Message message;
   pb::tagreader::LoadEmbeddedArtRequest* req =
       message.mutable_load_embedded_art_request();
 
   req->set_filename(DataCommaSizeFromQString(filename));
+  if (max_size > 0) {
+    req->set_max_size(max_size);
+  }
 
   return worker_pool_->SendMessageWithReply(&message);
 }
@@ -143,6 +135,7 @@ TagReaderReply* TagReaderClient::ReadCloudFile(
 
 void TagReaderClient::ReadFileBlocking(const QString& filename, Song* song) {
   Q_ASSERT(QThread::currentThread() != thread());
+  TRACE_SPAN_CATEGORY("TagReaderClient::ReadFileBlocking", "ipc");
 
   TagReaderReply* reply = ReadFile(filename);
   if (reply->WaitForFinished()) {
@@ -196,6 +189,7 @@ bool TagReaderClient::UpdateSongRatingBlocking(const Song& metadata) {
 
 bool TagReaderClient::IsMediaFileBlocking(const QString& filename) {
   Q_ASSERT(QThread::currentThread() != thread());
+  TRACE_SPAN_CATEGORY("TagReaderClient::IsMediaFileBlocking", "ipc");
 
   bool ret = false;
 
@@ -208,16 +202,30 @@ bool TagReaderClient::IsMediaFileBlocking(const QString& filename) {
   return ret;
 }
 
-QImage TagReaderClient::LoadEmbeddedArtBlocking(const QString& filename) {
+QImage TagReaderClient::LoadEmbeddedArtBlocking(const QString& filename,
+                                                int max_size) {
   Q_ASSERT(QThread::currentThread() != thread());
+  TRACE_SPAN_CATEGORY("TagReaderClient::LoadEmbeddedArtBlocking", "ipc");
 
   QImage ret;
 
-  TagReaderReply* reply = LoadEmbeddedArt(filename);
+  TagReaderReply* reply = LoadEmbeddedArt(filename, max_size);
   if (reply->WaitForFinished()) {
-    const std::string& data_str =
-        reply->message().load_embedded_art_response().data();
-    ret.loadFromData(QByteArray(data_str.data(), data_str.size()));
+    const pb::tagreader::LoadEmbeddedArtResponse& response =
+        reply->message().load_embedded_art_response();
+    const std::string& data_str = response.data();
+
+    if (response.has_width()) {
+      // Raw pixels that were already decoded and scaled by the worker.
+      QImage image(response.width(), response.height(), QImage::Format_ARGB32);
+      if (!image.isNull() && image.byteCount() == int(data_str.size())) {
+        memcpy(image.bits(), data_str.data(), data_str.size());
+        ret = image;
+      }
+    } else {
+      ret.loadFromData(reinterpret_cast<const uchar*>(data_str.data()),
+                       data_str.size());
+    }
   }
   reply->deleteLater();
 
@@ -49,7 +49,10 @@ class TagReaderClient : public QObject {
   ReplyType* UpdateSongStatistics(const Song& metadata);
   ReplyType* UpdateSongRating(const Song& metadata);
   ReplyType* IsMediaFile(const QString& filename);
-  ReplyType* LoadEmbeddedArt(const QString& filename);
+  // If max_size is set the image is decoded and scaled down to fit in a
+  // max_size x max_size square by the worker, so only the pixels we need are
+  // sent back.
+  ReplyType* LoadEmbeddedArt(const QString& filename, int max_size = 0);
   ReplyType* ReadCloudFile(const QUrl& download_url, const QString& title,
                            int size, const QString& mime_type,
                            const QString& authorisation_header);
@@ -62,15 +65,11 @@ class TagReaderClient : public QObject {
   bool UpdateSongStatisticsBlocking(const Song& metadata);
   bool UpdateSongRatingBlocking(const Song& metadata);
   bool IsMediaFileBlocking(const QString& filename);
-  QImage LoadEmbeddedArtBlocking(const QString& filename);
+  QImage LoadEmbeddedArtBlocking(const QString& filename, int max_size = 0);
 
   // TODO(David Sansome): Make this not a singleton
   static TagReaderClient* Instance() { return sInstance; }
 
- public slots:
-  void UpdateSongsStatistics(const SongList& songs);
-  void UpdateSongsRating(const SongList& songs);
-
  private slots:
   void WorkerFailedToStart();
 
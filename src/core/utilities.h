@@ -131,6 +131,7 @@ enum ConfigPath {
   Path_DefaultMusicLibrary,
   Path_LocalSpotifyBlob,
   Path_MoodbarCache,
+  Path_TranscodeCache,
   Path_CacheRoot,
 };
 QString GetConfigPath(ConfigPath config);
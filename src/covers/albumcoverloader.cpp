@@ -21,17 +21,24 @@
 
 #include "albumcoverloader.h"
 
+#include <functional>
+
+#include <QBuffer>
 #include <QPainter>
 #include <QDir>
 #include <QCoreApplication>
+#include <QImageReader>
 #include <QUrl>
 #include <QNetworkReply>
+#include <QThread>
 
 #include "config.h"
 #include "core/closure.h"
+#include "core/concurrentrun.h"
 #include "core/logging.h"
 #include "core/network.h"
 #include "core/tagreaderclient.h"
+#include "core/tracing.h"
 #include "core/utilities.h"
 #include "internet/core/internetmodel.h"
 #include "internet/spotify/spotifyservice.h"
@@ -39,9 +46,12 @@
 AlbumCoverLoader::AlbumCoverLoader(QObject* parent)
     : QObject(parent),
       stop_requested_(false),
+      active_workers_(0),
       next_id_(1),
       network_(new NetworkAccessManager(this)),
-      connected_spotify_(false) {}
+      connected_spotify_(false) {
+  pool_.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
 
 QString AlbumCoverLoader::ImageCacheDir() {
   return Utilities::GetConfigPath(Utilities::Path_AlbumCovers);
@@ -49,22 +59,26 @@ QString AlbumCoverLoader::ImageCacheDir() {
 
 void AlbumCoverLoader::CancelTask(quint64 id) {
   QMutexLocker l(&mutex_);
-  for (QQueue<Task>::iterator it = tasks_.begin(); it != tasks_.end(); ++it) {
-    if (it->id == id) {
-      tasks_.erase(it);
-      break;
-    }
-  }
+  tasks_.remove(id);
 }
 
 void AlbumCoverLoader::CancelTasks(const QSet<quint64>& ids) {
   QMutexLocker l(&mutex_);
-  for (QQueue<Task>::iterator it = tasks_.begin(); it != tasks_.end();) {
-    if (ids.contains(it->id)) {
-      it = tasks_.erase(it);
-    } else {
-      ++it;
-    }
+  for (quint64 id : ids) {
+    tasks_.remove(id);
+  }
+}
+
+void AlbumCoverLoader::SetPriority(const QSet<quint64>& ids,
+                                   Priority priority) {
+  QMutexLocker l(&mutex_);
+  for (quint64 id : ids) {
+    QHash<quint64, Task>::iterator it = tasks_.find(id);
+    if (it == tasks_.end() || it->priority == priority) continue;
+
+    // The old queue entry is left where it is and skipped later.
+    it->priority = priority;
+    queues_[priority].enqueue(id);
   }
 }
 
@@ -72,7 +86,8 @@ quint64 AlbumCoverLoader::LoadImageAsync(const AlbumCoverLoaderOptions& options,
                                          const QString& art_automatic,
                                          const QString& art_manual,
                                          const QString& song_filename,
-                                         const QImage& embedded_image) {
+                                         const QImage& embedded_image,
+                                         Priority priority) {
   Task task;
   task.options = options;
   task.art_automatic = art_automatic;
@@ -80,33 +95,69 @@ quint64 AlbumCoverLoader::LoadImageAsync(const AlbumCoverLoaderOptions& options,
   task.song_filename = song_filename;
   task.embedded_image = embedded_image;
   task.state = State_TryingManual;
+  task.priority = priority;
 
   {
     QMutexLocker l(&mutex_);
     task.id = next_id_++;
-    tasks_.enqueue(task);
   }
 
-  metaObject()->invokeMethod(this, "ProcessTasks", Qt::QueuedConnection);
+  EnqueueTask(task);
 
   return task.id;
 }
 
+void AlbumCoverLoader::EnqueueTask(const Task& task) {
+  {
+    QMutexLocker l(&mutex_);
+    tasks_.insert(task.id, task);
+    queues_[task.priority].enqueue(task.id);
+    TRACE_COUNTER("AlbumCoverLoader queued tasks", tasks_.count());
+
+    if (active_workers_ >= pool_.maxThreadCount()) return;
+    active_workers_++;
+  }
+
+  ConcurrentRun::Run<void>(&pool_,
+                           std::bind(&AlbumCoverLoader::ProcessTasks, this));
+}
+
 void AlbumCoverLoader::ProcessTasks() {
-  while (!stop_requested_) {
-    // Get the next task
-    Task task;
-    {
-      QMutexLocker l(&mutex_);
-      if (tasks_.isEmpty()) return;
-      task = tasks_.dequeue();
+  Task task;
+  while (!stop_requested_ && NextTask(&task)) {
+    ProcessTask(&task);
+  }
+}
+
+bool AlbumCoverLoader::NextTask(Task* task) {
+  QMutexLocker l(&mutex_);
+
+  if (!tasks_.isEmpty()) {
+    for (int priority = 0; priority < kPriorityCount; ++priority) {
+      QQueue<quint64>& queue = queues_[priority];
+      while (!queue.isEmpty()) {
+        QHash<quint64, Task>::iterator it = tasks_.find(queue.dequeue());
+
+        // Skip tasks that were cancelled or moved to a different queue.
+        if (it == tasks_.end() || it->priority != priority) continue;
+
+        *task = it.value();
+        tasks_.erase(it);
+        return true;
+      }
     }
+  }
 
-    ProcessTask(&task);
+  // Nothing left to do - throw away any stale queue entries too.
+  for (int priority = 0; priority < kPriorityCount; ++priority) {
+    queues_[priority].clear();
   }
+  active_workers_--;
+  return false;
 }
 
 void AlbumCoverLoader::ProcessTask(Task* task) {
+  TRACE_SPAN("AlbumCoverLoader::ProcessTask");
   TryLoadResult result = TryLoadImage(*task);
   if (result.started_async) {
     // The image is being loaded from a remote URL, we'll carry on later
@@ -128,7 +179,7 @@ void AlbumCoverLoader::NextState(Task* task) {
   if (task->state == State_TryingManual) {
     // Try the automatic one next
     task->state = State_TryingAuto;
-    ProcessTask(task);
+    EnqueueTask(*task);
   } else {
     // Give up
     emit ImageLoaded(task->id, task->options.default_output_image_);
@@ -158,9 +209,10 @@ AlbumCoverLoader::TryLoadResult AlbumCoverLoader::TryLoadImage(
     return TryLoadResult(false, true, task.options.default_output_image_);
 
   if (filename == Song::kEmbeddedCover && !task.song_filename.isEmpty()) {
+    // The tagreader can scale the image itself, which saves decoding the
+    // whole thing here and sending it over the socket.
     const QImage taglib_image =
-        TagReaderClient::Instance()->LoadEmbeddedArtBlocking(
-            task.song_filename);
+        LoadEmbeddedArt(task.song_filename, MaxDecodeSize(task.options));
 
     if (!taglib_image.isNull())
       return TryLoadResult(false, true,
@@ -168,17 +220,86 @@ AlbumCoverLoader::TryLoadResult AlbumCoverLoader::TryLoadImage(
   }
 
   if (filename.toLower().startsWith("http://") ||
-      filename.toLower().startsWith("https://")) {
-    QUrl url(filename);
-    QNetworkReply* reply = network_->get(QNetworkRequest(url));
-    NewClosure(reply, SIGNAL(finished()), this,
-               SLOT(RemoteFetchFinished(QNetworkReply*)), reply);
-
-    remote_tasks_.insert(reply, task);
+      filename.toLower().startsWith("https://") ||
+      filename.toLower().startsWith("spotify://image/")) {
+    // The network access manager belongs to the loader's thread.
+    {
+      QMutexLocker l(&mutex_);
+      remote_queue_.enqueue(task);
+    }
+    metaObject()->invokeMethod(this, "StartRemoteFetches",
+                               Qt::QueuedConnection);
     return TryLoadResult(true, false, QImage());
-  } else if (filename.toLower().startsWith("spotify://image/")) {
+  }
+
+  QImageReader reader(filename);
+  QImage image = ReadImage(&reader, task.options);
+  return TryLoadResult(
+      false, !image.isNull(),
+      image.isNull() ? task.options.default_output_image_ : image);
+}
+
+QImage AlbumCoverLoader::LoadEmbeddedArt(const QString& song_filename,
+                                         int max_size) {
+  return TagReaderClient::Instance()->LoadEmbeddedArtBlocking(song_filename,
+                                                              max_size);
+}
+
+int AlbumCoverLoader::MaxDecodeSize(const AlbumCoverLoaderOptions& options) {
+  if (options.scale_output_image_ && options.decode_at_scaled_size_) {
+    return options.desired_height_;
+  }
+  return options.max_original_size_;
+}
+
+QImage AlbumCoverLoader::ReadImage(QImageReader* reader,
+                                   const AlbumCoverLoaderOptions& options) {
+  TRACE_SPAN("AlbumCoverLoader::ReadImage");
+
+  const int max_size = MaxDecodeSize(options);
+  if (max_size > 0) {
+    // Let the decoder do the scaling - for JPEGs this skips most of the work.
+    const QSize size = reader->size();
+    const QSize desired(max_size, max_size);
+    if (size.isValid() &&
+        (size.width() > desired.width() || size.height() > desired.height())) {
+      reader->setScaledSize(size.scaled(desired, Qt::KeepAspectRatio));
+    }
+  }
+
+  return reader->read();
+}
+
+void AlbumCoverLoader::StartRemoteFetches() {
+  QQueue<Task> tasks;
+  {
+    QMutexLocker l(&mutex_);
+    tasks = remote_queue_;
+    remote_queue_.clear();
+  }
+
+  for (const Task& task : tasks) {
+    const QString filename = task.state == State_TryingAuto
+                                 ? task.art_automatic
+                                 : task.art_manual;
+
+    if (!filename.toLower().startsWith("spotify://image/")) {
+      QUrl url(filename);
+      QNetworkReply* reply = network_->get(QNetworkRequest(url));
+      NewClosure(reply, SIGNAL(finished()), this,
+                 SLOT(RemoteFetchFinished(QNetworkReply*)), reply);
+
+      remote_tasks_.insert(reply, task);
+      continue;
+    }
+
     // HACK: we should add generic image URL handlers
     SpotifyService* spotify = InternetModel::Service<SpotifyService>();
+    if (!spotify) {
+      Task next_task(task);
+      NextState(&next_task);
+      continue;
+    }
 
     if (!connected_spotify_) {
       connect(spotify, SIGNAL(ImageLoaded(QString, QImage)),
@@ -195,13 +316,7 @@ AlbumCoverLoader::TryLoadResult AlbumCoverLoader::TryLoadImage(
     // Need to schedule this in the spotify service's thread
     QMetaObject::invokeMethod(spotify, "LoadImage", Qt::QueuedConnection,
                               Q_ARG(QString, id));
-    return TryLoadResult(true, false, QImage());
   }
-
-  QImage image(filename);
-  return TryLoadResult(
-      false, !image.isNull(),
-      image.isNull() ? task.options.default_output_image_ : image);
 }
 
 void AlbumCoverLoader::SpotifyImageLoaded(const QString& id,
@@ -237,9 +352,15 @@ void AlbumCoverLoader::RemoteFetchFinished(QNetworkReply* reply) {
   }
 
   if (reply->error() == QNetworkReply::NoError) {
-    // Try to load the image
-    QImage image;
-    if (image.load(reply, 0)) {
+    // Try to load the image.  Read it into a buffer first so the reader can
+    // seek back after looking at the image's size.
+    QByteArray data = reply->readAll();
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+
+    QImage image = ReadImage(&reader, task.options);
+    if (!image.isNull()) {
       QImage scaled = ScaleAndPad(task.options, image);
       emit ImageLoaded(task.id, scaled);
       emit ImageLoaded(task.id, scaled, image);
@@ -254,6 +375,8 @@ QImage AlbumCoverLoader::ScaleAndPad(const AlbumCoverLoaderOptions& options,
                                      const QImage& image) {
   if (image.isNull()) return image;
 
+  TRACE_SPAN("AlbumCoverLoader::ScaleAndPad");
+
   // Scale the image down
   QImage copy;
   if (options.scale_output_image_) {
@@ -295,7 +418,7 @@ QPixmap AlbumCoverLoader::TryLoadPixmap(const QString& automatic,
 }
 
 quint64 AlbumCoverLoader::LoadImageAsync(const AlbumCoverLoaderOptions& options,
-                                         const Song& song) {
+                                         const Song& song, Priority priority) {
   return LoadImageAsync(options, song.art_automatic(), song.art_manual(),
-                        song.url().toLocalFile(), song.image());
+                        song.url().toLocalFile(), song.image(), priority);
 }
@@ -24,13 +24,16 @@
 #include "albumcoverloaderoptions.h"
 #include "core/song.h"
 
+#include <QHash>
 #include <QImage>
 #include <QMutex>
 #include <QObject>
 #include <QQueue>
+#include <QThreadPool>
 #include <QUrl>
 
 class NetworkAccessManager;
+class QImageReader;
 class QNetworkReply;
 
 class AlbumCoverLoader : public QObject {
@@ -39,18 +42,35 @@ class AlbumCoverLoader : public QObject {
  public:
   explicit AlbumCoverLoader(QObject* parent = nullptr);
 
+  // Tasks are decoded on a pool of threads, and higher priority tasks are
+  // always started first.  Views with lots of covers should load them all with
+  // Priority_Prefetch and then use SetPriority as they scroll.
+  enum Priority {
+    Priority_Visible = 0,
+    Priority_NearVisible,
+    Priority_Prefetch,
+  };
+  static const int kPriorityCount = Priority_Prefetch + 1;
+
   void Stop() { stop_requested_ = true; }
 
   static QString ImageCacheDir();
 
   quint64 LoadImageAsync(const AlbumCoverLoaderOptions& options,
-                         const Song& song);
+                         const Song& song,
+                         Priority priority = Priority_Visible);
   virtual quint64 LoadImageAsync(const AlbumCoverLoaderOptions& options,
                                  const QString& art_automatic,
                                  const QString& art_manual,
                                  const QString& song_filename = QString(),
-                                 const QImage& embedded_image = QImage());
+                                 const QImage& embedded_image = QImage(),
+                                 Priority priority = Priority_Visible);
 
+  // Changes the priority of tasks that haven't been started yet.
+  void SetPriority(const QSet<quint64>& ids, Priority priority);
+
+  // Cancelling is O(1) per task - cancelled tasks are skipped when they reach
+  // the front of their queue.
   void CancelTask(quint64 id);
   void CancelTasks(const QSet<quint64>& ids);
 
@@ -64,7 +84,7 @@ class AlbumCoverLoader : public QObject {
   void ImageLoaded(quint64 id, const QImage& scaled, const QImage& original);
 
  protected slots:
-  void ProcessTasks();
+  void StartRemoteFetches();
   void RemoteFetchFinished(QNetworkReply* reply);
   void SpotifyImageLoaded(const QString& url, const QImage& image);
 
@@ -72,11 +92,12 @@ class AlbumCoverLoader : public QObject {
   enum State { State_TryingManual, State_TryingAuto, };
 
   struct Task {
-    Task() : redirects(0) {}
+    Task() : priority(Priority_Visible), redirects(0) {}
 
     AlbumCoverLoaderOptions options;
 
     quint64 id;
+    Priority priority;
     QString art_automatic;
     QString art_manual;
     QString song_filename;
@@ -94,22 +115,50 @@ class AlbumCoverLoader : public QObject {
     QImage image;
   };
 
+  // Adds the task to the queue for its priority and starts another worker if
+  // there's room in the pool.
+  void EnqueueTask(const Task& task);
+
+  // Run on the thread pool.
+  void ProcessTasks();
+  bool NextTask(Task* task);
   void ProcessTask(Task* task);
+
   void NextState(Task* task);
   TryLoadResult TryLoadImage(const Task& task);
+  static QImage ReadImage(QImageReader* reader,
+                          const AlbumCoverLoaderOptions& options);
+
+  // The largest image that's needed for these options, or 0 for full size.
+  static int MaxDecodeSize(const AlbumCoverLoaderOptions& options);
+
+  // Asks the tagreader for the song's embedded image, scaled down to fit in a
+  // max_size square if max_size is set.  Run on the thread pool.  Virtual so
+  // tests can check what's requested without a tagreader.
+  virtual QImage LoadEmbeddedArt(const QString& song_filename, int max_size);
 
   bool stop_requested_;
 
+  // Protects tasks_, queues_, active_workers_, remote_queue_ and next_id_.
   QMutex mutex_;
-  QQueue<Task> tasks_;
+  QHash<quint64, Task> tasks_;
+  QQueue<quint64> queues_[kPriorityCount];
+  int active_workers_;
+  quint64 next_id_;
+
+  // Remote tasks are handed back to the loader's own thread, which owns the
+  // network access manager.
+  QQueue<Task> remote_queue_;
   QMap<QNetworkReply*, Task> remote_tasks_;
   QMap<QString, Task> remote_spotify_tasks_;
-  quint64 next_id_;
 
   NetworkAccessManager* network_;
 
   bool connected_spotify_;
 
+  // Declared last so it's destroyed (waiting for the workers) first.
+  QThreadPool pool_;
+
   static const int kMaxRedirects = 3;
 };
 
@@ -26,11 +26,24 @@ struct AlbumCoverLoaderOptions {
   AlbumCoverLoaderOptions()
       : desired_height_(120),
         scale_output_image_(true),
-        pad_output_image_(true) {}
+        pad_output_image_(true),
+        decode_at_scaled_size_(false),
+        max_original_size_(0) {}
 
   int desired_height_;
   bool scale_output_image_;
   bool pad_output_image_;
+
+  // If set, local, remote and embedded images are decoded straight at the
+  // output size instead of at full resolution.  This is much faster for
+  // thumbnails, but the "original" image passed to ImageLoaded is then the
+  // reduced one too.
+  bool decode_at_scaled_size_;
+
+  // If set, local and embedded images bigger than this are decoded to fit in
+  // a max_original_size_ square even when the full sized image is wanted.
+  // For callers that show the original but never need it any bigger.
+  int max_original_size_;
   QImage default_output_image_;
 };
 
@@ -80,8 +80,14 @@ void CoverExportRunnable::ProcessAndExportCover() {
 
   // load embedded cover if any
   if (song_.has_embedded_cover()) {
+    // The cover is going to be scaled to the forced size anyway, so it doesn't
+    // need decoding any bigger than that.
+    const int max_size =
+        dialog_result_.IsSizeForced()
+            ? qMax(dialog_result_.width_, dialog_result_.height_)
+            : 0;
     embedded_cover = TagReaderClient::Instance()->LoadEmbeddedArtBlocking(
-        song_.url().toLocalFile());
+        song_.url().toLocalFile(), max_size);
 
     if (embedded_cover.isNull()) {
       EmitCoverSkipped();
@@ -27,14 +27,14 @@
 #include "covers/albumcoverloader.h"
 #include "playlist/playlistmanager.h"
 
+const int CurrentArtLoader::kMaxArtSize = 2048;
+
 CurrentArtLoader::CurrentArtLoader(Application* app, QObject* parent)
     : QObject(parent),
       app_(app),
+      options_(DefaultOptions()),
       temp_file_pattern_(QDir::tempPath() + "/clementine-art-XXXXXX.jpg"),
       id_(0) {
-  options_.scale_output_image_ = false;
-  options_.pad_output_image_ = false;
-  options_.default_output_image_ = QImage(":nocover.png");
 
   connect(app_->album_cover_loader(), SIGNAL(ImageLoaded(quint64, QImage)),
           SLOT(TempArtLoaded(quint64, QImage)));
@@ -45,6 +45,15 @@ CurrentArtLoader::CurrentArtLoader(Application* app, QObject* parent)
 
 CurrentArtLoader::~CurrentArtLoader() {}
 
+AlbumCoverLoaderOptions CurrentArtLoader::DefaultOptions() {
+  AlbumCoverLoaderOptions options;
+  options.scale_output_image_ = false;
+  options.pad_output_image_ = false;
+  options.max_original_size_ = kMaxArtSize;
+  options.default_output_image_ = QImage(":nocover.png");
+  return options;
+}
+
 void CurrentArtLoader::LoadArt(const Song& song) {
   last_song_ = song;
   id_ = app_->album_cover_loader()->LoadImageAsync(options_, last_song_);
@@ -39,6 +39,13 @@ class CurrentArtLoader : public QObject {
   explicit CurrentArtLoader(Application* app, QObject* parent = nullptr);
   ~CurrentArtLoader();
 
+  // The art is shown in the now playing widget and behind the playlist, and
+  // neither needs it bigger than this.
+  static const int kMaxArtSize;
+
+  // The options the art is loaded with.
+  static AlbumCoverLoaderOptions DefaultOptions();
+
   const AlbumCoverLoaderOptions& options() const { return options_; }
   const Song& last_song() const { return last_song_; }
 
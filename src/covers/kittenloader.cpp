@@ -91,18 +91,23 @@ void KittenLoader::KittensRetrieved(QNetworkReply* reply) {
     }
   }
 
-  QMutexLocker l(&mutex_);
-  while (!kitten_urls_.isEmpty() && !pending_kittens_.isEmpty()) {
-    Task task = pending_kittens_.dequeue();
-    QUrl kitten_url = kitten_urls_.dequeue();
-    task.art_manual = kitten_url.toString();
-    task.state = State_TryingManual;
-    tasks_.enqueue(task);
+  QList<Task> tasks;
+  {
+    QMutexLocker l(&mutex_);
+    while (!kitten_urls_.isEmpty() && !pending_kittens_.isEmpty()) {
+      Task task = pending_kittens_.dequeue();
+      QUrl kitten_url = kitten_urls_.dequeue();
+      task.art_manual = kitten_url.toString();
+      task.state = State_TryingManual;
+      tasks << task;
+    }
   }
 
   if (kitten_urls_.isEmpty()) {
     FetchMoreKittens();
   }
 
-  metaObject()->invokeMethod(this, "ProcessTasks", Qt::QueuedConnection);
+  for (const Task& task : tasks) {
+    EnqueueTask(task);
+  }
 }
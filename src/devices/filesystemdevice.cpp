@@ -58,8 +58,8 @@ FilesystemDevice::FilesystemDevice(const QUrl& url, DeviceLister* lister,
           SLOT(AddOrUpdateSubdirs(SubdirectoryList)));
   connect(watcher_, SIGNAL(SubdirsMTimeUpdated(SubdirectoryList)), backend_,
           SLOT(AddOrUpdateSubdirs(SubdirectoryList)));
-  connect(watcher_, SIGNAL(CompilationsNeedUpdating()), backend_,
-          SLOT(UpdateCompilations()));
+  connect(watcher_, SIGNAL(CompilationsNeedUpdating(QStringList)), backend_,
+          SLOT(UpdateCompilationsForAlbums(QStringList)));
   connect(watcher_, SIGNAL(ScanStarted(int)), SIGNAL(TaskStarted(int)));
 }
 
@@ -46,6 +46,10 @@ class Base : public QObject {
   virtual bool Init() = 0;
 
   virtual void StartPreloading(const QUrl&, bool, qint64, qint64) {}
+  // Gets a track that is likely to be played next ready to start immediately,
+  // so a manual skip to it doesn't have to wait for it to be opened and
+  // decoded.  Only one track is prerolled at a time - an empty URL cancels it.
+  virtual void StartPrerolling(const QUrl&, bool, qint64, qint64) {}
   virtual bool Play(quint64 offset_nanosec) = 0;
   virtual void Stop(bool stop_after = false) = 0;
   virtual void Pause() = 0;
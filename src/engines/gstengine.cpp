@@ -104,6 +104,8 @@ GstEngine::GstEngine(TaskManager* task_manager)
       buffer_min_fill_(33),
       mono_playback_(false),
       sample_rate_(kAutoSampleRate),
+      preroll_enabled_(true),
+      preroll_end_nanosec_(0),
       seek_timer_(new QTimer(this)),
       timer_id_(-1),
       next_element_id_(0),
@@ -129,6 +131,7 @@ GstEngine::~GstEngine() {
   EnsureInitialised();
 
   current_pipeline_.reset();
+  preroll_pipeline_.reset();
 
   qDeleteAll(device_finders_);
 
@@ -206,6 +209,12 @@ void GstEngine::ReloadSettings() {
 
   mono_playback_ = s.value("monoplayback", false).toBool();
   sample_rate_ = s.value("samplerate", kAutoSampleRate).toInt();
+
+  preroll_enabled_ = s.value("preroll", true).toBool();
+
+  // The sink or replaygain settings might have changed, so don't reuse a
+  // pipeline that was built with the old ones.
+  preroll_pipeline_.reset();
 }
 
 qint64 GstEngine::position_nanosec() const {
@@ -355,6 +364,38 @@ void GstEngine::StartPreloading(const QUrl& url, bool force_stop_at_end,
                                   force_stop_at_end ? end_nanosec : 0);
 }
 
+void GstEngine::StartPrerolling(const QUrl& url, bool force_stop_at_end,
+                                qint64 beginning_nanosec, qint64 end_nanosec) {
+  EnsureInitialised();
+
+  const QUrl gst_url = FixupUrl(url);
+  const qint64 end = force_stop_at_end ? end_nanosec : 0;
+
+  if (preroll_pipeline_ && preroll_pipeline_->url() == gst_url &&
+      preroll_end_nanosec_ == end) {
+    // Already prerolled.
+    return;
+  }
+
+  preroll_pipeline_.reset();
+
+  // Only local files are prerolled - opening a stream would start buffering
+  // (and maybe count as a play on the server) for a track that might never be
+  // played.
+  if (!preroll_enabled_ || gst_url.scheme() != "file") return;
+
+  preroll_pipeline_ = CreatePipeline(gst_url, end);
+  if (!preroll_pipeline_) return;
+
+  preroll_end_nanosec_ = end;
+
+  // Going to PAUSED opens the file and finds the demuxer and decoder, which
+  // then wait with the first decoded buffer.  The output is held back so the
+  // audio device isn't opened for a track that might never be played.
+  preroll_pipeline_->HoldOutput();
+  preroll_pipeline_->SetState(GST_STATE_PAUSED);
+}
+
 QUrl GstEngine::FixupUrl(const QUrl& url) {
   QUrl copy = url;
 
@@ -396,13 +437,23 @@ bool GstEngine::Load(const QUrl& url, Engine::TrackChangeFlags change,
     return true;
   }
 
-  shared_ptr<GstEnginePipeline> pipeline =
-      CreatePipeline(gst_url, force_stop_at_end ? end_nanosec : 0);
+  const qint64 end = force_stop_at_end ? end_nanosec : 0;
+
+  shared_ptr<GstEnginePipeline> pipeline;
+  if (preroll_pipeline_ && preroll_pipeline_->url() == gst_url &&
+      preroll_end_nanosec_ == end) {
+    pipeline = preroll_pipeline_;
+    pipeline->ReleaseOutput();
+  } else {
+    pipeline = CreatePipeline(gst_url, end);
+  }
+  preroll_pipeline_.reset();
+
   if (!pipeline) return false;
 
   if (crossfade) StartFadeout();
 
-  BufferingFinished();
+  FinishBufferingTask();
   current_pipeline_ = pipeline;
 
   SetVolume(volume_);
@@ -490,7 +541,7 @@ void GstEngine::PlayDone() {
     // Failure - give up
     qLog(Warning) << "Could not set thread to PLAYING.";
     current_pipeline_.reset();
-    BufferingFinished();
+    FinishBufferingTask();
     return;
   }
 
@@ -526,7 +577,8 @@ void GstEngine::Stop(bool stop_after) {
   if (fadeout_enabled_ && current_pipeline_ && !stop_after) StartFadeout();
 
   current_pipeline_.reset();
-  BufferingFinished();
+  preroll_pipeline_.reset();
+  FinishBufferingTask();
   emit StateChanged(Engine::Empty);
 }
 
@@ -687,6 +739,14 @@ void GstEngine::timerEvent(QTimerEvent* e) {
 
 void GstEngine::HandlePipelineError(int pipeline_id, const QString& message,
                                     int domain, int error_code) {
+  if (preroll_pipeline_ && preroll_pipeline_->id() == pipeline_id) {
+    // Don't bother the user about a track they haven't asked to play yet -
+    // Load() will make a new pipeline and report the error if they do.
+    qLog(Debug) << "Error prerolling" << preroll_pipeline_->url() << message;
+    preroll_pipeline_.reset();
+    return;
+  }
+
   if (!current_pipeline_.get() || current_pipeline_->id() != pipeline_id)
     return;
 
@@ -694,7 +754,7 @@ void GstEngine::HandlePipelineError(int pipeline_id, const QString& message,
 
   current_pipeline_.reset();
 
-  BufferingFinished();
+  FinishBufferingTask();
   emit StateChanged(Engine::Error);
   // unable to play media stream with this url
   emit InvalidSongRequested(url_);
@@ -721,7 +781,7 @@ void GstEngine::EndOfStreamReached(int pipeline_id, bool has_next_track) {
 
   if (!has_next_track) {
     current_pipeline_.reset();
-    BufferingFinished();
+    FinishBufferingTask();
   }
   emit TrackEnded();
 }
@@ -803,10 +863,12 @@ shared_ptr<GstEnginePipeline> GstEngine::CreatePipeline() {
           SLOT(HandlePipelineError(int, QString, int, int)));
   connect(ret.get(), SIGNAL(MetadataFound(int, Engine::SimpleMetaBundle)),
           SLOT(NewMetaData(int, Engine::SimpleMetaBundle)));
-  connect(ret.get(), SIGNAL(BufferingStarted()), SLOT(BufferingStarted()));
-  connect(ret.get(), SIGNAL(BufferingProgress(int)),
-          SLOT(BufferingProgress(int)));
-  connect(ret.get(), SIGNAL(BufferingFinished()), SLOT(BufferingFinished()));
+  connect(ret.get(), SIGNAL(BufferingStarted(int)),
+          SLOT(BufferingStarted(int)));
+  connect(ret.get(), SIGNAL(BufferingProgress(int, int)),
+          SLOT(BufferingProgress(int, int)));
+  connect(ret.get(), SIGNAL(BufferingFinished(int)),
+          SLOT(BufferingFinished(int)));
 
   return ret;
 }
@@ -899,7 +961,11 @@ void GstEngine::SetBackgroundStreamVolume(int id, int volume) {
   pipeline->SetVolume(volume);
 }
 
-void GstEngine::BufferingStarted() {
+void GstEngine::BufferingStarted(int pipeline_id) {
+  // Ignore the fading out and prerolled pipelines.
+  if (!current_pipeline_.get() || current_pipeline_->id() != pipeline_id)
+    return;
+
   if (buffering_task_id_ != -1) {
     task_manager_->SetTaskFinished(buffering_task_id_);
   }
@@ -908,11 +974,21 @@ void GstEngine::BufferingStarted() {
   task_manager_->SetTaskProgress(buffering_task_id_, 0, 100);
 }
 
-void GstEngine::BufferingProgress(int percent) {
+void GstEngine::BufferingProgress(int pipeline_id, int percent) {
+  if (!current_pipeline_.get() || current_pipeline_->id() != pipeline_id)
+    return;
+
   task_manager_->SetTaskProgress(buffering_task_id_, percent, 100);
 }
 
-void GstEngine::BufferingFinished() {
+void GstEngine::BufferingFinished(int pipeline_id) {
+  if (!current_pipeline_.get() || current_pipeline_->id() != pipeline_id)
+    return;
+
+  FinishBufferingTask();
+}
+
+void GstEngine::FinishBufferingTask() {
   if (buffering_task_id_ != -1) {
     task_manager_->SetTaskFinished(buffering_task_id_);
     buffering_task_id_ = -1;
@@ -98,6 +98,8 @@ class GstEngine : public Engine::Base, public BufferConsumer {
  public slots:
   void StartPreloading(const QUrl& url, bool force_stop_at_end,
                        qint64 beginning_nanosec, qint64 end_nanosec);
+  void StartPrerolling(const QUrl& url, bool force_stop_at_end,
+                       qint64 beginning_nanosec, qint64 end_nanosec);
   bool Load(const QUrl&, Engine::TrackChangeFlags change,
             bool force_stop_at_end, quint64 beginning_nanosec,
             qint64 end_nanosec);
@@ -129,6 +131,10 @@ class GstEngine : public Engine::Base, public BufferConsumer {
   void SetVolumeSW(uint percent);
   void timerEvent(QTimerEvent*);
 
+  // Virtual so tests can see which pipelines get created.
+  virtual std::shared_ptr<GstEnginePipeline> CreatePipeline(
+      const QUrl& url, qint64 end_nanosec);
+
  private slots:
   void EndOfStreamReached(int pipeline_id, bool has_next_track);
   void HandlePipelineError(int pipeline_id, const QString& message, int domain,
@@ -142,9 +148,9 @@ class GstEngine : public Engine::Base, public BufferConsumer {
   void BackgroundStreamPlayDone();
   void PlayDone();
 
-  void BufferingStarted();
-  void BufferingProgress(int percent);
-  void BufferingFinished();
+  void BufferingStarted(int pipeline_id);
+  void BufferingProgress(int pipeline_id, int percent);
+  void BufferingFinished(int pipeline_id);
 
  private:
   typedef QPair<quint64, int> PlayFutureWatcherArg;
@@ -167,8 +173,8 @@ class GstEngine : public Engine::Base, public BufferConsumer {
   void StopTimers();
 
   std::shared_ptr<GstEnginePipeline> CreatePipeline();
-  std::shared_ptr<GstEnginePipeline> CreatePipeline(const QUrl& url,
-                                                    qint64 end_nanosec);
+
+  void FinishBufferingTask();
 
   void UpdateScope(int chunk_length);
 
@@ -197,6 +203,12 @@ class GstEngine : public Engine::Base, public BufferConsumer {
   std::shared_ptr<GstEnginePipeline> fadeout_pause_pipeline_;
   QUrl preloaded_url_;
 
+  // A paused pipeline for the track the player thinks will be played next.
+  // Load() takes it over if it's asked for the same URL.
+  bool preroll_enabled_;
+  std::shared_ptr<GstEnginePipeline> preroll_pipeline_;
+  qint64 preroll_end_nanosec_;
+
   QList<BufferConsumer*> buffer_consumers_;
 
   GstBuffer* latest_buffer_;
@@ -78,6 +78,9 @@ GstEnginePipeline::GstEnginePipeline(GstEngine* engine)
       pipeline_is_initialised_(false),
       pipeline_is_connected_(false),
       pending_seek_nanosec_(-1),
+      output_held_(false),
+      output_hold_pad_(nullptr),
+      output_hold_probe_id_(0),
       last_known_position_ns_(0),
       volume_percent_(100),
       volume_modifier_(1.0),
@@ -174,8 +177,9 @@ bool GstEnginePipeline::ReplaceDecodeBin(const QUrl& url) {
     gst_object_unref(GST_OBJECT(pad));
 
     // Tell spotify to start sending data to us.
-    InternetModel::Service<SpotifyService>()->server()->StartPlaybackLater(
-        url.toString(), port);
+    SpotifyService* spotify = InternetModel::Service<SpotifyService>();
+    if (!spotify) return false;
+    spotify->server()->StartPlaybackLater(url.toString(), port);
   } else {
     new_bin = engine_->CreateElement("uridecodebin");
     g_object_set(G_OBJECT(new_bin), "uri", url.toEncoded().constData(),
@@ -480,6 +484,39 @@ GstEnginePipeline::~GstEnginePipeline() {
     gst_element_set_state(pipeline_, GST_STATE_NULL);
     gst_object_unref(GST_OBJECT(pipeline_));
   }
+
+  if (output_hold_pad_) gst_object_unref(output_hold_pad_);
+}
+
+void GstEnginePipeline::HoldOutput() {
+  QMutexLocker l(&output_hold_mutex_);
+  if (!audiobin_ || output_held_) return;
+
+  output_held_ = true;
+  gst_element_set_locked_state(audiobin_, TRUE);
+}
+
+void GstEnginePipeline::ReleaseOutput() {
+  QMutexLocker l(&output_hold_mutex_);
+  if (!output_held_) return;
+
+  output_held_ = false;
+  gst_element_set_locked_state(audiobin_, FALSE);
+  gst_element_sync_state_with_parent(audiobin_);
+
+  if (output_hold_pad_) {
+    gst_pad_remove_probe(output_hold_pad_, output_hold_probe_id_);
+    gst_object_unref(output_hold_pad_);
+    output_hold_pad_ = nullptr;
+    output_hold_probe_id_ = 0;
+  }
+}
+
+GstPadProbeReturn GstEnginePipeline::HoldOutputCallback(GstPad*,
+                                                        GstPadProbeInfo*,
+                                                        gpointer) {
+  // Keep the pad blocked until ReleaseOutput() removes the probe.
+  return GST_PAD_PROBE_OK;
 }
 
 gboolean GstEnginePipeline::BusCallback(GstBus*, GstMessage* msg,
@@ -730,16 +767,16 @@ void GstEnginePipeline::BufferingMessageReceived(GstMessage* msg) {
 
   if (percent == 0 && current_state == GST_STATE_PLAYING && !buffering_) {
     buffering_ = true;
-    emit BufferingStarted();
+    emit BufferingStarted(id());
 
     SetState(GST_STATE_PAUSED);
   } else if (percent == 100 && buffering_) {
     buffering_ = false;
-    emit BufferingFinished();
+    emit BufferingFinished(id());
 
     SetState(GST_STATE_PLAYING);
   } else if (buffering_) {
-    emit BufferingProgress(percent);
+    emit BufferingProgress(id(), percent);
   }
 }
 
@@ -775,6 +812,18 @@ void GstEnginePipeline::NewPadCallback(GstElement*, GstPad* pad,
                                         GST_PAD_PROBE_TYPE_EVENT_FLUSH),
       DecodebinProbe, instance, nullptr);
 
+  // The audiobin is in NULL while the output is held, so anything pushed into
+  // it would fail with FLUSHING.  Block here instead, before its sink pad.
+  {
+    QMutexLocker l(&instance->output_hold_mutex_);
+    if (instance->output_held_ && !instance->output_hold_pad_) {
+      instance->output_hold_pad_ = GST_PAD(gst_object_ref(pad));
+      instance->output_hold_probe_id_ =
+          gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BLOCK_DOWNSTREAM,
+                            HoldOutputCallback, nullptr, nullptr);
+    }
+  }
+
   instance->pipeline_is_connected_ = true;
   if (instance->pending_seek_nanosec_ != -1 &&
       instance->pipeline_is_initialised_) {
@@ -1028,15 +1077,19 @@ QFuture<GstStateChangeReturn> GstEnginePipeline::SetState(GstState state) {
       SpotifyService* spotify = InternetModel::Service<SpotifyService>();
 
       // Need to schedule this in the spotify service's thread
-      QMetaObject::invokeMethod(spotify, "SetPaused", Qt::QueuedConnection,
-                                Q_ARG(bool, true));
+      if (spotify) {
+        QMetaObject::invokeMethod(spotify, "SetPaused", Qt::QueuedConnection,
+                                  Q_ARG(bool, true));
+      }
     } else if (state == GST_STATE_PLAYING &&
                current_state == GST_STATE_PAUSED) {
       SpotifyService* spotify = InternetModel::Service<SpotifyService>();
 
       // Need to schedule this in the spotify service's thread
-      QMetaObject::invokeMethod(spotify, "SetPaused", Qt::QueuedConnection,
-                                Q_ARG(bool, false));
+      if (spotify) {
+        QMetaObject::invokeMethod(spotify, "SetPaused", Qt::QueuedConnection,
+                                  Q_ARG(bool, false));
+      }
     }
   }
   return ConcurrentRun::Run<GstStateChangeReturn, GstElement*, GstState>(
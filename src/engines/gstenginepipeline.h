@@ -61,6 +61,13 @@ class GstEnginePipeline : public QObject {
   bool InitFromUrl(const QUrl& url, qint64 end_nanosec);
   bool InitFromString(const QString& pipeline);
 
+  // Call before going to PAUSED to only decode as far as the audiobin: the
+  // output stays in NULL, so the audio device isn't opened, and the first
+  // decoded buffer waits on the decodebin's src pad.  ReleaseOutput() lets
+  // it through once the pipeline is going to be played.
+  void HoldOutput();
+  void ReleaseOutput();
+
   // BufferConsumers get fed audio data.  Thread-safe.
   void AddBufferConsumer(BufferConsumer* consumer);
   void RemoveBufferConsumer(BufferConsumer* consumer);
@@ -118,9 +125,9 @@ signals:
              int error_code);
   void FaderFinished();
 
-  void BufferingStarted();
-  void BufferingProgress(int percent);
-  void BufferingFinished();
+  void BufferingStarted(int pipeline_id);
+  void BufferingProgress(int pipeline_id, int percent);
+  void BufferingFinished(int pipeline_id);
 
  protected:
   void timerEvent(QTimerEvent*);
@@ -135,6 +142,8 @@ signals:
   static GstPadProbeReturn EventHandoffCallback(GstPad*, GstPadProbeInfo*,
                                                 gpointer);
   static GstPadProbeReturn DecodebinProbe(GstPad*, GstPadProbeInfo*, gpointer);
+  static GstPadProbeReturn HoldOutputCallback(GstPad*, GstPadProbeInfo*,
+                                              gpointer);
   static void SourceDrainedCallback(GstURIDecodeBin*, gpointer);
   static void SourceSetupCallback(GstURIDecodeBin*, GParamSpec* pspec,
                                   gpointer);
@@ -260,6 +269,13 @@ signals:
   bool pipeline_is_connected_;
   qint64 pending_seek_nanosec_;
 
+  // Set by HoldOutput().  NewPadCallback() runs in a streaming thread, so the
+  // blocked pad and its probe are protected by the mutex.
+  QMutex output_hold_mutex_;
+  bool output_held_;
+  GstPad* output_hold_pad_;
+  gulong output_hold_probe_id_;
+
   // We can only use gst_element_query_position() when the pipeline is in
   // PAUSED nor PLAYING state. Whenever we get a new position (e.g. after a
   // correct call to gst_element_query_position() or after a seek), we store
@@ -37,10 +37,13 @@ GlobalSearch::GlobalSearch(Application* app, QObject* parent)
     : QObject(parent),
       app_(app),
       next_id_(1),
+      lazy_providers_requested_(false),
+      disabled_lazy_providers_requested_(false),
       url_provider_(new UrlSearchProvider(app, this)) {
   cover_loader_options_.desired_height_ = SearchProvider::kArtHeight;
   cover_loader_options_.pad_output_image_ = true;
   cover_loader_options_.scale_output_image_ = true;
+  cover_loader_options_.decode_at_scaled_size_ = true;
 
   connect(app_->album_cover_loader(), SIGNAL(ImageLoaded(quint64, QImage)),
           SLOT(AlbumArtLoaded(quint64, QImage)));
@@ -61,26 +64,36 @@ void GlobalSearch::ConnectProvider(SearchProvider* provider) {
 void GlobalSearch::AddProvider(SearchProvider* provider) {
   Q_ASSERT(!provider->name().isEmpty());
 
-  bool enabled = provider->is_enabled_by_default();
-
-  // Check if there is saved enabled/disabled state for this provider.
-  QSettings s;
-  s.beginGroup(kSettingsGroup);
-  QVariant enabled_variant = s.value("enabled_" + provider->id());
-  if (enabled_variant.isValid()) {
-    enabled = enabled_variant.toBool();
-  }
-
   // Add data
   ProviderData data;
-  data.enabled_ = enabled;
+  data.enabled_ = IsProviderEnabledInSettings(
+      provider->id(), provider->is_enabled_by_default());
   providers_[provider] = data;
 
   ConnectProvider(provider);
   emit ProviderAdded(provider);
 }
 
+void GlobalSearch::RequestLazyProviders(bool include_disabled) {
+  if (disabled_lazy_providers_requested_) return;
+  if (lazy_providers_requested_ && !include_disabled) return;
+  lazy_providers_requested_ = true;
+  disabled_lazy_providers_requested_ = include_disabled;
+
+  emit LazyProvidersRequested(include_disabled);
+}
+
+bool GlobalSearch::IsProviderEnabledInSettings(const QString& id,
+                                               bool enabled_by_default) {
+  // Check if there is saved enabled/disabled state for this provider.
+  QSettings s;
+  s.beginGroup(kSettingsGroup);
+  return s.value("enabled_" + id, enabled_by_default).toBool();
+}
+
 int GlobalSearch::SearchAsync(const QString& query) {
+  RequestLazyProviders();
+
   const int id = next_id_++;
   pending_search_providers_[id] = 0;
 
@@ -116,7 +129,14 @@ void GlobalSearch::CancelSearch(int id) {
     if (it.value().id_ == id) {
       killTimer(it.key());
       delayed_searches_.erase(it);
-      return;
+      break;
+    }
+  }
+
+  // Let the providers that are already searching stop early.
+  if (pending_search_providers_.contains(id)) {
+    for (SearchProvider* provider : providers_.keys()) {
+      provider->CancelSearch(id);
     }
   }
 }
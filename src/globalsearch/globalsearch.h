@@ -56,6 +56,19 @@ class GlobalSearch : public QObject {
   bool FindCachedPixmap(const SearchProvider::Result& result,
                         QPixmap* pixmap) const;
 
+  // Some providers belong to services that are only created when they're
+  // needed.  This emits LazyProvidersRequested so they can be created and
+  // added before a search or the list of providers is shown.  Only the
+  // enabled ones are wanted for searching, but the settings page has to list
+  // the disabled ones too so they can be turned on.  SearchAsync calls it
+  // automatically.
+  void RequestLazyProviders(bool include_disabled = false);
+
+  // Returns the saved enabled state of a provider that might not have been
+  // added yet, or enabled_by_default if the user has never changed it.
+  static bool IsProviderEnabledInSettings(const QString& id,
+                                          bool enabled_by_default);
+
   // "enabled" is the user preference.  "usable" is enabled AND logged in.
   QList<SearchProvider*> providers() const;
   bool is_provider_enabled(const SearchProvider* provider) const;
@@ -71,6 +84,7 @@ signals:
 
   void ArtLoaded(int id, const QPixmap& pixmap);
 
+  void LazyProvidersRequested(bool include_disabled);
   void ProviderAdded(const SearchProvider* provider);
   void ProviderRemoved(const SearchProvider* provider);
   void ProviderToggled(const SearchProvider* provider, bool enabled);
@@ -120,6 +134,8 @@ signals:
 
   int next_id_;
   QMap<int, int> pending_search_providers_;
+  bool lazy_providers_requested_;
+  bool disabled_lazy_providers_requested_;
 
   QPixmapCache pixmap_cache_;
   QMap<int, QString> pending_art_searches_;
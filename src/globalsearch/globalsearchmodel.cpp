@@ -20,12 +20,14 @@
 #include "core/mimedata.h"
 #include "ui/iconloader.h"
 
-#include <QSortFilterProxyModel>
+#include <algorithm>
+#include <cwchar>
 
 GlobalSearchModel::GlobalSearchModel(GlobalSearch* engine, QObject* parent)
-    : QStandardItemModel(parent),
+    : QAbstractItemModel(parent),
       engine_(engine),
-      proxy_(nullptr),
+      root_(Node::Type_Root, nullptr),
+      next_provider_sort_index_(1000),
       use_pretty_covers_(true),
       artist_icon_(IconLoader::Load("x-clementine-artist", IconLoader::Base)),
       album_icon_(IconLoader::Load("x-clementine-album", IconLoader::Base)) {
@@ -38,6 +40,73 @@ GlobalSearchModel::GlobalSearchModel(GlobalSearch* engine, QObject* parent)
       Qt::KeepAspectRatio, Qt::SmoothTransformation);
 }
 
+GlobalSearchModel::~GlobalSearchModel() {}
+
+#if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
+
+GlobalSearchModel::CollationKey GlobalSearchModel::MakeCollationKey(
+    const QString& text) {
+  const std::wstring source = text.toStdWString();
+  const size_t length = wcsxfrm(nullptr, source.c_str(), 0);
+  if (length == size_t(-1)) {
+    return source;
+  }
+
+  std::wstring ret(length + 1, L'\0');
+  wcsxfrm(&ret[0], source.c_str(), length + 1);
+  ret.resize(length);
+  return ret;
+}
+
+int GlobalSearchModel::CompareCollationKeys(const CollationKey& left,
+                                            const CollationKey& right) {
+  return left.compare(right);
+}
+
+#else
+
+GlobalSearchModel::CollationKey GlobalSearchModel::MakeCollationKey(
+    const QString& text) {
+  return text;
+}
+
+int GlobalSearchModel::CompareCollationKeys(const CollationKey& left,
+                                            const CollationKey& right) {
+  return QString::localeAwareCompare(left, right);
+}
+
+#endif
+
+bool GlobalSearchModel::CompareNodes(const Node* left, const Node* right) {
+  const SortKey& l = left->sort_key_;
+  const SortKey& r = right->sort_key_;
+
+#define CMP(field)                     \
+  if (l.field < r.field) return true;  \
+  if (l.field > r.field) return false
+
+  // Provider order first, then dividers before containers before songs.
+  // Containers are then sorted on their sort text and songs by disc, track
+  // and title.
+  CMP(provider_index_);
+  CMP(type_);
+  CMP(disc_);
+  CMP(track_);
+  return CompareCollationKeys(l.text_, r.text_) < 0;
+
+#undef CMP
+}
+
+void GlobalSearchModel::AddChild(Node* parent, Node* child) {
+  new_nodes_.insert(child);
+
+  if (new_nodes_.contains(parent)) {
+    parent->children_ << child;
+  } else {
+    pending_[parent] << child;
+  }
+}
+
 void GlobalSearchModel::AddResults(const SearchProvider::ResultList& results) {
   int sort_index = 0;
 
@@ -53,20 +122,22 @@ void GlobalSearchModel::AddResults(const SearchProvider::ResultList& results) {
       sort_index = next_provider_sort_index_++;
     }
 
-    QStandardItem* divider =
-        new QStandardItem(provider->icon(), provider->name());
-    divider->setData(true, LibraryModel::Role_IsDivider);
-    divider->setData(sort_index, Role_ProviderIndex);
-    divider->setFlags(Qt::ItemIsEnabled);
-    appendRow(divider);
+    Node* divider = new Node(Node::Type_Divider, &root_);
+    divider->display_text_ = provider->name();
+    divider->decoration_ = provider->icon();
+    divider->sort_key_.provider_index_ = sort_index;
+    divider->sort_key_.type_ = Node::Type_Divider;
+    AddChild(&root_, divider);
 
     provider_sort_indices_[provider] = sort_index;
   } else {
     sort_index = provider_sort_indices_[provider];
   }
 
+  results_.reserve(results_.count() + results.count());
+
   for (const SearchProvider::Result& result : results) {
-    QStandardItem* parent = invisibleRootItem();
+    Node* parent = &root_;
 
     // Find (or create) the container nodes for this result if we can.
     if (result.group_automatically_) {
@@ -77,19 +148,86 @@ void GlobalSearchModel::AddResults(const SearchProvider::ResultList& results) {
     }
 
     // Create the item
-    QStandardItem* item = new QStandardItem;
-    item->setText(result.metadata_.TitleWithCompilationArtist());
-    item->setData(QVariant::fromValue(result), Role_Result);
-    item->setData(sort_index, Role_ProviderIndex);
+    Node* node = new Node(Node::Type_Result, parent);
+    node->display_text_ = result.metadata_.TitleWithCompilationArtist();
+    node->result_index_ = results_.count();
+    node->sort_key_.provider_index_ = sort_index;
+    node->sort_key_.type_ = Node::Type_Result;
+    node->sort_key_.disc_ = result.metadata_.disc();
+    node->sort_key_.track_ = result.metadata_.track();
+    node->sort_key_.text_ = MakeCollationKey(result.metadata_.title());
+    results_ << result;
+
+    AddChild(parent, node);
+  }
 
-    parent->appendRow(item);
+  MergePending();
+}
+
+void GlobalSearchModel::MergePending() {
+  // Sort the children of the nodes that were created by this batch first -
+  // these go into the model along with their parents.
+  for (Node* node : new_nodes_) {
+    if (node->children_.isEmpty()) continue;
+
+    std::stable_sort(node->children_.begin(), node->children_.end(),
+                     CompareNodes);
+    for (int i = 0; i < node->children_.count(); ++i) {
+      node->children_[i]->row_ = i;
+    }
   }
+
+  // Now merge the new children into each existing node in a single pass,
+  // inserting each run of consecutive new rows with one beginInsertRows.
+  for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+    Node* parent = it.key();
+    QList<Node*>& new_children = it.value();
+    std::stable_sort(new_children.begin(), new_children.end(), CompareNodes);
+
+    const QModelIndex parent_index = IndexForNode(parent);
+    QList<Node*>& children = parent->children_;
+
+    int row = 0;
+    int i = 0;
+    while (i < new_children.count()) {
+      // Skip past the existing rows that go before the next new one.
+      while (row < children.count() &&
+             !CompareNodes(new_children[i], children[row])) {
+        ++row;
+      }
+
+      // Find all the new rows that go before that existing row.
+      int end = new_children.count();
+      if (row < children.count()) {
+        end = i + 1;
+        while (end < new_children.count() &&
+               CompareNodes(new_children[end], children[row])) {
+          ++end;
+        }
+      }
+
+      beginInsertRows(parent_index, row, row + end - i - 1);
+      for (int j = i; j < end; ++j) {
+        children.insert(row + j - i, new_children[j]);
+      }
+      for (int j = row; j < children.count(); ++j) {
+        children[j]->row_ = j;
+      }
+      endInsertRows();
+
+      row += end - i;
+      i = end;
+    }
+  }
+
+  pending_.clear();
+  new_nodes_.clear();
 }
 
-QStandardItem* GlobalSearchModel::BuildContainers(const Song& s,
-                                                  QStandardItem* parent,
-                                                  ContainerKey* key,
-                                                  int level) {
+GlobalSearchModel::Node* GlobalSearchModel::BuildContainers(const Song& s,
+                                                            Node* parent,
+                                                            ContainerKey* key,
+                                                            int level) {
   if (level >= 3) {
     return parent;
   }
@@ -180,24 +318,27 @@ QStandardItem* GlobalSearchModel::BuildContainers(const Song& s,
 
   // Find a container for this level
   key->group_[level] = display_text + QString::number(unique_tag);
-  QStandardItem* container = containers_[*key];
+  Node* container = containers_[*key];
   if (!container) {
-    container = new QStandardItem(display_text);
-    container->setData(key->provider_index_, Role_ProviderIndex);
-    container->setData(sort_text, LibraryModel::Role_SortText);
-    container->setData(group_by_[level], LibraryModel::Role_ContainerType);
+    container = new Node(Node::Type_Container, parent);
+    container->display_text_ = display_text;
+    container->sort_text_ = sort_text;
+    container->container_type_ = group_by_[level];
+    container->sort_key_.provider_index_ = key->provider_index_;
+    container->sort_key_.type_ = Node::Type_Container;
+    container->sort_key_.text_ = MakeCollationKey(sort_text);
 
     if (has_artist_icon) {
-      container->setIcon(artist_icon_);
+      container->decoration_ = artist_icon_;
     } else if (has_album_icon) {
       if (use_pretty_covers_) {
-        container->setData(no_cover_icon_, Qt::DecorationRole);
+        container->decoration_ = no_cover_icon_;
       } else {
-        container->setIcon(album_icon_);
+        container->decoration_ = album_icon_;
       }
     }
 
-    parent->appendRow(container);
+    AddChild(parent, container);
     containers_[*key] = container;
   }
 
@@ -206,97 +347,182 @@ QStandardItem* GlobalSearchModel::BuildContainers(const Song& s,
 }
 
 void GlobalSearchModel::Clear() {
+  beginResetModel();
+  qDeleteAll(root_.children_);
+  root_.children_.clear();
+  results_.clear();
   provider_sort_indices_.clear();
   containers_.clear();
   next_provider_sort_index_ = 1000;
-  clear();
+  endResetModel();
 }
 
-SearchProvider::ResultList GlobalSearchModel::GetChildResults(
-    const QModelIndexList& indexes) const {
-  QList<QStandardItem*> items;
-  for (const QModelIndex& index : indexes) {
-    items << itemFromIndex(index);
+GlobalSearchModel::Node* GlobalSearchModel::NodeForIndex(
+    const QModelIndex& index) const {
+  if (!index.isValid()) return const_cast<Node*>(&root_);
+  return static_cast<Node*>(index.internalPointer());
+}
+
+QModelIndex GlobalSearchModel::IndexForNode(const Node* node) const {
+  if (node == &root_) return QModelIndex();
+  return createIndex(node->row_, 0, const_cast<Node*>(node));
+}
+
+QModelIndex GlobalSearchModel::index(int row, int column,
+                                     const QModelIndex& parent) const {
+  const Node* parent_node = NodeForIndex(parent);
+  if (column != 0 || row < 0 || row >= parent_node->children_.count()) {
+    return QModelIndex();
   }
-  return GetChildResults(items);
+  return IndexForNode(parent_node->children_[row]);
+}
+
+QModelIndex GlobalSearchModel::parent(const QModelIndex& index) const {
+  if (!index.isValid()) return QModelIndex();
+  return IndexForNode(NodeForIndex(index)->parent_);
+}
+
+int GlobalSearchModel::rowCount(const QModelIndex& parent) const {
+  if (parent.column() > 0) return 0;
+  return NodeForIndex(parent)->children_.count();
+}
+
+int GlobalSearchModel::columnCount(const QModelIndex&) const { return 1; }
+
+bool GlobalSearchModel::hasChildren(const QModelIndex& parent) const {
+  return rowCount(parent) > 0;
+}
+
+QVariant GlobalSearchModel::data(const QModelIndex& index, int role) const {
+  if (!index.isValid()) return QVariant();
+  const Node* node = NodeForIndex(index);
+
+  switch (role) {
+    case Qt::DisplayRole:
+      return node->display_text_;
+
+    case Qt::DecorationRole:
+      return node->decoration_;
+
+    case LibraryModel::Role_IsDivider:
+      return node->type_ == Node::Type_Divider;
+
+    case LibraryModel::Role_ContainerType:
+      if (node->type_ != Node::Type_Container) return QVariant();
+      return int(node->container_type_);
+
+    case LibraryModel::Role_SortText:
+      if (node->type_ != Node::Type_Container) return QVariant();
+      return node->sort_text_;
+
+    case Role_Result:
+      if (node->type_ != Node::Type_Result) return QVariant();
+      return QVariant::fromValue(results_[node->result_index_]);
+
+    case Role_LazyLoadingArt:
+      if (!node->lazy_loading_art_) return QVariant();
+      return true;
+
+    case Role_ProviderIndex:
+      return node->sort_key_.provider_index_;
+  }
+
+  return QVariant();
+}
+
+bool GlobalSearchModel::setData(const QModelIndex& index,
+                                const QVariant& value, int role) {
+  if (!index.isValid()) return false;
+  Node* node = NodeForIndex(index);
+
+  switch (role) {
+    case Qt::DecorationRole:
+      node->decoration_ = value;
+      break;
+
+    case Role_LazyLoadingArt:
+      node->lazy_loading_art_ = value.toBool();
+      break;
+
+    default:
+      return false;
+  }
+
+  const QModelIndex current_index = IndexForNode(node);
+  emit dataChanged(current_index, current_index);
+  return true;
+}
+
+Qt::ItemFlags GlobalSearchModel::flags(const QModelIndex& index) const {
+  if (!index.isValid()) return 0;
+  if (NodeForIndex(index)->type_ == Node::Type_Divider) {
+    return Qt::ItemIsEnabled;
+  }
+  return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDragEnabled;
 }
 
 SearchProvider::ResultList GlobalSearchModel::GetChildResults(
-    const QList<QStandardItem*>& items) const {
+    const QModelIndexList& indexes) const {
   SearchProvider::ResultList results;
-  QSet<const QStandardItem*> visited;
+  QSet<const Node*> visited;
 
-  for (QStandardItem* item : items) {
-    GetChildResults(item, &results, &visited);
+  for (const QModelIndex& index : indexes) {
+    if (index.isValid()) {
+      GetChildResults(NodeForIndex(index), &results, &visited);
+    }
   }
 
   return results;
 }
 
 void GlobalSearchModel::GetChildResults(
-    const QStandardItem* item, SearchProvider::ResultList* results,
-    QSet<const QStandardItem*>* visited) const {
-  if (visited->contains(item)) {
+    const Node* node, SearchProvider::ResultList* results,
+    QSet<const Node*>* visited) const {
+  if (visited->contains(node)) {
     return;
   }
-  visited->insert(item);
-
-  // Does this item have children?
-  if (item->rowCount()) {
-    const QModelIndex parent_proxy_index = proxy_->mapFromSource(item->index());
-
-    // Yes - visit all the children, but do so through the proxy so we get them
-    // in the right order.
-    for (int i = 0; i < item->rowCount(); ++i) {
-      const QModelIndex proxy_index = parent_proxy_index.child(i, 0);
-      const QModelIndex index = proxy_->mapToSource(proxy_index);
-      GetChildResults(itemFromIndex(index), results, visited);
-    }
-  } else {
-    // No - maybe it's a song, add its result if valid
-    QVariant result = item->data(Role_Result);
-    if (result.isValid()) {
-      results->append(result.value<SearchProvider::Result>());
-    } else {
-      // Maybe it's a provider then?
-      bool is_provider;
-      const int sort_index = item->data(Role_ProviderIndex).toInt(&is_provider);
-      if (is_provider) {
-        // Go through all the items (through the proxy to keep them ordered) and
-        // add the ones belonging to this provider to our list
-        for (int i = 0; i < proxy_->rowCount(invisibleRootItem()->index());
-             ++i) {
-          QModelIndex child_index =
-              proxy_->index(i, 0, invisibleRootItem()->index());
-          const QStandardItem* child_item =
-              itemFromIndex(proxy_->mapToSource(child_index));
-          if (child_item->data(Role_ProviderIndex).toInt() == sort_index) {
-            GetChildResults(child_item, results, visited);
-          }
+  visited->insert(node);
+
+  switch (node->type_) {
+    case Node::Type_Root:
+    case Node::Type_Container:
+      // Children are already in the right order.
+      for (const Node* child : node->children_) {
+        GetChildResults(child, results, visited);
+      }
+      break;
+
+    case Node::Type_Result:
+      results->append(results_[node->result_index_]);
+      break;
+
+    case Node::Type_Divider:
+      // Add all the top level items belonging to this provider.
+      for (const Node* child : root_.children_) {
+        if (child->sort_key_.provider_index_ ==
+            node->sort_key_.provider_index_) {
+          GetChildResults(child, results, visited);
         }
       }
-    }
+      break;
   }
 }
 
-QMimeData* GlobalSearchModel::mimeData(const QModelIndexList& indexes) const {
-  return engine_->LoadTracks(GetChildResults(indexes));
-}
-
-namespace {
-void GatherResults(const QStandardItem* parent,
-                   QMap<SearchProvider*, SearchProvider::ResultList>* results) {
-  QVariant result_variant = parent->data(GlobalSearchModel::Role_Result);
-  if (result_variant.isValid()) {
-    SearchProvider::Result result =
-        result_variant.value<SearchProvider::Result>();
-    (*results)[result.provider_].append(result);
+SearchProvider::Result GlobalSearchModel::FirstChildResult(
+    const QModelIndex& index) const {
+  const Node* node = NodeForIndex(index);
+  while (!node->children_.isEmpty()) {
+    node = node->children_.first();
   }
 
-  for (int i = 0; i < parent->rowCount(); ++i) {
-    GatherResults(parent->child(i), results);
+  if (node->type_ != Node::Type_Result) {
+    return SearchProvider::Result();
   }
+  return results_[node->result_index_];
 }
+
+QMimeData* GlobalSearchModel::mimeData(const QModelIndexList& indexes) const {
+  return engine_->LoadTracks(GetChildResults(indexes));
 }
 
 void GlobalSearchModel::SetGroupBy(const LibraryModel::Grouping& grouping,
@@ -305,9 +531,11 @@ void GlobalSearchModel::SetGroupBy(const LibraryModel::Grouping& grouping,
   group_by_ = grouping;
 
   if (regroup_now && group_by_ != old_group_by) {
-    // Walk the tree gathering the results we have already
+    // Take the results we have already, grouped by provider.
     QMap<SearchProvider*, SearchProvider::ResultList> results;
-    GatherResults(invisibleRootItem(), &results);
+    for (const SearchProvider::Result& result : results_) {
+      results[result.provider_].append(result);
+    }
 
     // Reset the model and re-add all the results using the new grouping.
     Clear();
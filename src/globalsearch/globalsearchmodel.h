@@ -21,17 +21,24 @@
 #include "searchprovider.h"
 #include "library/librarymodel.h"
 
-#include <QStandardItemModel>
+#include <string>
 
-class GlobalSearch;
+#include <QAbstractItemModel>
+#include <QVector>
 
-class QSortFilterProxyModel;
+class GlobalSearch;
 
-class GlobalSearchModel : public QStandardItemModel {
+// Holds the results of a global search as a tree of provider dividers,
+// artist/album containers and songs.  Every node's children are kept in
+// display order as results arrive, so no sorting proxy is needed on top: each
+// AddResults call sorts the new rows once on keys computed when they are
+// created and merges them into the existing ones.
+class GlobalSearchModel : public QAbstractItemModel {
   Q_OBJECT
 
  public:
   GlobalSearchModel(GlobalSearch* engine, QObject* parent = nullptr);
+  ~GlobalSearchModel();
 
   enum Role {
     Role_Result = LibraryModel::LastRole,
@@ -45,7 +52,6 @@ class GlobalSearchModel : public QStandardItemModel {
     QString group_[3];
   };
 
-  void set_proxy(QSortFilterProxyModel* proxy) { proxy_ = proxy; }
   void set_use_pretty_covers(bool pretty) { use_pretty_covers_ = pretty; }
   void set_provider_order(const QStringList& provider_order) {
     provider_order_ = provider_order;
@@ -56,31 +62,110 @@ class GlobalSearchModel : public QStandardItemModel {
 
   SearchProvider::ResultList GetChildResults(const QModelIndexList& indexes)
       const;
-  SearchProvider::ResultList GetChildResults(const QList<QStandardItem*>& items)
-      const;
+
+  // Returns the first song result underneath this index, or an invalid
+  // result (with no provider) if there isn't one.
+  SearchProvider::Result FirstChildResult(const QModelIndex& index) const;
 
   // QAbstractItemModel
+  QModelIndex index(int row, int column,
+                    const QModelIndex& parent = QModelIndex()) const;
+  QModelIndex parent(const QModelIndex& index) const;
+  int rowCount(const QModelIndex& parent = QModelIndex()) const;
+  int columnCount(const QModelIndex& parent = QModelIndex()) const;
+  bool hasChildren(const QModelIndex& parent = QModelIndex()) const;
+  QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+  bool setData(const QModelIndex& index, const QVariant& value,
+               int role = Qt::EditRole);
+  Qt::ItemFlags flags(const QModelIndex& index) const;
   QMimeData* mimeData(const QModelIndexList& indexes) const;
 
  public slots:
   void AddResults(const SearchProvider::ResultList& results);
 
  private:
-  QStandardItem* BuildContainers(const Song& metadata, QStandardItem* parent,
-                                 ContainerKey* key, int level = 0);
-  void GetChildResults(const QStandardItem* item,
-                       SearchProvider::ResultList* results,
-                       QSet<const QStandardItem*>* visited) const;
+#if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
+  // Here QString::localeAwareCompare uses wcscoll, and comparing strings
+  // transformed with wcsxfrm gives the same order, so the expensive part is
+  // only done once for each node.
+  typedef std::wstring CollationKey;
+#else
+  // Qt uses the platform's own collation functions on Windows and Mac, so the
+  // text is kept as it is and compared with QString::localeAwareCompare.
+  typedef QString CollationKey;
+#endif
+
+  struct SortKey {
+    SortKey() : provider_index_(0), type_(0), disc_(0), track_(0) {}
+
+    int provider_index_;
+    int type_;
+    int disc_;
+    int track_;
+    CollationKey text_;
+  };
+
+  struct Node {
+    enum Type { Type_Root, Type_Divider, Type_Container, Type_Result };
+
+    Node(Type type, Node* parent)
+        : type_(type),
+          parent_(parent),
+          row_(-1),
+          container_type_(LibraryModel::GroupBy_None),
+          result_index_(-1),
+          lazy_loading_art_(false) {}
+    ~Node() { qDeleteAll(children_); }
+
+    Type type_;
+    Node* parent_;
+    QList<Node*> children_;
+    int row_;
+
+    SortKey sort_key_;
+    QString display_text_;
+    QString sort_text_;
+    QVariant decoration_;
+    LibraryModel::GroupBy container_type_;
+    int result_index_;
+    bool lazy_loading_art_;
+  };
+
+  static bool CompareNodes(const Node* left, const Node* right);
+  static CollationKey MakeCollationKey(const QString& text);
+  static int CompareCollationKeys(const CollationKey& left,
+                                  const CollationKey& right);
+
+  Node* NodeForIndex(const QModelIndex& index) const;
+  QModelIndex IndexForNode(const Node* node) const;
+
+  // New children of nodes that are already in the model are collected in
+  // pending_ and merged in by MergePending at the end of AddResults.  New
+  // nodes get their children directly.
+  void AddChild(Node* parent, Node* child);
+  void MergePending();
+
+  Node* BuildContainers(const Song& metadata, Node* parent, ContainerKey* key,
+                        int level = 0);
+  void GetChildResults(const Node* node, SearchProvider::ResultList* results,
+                       QSet<const Node*>* visited) const;
 
  private:
   GlobalSearch* engine_;
-  QSortFilterProxyModel* proxy_;
 
   LibraryModel::Grouping group_by_;
 
+  // All the results that have been added, in the order they arrived.  Result
+  // nodes refer to them by their position.
+  QVector<SearchProvider::Result> results_;
+
+  Node root_;
+  QHash<Node*, QList<Node*> > pending_;
+  QSet<Node*> new_nodes_;
+
   QMap<SearchProvider*, int> provider_sort_indices_;
   int next_provider_sort_index_;
-  QMap<ContainerKey, QStandardItem*> containers_;
+  QHash<ContainerKey, Node*> containers_;
 
   QStringList provider_order_;
   bool use_pretty_covers_;
@@ -94,19 +179,12 @@ inline uint qHash(const GlobalSearchModel::ContainerKey& key) {
          qHash(key.group_[1]) ^ qHash(key.group_[2]);
 }
 
-inline bool operator<(const GlobalSearchModel::ContainerKey& left,
-                      const GlobalSearchModel::ContainerKey& right) {
-#define CMP(field)                           \
-  if (left.field < right.field) return true; \
-  if (left.field > right.field) return false
-
-  CMP(provider_index_);
-  CMP(group_[0]);
-  CMP(group_[1]);
-  CMP(group_[2]);
-  return false;
-
-#undef CMP
+inline bool operator==(const GlobalSearchModel::ContainerKey& left,
+                       const GlobalSearchModel::ContainerKey& right) {
+  return left.provider_index_ == right.provider_index_ &&
+         left.group_[0] == right.group_[0] &&
+         left.group_[1] == right.group_[1] &&
+         left.group_[2] == right.group_[2];
 }
 
 #endif  // GLOBALSEARCHMODEL_H
@@ -53,6 +53,7 @@ void GlobalSearchSettingsPage::Load() {
   s.beginGroup(GlobalSearch::kSettingsGroup);
 
   GlobalSearch* engine = dialog()->global_search();
+  engine->RequestLazyProviders(true);
   QList<SearchProvider*> providers = engine->providers();
 
   // Sort the list of providers alphabetically (by id) initially, so any that
@@ -18,8 +18,6 @@
 #include "globalsearchview.h"
 
 #include <QMenu>
-#include <QSortFilterProxyModel>
-#include <QStandardItem>
 #include <QTimer>
 
 #include <functional>
@@ -27,7 +25,6 @@
 #include "globalsearch.h"
 #include "globalsearchitemdelegate.h"
 #include "globalsearchmodel.h"
-#include "globalsearchsortmodel.h"
 #include "searchprovider.h"
 #include "searchproviderstatuswidget.h"
 #include "suggestionwidget.h"
@@ -57,9 +54,6 @@ GlobalSearchView::GlobalSearchView(Application* app, QWidget* parent)
       front_model_(new GlobalSearchModel(engine_, this)),
       back_model_(new GlobalSearchModel(engine_, this)),
       current_model_(front_model_),
-      front_proxy_(new GlobalSearchSortModel(this)),
-      back_proxy_(new GlobalSearchSortModel(this)),
-      current_proxy_(front_proxy_),
       swap_models_timer_(new QTimer(this)),
       update_suggestions_timer_(new QTimer(this)),
       search_icon_(IconLoader::Load("search", IconLoader::Base)),
@@ -68,9 +62,6 @@ GlobalSearchView::GlobalSearchView(Application* app, QWidget* parent)
       show_suggestions_(true) {
   ui_->setupUi(this);
 
-  front_model_->set_proxy(front_proxy_);
-  back_model_->set_proxy(back_proxy_);
-
   ui_->search->installEventFilter(this);
   ui_->results_stack->installEventFilter(this);
 
@@ -123,15 +114,6 @@ GlobalSearchView::GlobalSearchView(Application* app, QWidget* parent)
   help_font.setBold(true);
   ui_->help_text->setFont(help_font);
 
-  // Set up the sorting proxy model
-  front_proxy_->setSourceModel(front_model_);
-  front_proxy_->setDynamicSortFilter(true);
-  front_proxy_->sort(0);
-
-  back_proxy_->setSourceModel(back_model_);
-  back_proxy_->setDynamicSortFilter(true);
-  back_proxy_->sort(0);
-
   swap_models_timer_->setSingleShot(true);
   swap_models_timer_->setInterval(kSwapModelsTimeoutMsec);
   connect(swap_models_timer_, SIGNAL(timeout()), SLOT(SwapModels()));
@@ -160,6 +142,13 @@ GlobalSearchView::GlobalSearchView(Application* app, QWidget* parent)
           Qt::QueuedConnection);
   connect(engine_, SIGNAL(ArtLoaded(int, QPixmap)),
           SLOT(ArtLoaded(int, QPixmap)), Qt::QueuedConnection);
+
+  // Internet services are created on demand, so their providers can come and
+  // go while we're visible.
+  connect(engine_, SIGNAL(ProviderAdded(const SearchProvider*)),
+          SLOT(UpdateProviderStatusWidgets()));
+  connect(engine_, SIGNAL(ProviderRemoved(const SearchProvider*)),
+          SLOT(UpdateProviderStatusWidgets()));
 }
 
 GlobalSearchView::~GlobalSearchView() { delete ui_; }
@@ -212,6 +201,25 @@ void GlobalSearchView::ReloadSettings() {
           s.value("group_by3", int(LibraryModel::GroupBy_None)).toInt())));
   s.endGroup();
 
+  UpdateProviderStatusWidgets();
+
+  ui_->suggestions_group->setVisible(show_suggestions_);
+  if (!show_suggestions_) {
+    update_suggestions_timer_->stop();
+  }
+
+  if (!old_show_suggestions && show_suggestions_) {
+    UpdateSuggestions();
+  }
+}
+
+void GlobalSearchView::UpdateProviderStatusWidgets() {
+  QSettings s;
+  s.beginGroup(GlobalSearch::kSettingsGroup);
+  const QStringList provider_order =
+      s.value("provider_order", QStringList() << "library").toStringList();
+  s.endGroup();
+
   // Delete any old status widgets
   qDeleteAll(provider_status_widgets_);
   provider_status_widgets_.clear();
@@ -243,15 +251,6 @@ void GlobalSearchView::ReloadSettings() {
 
     ui_->disabled_label->setVisible(any_disabled);
   }
-
-  ui_->suggestions_group->setVisible(show_suggestions_);
-  if (!show_suggestions_) {
-    update_suggestions_timer_->stop();
-  }
-
-  if (!old_show_suggestions && show_suggestions_) {
-    UpdateSuggestions();
-  }
 }
 
 void GlobalSearchView::UpdateSuggestions() {
@@ -282,7 +281,6 @@ void GlobalSearchView::TextEdited(const QString& text) {
   // Add results to the back model, switch models after some delay.
   back_model_->Clear();
   current_model_ = back_model_;
-  current_proxy_ = back_proxy_;
   swap_models_timer_->start();
 
   // Cancel the last search (if any) and start the new one.
@@ -306,9 +304,8 @@ void GlobalSearchView::SwapModels() {
   art_requests_.clear();
 
   qSwap(front_model_, back_model_);
-  qSwap(front_proxy_, back_proxy_);
 
-  ui_->results->setModel(front_proxy_);
+  ui_->results->setModel(front_model_);
 
   if (ui_->search->text().trimmed().isEmpty()) {
     ui_->results_stack->setCurrentWidget(ui_->help_page);
@@ -317,13 +314,13 @@ void GlobalSearchView::SwapModels() {
   }
 }
 
-void GlobalSearchView::LazyLoadArt(const QModelIndex& proxy_index) {
-  if (!proxy_index.isValid() || proxy_index.model() != front_proxy_) {
+void GlobalSearchView::LazyLoadArt(const QModelIndex& index) {
+  if (!index.isValid() || index.model() != front_model_) {
     return;
   }
 
   // Already loading art for this item?
-  if (proxy_index.data(GlobalSearchModel::Role_LazyLoadingArt).isValid()) {
+  if (index.data(GlobalSearchModel::Role_LazyLoadingArt).isValid()) {
     return;
   }
 
@@ -334,7 +331,7 @@ void GlobalSearchView::LazyLoadArt(const QModelIndex& proxy_index) {
 
   // Is this an album?
   const LibraryModel::GroupBy container_type = LibraryModel::GroupBy(
-      proxy_index.data(LibraryModel::Role_ContainerType).toInt());
+      index.data(LibraryModel::Role_ContainerType).toInt());
   if (container_type != LibraryModel::GroupBy_Album &&
       container_type != LibraryModel::GroupBy_AlbumArtist &&
       container_type != LibraryModel::GroupBy_YearAlbum &&
@@ -343,31 +340,25 @@ void GlobalSearchView::LazyLoadArt(const QModelIndex& proxy_index) {
   }
 
   // Mark the item as loading art
-  const QModelIndex source_index = front_proxy_->mapToSource(proxy_index);
-  QStandardItem* item = front_model_->itemFromIndex(source_index);
-  item->setData(true, GlobalSearchModel::Role_LazyLoadingArt);
+  front_model_->setData(index, true, GlobalSearchModel::Role_LazyLoadingArt);
 
-  // Walk down the item's children until we find a track
-  while (item->rowCount()) {
-    item = item->child(0);
+  // Get the Result of the first track under the item
+  const SearchProvider::Result result = front_model_->FirstChildResult(index);
+  if (!result.provider_) {
+    return;
   }
 
-  // Get the track's Result
-  const SearchProvider::Result result =
-      item->data(GlobalSearchModel::Role_Result)
-          .value<SearchProvider::Result>();
-
   // Load the art.
   int id = engine_->LoadArtAsync(result);
-  art_requests_[id] = source_index;
+  art_requests_[id] = index;
 }
 
 void GlobalSearchView::ArtLoaded(int id, const QPixmap& pixmap) {
   if (!art_requests_.contains(id)) return;
-  QModelIndex index = art_requests_.take(id);
+  QPersistentModelIndex index = art_requests_.take(id);
 
-  if (!pixmap.isNull()) {
-    front_model_->itemFromIndex(index)->setData(pixmap, Qt::DecorationRole);
+  if (!pixmap.isNull() && index.isValid()) {
+    front_model_->setData(index, pixmap, Qt::DecorationRole);
   }
 }
 
@@ -379,8 +370,8 @@ MimeData* GlobalSearchView::SelectedMimeData() {
   if (indexes.isEmpty()) {
     // There's nothing selected - take the first thing in the model that isn't
     // a divider.
-    for (int i = 0; i < front_proxy_->rowCount(); ++i) {
-      QModelIndex index = front_proxy_->index(i, 0);
+    for (int i = 0; i < front_model_->rowCount(); ++i) {
+      QModelIndex index = front_model_->index(i, 0);
       if (!index.data(LibraryModel::Role_IsDivider).toBool()) {
         indexes << index;
         ui_->results->setCurrentIndex(index);
@@ -394,14 +385,8 @@ MimeData* GlobalSearchView::SelectedMimeData() {
     return nullptr;
   }
 
-  // Get items for these indexes
-  QList<QStandardItem*> items;
-  for (const QModelIndex& index : indexes) {
-    items << (front_model_->itemFromIndex(front_proxy_->mapToSource(index)));
-  }
-
   // Get a MimeData for these items
-  return engine_->LoadTracks(front_model_->GetChildResults(items));
+  return engine_->LoadTracks(front_model_->GetChildResults(indexes));
 }
 
 bool GlobalSearchView::eventFilter(QObject* object, QEvent* event) {
@@ -516,6 +501,10 @@ void GlobalSearchView::OpenSelectedInNewPlaylist() {
 }
 
 void GlobalSearchView::showEvent(QShowEvent* e) {
+  // Make sure the providers of services that haven't been created yet are
+  // there for the status widgets and suggestions.
+  engine_->RequestLazyProviders();
+
   if (show_suggestions_) {
     UpdateSuggestions();
     update_suggestions_timer_->start();
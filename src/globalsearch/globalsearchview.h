@@ -33,9 +33,6 @@ class Ui_GlobalSearchView;
 
 class QActionGroup;
 class QMimeData;
-class QSortFilterProxyModel;
-class QStandardItem;
-class QStandardItemModel;
 
 class GlobalSearchView : public QWidget {
   Q_OBJECT
@@ -70,6 +67,8 @@ signals:
  private slots:
   void UpdateSuggestions();
 
+  void UpdateProviderStatusWidgets();
+
   void SwapModels();
   void TextEdited(const QString& text);
   void AddResults(int id, const SearchProvider::ResultList& results);
@@ -111,11 +110,7 @@ signals:
   GlobalSearchModel* back_model_;
   GlobalSearchModel* current_model_;
 
-  QSortFilterProxyModel* front_proxy_;
-  QSortFilterProxyModel* back_proxy_;
-  QSortFilterProxyModel* current_proxy_;
-
-  QMap<int, QModelIndex> art_requests_;
+  QMap<int, QPersistentModelIndex> art_requests_;
 
   QTimer* swap_models_timer_;
   QTimer* update_suggestions_timer_;
@@ -16,6 +16,7 @@
 */
 
 #include "librarysearchprovider.h"
+#include "core/database.h"
 #include "core/logging.h"
 #include "covers/albumcoverloader.h"
 #include "library/librarybackend.h"
@@ -23,7 +24,12 @@
 #include "library/sqlrow.h"
 #include "playlist/songmimedata.h"
 
-#include <QStack>
+#include <QMutexLocker>
+#include <QtConcurrentRun>
+
+const int LibrarySearchProvider::kMaxResults = 500;
+const int LibrarySearchProvider::kResultsPerBatch = 100;
+const int LibrarySearchProvider::kSuggestionSamplesPerResult = 5;
 
 LibrarySearchProvider::LibrarySearchProvider(LibraryBackendInterface* backend,
                                              const QString& name,
@@ -31,7 +37,7 @@ LibrarySearchProvider::LibrarySearchProvider(LibraryBackendInterface* backend,
                                              const QIcon& icon,
                                              bool enabled_by_default,
                                              Application* app, QObject* parent)
-    : BlockingSearchProvider(app, parent), backend_(backend) {
+    : SearchProvider(app, parent), backend_(backend) {
   Hints hints =
       WantsSerialisedArtQueries | ArtIsInSongMetadata | CanGiveSuggestions;
 
@@ -42,27 +48,64 @@ LibrarySearchProvider::LibrarySearchProvider(LibraryBackendInterface* backend,
   Init(name, id, icon, hints);
 }
 
-SearchProvider::ResultList LibrarySearchProvider::Search(int id,
-                                                         const QString& query) {
+void LibrarySearchProvider::SearchAsync(int id, const QString& query) {
+  // Register the search before it starts so it can be cancelled straight
+  // away.
+  DatabaseInterrupter* interrupter = new DatabaseInterrupter;
+  {
+    QMutexLocker l(&running_searches_mutex_);
+    running_searches_[id] = interrupter;
+  }
+
+  QtConcurrent::run(this, &LibrarySearchProvider::DoSearch, id, query,
+                    interrupter);
+}
+
+void LibrarySearchProvider::CancelSearch(int id) {
+  QMutexLocker l(&running_searches_mutex_);
+  if (running_searches_.contains(id)) {
+    running_searches_[id]->Interrupt();
+  }
+}
+
+void LibrarySearchProvider::DoSearch(int id, const QString& query,
+                                     DatabaseInterrupter* interrupter) {
   QueryOptions options;
   options.set_filter(query);
 
   LibraryQuery q(options);
   q.SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
+  q.SetLimit(kMaxResults);
+  q.SetInterrupter(interrupter);
+
+  // Results are emitted from this thread as they're read - the signals are
+  // queued to GlobalSearch in order, before SearchFinished.
+  if (!interrupter->is_interrupted() && backend_->ExecQuery(&q)) {
+    ResultList batch;
+    while (!interrupter->is_interrupted() && q.Next()) {
+      Result result(this);
+      result.metadata_.InitFromQuery(q, true);
+      batch << result;
+
+      if (batch.count() == kResultsPerBatch) {
+        emit ResultsAvailable(id, batch);
+        batch.clear();
+      }
+    }
 
-  if (!backend_->ExecQuery(&q)) {
-    return ResultList();
+    if (!batch.isEmpty() && !interrupter->is_interrupted()) {
+      emit ResultsAvailable(id, batch);
+    }
   }
+  interrupter->Detach();
 
-  // Build the result list
-  ResultList ret;
-  while (q.Next()) {
-    Result result(this);
-    result.metadata_.InitFromQuery(q, true);
-    ret << result;
+  {
+    QMutexLocker l(&running_searches_mutex_);
+    running_searches_.remove(id);
   }
+  delete interrupter;
 
-  return ret;
+  emit SearchFinished(id);
 }
 
 MimeData* LibrarySearchProvider::LoadTracks(const ResultList& results) {
@@ -74,38 +117,19 @@ MimeData* LibrarySearchProvider::LoadTracks(const ResultList& results) {
 
 QStringList LibrarySearchProvider::GetSuggestions(int count) {
   // We'd like to use order by random(), but that's O(n) in sqlite, so instead
-  // get the largest ROWID and pick a couple of random numbers within that
-  // range.
-
+  // look up a few random ROWIDs in one query.
   LibraryQuery q;
-  q.SetColumnSpec("ROWID");
-  q.SetOrderBy("ROWID DESC");
+  q.SetColumnSpec("artist, album");
   q.SetIncludeUnavailable(true);
-  q.SetLimit(1);
+  q.AddRandomSample(count * kSuggestionSamplesPerResult);
 
   QStringList ret;
 
-  if (!backend_->ExecQuery(&q) || !q.Next()) {
+  if (!backend_->ExecQuery(&q)) {
     return ret;
   }
 
-  const int largest_rowid = q.Value(0).toInt();
-
-  for (int attempt = 0; attempt < count * 5; ++attempt) {
-    if (ret.count() >= count) {
-      break;
-    }
-
-    LibraryQuery q;
-    q.SetColumnSpec("artist, album");
-    q.SetIncludeUnavailable(true);
-    q.AddWhere("ROWID", qrand() % largest_rowid);
-    q.SetLimit(1);
-
-    if (!backend_->ExecQuery(&q) || !q.Next()) {
-      continue;
-    }
-
+  while (q.Next()) {
     const QString artist = q.Value(0).toString();
     const QString album = q.Value(1).toString();
 
@@ -117,5 +141,11 @@ QStringList LibrarySearchProvider::GetSuggestions(int count) {
       ret << album;
   }
 
+  // The rows come back in ROWID order, so drop random ones rather than the
+  // last ones to keep the suggestions spread out over the whole library.
+  while (ret.count() > count) {
+    ret.removeAt(qrand() % ret.count());
+  }
+
   return ret;
 }
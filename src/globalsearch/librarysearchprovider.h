@@ -20,21 +20,42 @@
 
 #include "searchprovider.h"
 
+#include <QMap>
+#include <QMutex>
+
+class DatabaseInterrupter;
 class LibraryBackendInterface;
 
-class LibrarySearchProvider : public BlockingSearchProvider {
+class LibrarySearchProvider : public SearchProvider {
  public:
   LibrarySearchProvider(LibraryBackendInterface* backend, const QString& name,
                         const QString& id, const QIcon& icon,
                         bool enabled_by_default, Application* app,
                         QObject* parent = nullptr);
 
-  ResultList Search(int id, const QString& query);
+  // Only the first kMaxResults matches are read from the database.  They are
+  // emitted in batches of kResultsPerBatch so the first ones can be shown
+  // while the rest are still being loaded.
+  static const int kMaxResults;
+  static const int kResultsPerBatch;
+
+  // The number of random songs GetSuggestions looks at for each suggestion.
+  static const int kSuggestionSamplesPerResult;
+
+  void SearchAsync(int id, const QString& query);
+  void CancelSearch(int id);
   MimeData* LoadTracks(const ResultList& results);
   QStringList GetSuggestions(int count);
 
+ private:
+  void DoSearch(int id, const QString& query,
+                DatabaseInterrupter* interrupter);
+
  private:
   LibraryBackendInterface* backend_;
+
+  QMutex running_searches_mutex_;
+  QMap<int, DatabaseInterrupter*> running_searches_;
 };
 
 #endif  // LIBRARYSEARCHPROVIDER_H
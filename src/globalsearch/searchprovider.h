@@ -125,6 +125,10 @@ class SearchProvider : public QObject {
   // SearchFinished exactly once, using this ID.
   virtual void SearchAsync(int id, const QString& query) = 0;
 
+  // Called when the results of a search are no longer wanted.  Providers that
+  // can stop a search early should do so, but must still emit SearchFinished.
+  virtual void CancelSearch(int id) {}
+
   // Starts loading an icon for a result that was previously emitted by
   // ResultsAvailable.  Must emit ArtLoaded exactly once with this ID.
   virtual void LoadArtAsync(int id, const Result& result);
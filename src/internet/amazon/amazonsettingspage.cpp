@@ -27,7 +27,7 @@
 AmazonSettingsPage::AmazonSettingsPage(SettingsDialog* parent)
     : SettingsPage(parent),
       ui_(new Ui::AmazonSettingsPage),
-      service_(dialog()->app()->internet_model()->Service<AmazonCloudDrive>()) {
+      service_(nullptr) {
   ui_->setupUi(this);
   setWindowIcon(IconLoader::Load("amazon", IconLoader::Provider));
 
@@ -35,13 +35,17 @@ AmazonSettingsPage::AmazonSettingsPage(SettingsDialog* parent)
 
   connect(ui_->login_button, SIGNAL(clicked()), SLOT(LoginClicked()));
   connect(ui_->login_state, SIGNAL(LogoutClicked()), SLOT(LogoutClicked()));
-  connect(service_, SIGNAL(Connected()), SLOT(Connected()));
 
   dialog()->installEventFilter(this);
 }
 
 AmazonSettingsPage::~AmazonSettingsPage() { delete ui_; }
 
+void AmazonSettingsPage::FirstShown() {
+  service_ = InternetModel::Service<AmazonCloudDrive>();
+  connect(service_, SIGNAL(Connected()), SLOT(Connected()));
+}
+
 void AmazonSettingsPage::Load() {
   QSettings s;
   s.beginGroup(AmazonCloudDrive::kSettingsGroup);
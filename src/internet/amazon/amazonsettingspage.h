@@ -39,6 +39,10 @@ class AmazonSettingsPage : public SettingsPage {
   // QObject
   bool eventFilter(QObject* object, QEvent* event);
 
+ protected:
+  // SettingsPage
+  void FirstShown();
+
  private slots:
   void LoginClicked();
   void LogoutClicked();
@@ -30,7 +30,7 @@
 BoxSettingsPage::BoxSettingsPage(SettingsDialog* parent)
     : SettingsPage(parent),
       ui_(new Ui::BoxSettingsPage),
-      service_(dialog()->app()->internet_model()->Service<BoxService>()) {
+      service_(nullptr) {
   ui_->setupUi(this);
   setWindowIcon(IconLoader::Load("box", IconLoader::Provider));
 
@@ -38,13 +38,17 @@ BoxSettingsPage::BoxSettingsPage(SettingsDialog* parent)
 
   connect(ui_->login_button, SIGNAL(clicked()), SLOT(LoginClicked()));
   connect(ui_->login_state, SIGNAL(LogoutClicked()), SLOT(LogoutClicked()));
-  connect(service_, SIGNAL(Connected()), SLOT(Connected()));
 
   dialog()->installEventFilter(this);
 }
 
 BoxSettingsPage::~BoxSettingsPage() { delete ui_; }
 
+void BoxSettingsPage::FirstShown() {
+  service_ = InternetModel::Service<BoxService>();
+  connect(service_, SIGNAL(Connected()), SLOT(Connected()));
+}
+
 void BoxSettingsPage::Load() {
   QSettings s;
   s.beginGroup(BoxService::kSettingsGroup);
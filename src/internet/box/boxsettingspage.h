@@ -40,6 +40,10 @@ class BoxSettingsPage : public SettingsPage {
   // QObject
   bool eventFilter(QObject* object, QEvent* event);
 
+ protected:
+  // SettingsPage
+  void FirstShown();
+
  private slots:
   void LoginClicked();
   void LogoutClicked();
@@ -25,7 +25,9 @@
 
 #include "internet/core/internetmodel.h"
 
+#include <QElapsedTimer>
 #include <QMimeData>
+#include <QThread>
 #include <QtDebug>
 
 #include "internet/digitally/digitallyimportedservicebase.h"
@@ -39,11 +41,16 @@
 #include "internet/soundcloud/soundcloudservice.h"
 #include "internet/spotify/spotifyservice.h"
 #include "internet/subsonic/subsonicservice.h"
+#include "core/application.h"
 #include "core/closure.h"
 #include "core/logging.h"
 #include "core/mergedproxymodel.h"
+#include "core/player.h"
+#include "core/tracing.h"
+#include "globalsearch/globalsearch.h"
 #include "internet/podcasts/podcastservice.h"
 #include "smartplaylists/generatormimedata.h"
+#include "ui/iconloader.h"
 
 #ifdef HAVE_GOOGLE_DRIVE
 #include "internet/googledrive/googledriveservice.h"
@@ -72,6 +79,7 @@ using smart_playlists::GeneratorMimeData;
 using smart_playlists::GeneratorPtr;
 
 QMap<QString, InternetService*>* InternetModel::sServices = nullptr;
+InternetModel* InternetModel::sInstance = nullptr;
 
 const char* InternetModel::kSettingsGroup = "InternetModel";
 
@@ -83,46 +91,103 @@ InternetModel::InternetModel(Application* app, QObject* parent)
     sServices = new QMap<QString, InternetService*>;
   }
   Q_ASSERT(sServices->isEmpty());
+  sInstance = this;
+
+  TRACE_SPAN("InternetModel::InternetModel");
+  QElapsedTimer startup_timer;
+  startup_timer.start();
 
   merged_model_->setSourceModel(this);
 
+  connect(app_->global_search(), SIGNAL(LazyProvidersRequested(bool)),
+          SLOT(CreateSearchServices(bool)));
+
+  // These are used by other parts of Clementine from startup (the radio
+  // streams are listed in the tree straight away, Spotify is used by the
+  // engine and the cover loader, and VK by the love button), so they're
+  // always created up front.
   AddService(new DigitallyImportedService(app, this));
-  AddService(new IcecastService(app, this));
-  AddService(new JamendoService(app, this));
   AddService(new JazzRadioService(app, this));
-  AddService(new MagnatuneService(app, this));
   AddService(new PodcastService(app, this));
   AddService(new RockRadioService(app, this));
   AddService(new SavedRadio(app, this));
   AddService(new RadioTunesService(app, this));
   AddService(new SomaFMService(app, this));
-  AddService(new SoundCloudService(app, this));
   AddService(new SpotifyService(app, this));
-  AddService(new SubsonicService(app, this));
+#ifdef HAVE_VK
+  AddService(new VkService(app, this));
+#endif
+
+  // Everything else is created the first time it's needed.
+  AddLazyService(IcecastService::kServiceName,
+                 IconLoader::Load("icon_radio", IconLoader::Lastfm),
+                 QStringList(), "icecast", false,
+                 [app, this]() { return new IcecastService(app, this); });
+  AddLazyService(JamendoService::kServiceName,
+                 IconLoader::Load("jamendo", IconLoader::Provider),
+                 QStringList(), "jamendo", false,
+                 [app, this]() { return new JamendoService(app, this); });
+  AddLazyService(MagnatuneService::kServiceName,
+                 IconLoader::Load("magnatune", IconLoader::Provider),
+                 QStringList() << "magnatune", "magnatune", true,
+                 [app, this]() { return new MagnatuneService(app, this); });
+  AddLazyService(SoundCloudService::kServiceName,
+                 IconLoader::Load("soundcloud", IconLoader::Provider),
+                 QStringList(), "soundcloud", true,
+                 [app, this]() { return new SoundCloudService(app, this); });
+  AddLazyService(SubsonicService::kServiceName,
+                 IconLoader::Load("subsonic", IconLoader::Provider),
+                 QStringList() << "subsonic", "subsonic", true,
+                 [app, this]() { return new SubsonicService(app, this); });
 #ifdef HAVE_BOX
-  AddService(new BoxService(app, this));
+  AddLazyService(BoxService::kServiceName,
+                 IconLoader::Load("box", IconLoader::Provider),
+                 QStringList() << "box", "Box", true,
+                 [app, this]() { return new BoxService(app, this); });
 #endif
 #ifdef HAVE_DROPBOX
-  AddService(new DropboxService(app, this));
+  AddLazyService(DropboxService::kServiceName,
+                 IconLoader::Load("dropbox", IconLoader::Provider),
+                 QStringList() << "dropbox", "dropbox", true,
+                 [app, this]() { return new DropboxService(app, this); });
 #endif
 #ifdef HAVE_GOOGLE_DRIVE
-  AddService(new GoogleDriveService(app, this));
+  AddLazyService(GoogleDriveService::kServiceName,
+                 IconLoader::Load("googledrive", IconLoader::Provider),
+                 QStringList() << "googledrive", "google_drive", true,
+                 [app, this]() { return new GoogleDriveService(app, this); });
 #endif
 #ifdef HAVE_SEAFILE
-  AddService(new SeafileService(app, this));
+  AddLazyService(SeafileService::kServiceName,
+                 IconLoader::Load("seafile", IconLoader::Provider),
+                 QStringList() << "seafile", "Seafile", true,
+                 [app, this]() { return new SeafileService(app, this); });
 #endif
 #ifdef HAVE_SKYDRIVE
-  AddService(new SkydriveService(app, this));
-#endif
-#ifdef HAVE_VK
-  AddService(new VkService(app, this));
+  AddLazyService(SkydriveService::kServiceName,
+                 IconLoader::Load("skydrive", IconLoader::Provider),
+                 QStringList() << "skydrive", "skydrive", true,
+                 [app, this]() { return new SkydriveService(app, this); });
 #endif
 #ifdef HAVE_AMAZON_CLOUD_DRIVE
-  AddService(new AmazonCloudDrive(app, this));
+  AddLazyService(AmazonCloudDrive::kServiceName,
+                 IconLoader::Load("amazonclouddrive", IconLoader::Provider),
+                 QStringList() << "amazonclouddrive", "amazon_cloud_drive",
+                 true,
+                 [app, this]() { return new AmazonCloudDrive(app, this); });
 #endif
 
   invisibleRootItem()->sortChildren(0, Qt::AscendingOrder);
   UpdateServices();
+
+  qLog(Debug) << "Created" << sServices->count() << "internet services and"
+              << lazy_services_.count() << "placeholders in"
+              << startup_timer.elapsed() << "ms";
+}
+
+InternetModel::~InternetModel() {
+  // ServiceByName must not create lazy services on a model that's gone.
+  if (sInstance == this) sInstance = nullptr;
 }
 
 void InternetModel::AddService(InternetService* service) {
@@ -136,7 +201,7 @@ void InternetModel::AddService(InternetService* service) {
   root->setData(Type_Service, Role_Type);
   root->setData(QVariant::fromValue(service), Role_Service);
 
-  invisibleRootItem()->appendRow(root);
+  invisibleRootItem()->insertRow(FindItemPosition(root->text()), root);
   qLog(Debug) << "Adding internet service:" << service->name();
   sServices->insert(service->name(), service);
 
@@ -160,6 +225,87 @@ void InternetModel::AddService(InternetService* service) {
   } else {
     service->ReloadSettings();
   }
+
+  emit ServiceAdded(service);
+}
+
+void InternetModel::AddLazyService(const QString& name, const QIcon& icon,
+                                   const QStringList& url_schemes,
+                                   const QString& search_provider_id,
+                                   bool search_enabled_by_default,
+                                   ServiceFactory factory) {
+  QStandardItem* item = new QStandardItem(icon, name);
+  item->setData(Type_Service, Role_Type);
+  item->setData(true, Role_CanLazyLoad);
+  item->setData(name, Role_LazyServiceName);
+  invisibleRootItem()->insertRow(FindItemPosition(name), item);
+
+  LazyService lazy_service;
+  lazy_service.name_ = name;
+  lazy_service.icon_ = icon;
+  lazy_service.factory_ = factory;
+  lazy_service.search_provider_id_ = search_provider_id;
+  lazy_service.search_enabled_by_default_ = search_enabled_by_default;
+  lazy_service.item_ = item;
+  lazy_service.shown_ = true;
+  lazy_services_.insert(name, lazy_service);
+
+  // The service registers its real URL handlers when it's created.
+  for (const QString& scheme : url_schemes) {
+    app_->player()->RegisterLazyUrlHandler(
+        scheme, [this, name]() { CreateLazyService(name); });
+  }
+}
+
+InternetService* InternetModel::CreateLazyService(const QString& name) {
+  if (!lazy_services_.contains(name)) return sServices->value(name);
+
+  TRACE_SPAN("InternetModel::CreateLazyService");
+  QElapsedTimer timer;
+  timer.start();
+
+  LazyService lazy_service = lazy_services_.take(name);
+
+  // Replace the placeholder with the service's real root item.
+  if (lazy_service.shown_) {
+    invisibleRootItem()->removeRow(lazy_service.item_->row());
+  } else {
+    delete lazy_service.item_;
+  }
+
+  InternetService* service = lazy_service.factory_();
+  AddService(service);
+  if (!lazy_service.shown_ && shown_services_.contains(service)) {
+    HideService(service);
+  }
+
+  qLog(Debug) << "Created internet service" << name << "on demand in"
+              << timer.elapsed() << "ms";
+  return service;
+}
+
+void InternetModel::LazyServiceExpanded(const QString& name) {
+  InternetService* service = CreateLazyService(name);
+  if (!service || !shown_services_.contains(service)) return;
+
+  // The placeholder the user expanded is gone, so expand the real item.
+  QStandardItem* root = shown_services_[service].item;
+  emit ScrollToIndex(merged_model_->mapFromSource(root->index()));
+}
+
+void InternetModel::CreateSearchServices(bool include_disabled) {
+  for (const LazyService& lazy_service : lazy_services_.values()) {
+    if (lazy_service.search_provider_id_.isEmpty()) continue;
+
+    // A disabled provider would never be searched, so there's no point
+    // creating its service just for that.
+    if (include_disabled ||
+        GlobalSearch::IsProviderEnabledInSettings(
+            lazy_service.search_provider_id_,
+            lazy_service.search_enabled_by_default_)) {
+      CreateLazyService(lazy_service.name_);
+    }
+  }
 }
 
 void InternetModel::RemoveService(InternetService* service) {
@@ -192,6 +338,20 @@ void InternetModel::ServiceDeleted() {
 
 InternetService* InternetModel::ServiceByName(const QString& name) {
   if (sServices->contains(name)) return sServices->value(name);
+
+  if (sInstance && sInstance->lazy_services_.contains(name)) {
+    if (QThread::currentThread() != sInstance->thread()) {
+      qLog(Warning) << "Internet service" << name
+                    << "requested from another thread before it was created";
+      return nullptr;
+    }
+    return sInstance->CreateLazyService(name);
+  }
+  return nullptr;
+}
+
+InternetService* InternetModel::CreatedServiceByName(const QString& name) {
+  if (sServices->contains(name)) return sServices->value(name);
   return nullptr;
 }
 
@@ -235,6 +395,14 @@ int InternetModel::rowCount(const QModelIndex& parent) const {
     if (service) {
       item->setData(false, Role_CanLazyLoad);
       service->LazyPopulate(item);
+    } else if (parent.data(Role_LazyServiceName).isValid()) {
+      // This is the placeholder of a service that hasn't been created yet.
+      // Don't replace it while the view is still asking about it.
+      item->setData(false, Role_CanLazyLoad);
+      QMetaObject::invokeMethod(
+          const_cast<InternetModel*>(this), "LazyServiceExpanded",
+          Qt::QueuedConnection,
+          Q_ARG(QString, parent.data(Role_LazyServiceName).toString()));
     }
   }
 
@@ -351,11 +519,26 @@ void InternetModel::UpdateServices() {
   QStringList keys = s.childKeys();
 
   for (const QString& service_name : keys) {
+    bool setting_val = s.value(service_name).toBool();
+
+    if (lazy_services_.contains(service_name)) {
+      // Just show or hide the placeholder, there's no need to create it.
+      LazyService& lazy_service = lazy_services_[service_name];
+      if (setting_val && !lazy_service.shown_) {
+        invisibleRootItem()->insertRow(
+            FindItemPosition(lazy_service.item_->text()), lazy_service.item_);
+        lazy_service.shown_ = true;
+      } else if (!setting_val && lazy_service.shown_) {
+        invisibleRootItem()->takeRow(lazy_service.item_->row());
+        lazy_service.shown_ = false;
+      }
+      continue;
+    }
+
     InternetService* internet_service = ServiceByName(service_name);
     if (internet_service == nullptr) {
       continue;
     }
-    bool setting_val = s.value(service_name).toBool();
 
     // Only update if values are different
     if (setting_val == true &&
@@ -23,6 +23,8 @@
 #ifndef INTERNET_CORE_INTERNETMODEL_H_
 #define INTERNET_CORE_INTERNETMODEL_H_
 
+#include <functional>
+
 #include "core/song.h"
 #include "library/librarymodel.h"
 #include "playlist/playlistitem.h"
@@ -48,6 +50,7 @@ class InternetModel : public QStandardItemModel {
 
  public:
   explicit InternetModel(Application* app, QObject* parent = nullptr);
+  ~InternetModel();
 
   enum Role {
     // Services can use this role to distinguish between different types of
@@ -82,6 +85,10 @@ class InternetModel : public QStandardItemModel {
     // Setting this to true means that the item can be changed by user action
     // (e.g. changing remote playlists)
     Role_CanBeModified,
+
+    // Set on the placeholder root item of a service that hasn't been created
+    // yet.  Contains the service's name.
+    Role_LazyServiceName,
     RoleCount,
     Role_IsDivider = LibraryModel::Role_IsDivider,
   };
@@ -124,8 +131,32 @@ class InternetModel : public QStandardItemModel {
     bool shown;
   };
 
-  // Needs to be static for InternetPlaylistItem::restore
+  typedef std::function<InternetService*()> ServiceFactory;
+
+  // A service that is only constructed when it's first needed - when its root
+  // item is expanded, when its search provider is used, when a URL with one
+  // of its schemes is played, or when something asks for it by name.
+  struct LazyService {
+    QString name_;
+    QIcon icon_;
+    ServiceFactory factory_;
+
+    // The id of the service's global search provider, or empty if it has
+    // none, and whether that provider is enabled before the user changes it.
+    QString search_provider_id_;
+    bool search_enabled_by_default_;
+
+    // The placeholder root item shown in the tree until the service exists.
+    QStandardItem* item_;
+    bool shown_;
+  };
+
+  // Needs to be static for InternetPlaylistItem::restore.  Creates the service
+  // if it was registered with AddLazyService and doesn't exist yet.
   static InternetService* ServiceByName(const QString& name);
+
+  // Like ServiceByName but never creates a lazy service.
+  static InternetService* CreatedServiceByName(const QString& name);
   static const char* kSettingsGroup;
 
   template <typename T>
@@ -137,6 +168,15 @@ class InternetModel : public QStandardItemModel {
   // is not reparented.  If the service is deleted it will be automatically
   // removed from the model.
   void AddService(InternetService* service);
+  // Adds a placeholder root item for a service and defers calling factory
+  // until the service is needed.  url_schemes are the schemes of the URL
+  // handlers the service will register.  search_provider_id and
+  // search_enabled_by_default describe the global search provider the
+  // service will add, so it's only created for searching if it's enabled.
+  void AddLazyService(const QString& name, const QIcon& icon,
+                      const QStringList& url_schemes,
+                      const QString& search_provider_id,
+                      bool search_enabled_by_default, ServiceFactory factory);
   void RemoveService(InternetService* service);
   void HideService(InternetService* service);
   void ShowService(InternetService* service);
@@ -176,6 +216,8 @@ class InternetModel : public QStandardItemModel {
   const QMap<InternetService*, ServiceItem> shown_services() const {
     return shown_services_;
   }
+  // Services that haven't been created yet.
+  QList<LazyService> lazy_services() const { return lazy_services_.values(); }
 
  signals:
   void StreamError(const QString& message);
@@ -184,13 +226,21 @@ class InternetModel : public QStandardItemModel {
   void AddToPlaylist(QMimeData* data);
   void ScrollToIndex(const QModelIndex& index);
 
+  void ServiceAdded(InternetService* service);
+
  private slots:
   void ServiceDeleted();
+  void LazyServiceExpanded(const QString& name);
+  void CreateSearchServices(bool include_disabled);
 
  private:
+  InternetService* CreateLazyService(const QString& name);
+
   QMap<InternetService*, ServiceItem> shown_services_;
+  QMap<QString, LazyService> lazy_services_;
 
   static QMap<QString, InternetService*>* sServices;
+  static InternetModel* sInstance;
 
   Application* app_;
   MergedProxyModel* merged_model_;
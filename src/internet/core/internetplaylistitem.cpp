@@ -88,8 +88,10 @@ void InternetPlaylistItem::InitMetadata() {
 }
 
 Song InternetPlaylistItem::Metadata() const {
-  if (!set_service_icon_) {
-    // Get the icon if we don't have it already
+  if (!set_service_icon_ &&
+      InternetModel::CreatedServiceByName(service_name_)) {
+    // Get the icon if we don't have it already.  Don't create the service just
+    // to show its icon.
     service();
   }
 
@@ -58,6 +58,19 @@ void InternetShowSettingsPage::Load() {
     ui_->sources->invisibleRootItem()->addChild(item);
   }
 
+  // Services that haven't been created yet
+  for (const InternetModel::LazyService& lazy_service :
+       dialog()->app()->internet_model()->lazy_services()) {
+    QTreeWidgetItem* item = new QTreeWidgetItem;
+    item->setText(0, lazy_service.name_);
+    item->setIcon(0, lazy_service.icon_);
+    item->setData(0, Qt::CheckStateRole,
+                  lazy_service.shown_ ? Qt::Checked : Qt::Unchecked);
+    item->setData(1, Qt::UserRole, lazy_service.name_);
+
+    ui_->sources->invisibleRootItem()->addChild(item);
+  }
+
   ui_->sources->invisibleRootItem()->sortChildren(0, Qt::AscendingOrder);
 }
 
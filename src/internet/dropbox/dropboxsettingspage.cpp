@@ -39,7 +39,7 @@ static const char* kOAuthScope = "";
 DropboxSettingsPage::DropboxSettingsPage(SettingsDialog* parent)
     : SettingsPage(parent),
       ui_(new Ui::DropboxSettingsPage),
-      service_(dialog()->app()->internet_model()->Service<DropboxService>()) {
+      service_(nullptr) {
   ui_->setupUi(this);
   setWindowIcon(IconLoader::Load("dropbox", IconLoader::Provider));
   
@@ -53,6 +53,10 @@ DropboxSettingsPage::DropboxSettingsPage(SettingsDialog* parent)
 
 DropboxSettingsPage::~DropboxSettingsPage() { delete ui_; }
 
+void DropboxSettingsPage::FirstShown() {
+  service_ = InternetModel::Service<DropboxService>();
+}
+
 void DropboxSettingsPage::Load() {
   QSettings s;
   s.beginGroup(DropboxService::kSettingsGroup);
@@ -40,6 +40,10 @@ class DropboxSettingsPage : public SettingsPage {
   // QObject
   bool eventFilter(QObject* object, QEvent* event) override;
 
+ protected:
+  // SettingsPage
+  void FirstShown();
+
  private slots:
   void LoginClicked();
   void LogoutClicked();
@@ -32,8 +32,7 @@
 GoogleDriveSettingsPage::GoogleDriveSettingsPage(SettingsDialog* parent)
     : SettingsPage(parent),
       ui_(new Ui::GoogleDriveSettingsPage),
-      service_(
-          dialog()->app()->internet_model()->Service<GoogleDriveService>()) {
+      service_(nullptr) {
   ui_->setupUi(this);
   setWindowIcon(IconLoader::Load("googledrive", IconLoader::Provider));
 
@@ -41,13 +40,17 @@ GoogleDriveSettingsPage::GoogleDriveSettingsPage(SettingsDialog* parent)
 
   connect(ui_->login_button, SIGNAL(clicked()), SLOT(LoginClicked()));
   connect(ui_->login_state, SIGNAL(LogoutClicked()), SLOT(LogoutClicked()));
-  connect(service_, SIGNAL(Connected()), SLOT(Connected()));
 
   dialog()->installEventFilter(this);
 }
 
 GoogleDriveSettingsPage::~GoogleDriveSettingsPage() { delete ui_; }
 
+void GoogleDriveSettingsPage::FirstShown() {
+  service_ = InternetModel::Service<GoogleDriveService>();
+  connect(service_, SIGNAL(Connected()), SLOT(Connected()));
+}
+
 void GoogleDriveSettingsPage::Load() {
   QSettings s;
   s.beginGroup(GoogleDriveService::kSettingsGroup);
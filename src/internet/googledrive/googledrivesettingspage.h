@@ -41,6 +41,10 @@ class GoogleDriveSettingsPage : public SettingsPage {
   // QObject
   bool eventFilter(QObject* object, QEvent* event);
 
+ protected:
+  // SettingsPage
+  void FirstShown();
+
  private slots:
   void LoginClicked();
   void LogoutClicked();
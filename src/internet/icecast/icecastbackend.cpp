@@ -25,6 +25,7 @@
 #include <QVariant>
 
 #include "core/database.h"
+#include "core/preparedstatementcache.h"
 #include "core/scopedtransaction.h"
 
 const char* IcecastBackend::kTableName = "icecast_stations";
@@ -43,7 +44,7 @@ QStringList IcecastBackend::GetGenresAlphabetical(const QString& filter) {
   QString sql = QString("SELECT DISTINCT genre FROM %1 %2 ORDER BY genre")
                     .arg(kTableName, where);
 
-  QSqlQuery q(sql, db);
+  CachedQuery q(db_->StatementCache(db), sql);
   if (!filter.isEmpty()) {
     q.bindValue(":filter", QString("%" + filter + "%"));
   }
@@ -69,7 +70,7 @@ QStringList IcecastBackend::GetGenresByPopularity(const QString& filter) {
                     " %2"
                     " GROUP BY genre"
                     " ORDER BY count DESC").arg(kTableName, where);
-  QSqlQuery q(sql, db);
+  CachedQuery q(db_->StatementCache(db), sql);
   if (!filter.isEmpty()) {
     q.bindValue(":filter", QString("%" + filter + "%"));
   }
@@ -109,7 +110,7 @@ IcecastBackend::StationList IcecastBackend::GetStations(const QString& filter,
   if (!where_clauses.isEmpty()) {
     sql += " WHERE " + where_clauses.join(" AND ");
   }
-  QSqlQuery q(sql, db);
+  CachedQuery q(db_->StatementCache(db), sql);
   for (const QString& value : bound_items) {
     q.addBindValue(value);
   }
@@ -157,7 +157,10 @@ void MagnatuneSettingsPage::Save() {
   s.setValue("format", ui_->format->currentIndex());
   s.setValue("logged_in", logged_in_);
 
-  InternetModel::Service<MagnatuneService>()->ReloadSettings();
+  // If the service hasn't been created yet it reads the settings when it is.
+  InternetService* service =
+      InternetModel::CreatedServiceByName(MagnatuneService::kServiceName);
+  if (service) service->ReloadSettings();
 }
 
 void MagnatuneSettingsPage::MembershipChanged(int value) {
@@ -24,6 +24,7 @@
 #include "core/application.h"
 #include "core/database.h"
 #include "core/logging.h"
+#include "core/preparedstatementcache.h"
 #include "core/scopedtransaction.h"
 
 PodcastBackend::PodcastBackend(Application* app, QObject* parent)
@@ -136,14 +137,13 @@ void PodcastBackend::UpdateEpisodes(const PodcastEpisodeList& episodes) {
   QSqlDatabase db(db_->Connect());
   ScopedTransaction t(&db);
 
-  QSqlQuery q(
-      "UPDATE podcast_episodes"
-      " SET listened = :listened,"
-      "     listened_date = :listened_date,"
-      "     downloaded = :downloaded,"
-      "     local_url = :local_url"
-      " WHERE ROWID = :id",
-      db);
+  CachedQuery q(db_->StatementCache(db),
+                "UPDATE podcast_episodes"
+                " SET listened = :listened,"
+                "     listened_date = :listened_date,"
+                "     downloaded = :downloaded,"
+                "     local_url = :local_url"
+                " WHERE ROWID = :id");
 
   for (const PodcastEpisode& episode : episodes) {
     q.bindValue(":listened", episode.listened());
@@ -185,10 +185,10 @@ Podcast PodcastBackend::GetSubscriptionById(int id) {
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery q("SELECT ROWID, " + Podcast::kColumnSpec +
-                  " FROM podcasts"
-                  " WHERE ROWID = :id",
-              db);
+  CachedQuery q(db_->StatementCache(db),
+                "SELECT ROWID, " + Podcast::kColumnSpec +
+                    " FROM podcasts"
+                    " WHERE ROWID = :id");
   q.bindValue(":id", id);
   q.exec();
   if (!db_->CheckErrors(q) && q.next()) {
@@ -204,10 +204,10 @@ Podcast PodcastBackend::GetSubscriptionByUrl(const QUrl& url) {
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery q("SELECT ROWID, " + Podcast::kColumnSpec +
-                  " FROM podcasts"
-                  " WHERE url = :url",
-              db);
+  CachedQuery q(db_->StatementCache(db),
+                "SELECT ROWID, " + Podcast::kColumnSpec +
+                    " FROM podcasts"
+                    " WHERE url = :url");
   q.bindValue(":url", url.toEncoded());
   q.exec();
   if (!db_->CheckErrors(q) && q.next()) {
@@ -223,12 +223,12 @@ PodcastEpisodeList PodcastBackend::GetEpisodes(int podcast_id) {
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery q("SELECT ROWID, " + PodcastEpisode::kColumnSpec +
-                  " FROM podcast_episodes"
-                  " WHERE podcast_id = :id"
-                  " ORDER BY publication_date DESC",
-              db);
-  q.bindValue(":db", podcast_id);
+  CachedQuery q(db_->StatementCache(db),
+                "SELECT ROWID, " + PodcastEpisode::kColumnSpec +
+                    " FROM podcast_episodes"
+                    " WHERE podcast_id = :id"
+                    " ORDER BY publication_date DESC");
+  q.bindValue(":id", podcast_id);
   q.exec();
   if (db_->CheckErrors(q)) return ret;
 
@@ -247,11 +247,11 @@ PodcastEpisode PodcastBackend::GetEpisodeById(int id) {
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery q("SELECT ROWID, " + PodcastEpisode::kColumnSpec +
-                  " FROM podcast_episodes"
-                  " WHERE ROWID = :id",
-              db);
-  q.bindValue(":db", id);
+  CachedQuery q(db_->StatementCache(db),
+                "SELECT ROWID, " + PodcastEpisode::kColumnSpec +
+                    " FROM podcast_episodes"
+                    " WHERE ROWID = :id");
+  q.bindValue(":id", id);
   q.exec();
   if (!db_->CheckErrors(q) && q.next()) {
     ret.InitFromQuery(q);
@@ -266,10 +266,10 @@ PodcastEpisode PodcastBackend::GetEpisodeByUrl(const QUrl& url) {
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery q("SELECT ROWID, " + PodcastEpisode::kColumnSpec +
-                  " FROM podcast_episodes"
-                  " WHERE url = :url",
-              db);
+  CachedQuery q(db_->StatementCache(db),
+                "SELECT ROWID, " + PodcastEpisode::kColumnSpec +
+                    " FROM podcast_episodes"
+                    " WHERE url = :url");
   q.bindValue(":url", url.toEncoded());
   q.exec();
   if (!db_->CheckErrors(q) && q.next()) {
@@ -285,11 +285,11 @@ PodcastEpisode PodcastBackend::GetEpisodeByUrlOrLocalUrl(const QUrl& url) {
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery q("SELECT ROWID, " + PodcastEpisode::kColumnSpec +
-                  " FROM podcast_episodes"
-                  " WHERE url = :url"
-                  "    OR local_url = :url",
-              db);
+  CachedQuery q(db_->StatementCache(db),
+                "SELECT ROWID, " + PodcastEpisode::kColumnSpec +
+                    " FROM podcast_episodes"
+                    " WHERE url = :url"
+                    "    OR local_url = :url");
   q.bindValue(":url", url.toEncoded());
   q.exec();
   if (!db_->CheckErrors(q) && q.next()) {
@@ -35,7 +35,7 @@
 SeafileSettingsPage::SeafileSettingsPage(SettingsDialog* dialog)
     : SettingsPage(dialog),
       ui_(new Ui_SeafileSettingsPage),
-      service_(InternetModel::Service<SeafileService>()) {
+      service_(nullptr) {
   ui_->setupUi(this);
 
   setWindowIcon(IconLoader::Load("seafile", IconLoader::Provider));
@@ -50,12 +50,19 @@ SeafileSettingsPage::SeafileSettingsPage(SettingsDialog* dialog)
 
   ui_->library_box->addItem("None", "none");
 
-  connect(service_, SIGNAL(GetLibrariesFinishedSignal(QMap<QString, QString>)),
-          this, SLOT(GetLibrariesFinished(QMap<QString, QString>)));
 }
 
 SeafileSettingsPage::~SeafileSettingsPage() {}
 
+void SeafileSettingsPage::FirstShown() {
+  service_ = InternetModel::Service<SeafileService>();
+  connect(service_, SIGNAL(GetLibrariesFinishedSignal(QMap<QString, QString>)),
+          this, SLOT(GetLibrariesFinished(QMap<QString, QString>)));
+
+  // Load skipped the parts that need the service.
+  Load();
+}
+
 void SeafileSettingsPage::Load() {
   QSettings s;
   s.beginGroup(SeafileService::kSettingsGroup);
@@ -69,7 +76,7 @@ void SeafileSettingsPage::Load() {
 
     // If there is more than "none" library, that means that we already got the
     // libraries
-    if (ui_->library_box->count() <= 1) {
+    if (service_ && ui_->library_box->count() <= 1) {
       service_->GetLibraries();
     }
   }
@@ -110,7 +117,8 @@ void SeafileSettingsPage::Save() {
   s.setValue("library", id);
   // Don't need to save the password
 
-  if (service_->has_credentials()) {
+  // The library can only have been changed if the page was shown.
+  if (service_ && service_->has_credentials()) {
     service_->ChangeLibrary(id);
   }
 }
@@ -37,6 +37,10 @@ class SeafileSettingsPage : public SettingsPage {
   void Load();
   void Save();
 
+ protected:
+  // SettingsPage
+  void FirstShown();
+
  private slots:
   void Login();
   void Logout();
@@ -30,7 +30,7 @@
 SkydriveSettingsPage::SkydriveSettingsPage(SettingsDialog* parent)
     : SettingsPage(parent),
       ui_(new Ui::SkydriveSettingsPage),
-      service_(dialog()->app()->internet_model()->Service<SkydriveService>()) {
+      service_(nullptr) {
   ui_->setupUi(this);
   setWindowIcon(IconLoader::Load("skydrive", IconLoader::Provider));
 
@@ -38,13 +38,17 @@ SkydriveSettingsPage::SkydriveSettingsPage(SettingsDialog* parent)
 
   connect(ui_->login_button, SIGNAL(clicked()), SLOT(LoginClicked()));
   connect(ui_->login_state, SIGNAL(LogoutClicked()), SLOT(LogoutClicked()));
-  connect(service_, SIGNAL(Connected()), SLOT(Connected()));
 
   dialog()->installEventFilter(this);
 }
 
 SkydriveSettingsPage::~SkydriveSettingsPage() { delete ui_; }
 
+void SkydriveSettingsPage::FirstShown() {
+  service_ = InternetModel::Service<SkydriveService>();
+  connect(service_, SIGNAL(Connected()), SLOT(Connected()));
+}
+
 void SkydriveSettingsPage::Load() {
   QSettings s;
   s.beginGroup(SkydriveService::kSettingsGroup);
@@ -26,8 +26,7 @@
 SoundCloudSettingsPage::SoundCloudSettingsPage(SettingsDialog* parent)
     : SettingsPage(parent),
       ui_(new Ui::SoundCloudSettingsPage),
-      service_(
-          dialog()->app()->internet_model()->Service<SoundCloudService>()) {
+      service_(nullptr) {
   ui_->setupUi(this);
   setWindowIcon(IconLoader::Load("soundcloud", IconLoader::Provider));
   
@@ -35,15 +34,22 @@ SoundCloudSettingsPage::SoundCloudSettingsPage(SettingsDialog* parent)
 
   connect(ui_->login_button, SIGNAL(clicked()), SLOT(LoginClicked()));
   connect(ui_->login_state, SIGNAL(LogoutClicked()), SLOT(LogoutClicked()));
-  connect(service_, SIGNAL(Connected()), SLOT(Connected()));
 
   dialog()->installEventFilter(this);
 }
 
 SoundCloudSettingsPage::~SoundCloudSettingsPage() { delete ui_; }
 
+void SoundCloudSettingsPage::FirstShown() {
+  service_ = InternetModel::Service<SoundCloudService>();
+  connect(service_, SIGNAL(Connected()), SLOT(Connected()));
+
+  // Load skipped the parts that need the service.
+  Load();
+}
+
 void SoundCloudSettingsPage::Load() {
-  if (service_->IsLoggedIn()) {
+  if (service_ && service_->IsLoggedIn()) {
     ui_->login_state->SetLoggedIn(LoginStateWidget::LoggedIn);
   }
 }
@@ -37,6 +37,10 @@ class SoundCloudSettingsPage : public SettingsPage {
   // QObject
   bool eventFilter(QObject* object, QEvent* event);
 
+ protected:
+  // SettingsPage
+  void FirstShown();
+
  private slots:
   void LoginClicked();
   void LogoutClicked();
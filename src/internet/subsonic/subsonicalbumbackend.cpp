@@ -0,0 +1,166 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "subsonicalbumbackend.h"
+
+#include <QSqlQuery>
+#include <QVariant>
+
+#include "core/database.h"
+#include "core/scopedtransaction.h"
+
+const char* SubsonicAlbumBackend::kAlbumsTable = "subsonic_albums";
+const char* SubsonicAlbumBackend::kAlbumSongsTable = "subsonic_album_songs";
+
+SubsonicAlbumBackend::SubsonicAlbumBackend(QObject* parent)
+    : QObject(parent), db_(nullptr) {}
+
+void SubsonicAlbumBackend::Init(Database* db) { db_ = db; }
+
+QMap<QString, QString> SubsonicAlbumBackend::GetFingerprints() {
+  QMap<QString, QString> ret;
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db = db_->Connect();
+
+  QSqlQuery q(QString("SELECT id, fingerprint FROM %1").arg(kAlbumsTable), db);
+  q.exec();
+  if (db_->CheckErrors(q)) return ret;
+
+  while (q.next()) {
+    ret.insert(q.value(0).toString(), q.value(1).toString());
+  }
+  return ret;
+}
+
+QList<QUrl> SubsonicAlbumBackend::GetSongUrls(const QStringList& album_ids) {
+  QList<QUrl> ret;
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db = db_->Connect();
+
+  QSqlQuery q(QString("SELECT url FROM %1 WHERE album_id = :album_id")
+                  .arg(kAlbumSongsTable),
+              db);
+
+  for (const QString& album_id : album_ids) {
+    q.bindValue(":album_id", album_id);
+    q.exec();
+    if (db_->CheckErrors(q)) return ret;
+
+    while (q.next()) {
+      ret << QUrl::fromEncoded(q.value(0).toByteArray());
+    }
+  }
+  return ret;
+}
+
+QSet<QUrl> SubsonicAlbumBackend::GetAllSongUrls() {
+  QSet<QUrl> ret;
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db = db_->Connect();
+
+  QSqlQuery q(QString("SELECT url FROM %1").arg(kAlbumSongsTable), db);
+  q.exec();
+  if (db_->CheckErrors(q)) return ret;
+
+  while (q.next()) {
+    ret << QUrl::fromEncoded(q.value(0).toByteArray());
+  }
+  return ret;
+}
+
+void SubsonicAlbumBackend::UpdateAlbums(const AlbumList& albums) {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db = db_->Connect();
+
+  QSqlQuery update_album(
+      QString("INSERT OR REPLACE INTO %1 (id, fingerprint)"
+              " VALUES (:id, :fingerprint)").arg(kAlbumsTable),
+      db);
+  QSqlQuery clear_songs(
+      QString("DELETE FROM %1 WHERE album_id = :album_id")
+          .arg(kAlbumSongsTable),
+      db);
+  QSqlQuery add_song(QString("INSERT INTO %1 (album_id, url)"
+                             " VALUES (:album_id, :url)")
+                         .arg(kAlbumSongsTable),
+                     db);
+
+  ScopedTransaction t(&db);
+
+  for (const Album& album : albums) {
+    update_album.bindValue(":id", album.id);
+    update_album.bindValue(":fingerprint", album.fingerprint);
+    update_album.exec();
+    if (db_->CheckErrors(update_album)) return;
+
+    clear_songs.bindValue(":album_id", album.id);
+    clear_songs.exec();
+    if (db_->CheckErrors(clear_songs)) return;
+
+    for (const QUrl& url : album.song_urls) {
+      add_song.bindValue(":album_id", album.id);
+      add_song.bindValue(":url", url.toEncoded());
+      add_song.exec();
+      if (db_->CheckErrors(add_song)) return;
+    }
+  }
+
+  t.Commit();
+}
+
+void SubsonicAlbumBackend::RemoveAlbums(const QStringList& album_ids) {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db = db_->Connect();
+
+  QSqlQuery remove_album(
+      QString("DELETE FROM %1 WHERE id = :id").arg(kAlbumsTable), db);
+  QSqlQuery remove_songs(
+      QString("DELETE FROM %1 WHERE album_id = :album_id")
+          .arg(kAlbumSongsTable),
+      db);
+
+  ScopedTransaction t(&db);
+
+  for (const QString& album_id : album_ids) {
+    remove_album.bindValue(":id", album_id);
+    remove_album.exec();
+    if (db_->CheckErrors(remove_album)) return;
+
+    remove_songs.bindValue(":album_id", album_id);
+    remove_songs.exec();
+    if (db_->CheckErrors(remove_songs)) return;
+  }
+
+  t.Commit();
+}
+
+void SubsonicAlbumBackend::DeleteAll() {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db = db_->Connect();
+
+  ScopedTransaction t(&db);
+
+  QSqlQuery q(QString("DELETE FROM %1").arg(kAlbumsTable), db);
+  q.exec();
+  if (db_->CheckErrors(q)) return;
+
+  q = QSqlQuery(QString("DELETE FROM %1").arg(kAlbumSongsTable), db);
+  q.exec();
+  if (db_->CheckErrors(q)) return;
+
+  t.Commit();
+}
@@ -0,0 +1,72 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INTERNET_SUBSONIC_SUBSONICALBUMBACKEND_H_
+#define INTERNET_SUBSONIC_SUBSONICALBUMBACKEND_H_
+
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QUrl>
+
+#include "core/qhash_qurl.h"
+
+class Database;
+
+// Remembers which albums were fetched from the Subsonic server, what they
+// looked like at the time and which songs they contained, so the next sync only
+// has to fetch the albums that changed.
+class SubsonicAlbumBackend : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit SubsonicAlbumBackend(QObject* parent = nullptr);
+  void Init(Database* db);
+
+  static const char* kAlbumsTable;
+  static const char* kAlbumSongsTable;
+
+  struct Album {
+    QString id;
+    QString fingerprint;
+    QList<QUrl> song_urls;
+  };
+  typedef QList<Album> AlbumList;
+
+  // Returns album id -> fingerprint for every album that has been synced.
+  QMap<QString, QString> GetFingerprints();
+
+  // Returns the URLs of the songs that were in these albums when they were
+  // last synced.
+  QList<QUrl> GetSongUrls(const QStringList& album_ids);
+
+  // Returns the URLs of the songs in every album.
+  QSet<QUrl> GetAllSongUrls();
+
+  // Replaces everything stored about these albums.
+  void UpdateAlbums(const AlbumList& albums);
+  void RemoveAlbums(const QStringList& album_ids);
+
+  void DeleteAll();
+
+ private:
+  Database* db_;
+};
+
+#endif  // INTERNET_SUBSONIC_SUBSONICALBUMBACKEND_H_
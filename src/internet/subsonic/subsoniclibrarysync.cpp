@@ -0,0 +1,130 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "subsoniclibrarysync.h"
+
+#include <QHash>
+
+#include "core/qhash_qurl.h"
+#include "library/librarybackend.h"
+
+const int SubsonicLibrarySync::kBatchSize = 1000;
+
+SubsonicLibrarySync::SubsonicLibrarySync(LibraryBackend* library_backend,
+                                         SubsonicAlbumBackend* album_backend,
+                                         QObject* parent)
+    : QObject(parent),
+      library_backend_(library_backend),
+      album_backend_(album_backend) {}
+
+void SubsonicLibrarySync::Start() {
+  scanned_albums_.clear();
+  scanned_songs_.clear();
+  known_fingerprints_ = album_backend_->GetFingerprints();
+  emit Started(known_fingerprints_);
+}
+
+void SubsonicLibrarySync::AddAlbum(const QString& id,
+                                   const QString& fingerprint,
+                                   const SongList& songs) {
+  SubsonicAlbumBackend::Album album;
+  album.id = id;
+  album.fingerprint = fingerprint;
+  for (const Song& song : songs) {
+    album.song_urls << song.url();
+  }
+
+  scanned_albums_ << album;
+  scanned_songs_ << songs;
+
+  if (scanned_songs_.count() >= kBatchSize) {
+    Commit();
+  }
+}
+
+void SubsonicLibrarySync::Commit() {
+  if (scanned_albums_.isEmpty()) return;
+
+  QList<QUrl> urls;
+  for (const Song& song : scanned_songs_) {
+    urls << song.url();
+  }
+
+  QHash<QUrl, Song> existing_songs;
+  for (const Song& song : library_backend_->GetSongsByUrls(urls)) {
+    existing_songs[song.url()] = song;
+  }
+
+  SongList changed_songs;
+  for (const Song& song : scanned_songs_) {
+    if (existing_songs.contains(song.url())) {
+      const Song& existing = existing_songs[song.url()];
+      if (existing.IsMetadataEqual(song)) continue;
+
+      Song updated(song);
+      updated.set_id(existing.id());
+      changed_songs << updated;
+    } else {
+      changed_songs << song;
+    }
+  }
+
+  if (!changed_songs.isEmpty()) {
+    library_backend_->AddOrUpdateSongs(changed_songs);
+  }
+  album_backend_->UpdateAlbums(scanned_albums_);
+
+  scanned_albums_.clear();
+  scanned_songs_.clear();
+}
+
+void SubsonicLibrarySync::Finish(bool complete,
+                                 const QSet<QString>& seen_albums) {
+  Commit();
+
+  // If the album list didn't come through completely we can't tell which
+  // songs were removed, so leave everything else alone until next time.
+  if (!complete) {
+    emit Finished();
+    return;
+  }
+
+  QStringList removed_albums;
+  for (const QString& id : known_fingerprints_.keys()) {
+    if (!seen_albums.contains(id)) removed_albums << id;
+  }
+  album_backend_->RemoveAlbums(removed_albums);
+
+  // Every song on the server now belongs to exactly one album we know about,
+  // so anything else has gone - whether its album was removed, or it was
+  // dropped from an album that changed.  This also cleans up libraries that
+  // were synced before albums were tracked.
+  library_backend_->DeleteSongsNotIn(SubsonicAlbumBackend::kAlbumSongsTable,
+                                     "url");
+
+  emit Finished();
+}
+
+void SubsonicLibrarySync::Clear() {
+  scanned_albums_.clear();
+  scanned_songs_.clear();
+  known_fingerprints_.clear();
+
+  library_backend_->DeleteAll();
+  album_backend_->DeleteAll();
+}
@@ -0,0 +1,81 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef INTERNET_SUBSONIC_SUBSONICLIBRARYSYNC_H_
+#define INTERNET_SUBSONIC_SUBSONICLIBRARYSYNC_H_
+
+#include <QMap>
+#include <QObject>
+#include <QSet>
+#include <QString>
+
+#include "core/song.h"
+#include "internet/subsonic/subsonicalbumbackend.h"
+
+class LibraryBackend;
+
+// Applies the albums fetched by a SubsonicLibraryScanner to the local library.
+// Songs are added and updated in batches as their albums arrive, but nothing
+// is deleted until the whole album list has been seen: a song that moved to
+// another album might only turn up in a later batch.
+//
+// SubsonicService moves this to the database thread and calls its slots with
+// queued connections, so the library stays usable while a sync runs.
+class SubsonicLibrarySync : public QObject {
+  Q_OBJECT
+
+ public:
+  SubsonicLibrarySync(LibraryBackend* library_backend,
+                      SubsonicAlbumBackend* album_backend,
+                      QObject* parent = nullptr);
+
+  static const int kBatchSize;
+
+ public slots:
+  // Emits Started with album id -> fingerprint for the albums already in the
+  // library, to pass to SubsonicLibraryScanner::Scan().
+  void Start();
+
+  void AddAlbum(const QString& id, const QString& fingerprint,
+                const SongList& songs);
+
+  // Writes the albums added so far to the database.
+  void Commit();
+
+  // Commits what's left, and if the scan saw every album on the server,
+  // removes the albums that weren't in seen_albums and any songs that no
+  // album refers to any more.  Emits Finished.
+  void Finish(bool complete, const QSet<QString>& seen_albums);
+
+  // Forgets everything that was synced.
+  void Clear();
+
+ signals:
+  void Started(const QMap<QString, QString>& known_fingerprints);
+  void Finished();
+
+ private:
+  LibraryBackend* library_backend_;
+  SubsonicAlbumBackend* album_backend_;
+
+  QMap<QString, QString> known_fingerprints_;
+  SubsonicAlbumBackend::AlbumList scanned_albums_;
+  SongList scanned_songs_;
+};
+
+#endif  // INTERNET_SUBSONIC_SUBSONICLIBRARYSYNC_H_
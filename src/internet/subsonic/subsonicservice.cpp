@@ -42,6 +42,7 @@
 #include "globalsearch/globalsearch.h"
 #include "globalsearch/librarysearchprovider.h"
 #include "internet/core/internetmodel.h"
+#include "internet/subsonic/subsoniclibrarysync.h"
 #include "internet/subsonic/subsonicurlhandler.h"
 #include "library/librarybackend.h"
 #include "library/libraryfilterwidget.h"
@@ -63,6 +64,8 @@ SubsonicService::SubsonicService(Application* app, InternetModel* parent)
       url_handler_(new SubsonicUrlHandler(this, this)),
       scanner_(new SubsonicLibraryScanner(this, this)),
       load_database_task_id_(0),
+      album_backend_(new SubsonicAlbumBackend(this)),
+      sync_(nullptr),
       context_menu_(nullptr),
       root_(nullptr),
       library_backend_(nullptr),
@@ -74,7 +77,9 @@ SubsonicService::SubsonicService(Application* app, InternetModel* parent)
       redirect_count_(0) {
   app_->player()->RegisterUrlHandler(url_handler_);
 
-  connect(scanner_, SIGNAL(ScanFinished()), SLOT(ReloadDatabaseFinished()));
+  connect(scanner_, SIGNAL(ScanFinished()), SLOT(ScanFinished()));
+
+  album_backend_->Init(app_->database());
 
   library_backend_ = new LibraryBackend;
   library_backend_->moveToThread(app_->database()->thread());
@@ -83,6 +88,14 @@ SubsonicService::SubsonicService(Application* app, InternetModel* parent)
   connect(library_backend_, SIGNAL(TotalSongCountUpdated(int)),
           SLOT(UpdateTotalSongCount(int)));
 
+  sync_ = new SubsonicLibrarySync(library_backend_, album_backend_);
+  sync_->moveToThread(app_->database()->thread());
+  connect(sync_, SIGNAL(Started(QMap<QString, QString>)),
+          SLOT(SyncStarted(QMap<QString, QString>)));
+  connect(scanner_, SIGNAL(AlbumScanned(QString, QString, SongList)), sync_,
+          SLOT(AddAlbum(QString, QString, SongList)));
+  connect(sync_, SIGNAL(Finished()), SLOT(ReloadDatabaseFinished()));
+
   library_model_ = new LibraryModel(library_backend_, app_, this);
   library_model_->set_show_various_artists(false);
   library_model_->set_show_smart_playlists(false);
@@ -99,9 +112,6 @@ SubsonicService::SubsonicService(Application* app, InternetModel* parent)
   library_sort_model_->setSortLocaleAware(true);
   library_sort_model_->sort(0);
 
-  connect(this, SIGNAL(LoginStateChanged(SubsonicService::LoginState)),
-          SLOT(OnLoginStateChanged(SubsonicService::LoginState)));
-
   context_menu_ = new QMenu;
   context_menu_->addActions(GetPlaylistActions());
   context_menu_->addSeparator();
@@ -121,7 +131,7 @@ SubsonicService::SubsonicService(Application* app, InternetModel* parent)
       IconLoader::Load("subsonic", IconLoader::Provider), true, app_, this));
 }
 
-SubsonicService::~SubsonicService() {}
+SubsonicService::~SubsonicService() { sync_->deleteLater(); }
 
 QStandardItem* SubsonicService::CreateRootItem() {
   root_ = new QStandardItem(IconLoader::Load("subsonic", IconLoader::Provider), 
@@ -246,26 +256,32 @@ void SubsonicService::UpdateTotalSongCount(int count) {
 }
 
 void SubsonicService::ReloadDatabase() {
-  if (!load_database_task_id_) {
-    load_database_task_id_ =
-        app_->task_manager()->StartTask(tr("Fetching Subsonic library"));
-  }
-  scanner_->Scan();
+  if (load_database_task_id_) return;
+
+  load_database_task_id_ =
+      app_->task_manager()->StartTask(tr("Fetching Subsonic library"));
+
+  QMetaObject::invokeMethod(sync_, "Start", Qt::QueuedConnection);
+}
+
+void SubsonicService::SyncStarted(
+    const QMap<QString, QString>& known_fingerprints) {
+  scanner_->Scan(known_fingerprints);
+}
+
+void SubsonicService::ScanFinished() {
+  QMetaObject::invokeMethod(sync_, "Finish", Qt::QueuedConnection,
+                            Q_ARG(bool, !scanner_->aborted()),
+                            Q_ARG(QSet<QString>, scanner_->seen_albums()));
 }
 
 void SubsonicService::ReloadDatabaseFinished() {
   app_->task_manager()->SetTaskFinished(load_database_task_id_);
   load_database_task_id_ = 0;
-
-  library_backend_->DeleteAll();
-  library_backend_->AddOrUpdateSongs(scanner_->GetSongs());
-  library_model_->Reset();
 }
 
-void SubsonicService::OnLoginStateChanged(
-    SubsonicService::LoginState newstate) {
-  // TODO(Alan Briolat): library refresh logic?
-  if (newstate != LoginState_Loggedin) library_backend_->DeleteAll();
+void SubsonicService::Logout() {
+  QMetaObject::invokeMethod(sync_, "Clear", Qt::QueuedConnection);
 }
 
 void SubsonicService::OnPingFinished(QNetworkReply* reply) {
@@ -364,6 +380,12 @@ void SubsonicService::ShowConfig() {
 }
 
 void SubsonicService::UpdateServer(const QString& server) {
+  // The library that was synced belongs to the old server.  Failing to log in
+  // isn't enough to clear it - that might just be a network problem.
+  if (!configured_server_.isEmpty() && server != configured_server_) {
+    QMetaObject::invokeMethod(sync_, "Clear", Qt::QueuedConnection);
+  }
+
   configured_server_ = server;
   working_server_ = server;
   redirect_count_ = 0;
@@ -374,22 +396,39 @@ const int SubsonicLibraryScanner::kConcurrentRequests = 8;
 
 SubsonicLibraryScanner::SubsonicLibraryScanner(SubsonicService* service,
                                                QObject* parent)
-    : QObject(parent), service_(service), scanning_(false) {}
+    : QObject(parent), service_(service), scanning_(false), aborted_(false) {}
 
 SubsonicLibraryScanner::~SubsonicLibraryScanner() {}
 
-void SubsonicLibraryScanner::Scan() {
+void SubsonicLibraryScanner::Scan(
+    const QMap<QString, QString>& known_fingerprints) {
   if (scanning_) {
     return;
   }
 
+  known_fingerprints_ = known_fingerprints;
+  changed_fingerprints_.clear();
+  seen_albums_.clear();
   album_queue_.clear();
   pending_requests_.clear();
-  songs_.clear();
   scanning_ = true;
+  aborted_ = false;
   GetAlbumList(0);
 }
 
+QString SubsonicLibraryScanner::AlbumFingerprint(
+    const QXmlStreamReader& reader) {
+  // Servers that support it tell us when an album was last changed, but
+  // there's always a creation date, song count and duration to compare.
+  const QXmlStreamAttributes attributes = reader.attributes();
+  return (QStringList() << attributes.value("created").toString()
+                        << attributes.value("changed").toString()
+                        << attributes.value("songCount").toString()
+                        << attributes.value("duration").toString()
+                        << attributes.value("name").toString()
+                        << attributes.value("artist").toString()).join("|");
+}
+
 void SubsonicLibraryScanner::OnGetAlbumListFinished(QNetworkReply* reply,
                                                     int offset) {
   reply->deleteLater();
@@ -435,8 +474,16 @@ void SubsonicLibraryScanner::OnGetAlbumListFinished(QNetworkReply* reply,
         return;
       }
 
-      album_queue_ << reader.attributes().value("id").toString();
+      const QString id = reader.attributes().value("id").toString();
+      const QString fingerprint = AlbumFingerprint(reader);
+      seen_albums_ << id;
       albums_added++;
+
+      // Only fetch the songs of albums that are new or have changed.
+      if (known_fingerprints_.value(id) != fingerprint) {
+        changed_fingerprints_[id] = fingerprint;
+        album_queue_ << id;
+      }
       reader.skipCurrentElement();
     }
   }
@@ -445,7 +492,7 @@ void SubsonicLibraryScanner::OnGetAlbumListFinished(QNetworkReply* reply,
     // Non-empty reply means potentially more albums to fetch
     GetAlbumList(offset + kAlbumChunkSize);
   } else if (album_queue_.size() == 0) {
-    // Empty reply and no albums means an empty Subsonic server
+    // Empty reply and no changed albums means there's nothing to fetch
     scanning_ = false;
     emit ScanFinished();
   } else {
@@ -458,74 +505,82 @@ void SubsonicLibraryScanner::OnGetAlbumListFinished(QNetworkReply* reply,
   }
 }
 
-void SubsonicLibraryScanner::OnGetAlbumFinished(QNetworkReply* reply) {
+void SubsonicLibraryScanner::OnGetAlbumFinished(QNetworkReply* reply,
+                                                const QString& id) {
   reply->deleteLater();
   pending_requests_.remove(reply);
 
+  // A broken album doesn't stop the scan - it keeps its old fingerprint so it
+  // gets fetched again next time.
   QXmlStreamReader reader(reply);
-  reader.readNextStartElement();
+  SongList songs;
+  if (ParseAlbum(&reader, &songs)) {
+    emit AlbumScanned(id, changed_fingerprints_.value(id), songs);
+  } else {
+    qLog(Warning) << "Failed to read Subsonic album" << id;
+  }
 
-  if (reader.name() != "subsonic-response") {
-    ParsingError("Not a subsonic-response. Aborting scan.");
-    return;
+  // Start the next request if albums remain
+  if (!album_queue_.empty()) {
+    GetAlbum(album_queue_.dequeue());
   }
 
-  if (reader.attributes().value("status") != "ok") {
+  // If this was the last response, we're done!
+  if (album_queue_.empty() && pending_requests_.empty()) {
+    scanning_ = false;
+    emit ScanFinished();
+  }
+}
+
+bool SubsonicLibraryScanner::ParseAlbum(QXmlStreamReader* reader,
+                                        SongList* songs) {
+  reader->readNextStartElement();
+
+  if (reader->name() != "subsonic-response") return false;
+
+  if (reader->attributes().value("status") != "ok") {
     // TODO(Alan Briolat): error handling
-    return;
+    return false;
   }
 
   // Read album information
-  reader.readNextStartElement();
-  if (reader.name() != "album") {
-    ParsingError("album tag expected. Aborting scan.");
-    return;
-  }
+  reader->readNextStartElement();
+  if (reader->name() != "album") return false;
 
-  QString album_artist = reader.attributes().value("artist").toString();
+  QString album_artist = reader->attributes().value("artist").toString();
 
   // Read song information
-  while (reader.readNextStartElement()) {
-    if (reader.name() != "song") {
-      ParsingError("song tag expected. Aborting scan.");
-      return;
-    }
+  while (reader->readNextStartElement()) {
+    if (reader->name() != "song") return false;
+
+    const QXmlStreamAttributes attributes = reader->attributes();
 
     Song song;
-    QString id = reader.attributes().value("id").toString();
-    song.set_title(reader.attributes().value("title").toString());
-    song.set_album(reader.attributes().value("album").toString());
-    song.set_track(reader.attributes().value("track").toString().toInt());
-    song.set_disc(reader.attributes().value("discNumber").toString().toInt());
-    song.set_artist(reader.attributes().value("artist").toString());
+    QString id = attributes.value("id").toString();
+    song.set_title(attributes.value("title").toString());
+    song.set_album(attributes.value("album").toString());
+    song.set_track(attributes.value("track").toString().toInt());
+    song.set_disc(attributes.value("discNumber").toString().toInt());
+    song.set_artist(attributes.value("artist").toString());
     song.set_albumartist(album_artist);
-    song.set_bitrate(reader.attributes().value("bitRate").toString().toInt());
-    song.set_year(reader.attributes().value("year").toString().toInt());
-    song.set_genre(reader.attributes().value("genre").toString());
-    qint64 length = reader.attributes().value("duration").toString().toInt();
+    song.set_bitrate(attributes.value("bitRate").toString().toInt());
+    song.set_year(attributes.value("year").toString().toInt());
+    song.set_genre(attributes.value("genre").toString());
+    qint64 length = attributes.value("duration").toString().toInt();
     length *= kNsecPerSec;
     song.set_length_nanosec(length);
     QUrl url = QUrl(QString("subsonic://%1").arg(id));
     song.set_url(url);
-    song.set_filesize(reader.attributes().value("size").toString().toInt());
+    song.set_filesize(attributes.value("size").toString().toInt());
     // We need to set these to satisfy the database constraints
     song.set_directory_id(0);
     song.set_mtime(0);
     song.set_ctime(0);
-    songs_ << song;
-    reader.skipCurrentElement();
+    songs->append(song);
+    reader->skipCurrentElement();
   }
 
-  // Start the next request if albums remain
-  if (!album_queue_.empty()) {
-    GetAlbum(album_queue_.dequeue());
-  }
-
-  // If this was the last response, we're done!
-  if (album_queue_.empty() && pending_requests_.empty()) {
-    scanning_ = false;
-    emit ScanFinished();
-  }
+  return !reader->hasError();
 }
 
 void SubsonicLibraryScanner::GetAlbumList(int offset) {
@@ -543,12 +598,13 @@ void SubsonicLibraryScanner::GetAlbum(const QString& id) {
   url.addQueryItem("id", id);
   QNetworkReply* reply = service_->Send(url);
   NewClosure(reply, SIGNAL(finished()), this,
-             SLOT(OnGetAlbumFinished(QNetworkReply*)), reply);
+             SLOT(OnGetAlbumFinished(QNetworkReply*, QString)), reply, id);
   pending_requests_.insert(reply);
 }
 
 void SubsonicLibraryScanner::ParsingError(const QString& message) {
   qLog(Warning) << "Subsonic parsing error: " << message;
   scanning_ = false;
+  aborted_ = true;
   emit ScanFinished();
 }
@@ -23,9 +23,12 @@
 #define INTERNET_SUBSONIC_SUBSONICSERVICE_H_
 
 #include <QQueue>
+#include <QSet>
 
+#include "core/qhash_qurl.h"
 #include "internet/core/internetmodel.h"
 #include "internet/core/internetservice.h"
+#include "internet/subsonic/subsonicalbumbackend.h"
 
 class QNetworkAccessManager;
 class QNetworkReply;
@@ -34,6 +37,7 @@ class QXmlStreamReader;
 
 class SubsonicUrlHandler;
 class SubsonicLibraryScanner;
+class SubsonicLibrarySync;
 
 class SubsonicService : public InternetService {
   Q_OBJECT
@@ -99,6 +103,9 @@ class SubsonicService : public InternetService {
 
   LoginState login_state() const { return login_state_; }
 
+  // Forgets the library that was synced from the server.
+  void Logout();
+
   // Subsonic API methods
   void Ping();
 
@@ -133,6 +140,11 @@ signals:
   SubsonicLibraryScanner* scanner_;
   int load_database_task_id_;
 
+  // Albums are written to the library in batches as they're scanned, so the
+  // existing library stays usable while the sync runs.
+  SubsonicAlbumBackend* album_backend_;
+  SubsonicLibrarySync* sync_;
+
   QMenu* context_menu_;
   QStandardItem* root_;
 
@@ -156,8 +168,9 @@ signals:
  private slots:
   void UpdateTotalSongCount(int count);
   void ReloadDatabase();
+  void SyncStarted(const QMap<QString, QString>& known_fingerprints);
+  void ScanFinished();
   void ReloadDatabaseFinished();
-  void OnLoginStateChanged(SubsonicService::LoginState newstate);
   void OnPingFinished(QNetworkReply* reply);
 
   void ShowConfig();
@@ -171,20 +184,32 @@ class SubsonicLibraryScanner : public QObject {
                                   QObject* parent = nullptr);
   ~SubsonicLibraryScanner();
 
-  void Scan();
-  const SongList& GetSongs() const { return songs_; }
+  // Only albums whose fingerprint differs from the one in known_fingerprints
+  // are fetched.
+  void Scan(const QMap<QString, QString>& known_fingerprints);
+
+  // After ScanFinished, all the album ids the server listed.  Not valid if the
+  // scan was aborted.
+  const QSet<QString>& seen_albums() const { return seen_albums_; }
+  bool aborted() const { return aborted_; }
+
+  static QString AlbumFingerprint(const QXmlStreamReader& reader);
+  // Reads the songs from a getAlbum response.
+  static bool ParseAlbum(QXmlStreamReader* reader, SongList* songs);
 
   static const int kAlbumChunkSize;
   static const int kConcurrentRequests;
 
 signals:
+  void AlbumScanned(const QString& id, const QString& fingerprint,
+                    const SongList& songs);
   void ScanFinished();
 
  private slots:
   // Step 1: use getAlbumList2 type=alphabeticalByName to list all albums
   void OnGetAlbumListFinished(QNetworkReply* reply, int offset);
-  // Step 2: use getAlbum id=? to list all songs for each album
-  void OnGetAlbumFinished(QNetworkReply* reply);
+  // Step 2: use getAlbum id=? to list all songs for each changed album
+  void OnGetAlbumFinished(QNetworkReply* reply, const QString& id);
 
  private:
   void GetAlbumList(int offset);
@@ -193,9 +218,12 @@ signals:
 
   SubsonicService* service_;
   bool scanning_;
+  bool aborted_;
+  QMap<QString, QString> known_fingerprints_;
+  QMap<QString, QString> changed_fingerprints_;
+  QSet<QString> seen_albums_;
   QQueue<QString> album_queue_;
   QSet<QNetworkReply*> pending_requests_;
-  SongList songs_;
 };
 
 #endif  // INTERNET_SUBSONIC_SUBSONICSERVICE_H_
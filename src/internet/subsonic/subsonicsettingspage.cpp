@@ -30,7 +30,7 @@
 SubsonicSettingsPage::SubsonicSettingsPage(SettingsDialog* dialog)
     : SettingsPage(dialog),
       ui_(new Ui_SubsonicSettingsPage),
-      service_(InternetModel::Service<SubsonicService>()) {
+      service_(nullptr) {
   ui_->setupUi(this);
   setWindowIcon(IconLoader::Load("subsonic", IconLoader::Provider));
 
@@ -38,8 +38,6 @@ SubsonicSettingsPage::SubsonicSettingsPage(SettingsDialog* dialog)
           SLOT(ServerEditingFinished()));
   connect(ui_->login, SIGNAL(clicked()), SLOT(Login()));
   connect(ui_->login_state, SIGNAL(LogoutClicked()), SLOT(Logout()));
-  connect(service_, SIGNAL(LoginStateChanged(SubsonicService::LoginState)),
-          SLOT(LoginStateChanged(SubsonicService::LoginState)));
 
   ui_->login_state->AddCredentialField(ui_->server);
   ui_->login_state->AddCredentialField(ui_->username);
@@ -55,6 +53,15 @@ SubsonicSettingsPage::SubsonicSettingsPage(SettingsDialog* dialog)
 
 SubsonicSettingsPage::~SubsonicSettingsPage() { delete ui_; }
 
+void SubsonicSettingsPage::FirstShown() {
+  service_ = InternetModel::Service<SubsonicService>();
+  connect(service_, SIGNAL(LoginStateChanged(SubsonicService::LoginState)),
+          SLOT(LoginStateChanged(SubsonicService::LoginState)));
+
+  // Load skipped the parts that need the service.
+  Load();
+}
+
 void SubsonicSettingsPage::Load() {
   QSettings s;
   s.beginGroup(SubsonicService::kSettingsGroup);
@@ -67,7 +74,7 @@ void SubsonicSettingsPage::Load() {
   // If the settings are complete, SubsonicService will have used them already
   // and
   // we can tell the user if they worked
-  if (ui_->server->text() != "" && ui_->username->text() != "") {
+  if (service_ && ui_->server->text() != "" && ui_->username->text() != "") {
     LoginStateChanged(service_->login_state());
   }
 }
@@ -196,4 +203,5 @@ void SubsonicSettingsPage::Login() {
 void SubsonicSettingsPage::Logout() {
   ui_->username->setText("");
   ui_->password->setText("");
+  if (service_) service_->Logout();
 }
@@ -35,6 +35,10 @@ class SubsonicSettingsPage : public SettingsPage {
   void Load();
   void Save();
 
+ protected:
+  // SettingsPage
+  void FirstShown();
+
  public slots:
   void LoginStateChanged(SubsonicService::LoginState newstate);
 
@@ -19,6 +19,7 @@
 
 #include "librarymodel.h"
 #include "librarybackend.h"
+#include "tagstatisticswriter.h"
 #include "core/application.h"
 #include "core/database.h"
 #include "core/player.h"
@@ -29,10 +30,24 @@
 #include "smartplaylists/querygenerator.h"
 #include "smartplaylists/search.h"
 
+namespace {
+
+// Returns once the thread has processed every event that was posted to it
+// before this call.
+void FlushThread(QThread* thread) {
+  QObject* marker = new QObject;
+  marker->moveToThread(thread);
+  QMetaObject::invokeMethod(marker, "deleteLater",
+                            Qt::BlockingQueuedConnection);
+}
+
+}  // namespace
+
 const char* Library::kSongsTable = "songs";
 const char* Library::kDirsTable = "directories";
 const char* Library::kSubdirsTable = "subdirectories";
 const char* Library::kFtsTable = "songs_fts";
+const char* Library::kGroupsTable = "song_groups";
 
 Library::Library(Application* app, QObject* parent)
     : QObject(parent),
@@ -41,14 +56,32 @@ Library::Library(Application* app, QObject* parent)
       model_(nullptr),
       watcher_(nullptr),
       watcher_thread_(nullptr),
+      tag_writer_(nullptr),
       save_statistics_in_files_(false),
       save_ratings_in_files_(false) {
   backend_ = new LibraryBackend;
   backend()->moveToThread(app->database()->thread());
 
   backend_->Init(app->database(), kSongsTable, kDirsTable, kSubdirsTable,
-                 kFtsTable);
+                 kFtsTable, kGroupsTable);
+
+  // The writer keeps its journal in the database, so it runs in the same
+  // thread as the backend.
+  tag_writer_ = new TagStatisticsWriter(backend_, app->tag_reader_client());
+  app->MoveToThread(tag_writer_, backend_->thread());
+
+  // There's nothing to show the model in without a GUI, and its icons need a
+  // QApplication.
+  if (!app_->is_headless()) CreateModel();
+
+  // full rescan revisions
+  full_rescan_revisions_[26] = tr("CUE sheet support");
+  full_rescan_revisions_[50] = tr("Original year tag support");
+
+  ReloadSettings();
+}
 
+void Library::CreateModel() {
   using smart_playlists::Generator;
   using smart_playlists::GeneratorPtr;
   using smart_playlists::QueryGenerator;
@@ -112,12 +145,6 @@ Library::Library(Application* app, QObject* parent)
               Search(Search::Type_All, Search::TermList(), Search::Sort_Random,
                      SearchTerm::Field_Title),
               true))));
-
-  // full rescan revisions
-  full_rescan_revisions_[26] = tr("CUE sheet support");
-  full_rescan_revisions_[50] = tr("Original year tag support");
-
-  ReloadSettings();
 }
 
 Library::~Library() {
@@ -157,11 +184,15 @@ void Library::Init() {
           SLOT(AddOrUpdateSubdirs(SubdirectoryList)));
   connect(watcher_, SIGNAL(SubdirsMTimeUpdated(SubdirectoryList)), backend_,
           SLOT(AddOrUpdateSubdirs(SubdirectoryList)));
-  connect(watcher_, SIGNAL(CompilationsNeedUpdating()), backend_,
-          SLOT(UpdateCompilations()));
-  connect(app_->playlist_manager(), SIGNAL(CurrentSongChanged(Song)),
-          SLOT(CurrentSongChanged(Song)));
-  connect(app_->player(), SIGNAL(Stopped()), SLOT(Stopped()));
+  connect(watcher_, SIGNAL(CompilationsNeedUpdating(QStringList)), backend_,
+          SLOT(UpdateCompilationsForAlbums(QStringList)));
+  if (!app_->is_headless()) {
+    connect(app_->playlist_manager(), SIGNAL(CurrentSongChanged(Song)),
+            SLOT(CurrentSongChanged(Song)));
+    connect(app_->player(), SIGNAL(Stopped()), SLOT(Stopped()));
+  }
+
+  tag_writer_->InitAsync();
 
   // This will start the watcher checking for updates
   backend_->LoadDirectoriesAsync();
@@ -175,6 +206,16 @@ void Library::PauseWatcher() { watcher_->SetRescanPausedAsync(true); }
 
 void Library::ResumeWatcher() { watcher_->SetRescanPausedAsync(false); }
 
+void Library::WaitForScansToFinish() {
+  // Scans are started by queued signals from the backend and their results go
+  // back to it the same way.  The watcher scans synchronously inside its
+  // slots, so one trip through the backend's thread, the watcher's and the
+  // backend's again sees everything that was asked for so far through.
+  FlushThread(backend_->thread());
+  FlushThread(watcher_thread_);
+  FlushThread(backend_->thread());
+}
+
 void Library::ReloadSettings() {
   watcher_->ReloadSettingsAsync();
 
@@ -204,49 +245,26 @@ void Library::WriteAllSongsStatisticsToFiles() {
   app_->task_manager()->SetTaskFinished(task_id);
 }
 
+void Library::WritePendingStatisticsToFiles() { tag_writer_->FlushBlocking(); }
+
 void Library::Stopped() { CurrentSongChanged(Song()); }
 
 void Library::CurrentSongChanged(const Song& song) {
-  TagReaderReply* reply = nullptr;
-  if (queued_rating_.is_valid()) {
-    reply = app_->tag_reader_client()->UpdateSongRating(queued_rating_);
-    queued_rating_ = Song();
-  } else if (queued_statistics_.is_valid()) {
-    reply = app_->tag_reader_client()->UpdateSongStatistics(queued_statistics_);
-    queued_statistics_ = Song();
-  }
-
-  if (reply) {
-    connect(reply, SIGNAL(Finished(bool)), reply, SLOT(deleteLater()));
-  }
-
-  if (song.filetype() == Song::Type_Asf) {
-    current_wma_song_url_ = song.url();
-  }
+  // Hack: Gstreamer doesn't cope well with WMA files being rewritten while
+  // being played, so we delay statistics and rating changes until the current
+  // song has finished playing.
+  tag_writer_->SetHeldUrlAsync(
+      song.filetype() == Song::Type_Asf ? song.url() : QUrl());
 }
 
 void Library::SongsRatingChanged(const SongList& songs) {
   if (save_ratings_in_files_) {
-    app_->tag_reader_client()->UpdateSongsRating(
-        FilterCurrentWMASong(songs, &queued_rating_));
+    tag_writer_->QueueRatingAsync(songs);
   }
 }
 
 void Library::SongsStatisticsChanged(const SongList& songs) {
   if (save_statistics_in_files_) {
-    app_->tag_reader_client()->UpdateSongsStatistics(
-        FilterCurrentWMASong(songs, &queued_statistics_));
-  }
-}
-
-SongList Library::FilterCurrentWMASong(SongList songs, Song* queued) {
-  for (SongList::iterator it = songs.begin(); it != songs.end();) {
-    if (it->url() == current_wma_song_url_) {
-      *queued = *it;
-      it = songs.erase(it);
-    } else {
-      ++it;
-    }
+    tag_writer_->QueueStatisticsAsync(songs);
   }
-  return songs;
 }
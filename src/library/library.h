@@ -29,6 +29,7 @@ class Database;
 class LibraryBackend;
 class LibraryModel;
 class LibraryWatcher;
+class TagStatisticsWriter;
 class TaskManager;
 class Thread;
 
@@ -43,6 +44,7 @@ class Library : public QObject {
   static const char* kDirsTable;
   static const char* kSubdirsTable;
   static const char* kFtsTable;
+  static const char* kGroupsTable;
 
   void Init();
 
@@ -55,6 +57,15 @@ class Library : public QObject {
 
   void WriteAllSongsStatisticsToFiles();
 
+  // Writes any statistics and ratings that are still waiting to go into the
+  // files.  Called on shutdown while the tagreader is still running.
+  void WritePendingStatisticsToFiles();
+
+  // Blocks until the watcher has finished every scan it's been asked to do and
+  // the backend has written the results.  This would freeze the GUI, so it's
+  // only for headless runs.
+  void WaitForScansToFinish();
+
  public slots:
   void ReloadSettings();
 
@@ -72,7 +83,7 @@ class Library : public QObject {
   void Stopped();
 
  private:
-  SongList FilterCurrentWMASong(SongList songs, Song* queued);
+  void CreateModel();
 
  private:
   Application* app_;
@@ -82,16 +93,11 @@ class Library : public QObject {
   LibraryWatcher* watcher_;
   Thread* watcher_thread_;
 
+  TagStatisticsWriter* tag_writer_;
+
   bool save_statistics_in_files_;
   bool save_ratings_in_files_;
 
-  // Hack: Gstreamer doesn't cope well with WMA files being rewritten while
-  // being played, so we delay statistics and rating changes until the current
-  // song has finished playing.
-  QUrl current_wma_song_url_;
-  Song queued_statistics_;
-  Song queued_rating_;
-
   // DB schema versions which should trigger a full library rescan (each of
   // those with a short reason why).
   QHash<int, QString> full_rescan_revisions_;
@@ -20,6 +20,7 @@
 #include "sqlrow.h"
 #include "core/application.h"
 #include "core/database.h"
+#include "core/preparedstatementcache.h"
 #include "core/scopedtransaction.h"
 #include "core/tagreaderclient.h"
 #include "core/utilities.h"
@@ -29,6 +30,7 @@
 #include <QDateTime>
 #include <QDir>
 #include <QFileInfo>
+#include <QHash>
 #include <QSettings>
 #include <QVariant>
 #include <QtDebug>
@@ -41,6 +43,68 @@ const char* LibraryBackend::kNewScoreSql =
     "skipcount + 1)"
     " end";
 
+namespace {
+
+// One row of the groups table that's affected by a change to the songs table.
+struct GroupChange {
+  GroupChange()
+      : compilation(0), delta(0), first_song_id(-1), added(false) {}
+
+  QString column;
+  QVariant key;
+  int compilation;
+  int delta;
+  int first_song_id;  // Only valid if added is set.
+  bool added;
+};
+
+QString GroupHashKey(const QString& column, const QVariant& key,
+                     int compilation) {
+  return column + '\0' + key.toString() + '\0' + QString::number(compilation);
+}
+
+// Returns the value this song has in the given column of the songs table,
+// normalised the same way as Song::BindToQuery and the schema migration that
+// created the groups table.
+QVariant GroupKey(const Song& song, const QString& column) {
+  const int intval_disc = song.disc() <= 0 ? -1 : song.disc();
+  const int intval_year = song.year() <= 0 ? -1 : song.year();
+  const int intval_originalyear =
+      song.effective_originalyear() <= 0 ? -1 : song.effective_originalyear();
+  const int intval_bitrate = song.bitrate() <= 0 ? -1 : song.bitrate();
+
+  if (column == "artist") return song.artist().isNull() ? "" : song.artist();
+  if (column == "album") return song.album().isNull() ? "" : song.album();
+  if (column == "effective_albumartist")
+    return song.effective_albumartist().isNull() ? ""
+                                                 : song.effective_albumartist();
+  if (column == "composer")
+    return song.composer().isNull() ? "" : song.composer();
+  if (column == "performer")
+    return song.performer().isNull() ? "" : song.performer();
+  if (column == "grouping")
+    return song.grouping().isNull() ? "" : song.grouping();
+  if (column == "genre") return song.genre().isNull() ? "" : song.genre();
+  if (column == "year") return intval_year;
+  if (column == "effective_originalyear") return intval_originalyear;
+  if (column == "disc") return intval_disc;
+  if (column == "bitrate") return intval_bitrate;
+  if (column == "filetype") return int(song.filetype());
+  return QVariant();
+}
+
+// What NULLs in a group column are stored as in the group keys, so queries
+// can compare ifnull(column, this) against them.
+QString GroupKeyNullValue(const QString& column) {
+  if (column == "year" || column == "effective_originalyear" ||
+      column == "disc" || column == "bitrate" || column == "filetype") {
+    return "-1";
+  }
+  return "''";
+}
+
+}  // namespace
+
 LibraryBackend::LibraryBackend(QObject* parent)
     : LibraryBackendInterface(parent),
       save_statistics_in_file_(false),
@@ -49,12 +113,30 @@ LibraryBackend::LibraryBackend(QObject* parent)
 void LibraryBackend::Init(Database* db, const QString& songs_table,
                           const QString& dirs_table,
                           const QString& subdirs_table,
-                          const QString& fts_table) {
+                          const QString& fts_table,
+                          const QString& groups_table) {
   db_ = db;
   songs_table_ = songs_table;
   dirs_table_ = dirs_table;
   subdirs_table_ = subdirs_table;
   fts_table_ = fts_table;
+  groups_table_ = groups_table;
+}
+
+QStringList LibraryBackend::GroupColumns() {
+  // Must match the columns that are summarised in schema-53.sql.
+  return QStringList() << "artist"
+                       << "album"
+                       << "effective_albumartist"
+                       << "composer"
+                       << "performer"
+                       << "grouping"
+                       << "genre"
+                       << "year"
+                       << "effective_originalyear"
+                       << "disc"
+                       << "bitrate"
+                       << "filetype";
 }
 
 void LibraryBackend::LoadDirectoriesAsync() {
@@ -349,25 +431,25 @@ void LibraryBackend::AddOrUpdateSongs(const SongList& songs) {
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery check_dir(
-      QString("SELECT ROWID FROM %1 WHERE ROWID = :id").arg(dirs_table_), db);
-  QSqlQuery add_song(QString("INSERT INTO %1 (" + Song::kColumnSpec +
-                             ")"
-                             " VALUES (" +
-                             Song::kBindSpec + ")").arg(songs_table_),
-                     db);
-  QSqlQuery update_song(QString("UPDATE %1 SET " + Song::kUpdateSpec +
-                                " WHERE ROWID = :id").arg(songs_table_),
-                        db);
-  QSqlQuery add_song_fts(
-      QString("INSERT INTO %1 (ROWID, " + Song::kFtsColumnSpec +
-              ")"
-              " VALUES (:id, " +
-              Song::kFtsBindSpec + ")").arg(fts_table_),
-      db);
-  QSqlQuery update_song_fts(QString("UPDATE %1 SET " + Song::kFtsUpdateSpec +
-                                    " WHERE ROWID = :id").arg(fts_table_),
-                            db);
+  PreparedStatementCache* cache = db_->StatementCache(db);
+  CachedQuery check_dir(
+      cache,
+      QString("SELECT ROWID FROM %1 WHERE ROWID = :id").arg(dirs_table_));
+  CachedQuery add_song(cache, QString("INSERT INTO %1 (" + Song::kColumnSpec +
+                                      ")"
+                                      " VALUES (" +
+                                      Song::kBindSpec + ")").arg(songs_table_));
+  CachedQuery update_song(cache,
+                          QString("UPDATE %1 SET " + Song::kUpdateSpec +
+                                  " WHERE ROWID = :id").arg(songs_table_));
+  CachedQuery add_song_fts(
+      cache, QString("INSERT INTO %1 (ROWID, " + Song::kFtsColumnSpec +
+                     ")"
+                     " VALUES (:id, " +
+                     Song::kFtsBindSpec + ")").arg(fts_table_));
+  CachedQuery update_song_fts(
+      cache, QString("UPDATE %1 SET " + Song::kFtsUpdateSpec +
+                     " WHERE ROWID = :id").arg(fts_table_));
 
   ScopedTransaction transaction(&db);
 
@@ -427,6 +509,8 @@ void LibraryBackend::AddOrUpdateSongs(const SongList& songs) {
     }
   }
 
+  UpdateGroups(db, deleted_songs, added_songs);
+
   transaction.Commit();
 
   if (!deleted_songs.isEmpty()) emit SongsDeleted(deleted_songs);
@@ -440,9 +524,10 @@ void LibraryBackend::UpdateMTimesOnly(const SongList& songs) {
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery q(QString("UPDATE %1 SET mtime = :mtime WHERE ROWID = :id")
-                  .arg(songs_table_),
-              db);
+  CachedQuery q(
+      db_->StatementCache(db),
+      QString("UPDATE %1 SET mtime = :mtime WHERE ROWID = :id")
+          .arg(songs_table_));
 
   ScopedTransaction transaction(&db);
   for (const Song& song : songs) {
@@ -473,6 +558,57 @@ void LibraryBackend::DeleteSongs(const SongList& songs) {
     remove_fts.exec();
     db_->CheckErrors(remove_fts);
   }
+
+  UpdateGroups(db, songs, SongList());
+
+  transaction.Commit();
+
+  emit SongsDeleted(songs);
+
+  UpdateTotalSongCountAsync();
+}
+
+void LibraryBackend::DeleteSongsNotIn(const QString& table,
+                                      const QString& url_column) {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  const QString stale =
+      QString("SELECT ROWID FROM %1 WHERE filename NOT IN (SELECT %2 FROM %3)")
+          .arg(songs_table_, url_column, table);
+
+  // The songs are still needed to update the groups and the models, but
+  // usually there aren't any.
+  QSqlQuery find(QString("SELECT ROWID, " + Song::kColumnSpec +
+                         " FROM %1 WHERE ROWID IN (%2)")
+                     .arg(songs_table_, stale),
+                 db);
+  find.exec();
+  if (db_->CheckErrors(find)) return;
+
+  SongList songs;
+  while (find.next()) {
+    Song song;
+    song.InitFromQuery(find, true);
+    songs << song;
+  }
+  if (songs.isEmpty()) return;
+
+  ScopedTransaction transaction(&db);
+
+  QSqlQuery remove_fts(
+      QString("DELETE FROM %1 WHERE ROWID IN (%2)").arg(fts_table_, stale), db);
+  remove_fts.exec();
+  if (db_->CheckErrors(remove_fts)) return;
+
+  QSqlQuery remove(
+      QString("DELETE FROM %1 WHERE ROWID IN (%2)").arg(songs_table_, stale),
+      db);
+  remove.exec();
+  if (db_->CheckErrors(remove)) return;
+
+  UpdateGroups(db, songs, SongList());
+
   transaction.Commit();
 
   emit SongsDeleted(songs);
@@ -490,12 +626,28 @@ void LibraryBackend::MarkSongsUnavailable(const SongList& songs,
                        .arg(int(unavailable)),
                    db);
 
+  // Only the songs that actually change state move in or out of the groups.
+  SongList changed_songs;
+
   ScopedTransaction transaction(&db);
   for (const Song& song : songs) {
     remove.bindValue(":id", song.id());
     remove.exec();
     db_->CheckErrors(remove);
+
+    if (song.is_unavailable() != unavailable) {
+      Song copy(song);
+      copy.set_unavailable(false);
+      changed_songs << copy;
+    }
+  }
+
+  if (unavailable) {
+    UpdateGroups(db, changed_songs, SongList());
+  } else {
+    UpdateGroups(db, SongList(), changed_songs);
   }
+
   transaction.Commit();
 
   emit SongsDeleted(songs);
@@ -635,9 +787,19 @@ SongList LibraryBackend::GetSongsByForeignId(const QStringList& ids,
 }
 
 Song LibraryBackend::GetSongById(int id, QSqlDatabase& db) {
-  SongList list = GetSongsById(QStringList() << QString::number(id), db);
-  if (list.isEmpty()) return Song();
-  return list.first();
+  CachedQuery q(db_->StatementCache(db),
+                QString("SELECT ROWID, " + Song::kColumnSpec +
+                        " FROM %1"
+                        " WHERE ROWID = :id").arg(songs_table_));
+  q.bindValue(":id", id);
+  q.exec();
+  if (db_->CheckErrors(q)) return Song();
+
+  Song ret;
+  if (q.next()) {
+    ret.InitFromQuery(q, true);
+  }
+  return ret;
 }
 
 SongList LibraryBackend::GetSongsById(const QStringList& ids,
@@ -661,35 +823,77 @@ SongList LibraryBackend::GetSongsById(const QStringList& ids,
 }
 
 Song LibraryBackend::GetSongByUrl(const QUrl& url, qint64 beginning) {
-  LibraryQuery query;
-  query.SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
-  query.AddWhere("filename", url.toEncoded());
-  query.AddWhere("beginning", beginning);
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  CachedQuery q(db_->StatementCache(db),
+                QString("SELECT ROWID, " + Song::kColumnSpec +
+                        " FROM %1"
+                        " WHERE filename = :filename"
+                        "   AND beginning = :beginning"
+                        "   AND unavailable = 0").arg(songs_table_));
+  q.bindValue(":filename", url.toEncoded());
+  q.bindValue(":beginning", beginning);
+  q.exec();
+  if (db_->CheckErrors(q)) return Song();
 
   Song song;
-  if (ExecQuery(&query) && query.Next()) {
-    song.InitFromQuery(query, true);
+  if (q.next()) {
+    song.InitFromQuery(q, true);
   }
   return song;
 }
 
 SongList LibraryBackend::GetSongsByUrl(const QUrl& url) {
-  LibraryQuery query;
-  query.SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
-  query.AddWhere("filename", url.toEncoded());
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  CachedQuery q(db_->StatementCache(db),
+                QString("SELECT ROWID, " + Song::kColumnSpec +
+                        " FROM %1"
+                        " WHERE filename = :filename"
+                        "   AND unavailable = 0").arg(songs_table_));
+  q.bindValue(":filename", url.toEncoded());
+  q.exec();
+  if (db_->CheckErrors(q)) return SongList();
 
   SongList songlist;
-  if (ExecQuery(&query)) {
-    while (query.Next()) {
-      Song song;
-      song.InitFromQuery(query, true);
+  while (q.next()) {
+    Song song;
+    song.InitFromQuery(q, true);
 
-      songlist << song;
-    }
+    songlist << song;
   }
   return songlist;
 }
 
+SongList LibraryBackend::GetSongsByUrls(const QList<QUrl>& urls) {
+  SongList ret;
+  if (urls.isEmpty()) return ret;
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  CachedQuery q(db_->StatementCache(db),
+                QString("SELECT ROWID, " + Song::kColumnSpec +
+                        " FROM %1 WHERE filename = :filename")
+                    .arg(songs_table_));
+
+  for (const QUrl& url : urls) {
+    q.bindValue(":filename", url.toEncoded());
+    q.exec();
+    if (db_->CheckErrors(q)) return ret;
+
+    while (q.next()) {
+      Song song;
+      song.InitFromQuery(q, true);
+      ret << song;
+    }
+  }
+
+  return ret;
+}
+
 LibraryBackend::AlbumList LibraryBackend::GetCompilationAlbums(
     const QueryOptions& opt) {
   return GetAlbums(QString(), true, opt);
@@ -732,27 +936,66 @@ void LibraryBackend::UpdateCompilations() {
 
   QMap<QString, CompilationInfo> compilation_info;
   while (q.next()) {
-    QString artist = q.value(0).toString();
-    QString album = q.value(1).toString();
-    QString filename = q.value(2).toString();
-    bool sampler = q.value(3).toBool();
+    AddToCompilationInfo(q, &compilation_info);
+  }
 
-    // Ignore songs that don't have an album field set
+  UpdateCompilations(db, compilation_info);
+}
+
+void LibraryBackend::UpdateCompilationsForAlbums(const QStringList& albums) {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  // Only look at the songs in the albums that were touched by a scan - the
+  // compilation state of every other album can't have changed.
+  QSqlQuery q(
+      QString(
+          "SELECT effective_albumartist, album, filename, sampler "
+          "FROM %1 WHERE unavailable = 0 AND album = :album").arg(songs_table_),
+      db);
+
+  QMap<QString, CompilationInfo> compilation_info;
+  for (const QString& album : albums.toSet()) {
+    // Songs without an album are never compilations
     if (album.isEmpty()) continue;
 
-    // Find the directory the song is in
-    int last_separator = filename.lastIndexOf('/');
-    if (last_separator == -1) continue;
-
-    CompilationInfo& info = compilation_info[album];
-    info.artists.insert(artist);
-    info.directories.insert(filename.left(last_separator));
-    if (sampler)
-      info.has_samplers = true;
-    else
-      info.has_not_samplers = true;
+    q.bindValue(":album", album);
+    q.exec();
+    if (db_->CheckErrors(q)) return;
+
+    while (q.next()) {
+      AddToCompilationInfo(q, &compilation_info);
+    }
   }
 
+  UpdateCompilations(db, compilation_info);
+}
+
+void LibraryBackend::AddToCompilationInfo(
+    const QSqlQuery& q, QMap<QString, CompilationInfo>* compilation_info) {
+  QString artist = q.value(0).toString();
+  QString album = q.value(1).toString();
+  QString filename = q.value(2).toString();
+  bool sampler = q.value(3).toBool();
+
+  // Ignore songs that don't have an album field set
+  if (album.isEmpty()) return;
+
+  // Find the directory the song is in
+  int last_separator = filename.lastIndexOf('/');
+  if (last_separator == -1) return;
+
+  CompilationInfo& info = (*compilation_info)[album];
+  info.artists.insert(artist);
+  info.directories.insert(filename.left(last_separator));
+  if (sampler)
+    info.has_samplers = true;
+  else
+    info.has_not_samplers = true;
+}
+
+void LibraryBackend::UpdateCompilations(
+    QSqlDatabase& db, const QMap<QString, CompilationInfo>& compilation_info) {
   // Now mark the songs that we think are in compilations
   QSqlQuery update(
       QString(
@@ -796,6 +1039,8 @@ void LibraryBackend::UpdateCompilations() {
     }
   }
 
+  UpdateGroups(db, deleted_songs, added_songs);
+
   transaction.Commit();
 
   if (!deleted_songs.isEmpty()) {
@@ -818,7 +1063,7 @@ void LibraryBackend::UpdateCompilations(QSqlQuery& find_songs,
     Song song;
     song.InitFromQuery(find_songs, true);
     deleted_songs << song;
-    song.set_sampler(true);
+    song.set_sampler(sampler);
     added_songs << song;
   }
 
@@ -925,6 +1170,9 @@ void LibraryBackend::UpdateManualAlbumArt(const QString& artist,
     deleted_songs << song;
   }
 
+  // The groups table is updated in the same transaction as the songs.
+  ScopedTransaction transaction(&db);
+
   // Update the songs
   QString sql(
       QString(
@@ -950,6 +1198,9 @@ void LibraryBackend::UpdateManualAlbumArt(const QString& artist,
     added_songs << song;
   }
 
+  UpdateGroups(db, deleted_songs, added_songs);
+  transaction.Commit();
+
   if (!added_songs.isEmpty() || !deleted_songs.isEmpty()) {
     emit SongsDeleted(deleted_songs);
     emit SongsDiscovered(added_songs);
@@ -962,6 +1213,9 @@ void LibraryBackend::ForceCompilation(const QString& album,
   QSqlDatabase db(db_->Connect());
   SongList deleted_songs, added_songs;
 
+  // The groups table is updated in the same transaction as the songs.
+  ScopedTransaction transaction(&db);
+
   for (const QString& artist : artists) {
     // Get the songs before they're updated
     LibraryQuery query;
@@ -1006,6 +1260,10 @@ void LibraryBackend::ForceCompilation(const QString& album,
     }
   }
 
+  // Songs move between the compilation and non-compilation groups.
+  UpdateGroups(db, deleted_songs, added_songs);
+  transaction.Commit();
+
   if (!added_songs.isEmpty() || !deleted_songs.isEmpty()) {
     emit SongsDeleted(deleted_songs);
     emit SongsDiscovered(added_songs);
@@ -1052,13 +1310,13 @@ void LibraryBackend::IncrementPlayCount(int id) {
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery q(QString(
-                  "UPDATE %1 SET playcount = playcount + 1,"
-                  "              lastplayed = :now,"
-                  "              score = " +
-                  QString(kNewScoreSql).arg("1.0") +
-                  " WHERE ROWID = :id").arg(songs_table_),
-              db);
+  CachedQuery q(db_->StatementCache(db),
+                QString(
+                    "UPDATE %1 SET playcount = playcount + 1,"
+                    "              lastplayed = :now,"
+                    "              score = " +
+                    QString(kNewScoreSql).arg("1.0") +
+                    " WHERE ROWID = :id").arg(songs_table_));
   q.bindValue(":now", QDateTime::currentDateTime().toTime_t());
   q.bindValue(":id", id);
   q.exec();
@@ -1095,11 +1353,11 @@ void LibraryBackend::ResetStatistics(int id) {
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  QSqlQuery q(QString(
-                  "UPDATE %1 SET playcount = 0, skipcount = 0,"
-                  "              lastplayed = -1, score = 0"
-                  " WHERE ROWID = :id").arg(songs_table_),
-              db);
+  CachedQuery q(db_->StatementCache(db),
+                QString(
+                    "UPDATE %1 SET playcount = 0, skipcount = 0,"
+                    "              lastplayed = -1, score = 0"
+                    " WHERE ROWID = :id").arg(songs_table_));
   q.bindValue(":id", id);
   q.exec();
   if (db_->CheckErrors(q)) return;
@@ -1153,8 +1411,211 @@ void LibraryBackend::DeleteAll() {
     q.exec();
     if (db_->CheckErrors(q)) return;
 
+    if (!groups_table_.isEmpty()) {
+      q = QSqlQuery("DELETE FROM " + groups_table_, db);
+      q.exec();
+      if (db_->CheckErrors(q)) return;
+    }
+
     t.Commit();
   }
 
   emit DatabaseReset();
 }
+
+bool LibraryBackend::GetGroups(const QString& column, bool include_compilations,
+                               SqlRowList* rows) {
+  if (groups_table_.isEmpty() || !GroupColumns().contains(column)) return false;
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  // A group that has both compilation and non-compilation songs has a row for
+  // each, so GROUP BY the key to return it once.
+  QString sql = QString(
+                    "SELECT g.group_key, s.filename, s.art_automatic,"
+                    "       s.art_manual"
+                    " FROM %1 AS g"
+                    " LEFT JOIN %2 AS s ON s.ROWID = g.first_song_id"
+                    " WHERE g.group_by = :group_by").arg(groups_table_,
+                                                         songs_table_);
+  if (!include_compilations) sql += " AND g.compilation = 0";
+  sql += " GROUP BY g.group_key";
+
+  CachedQuery q(db_->StatementCache(db), sql);
+  q.bindValue(":group_by", column);
+  q.exec();
+  if (db_->CheckErrors(q)) return false;
+
+  while (q.next()) {
+    *rows << SqlRow(q);
+  }
+  return true;
+}
+
+bool LibraryBackend::HasCompilationGroups(const QString& column) {
+  if (groups_table_.isEmpty()) return false;
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  CachedQuery q(db_->StatementCache(db),
+                QString(
+                    "SELECT 1 FROM %1"
+                    " WHERE group_by = :group_by AND compilation = 1"
+                    " LIMIT 1").arg(groups_table_));
+  q.bindValue(":group_by", column);
+  q.exec();
+  if (db_->CheckErrors(q)) return false;
+
+  return q.next();
+}
+
+void LibraryBackend::UpdateGroups(QSqlDatabase& db, const SongList& removed,
+                                  const SongList& added) {
+  if (groups_table_.isEmpty()) return;
+
+  const QStringList columns = GroupColumns();
+
+  // Work out how many songs each group gained or lost first, so a song that
+  // was updated without changing its group doesn't touch the table at all.
+  QHash<QString, GroupChange> changes;
+  QSet<QString> added_memberships;
+  QSet<int> removed_ids;
+
+  for (const Song& song : removed) {
+    if (song.is_unavailable()) continue;
+    removed_ids << song.id();
+
+    const int compilation = song.is_compilation() ? 1 : 0;
+    for (const QString& column : columns) {
+      const QVariant key = GroupKey(song, column);
+      GroupChange& change = changes[GroupHashKey(column, key, compilation)];
+      change.column = column;
+      change.key = key;
+      change.compilation = compilation;
+      change.delta--;
+    }
+  }
+
+  for (const Song& song : added) {
+    if (song.is_unavailable()) continue;
+
+    const int compilation = song.is_compilation() ? 1 : 0;
+    for (const QString& column : columns) {
+      const QVariant key = GroupKey(song, column);
+      const QString hash_key = GroupHashKey(column, key, compilation);
+      GroupChange& change = changes[hash_key];
+      change.column = column;
+      change.key = key;
+      change.compilation = compilation;
+      change.delta++;
+      if (!change.added) {
+        change.added = true;
+        change.first_song_id = song.id();
+      }
+      added_memberships << QString::number(song.id()) + '\0' + hash_key;
+    }
+  }
+
+  PreparedStatementCache* cache = db_->StatementCache(db);
+  CachedQuery insert_group(
+      cache, QString(
+                 "INSERT OR IGNORE INTO %1"
+                 " (group_by, group_key, compilation, song_count,"
+                 "  first_song_id)"
+                 " VALUES (:group_by, :group_key, :compilation, 0,"
+                 "         :first_song_id)").arg(groups_table_));
+  CachedQuery update_group(
+      cache, QString(
+                 "UPDATE %1 SET song_count = song_count + :delta"
+                 " WHERE group_by = :group_by AND group_key = :group_key"
+                 "   AND compilation = :compilation").arg(groups_table_));
+
+  for (const GroupChange& change : changes) {
+    if (change.added) {
+      insert_group.bindValue(":group_by", change.column);
+      insert_group.bindValue(":group_key", change.key);
+      insert_group.bindValue(":compilation", change.compilation);
+      insert_group.bindValue(":first_song_id", change.first_song_id);
+      insert_group.exec();
+      if (db_->CheckErrors(insert_group)) return;
+    }
+
+    if (change.delta == 0) continue;
+
+    update_group.bindValue(":delta", change.delta);
+    update_group.bindValue(":group_by", change.column);
+    update_group.bindValue(":group_key", change.key);
+    update_group.bindValue(":compilation", change.compilation);
+    update_group.exec();
+    if (db_->CheckErrors(update_group)) return;
+  }
+
+  QSqlQuery q(
+      QString("DELETE FROM %1 WHERE song_count <= 0").arg(groups_table_), db);
+  q.exec();
+  if (db_->CheckErrors(q)) return;
+
+  // Groups whose first song went away need another one, so the model can still
+  // find their album art.
+  CachedQuery find_groups(
+      cache, QString(
+                 "SELECT group_by, group_key, compilation FROM %1"
+                 " WHERE first_song_id = :id").arg(groups_table_));
+  CachedQuery set_first_song(
+      cache, QString(
+                 "UPDATE %1 SET first_song_id = :first_song_id"
+                 " WHERE group_by = :group_by AND group_key = :group_key"
+                 "   AND compilation = :compilation").arg(groups_table_));
+
+  for (int id : removed_ids) {
+    find_groups.bindValue(":id", id);
+    find_groups.exec();
+    if (db_->CheckErrors(find_groups)) return;
+
+    QList<GroupChange> orphaned;
+    while (find_groups.next()) {
+      GroupChange group;
+      group.column = find_groups.value(0).toString();
+      group.key = find_groups.value(1);
+      group.compilation = find_groups.value(2).toInt();
+
+      // The song might have been updated without leaving this group.
+      if (added_memberships.contains(
+              QString::number(id) + '\0' +
+              GroupHashKey(group.column, group.key, group.compilation))) {
+        continue;
+      }
+      orphaned << group;
+    }
+
+    for (const GroupChange& group : orphaned) {
+      if (!columns.contains(group.column)) continue;
+
+      // The keys of songs with NULL in the column are stored as the same
+      // default the group table was built with.
+      QSqlQuery find_song(
+          QString(
+              "SELECT ROWID FROM %1"
+              " WHERE ifnull(%2, %3) = :group_key"
+              "   AND ifnull(effective_compilation, 0) = :compilation"
+              "   AND unavailable = 0"
+              " LIMIT 1").arg(songs_table_, group.column,
+                              GroupKeyNullValue(group.column)),
+          db);
+      find_song.bindValue(":group_key", group.key);
+      find_song.bindValue(":compilation", group.compilation);
+      find_song.exec();
+      if (db_->CheckErrors(find_song)) return;
+
+      set_first_song.bindValue(
+          ":first_song_id", find_song.next() ? find_song.value(0) : QVariant());
+      set_first_song.bindValue(":group_by", group.column);
+      set_first_song.bindValue(":group_key", group.key);
+      set_first_song.bindValue(":compilation", group.compilation);
+      set_first_song.exec();
+      if (db_->CheckErrors(set_first_song)) return;
+    }
+  }
+}
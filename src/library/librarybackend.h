@@ -19,11 +19,13 @@
 #define LIBRARYBACKEND_H
 
 #include <QObject>
+#include <QMap>
 #include <QSet>
 #include <QUrl>
 
 #include "directory.h"
 #include "libraryquery.h"
+#include "sqlrow.h"
 #include "core/song.h"
 
 class Database;
@@ -122,14 +124,21 @@ class LibraryBackend : public LibraryBackendInterface {
   static const char* kSettingsGroup;
 
   Q_INVOKABLE LibraryBackend(QObject* parent = nullptr);
+  // groups_table is optional.  If it's given it's kept up to date with the
+  // number of songs for each value of the columns in GroupColumns().
   void Init(Database* db, const QString& songs_table, const QString& dirs_table,
-            const QString& subdirs_table, const QString& fts_table);
+            const QString& subdirs_table, const QString& fts_table,
+            const QString& groups_table = QString());
 
   Database* db() const { return db_; }
 
   QString songs_table() const { return songs_table_; }
   QString dirs_table() const { return dirs_table_; }
   QString subdirs_table() const { return subdirs_table_; }
+  QString groups_table() const { return groups_table_; }
+
+  // The columns that are summarised in the groups table.
+  static QStringList GroupColumns();
 
   // Get a list of directories in the library.  Emits DirectoriesDiscovered.
   void LoadDirectoriesAsync();
@@ -170,6 +179,8 @@ class LibraryBackend : public LibraryBackendInterface {
                                const QString& column);
 
   SongList GetSongsByUrl(const QUrl& url);
+  // Like GetSongsByUrl, but looks up many URLs with a single statement.
+  SongList GetSongsByUrls(const QList<QUrl>& urls);
   Song GetSongByUrl(const QUrl& url, qint64 beginning = 0);
 
   void AddDirectory(const QString& path);
@@ -188,15 +199,32 @@ class LibraryBackend : public LibraryBackendInterface {
 
   void DeleteAll();
 
+  // Reads every group of a column from the groups table - the same values as
+  // SELECT DISTINCT on the songs table, without having to scan it.  Each row
+  // has the group's key, then the filename, art_automatic and art_manual of
+  // one of the songs in it.  Groups of compilation songs are left out unless
+  // include_compilations is set.  Returns false if there's no groups table or
+  // the column isn't in it.
+  bool GetGroups(const QString& column, bool include_compilations,
+                 SqlRowList* rows);
+  // Whether any of the songs in the groups of this column are compilations.
+  bool HasCompilationGroups(const QString& column);
+
  public slots:
   void LoadDirectories();
   void UpdateTotalSongCount();
   void AddOrUpdateSongs(const SongList& songs);
   void UpdateMTimesOnly(const SongList& songs);
   void DeleteSongs(const SongList& songs);
+  // Deletes the songs whose URLs aren't in url_column of another table in the
+  // same database.  Only the songs that are deleted are read.
+  void DeleteSongsNotIn(const QString& table, const QString& url_column);
   void MarkSongsUnavailable(const SongList& songs, bool unavailable = true);
   void AddOrUpdateSubdirs(const SubdirectoryList& subdirs);
   void UpdateCompilations();
+  // Like UpdateCompilations(), but only recomputes the compilation state of
+  // the given albums.
+  void UpdateCompilationsForAlbums(const QStringList& albums);
   void UpdateManualAlbumArt(const QString& artist, const QString& album,
                             const QString& art);
   void ForceCompilation(const QString& album, const QList<QString>& artists,
@@ -233,6 +261,10 @@ signals:
 
   static const char* kNewScoreSql;
 
+  void AddToCompilationInfo(const QSqlQuery& q,
+                            QMap<QString, CompilationInfo>* compilation_info);
+  void UpdateCompilations(QSqlDatabase& db,
+                          const QMap<QString, CompilationInfo>& compilation_info);
   void UpdateCompilations(QSqlQuery& find_songs, QSqlQuery& update,
                           SongList& deleted_songs, SongList& added_songs,
                           const QString& album, int sampler);
@@ -243,12 +275,19 @@ signals:
   Song GetSongById(int id, QSqlDatabase& db);
   SongList GetSongsById(const QStringList& ids, QSqlDatabase& db);
 
+  // Updates the groups table after the songs in removed were replaced by the
+  // songs in added.  Either list can be empty.  Must be called inside the same
+  // transaction as the change to the songs table.
+  void UpdateGroups(QSqlDatabase& db, const SongList& removed,
+                    const SongList& added);
+
  private:
   Database* db_;
   QString songs_table_;
   QString dirs_table_;
   QString subdirs_table_;
   QString fts_table_;
+  QString groups_table_;
   bool save_statistics_in_file_;
   bool save_ratings_in_file_;
 };
@@ -34,11 +34,13 @@
 #include "librarybackend.h"
 #include "libraryitem.h"
 #include "librarydirectorymodel.h"
+#include "libraryquerymimedata.h"
 #include "libraryview.h"
 #include "sqlrow.h"
 #include "core/application.h"
 #include "core/database.h"
 #include "core/logging.h"
+#include "core/stringpool.h"
 #include "core/taskmanager.h"
 #include "core/utilities.h"
 #include "covers/albumcoverloader.h"
@@ -101,9 +103,13 @@ LibraryModel::LibraryModel(LibraryBackend* backend, Application* app,
   cover_loader_options_.desired_height_ = kPrettyCoverSize;
   cover_loader_options_.pad_output_image_ = true;
   cover_loader_options_.scale_output_image_ = true;
+  cover_loader_options_.decode_at_scaled_size_ = true;
 
-  connect(app_->album_cover_loader(), SIGNAL(ImageLoaded(quint64, QImage)),
-          SLOT(AlbumArtLoaded(quint64, QImage)));
+  // Tests and benchmarks don't have an Application.
+  if (app_) {
+    connect(app_->album_cover_loader(), SIGNAL(ImageLoaded(quint64, QImage)),
+            SLOT(AlbumArtLoaded(quint64, QImage)));
+  }
 
   icon_cache_->setCacheDirectory(
       Utilities::GetConfigPath(Utilities::Path_CacheRoot) + "/pixmapcache");
@@ -496,8 +502,13 @@ QVariant LibraryModel::AlbumIcon(const QModelIndex& index) {
   }
 
   // No art is cached and we're not loading it already.  Load art for the first
-  // Song in the album.
-  SongList songs = GetChildSongs(index);
+  // Song in the album, or the one the groups table gave us.
+  SongList songs;
+  if (item->type == LibraryItem::Type_Container &&
+      item->metadata.url().isValid())
+    songs << item->metadata;
+  else
+    songs = GetChildSongs(index);
   if (!songs.isEmpty()) {
     const quint64 id = app_->album_cover_loader()->LoadImageAsync(
         cover_loader_options_, songs.first());
@@ -658,6 +669,62 @@ bool LibraryModel::HasCompilations(const LibraryQuery& query) {
   return q.Next();
 }
 
+QString LibraryModel::GroupsTableColumn(GroupBy type) {
+  switch (type) {
+    case GroupBy_Artist:
+      return "artist";
+    case GroupBy_Album:
+      return "album";
+    case GroupBy_AlbumArtist:
+      return "effective_albumartist";
+    case GroupBy_Composer:
+      return "composer";
+    case GroupBy_Performer:
+      return "performer";
+    case GroupBy_Grouping:
+      return "grouping";
+    case GroupBy_Genre:
+      return "genre";
+    case GroupBy_Year:
+      return "year";
+    case GroupBy_OriginalYear:
+      return "effective_originalyear";
+    case GroupBy_Disc:
+      return "disc";
+    case GroupBy_Bitrate:
+      return "bitrate";
+    case GroupBy_FileType:
+      return "filetype";
+    default:
+      return QString();
+  }
+}
+
+bool LibraryModel::RunGroupsQuery(GroupBy type, QueryResult* result) {
+  // The groups table only counts every available song, so anything that
+  // narrows down the songs has to go through the songs table.
+  if (backend_->groups_table().isEmpty() ||
+      !query_options_.filter().isEmpty() || query_options_.max_age() != -1 ||
+      query_options_.query_mode() != QueryOptions::QueryMode_All) {
+    return false;
+  }
+
+  const QString column = GroupsTableColumn(type);
+  if (column.isEmpty()) return false;
+
+  // Artists GroupBy is special - see RunQuery
+  const bool is_artist = IsArtistGroupBy(type);
+
+  SqlRowList rows;
+  if (!backend_->GetGroups(column, !is_artist, &rows)) return false;
+
+  result->rows = rows;
+  result->create_va = is_artist && show_various_artists_ &&
+                      backend_->HasCompilationGroups(column);
+  result->from_groups_table = true;
+  return true;
+}
+
 LibraryModel::QueryResult LibraryModel::RunQuery(LibraryItem* parent) {
   QueryResult result;
 
@@ -665,6 +732,11 @@ LibraryModel::QueryResult LibraryModel::RunQuery(LibraryItem* parent) {
   int child_level = parent == root_ ? 0 : parent->container_level + 1;
   GroupBy child_type = child_level >= 3 ? GroupBy_None : group_by_[child_level];
 
+  // The top level can usually be read straight from the groups table.
+  if (parent == root_ && RunGroupsQuery(child_type, &result)) {
+    return result;
+  }
+
   // Initialise the query.  child_type says what type of thing we want (artists,
   // songs, etc.)
   LibraryQuery q(query_options_);
@@ -715,6 +787,15 @@ void LibraryModel::PostQuery(LibraryItem* parent,
     LibraryItem* item = ItemFromQuery(child_type, signal, child_level == 0,
                                       parent, row, child_level);
 
+    // Remember one of the group's songs so AlbumIcon doesn't have to populate
+    // the whole group to find some art.
+    if (result.from_groups_table && !row.value(1).isNull()) {
+      item->metadata.set_url(
+          QUrl::fromEncoded(row.value(1).toString().toUtf8()));
+      item->metadata.set_art_automatic(row.value(2).toString());
+      item->metadata.set_art_manual(row.value(3).toString());
+    }
+
     // Save a pointer to it for later
     if (child_type == GroupBy_None)
       song_nodes_[item->metadata.id()] = item;
@@ -756,6 +837,10 @@ void LibraryModel::ResetAsyncQueryFinished() {
   }
 
   endResetModel();
+
+  // The strings used by the old tree have just been freed.  Tidy up the pool
+  // and log how much it's saving.
+  QtConcurrent::run(StringPool::Global(), &StringPool::Purge);
 }
 
 void LibraryModel::BeginReset() {
@@ -839,7 +924,7 @@ void LibraryModel::InitQuery(GroupBy type, LibraryQuery* q) {
 }
 
 void LibraryModel::FilterQuery(GroupBy type, LibraryItem* item,
-                               LibraryQuery* q) {
+                               LibraryQuery* q) const {
   // Say how we want the query to be filtered.  This is done once for each
   // parent going up the tree.
 
@@ -1219,6 +1304,12 @@ QMimeData* LibraryModel::mimeData(const QModelIndexList& indexes) const {
     return data;
   }
 
+  // Populating unexpanded containers here would run a query for each one on
+  // the GUI thread.
+  for (const QModelIndex& index : indexes) {
+    if (!IsPopulated(IndexToItem(index))) return QueryMimeData(indexes);
+  }
+
   SongMimeData* data = new SongMimeData;
   QList<QUrl> urls;
   QSet<int> song_ids;
@@ -1236,6 +1327,164 @@ QMimeData* LibraryModel::mimeData(const QModelIndexList& indexes) const {
   return data;
 }
 
+bool LibraryModel::IsPopulated(const LibraryItem* item) const {
+  if (item->type != LibraryItem::Type_Container) return true;
+  if (!item->lazy_loaded) return false;
+
+  for (const LibraryItem* child : item->children) {
+    if (!IsPopulated(child)) return false;
+  }
+  return true;
+}
+
+QMimeData* LibraryModel::QueryMimeData(const QModelIndexList& indexes) const {
+  LibraryQueryMimeData* data = new LibraryQueryMimeData(backend_);
+
+  QList<LibraryItem*> items;
+  QHash<LibraryItem*, int> selected_children;
+  for (const QModelIndex& index : indexes) {
+    LibraryItem* item = IndexToItem(index);
+    items << item;
+    if (item->type == LibraryItem::Type_Container) {
+      selected_children[item->parent]++;
+    }
+  }
+
+  // Containers whose siblings are all selected too (after a select all, say)
+  // are covered by a single query for their parent.
+  QSet<LibraryItem*> whole_parents;
+  for (LibraryItem* parent : selected_children.keys()) {
+    int containers = 0;
+    for (const LibraryItem* child : parent->children) {
+      if (child->type == LibraryItem::Type_Container) containers++;
+    }
+    if (selected_children[parent] == containers) whole_parents << parent;
+  }
+
+  QSet<LibraryItem*> queried_parents;
+  for (LibraryItem* item : items) {
+    if (item->type != LibraryItem::Type_Container) {
+      LibraryQueryMimeData::Part part;
+      part.songs = GetChildSongs(ItemToIndex(item));
+      data->parts << part;
+    } else if (whole_parents.contains(item->parent)) {
+      if (queried_parents.contains(item->parent)) continue;
+      queried_parents << item->parent;
+      AddQueryPart(item->parent, data);
+    } else if (IsPopulated(item)) {
+      LibraryQueryMimeData::Part part;
+      part.songs = GetChildSongs(ItemToIndex(item));
+      data->parts << part;
+    } else {
+      AddQueryPart(item, data);
+    }
+  }
+
+  if (indexes.count() == 1) {
+    data->name_for_new_playlist_ = this->data(indexes.first()).toString();
+  }
+
+  return data;
+}
+
+void LibraryModel::AddQueryPart(LibraryItem* parent,
+                                LibraryQueryMimeData* data) const {
+  LibraryQueryMimeData::Part part;
+  part.has_query = true;
+  part.query = LibraryQuery(query_options_);
+
+  // The same filters RunQuery would use to populate the parent and everything
+  // under it.
+  LibraryItem* p = parent;
+  while (p && p->type == LibraryItem::Type_Container) {
+    FilterQuery(group_by_[p->container_level], p, &part.query);
+    p = p->parent;
+  }
+
+  const int child_level = parent == root_ ? 0 : parent->container_level + 1;
+  for (int i = child_level; i < 3 && group_by_[i] != GroupBy_None; ++i) {
+    part.levels << group_by_[i];
+
+    // Compilations only appear under the Various artists node.
+    if (IsArtistGroupBy(group_by_[i]) && !show_various_artists_) {
+      part.query.AddCompilationRequirement(false);
+    }
+  }
+
+  data->parts << part;
+}
+
+QString LibraryModel::SortTextForGroup(GroupBy type, const Song& song) {
+  // The same sort text ItemFromQuery gives the container this song is in.
+  if (IsArtistGroupBy(type) && song.is_compilation()) {
+    return " various";
+  }
+
+  switch (type) {
+    case GroupBy_Artist:
+      return SortTextForArtist(song.artist());
+    case GroupBy_Album:
+      return SortTextForArtist(song.album());
+    case GroupBy_AlbumArtist:
+      return SortTextForArtist(song.effective_albumartist());
+    case GroupBy_Composer:
+      return SortTextForArtist(song.composer());
+    case GroupBy_Performer:
+      return SortTextForArtist(song.performer());
+    case GroupBy_Grouping:
+      return SortTextForArtist(song.grouping());
+    case GroupBy_Genre:
+      return SortTextForArtist(song.genre());
+    case GroupBy_YearAlbum:
+      return SortTextForNumber(qMax(0, song.year())) + song.grouping() +
+             song.album();
+    case GroupBy_OriginalYearAlbum:
+      return SortTextForNumber(qMax(0, song.effective_originalyear())) +
+             song.grouping() + song.album();
+    case GroupBy_Year:
+      return SortTextForNumber(qMax(0, song.year())) + " ";
+    case GroupBy_OriginalYear:
+      return SortTextForNumber(qMax(0, song.effective_originalyear())) + " ";
+    case GroupBy_Disc:
+      return SortTextForNumber(qMax(0, song.disc()));
+    case GroupBy_Bitrate:
+      return SortTextForNumber(qMax(0, song.bitrate())) + " ";
+    case GroupBy_FileType:
+      return song.TextForFiletype();
+    case GroupBy_None:
+      break;
+  }
+  return QString();
+}
+
+void LibraryModel::SortSongs(const QList<GroupBy>& levels, SongList* songs) {
+  typedef QPair<QStringList, Song> SortedSong;
+
+  QList<SortedSong> sorted;
+  for (const Song& song : *songs) {
+    QStringList sort_text;
+    for (GroupBy type : levels) {
+      sort_text << SortTextForGroup(type, song);
+    }
+    sort_text << SortTextForSong(song);
+    sorted << SortedSong(sort_text, song);
+  }
+
+  // Like CompareItems, one level at a time.
+  qStableSort(sorted.begin(), sorted.end(),
+              [](const SortedSong& a, const SortedSong& b) {
+    for (int i = 0; i < a.first.count(); ++i) {
+      if (a.first[i] != b.first[i]) return a.first[i] < b.first[i];
+    }
+    return false;
+  });
+
+  songs->clear();
+  for (const SortedSong& song : sorted) {
+    *songs << song.second;
+  }
+}
+
 bool LibraryModel::CompareItems(const LibraryItem* a,
                                 const LibraryItem* b) const {
   QVariant left(data(a, LibraryModel::Role_SortText));
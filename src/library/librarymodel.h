@@ -37,6 +37,7 @@ class Application;
 class AlbumCoverLoader;
 class LibraryDirectoryModel;
 class LibraryBackend;
+class LibraryQueryMimeData;
 namespace smart_playlists {
 class Search;
 }
@@ -108,10 +109,12 @@ class LibraryModel : public SimpleTreeModel<LibraryItem> {
   };
 
   struct QueryResult {
-    QueryResult() : create_va(false) {}
+    QueryResult() : create_va(false), from_groups_table(false) {}
 
     SqlRowList rows;
     bool create_va;
+    // The rows came from LibraryBackend::GetGroups instead of a LibraryQuery.
+    bool from_groups_table;
   };
 
   LibraryBackend* backend() const { return backend_; }
@@ -169,6 +172,10 @@ class LibraryModel : public SimpleTreeModel<LibraryItem> {
   static QString SortTextForNumber(int year);
   static QString SortTextForSong(const Song& song);
 
+  // Sorts songs into the order they'd be shown in under a container whose
+  // children are grouped by levels.
+  static void SortSongs(const QList<GroupBy>& levels, SongList* songs);
+
 signals:
   void TotalSongCountUpdated(int count);
   void GroupingChanged(const LibraryModel::Grouping& g);
@@ -208,6 +215,12 @@ signals:
 
   bool HasCompilations(const LibraryQuery& query);
 
+  // Fills the top level from the backend's groups table instead of scanning
+  // the songs table.  Returns false if that isn't possible for this type or
+  // with the current query options.
+  bool RunGroupsQuery(GroupBy type, QueryResult* result);
+  static QString GroupsTableColumn(GroupBy type);
+
   void BeginReset();
 
   // Functions for working with queries and creating items.
@@ -216,7 +229,14 @@ signals:
   // for each parent item, restricting the songs returned to a particular
   // album or artist for example.
   static void InitQuery(GroupBy type, LibraryQuery* q);
-  void FilterQuery(GroupBy type, LibraryItem* item, LibraryQuery* q);
+  void FilterQuery(GroupBy type, LibraryItem* item, LibraryQuery* q) const;
+  static QString SortTextForGroup(GroupBy type, const Song& song);
+
+  // Dragging containers that haven't been loaded yet gives a
+  // LibraryQueryMimeData, so the drag doesn't have to wait for them.
+  bool IsPopulated(const LibraryItem* item) const;
+  QMimeData* QueryMimeData(const QModelIndexList& indexes) const;
+  void AddQueryPart(LibraryItem* parent, LibraryQueryMimeData* data) const;
 
   // Items can be created either from a query that's been run to populate a
   // node, or by a spontaneous SongsDiscovered emission from the backend.
@@ -16,7 +16,9 @@
 */
 
 #include "libraryquery.h"
+#include "core/database.h"
 #include "core/song.h"
+#include "core/tracing.h"
 
 #include <QtDebug>
 #include <QDateTime>
@@ -25,7 +27,10 @@
 QueryOptions::QueryOptions() : max_age_(-1), query_mode_(QueryMode_All) {}
 
 LibraryQuery::LibraryQuery(const QueryOptions& options)
-    : include_unavailable_(false), join_with_fts_(false), limit_(-1) {
+    : include_unavailable_(false),
+      join_with_fts_(false),
+      limit_(-1),
+      interrupter_(nullptr) {
   if (!options.filter().isEmpty()) {
     // We need to munge the filter text a little bit to get it to work as
     // expected with sqlite's FTS3:
@@ -94,6 +99,17 @@ LibraryQuery::LibraryQuery(const QueryOptions& options)
   }
 }
 
+void LibraryQuery::AddRandomSample(int count) {
+  // Picks random ROWIDs up to the largest one.  sqlite evaluates each random()
+  // once when building the IN list, and max(ROWID) is a single index lookup.
+  // Deleted ROWIDs are just missed, so fewer rows than count might come back.
+  QStringList rowids;
+  for (int i = 0; i < count; ++i) {
+    rowids << "abs(random()) % (SELECT max(ROWID) FROM %songs_table) + 1";
+  }
+  where_clauses_ << "%songs_table.ROWID IN (" + rowids.join(", ") + ")";
+}
+
 QString LibraryQuery::GetInnerQuery() {
   return duplicates_only_
              ? QString(
@@ -140,6 +156,7 @@ void LibraryQuery::AddCompilationRequirement(bool compilation) {
 
 QSqlQuery LibraryQuery::Exec(QSqlDatabase db, const QString& songs_table,
                              const QString& fts_table) {
+  TRACE_SPAN_CATEGORY("LibraryQuery::Exec", "database");
   QString sql;
 
   if (join_with_fts_) {
@@ -173,6 +190,10 @@ QSqlQuery LibraryQuery::Exec(QSqlDatabase db, const QString& songs_table,
     query_.addBindValue(value);
   }
 
+  if (interrupter_) {
+    interrupter_->Attach(db);
+  }
+
   query_.exec();
   return query_;
 }
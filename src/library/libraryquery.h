@@ -24,6 +24,7 @@
 #include <QStringList>
 #include <QVariantList>
 
+class DatabaseInterrupter;
 class Song;
 class LibraryBackend;
 
@@ -86,6 +87,17 @@ class LibraryQuery {
     include_unavailable_ = include_unavailable;
   }
 
+  // Restricts the query to roughly count randomly chosen rows.  Unlike
+  // ORDER BY random() this doesn't have to visit every row in the table.
+  void AddRandomSample(int count);
+
+  // The interrupter is attached to the connection the query runs on, so the
+  // query can be aborted from another thread.  The caller must Detach() it
+  // once it has finished reading the results.
+  void SetInterrupter(DatabaseInterrupter* interrupter) {
+    interrupter_ = interrupter;
+  }
+
   QSqlQuery Exec(QSqlDatabase db, const QString& songs_table,
                  const QString& fts_table);
   bool Next();
@@ -104,6 +116,7 @@ class LibraryQuery {
   QVariantList bound_values_;
   int limit_;
   bool duplicates_only_;
+  DatabaseInterrupter* interrupter_;
 
   QSqlQuery query_;
 };
@@ -0,0 +1,98 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "libraryqueryinserter.h"
+
+#include <QSet>
+#include <QtConcurrentRun>
+
+#include "librarybackend.h"
+#include "core/taskmanager.h"
+#include "playlist/playlist.h"
+
+// Small enough that each batch still gets its own undo step.
+const int LibraryQueryInserter::kBatchSize = 500;
+
+LibraryQueryInserter::LibraryQueryInserter(TaskManager* task_manager,
+                                           QObject* parent)
+    : QObject(parent),
+      task_manager_(task_manager),
+      task_id_(-1),
+      library_(nullptr),
+      destination_(nullptr),
+      row_(-1),
+      play_now_(false),
+      enqueue_(false),
+      inserted_count_(0) {}
+
+void LibraryQueryInserter::Load(Playlist* destination, int row, bool play_now,
+                                bool enqueue,
+                                const LibraryQueryMimeData* data) {
+  task_id_ = task_manager_->StartTask(tr("Loading songs"));
+
+  // The mime data is deleted as soon as the drop has finished, so take a copy
+  // of everything we need.
+  library_ = data->library();
+  parts_ = data->parts;
+
+  destination_ = destination;
+  row_ = row;
+  play_now_ = play_now;
+  enqueue_ = enqueue;
+
+  connect(destination, SIGNAL(destroyed()), SLOT(DestinationDestroyed()));
+
+  QtConcurrent::run(this, &LibraryQueryInserter::AsyncLoad);
+}
+
+void LibraryQueryInserter::AsyncLoad() {
+  QSet<int> song_ids;
+
+  for (int i = 0; i < parts_.count(); ++i) {
+    const SongList songs =
+        LibraryQueryMimeData::ResolvePart(library_, parts_[i], &song_ids);
+
+    for (int start = 0; start < songs.count(); start += kBatchSize) {
+      metaObject()->invokeMethod(this, "InsertBatch", Qt::QueuedConnection,
+                                 Q_ARG(SongList, songs.mid(start, kBatchSize)));
+    }
+
+    task_manager_->SetTaskProgress(task_id_, i + 1, parts_.count());
+  }
+
+  metaObject()->invokeMethod(this, "Finished", Qt::QueuedConnection);
+}
+
+void LibraryQueryInserter::DestinationDestroyed() { destination_ = nullptr; }
+
+void LibraryQueryInserter::InsertBatch(const SongList& songs) {
+  if (!destination_) return;
+
+  // Only the first song should start playing, and later batches go after the
+  // ones that are already in.
+  const int row = row_ == -1 ? -1 : row_ + inserted_count_;
+  destination_->InsertSongsFromBackend(songs, library_, row,
+                                       play_now_ && inserted_count_ == 0,
+                                       enqueue_);
+  inserted_count_ += songs.count();
+}
+
+void LibraryQueryInserter::Finished() {
+  task_manager_->SetTaskFinished(task_id_);
+  deleteLater();
+}
@@ -0,0 +1,66 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef LIBRARY_LIBRARYQUERYINSERTER_H_
+#define LIBRARY_LIBRARYQUERYINSERTER_H_
+
+#include <QObject>
+
+#include "libraryquerymimedata.h"
+#include "core/song.h"
+
+class LibraryBackend;
+class Playlist;
+class TaskManager;
+
+// Runs the queries in a LibraryQueryMimeData in a background thread and
+// inserts the songs into a playlist a batch at a time as they arrive.
+class LibraryQueryInserter : public QObject {
+  Q_OBJECT
+
+ public:
+  LibraryQueryInserter(TaskManager* task_manager, QObject* parent = nullptr);
+
+  static const int kBatchSize;
+
+  void Load(Playlist* destination, int row, bool play_now, bool enqueue,
+            const LibraryQueryMimeData* data);
+
+ private slots:
+  void DestinationDestroyed();
+  void InsertBatch(const SongList& songs);
+  void Finished();
+
+ private:
+  void AsyncLoad();
+
+ private:
+  TaskManager* task_manager_;
+  int task_id_;
+
+  LibraryBackend* library_;
+  QList<LibraryQueryMimeData::Part> parts_;
+
+  Playlist* destination_;
+  int row_;
+  bool play_now_;
+  bool enqueue_;
+  int inserted_count_;
+};
+
+#endif  // LIBRARY_LIBRARYQUERYINSERTER_H_
@@ -0,0 +1,80 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "libraryquerymimedata.h"
+
+#include <QUrl>
+
+#include "librarybackend.h"
+
+namespace {
+const char* kUriListMimeType = "text/uri-list";
+}  // namespace
+
+LibraryQueryMimeData::LibraryQueryMimeData(LibraryBackend* library)
+    : library_(library), resolved_(false) {
+  backend = library;
+}
+
+SongList LibraryQueryMimeData::ResolvePart(LibraryBackend* library,
+                                           const Part& part,
+                                           QSet<int>* song_ids) {
+  SongList songs = part.songs;
+  if (part.has_query) {
+    LibraryQuery query(part.query);
+    songs = library->ExecLibraryQuery(&query);
+    LibraryModel::SortSongs(part.levels, &songs);
+  }
+
+  SongList ret;
+  for (const Song& song : songs) {
+    if (song_ids->contains(song.id())) continue;
+    song_ids->insert(song.id());
+    ret << song;
+  }
+  return ret;
+}
+
+SongList LibraryQueryMimeData::Resolve() const {
+  if (!resolved_) {
+    QSet<int> song_ids;
+    for (const Part& part : parts) {
+      resolved_songs_ << ResolvePart(library_, part, &song_ids);
+    }
+    resolved_ = true;
+  }
+  return resolved_songs_;
+}
+
+QStringList LibraryQueryMimeData::formats() const {
+  QStringList ret = SongMimeData::formats();
+  if (!ret.contains(kUriListMimeType)) ret << kUriListMimeType;
+  return ret;
+}
+
+QVariant LibraryQueryMimeData::retrieveData(const QString& mimetype,
+                                            QVariant::Type type) const {
+  if (mimetype == kUriListMimeType) {
+    QVariantList urls;
+    for (const Song& song : Resolve()) {
+      urls << song.url();
+    }
+    return urls;
+  }
+  return SongMimeData::retrieveData(mimetype, type);
+}
@@ -0,0 +1,82 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef LIBRARY_LIBRARYQUERYMIMEDATA_H_
+#define LIBRARY_LIBRARYQUERYMIMEDATA_H_
+
+#include <QList>
+#include <QSet>
+
+#include "librarymodel.h"
+#include "libraryquery.h"
+#include "playlist/songmimedata.h"
+
+class LibraryBackend;
+
+// Songs dragged out of a LibraryModel before they've all been loaded into the
+// model.  Instead of populating every container on the GUI thread the model
+// describes the selection as a few LibraryQueries, and the playlist runs them
+// in the background with a LibraryQueryInserter when they're dropped.
+//
+// The songs member is always empty - use the parts instead.
+class LibraryQueryMimeData : public SongMimeData {
+  Q_OBJECT
+
+ public:
+  explicit LibraryQueryMimeData(LibraryBackend* library);
+
+  // Part of the selection: either songs the model had already loaded, or a
+  // query for every song under a container.  The songs from a query are sorted
+  // the way the model shows them under a container whose children are grouped
+  // by levels.
+  struct Part {
+    Part() : has_query(false) {}
+
+    SongList songs;
+    bool has_query;
+    LibraryQuery query;
+    QList<LibraryModel::GroupBy> levels;
+  };
+
+  LibraryBackend* library() const { return library_; }
+
+  QList<Part> parts;
+
+  // Returns the songs in a part that aren't in song_ids already, and adds
+  // their IDs to it.  This runs the part's query so call it from a background
+  // thread.
+  static SongList ResolvePart(LibraryBackend* library, const Part& part,
+                              QSet<int>* song_ids);
+
+  QStringList formats() const;
+
+ protected:
+  // Other applications only get the songs if they ask for them, and then have
+  // to wait for all the queries to run.
+  QVariant retrieveData(const QString& mimetype, QVariant::Type type) const;
+
+ private:
+  SongList Resolve() const;
+
+  LibraryBackend* library_;
+
+  mutable bool resolved_;
+  mutable SongList resolved_songs_;
+};
+
+#endif  // LIBRARY_LIBRARYQUERYMIMEDATA_H_
@@ -22,6 +22,7 @@
 #include "core/logging.h"
 #include "core/tagreaderclient.h"
 #include "core/taskmanager.h"
+#include "core/tracing.h"
 #include "core/utilities.h"
 #include "playlistparsers/cueparser.h"
 
@@ -46,6 +47,7 @@
 QStringList LibraryWatcher::sValidImages;
 
 const char* LibraryWatcher::kSettingsGroup = "LibraryWatcher";
+const int LibraryWatcher::kDefaultCoalesceIntervalMsec = 1000;
 
 LibraryWatcher::LibraryWatcher(QObject* parent)
     : QObject(parent),
@@ -99,6 +101,10 @@ LibraryWatcher::ScanTransaction::~ScanTransaction() {
   // If we're stopping then don't commit the transaction
   if (watcher_->stop_requested_) return;
 
+  TRACE_SPAN("LibraryWatcher::ScanTransaction::Commit");
+  TRACE_COUNTER("LibraryWatcher new songs", new_songs.count());
+  TRACE_COUNTER("LibraryWatcher deleted songs", deleted_songs.count());
+
   if (!new_songs.isEmpty()) emit watcher_->NewOrUpdatedSongs(new_songs);
 
   if (!touched_songs.isEmpty()) emit watcher_->SongsMTimeUpdated(touched_songs);
@@ -112,6 +118,13 @@ LibraryWatcher::ScanTransaction::~ScanTransaction() {
   if (!touched_subdirs.isEmpty())
     emit watcher_->SubdirsMTimeUpdated(touched_subdirs);
 
+  // Remember which albums changed so we only need to look at those when
+  // updating compilations.
+  watcher_->touched_albums_ += touched_albums;
+  for (const Song& song : new_songs + deleted_songs + readded_songs) {
+    watcher_->touched_albums_.insert(song.album());
+  }
+
   watcher_->task_manager_->SetTaskFinished(task_id_);
 
   if (watcher_->monitor_) {
@@ -211,13 +224,14 @@ void LibraryWatcher::AddDirectory(const Directory& dir,
     }
   }
 
-  emit CompilationsNeedUpdating();
+  EmitCompilationsNeedUpdating();
 }
 
 void LibraryWatcher::ScanSubdirectory(const QString& path,
                                       const Subdirectory& subdir,
                                       ScanTransaction* t,
                                       bool force_noincremental) {
+  TRACE_SPAN("LibraryWatcher::ScanSubdirectory");
   QFileInfo path_info(path);
 
   // Do not scan symlinked dirs that are already in collection
@@ -294,88 +308,17 @@ void LibraryWatcher::ScanSubdirectory(const QString& path,
   QSet<QString> cues_processed;
 
   // Now compare the list from the database with the list of files on disk
+  QStringList vanished_files;
   for (const QString& file : files_on_disk) {
     if (stop_requested_) return;
 
-    // associated cue
-    QString matching_cue = NoExtensionPart(file) + ".cue";
-
-    Song matching_song;
-    if (FindSongByPath(songs_in_db, file, &matching_song)) {
-      uint matching_cue_mtime = GetMtimeForCue(matching_cue);
-
-      // The song is in the database and still on disk.
-      // Check the mtime to see if it's been changed since it was added.
-      QFileInfo file_info(file);
-
-      if (!file_info.exists()) {
-        // Partially fixes race condition - if file was removed between being
-        // added to the list and now.
-        files_on_disk.removeAll(file);
-        continue;
-      }
-
-      // cue sheet's path from library (if any)
-      QString song_cue = matching_song.cue_path();
-      uint song_cue_mtime = GetMtimeForCue(song_cue);
-
-      bool cue_deleted = song_cue_mtime == 0 && matching_song.has_cue();
-      bool cue_added = matching_cue_mtime != 0 && !matching_song.has_cue();
-
-      // watch out for cue songs which have their mtime equal to
-      // qMax(media_file_mtime, cue_sheet_mtime)
-      bool changed =
-          (matching_song.mtime() !=
-           qMax(file_info.lastModified().toTime_t(), song_cue_mtime)) ||
-          cue_deleted || cue_added;
-
-      // Also want to look to see whether the album art has changed
-      QString image = ImageForSong(file, album_art);
-      if ((matching_song.art_automatic().isEmpty() && !image.isEmpty()) ||
-          (!matching_song.art_automatic().isEmpty() &&
-           !matching_song.has_embedded_cover() &&
-           !QFile::exists(matching_song.art_automatic()))) {
-        changed = true;
-      }
-
-      // the song's changed - reread the metadata from file
-      if (t->ignores_mtime() || changed) {
-        qLog(Debug) << file << "changed";
-
-        // if cue associated...
-        if (!cue_deleted && (matching_song.has_cue() || cue_added)) {
-          UpdateCueAssociatedSongs(file, path, matching_cue, image, t);
-          // if no cue or it's about to lose it...
-        } else {
-          UpdateNonCueAssociatedSong(file, matching_song, image, cue_deleted,
-                                     t);
-        }
-      }
-
-      // nothing has changed - mark the song available without re-scanning
-      if (matching_song.is_unavailable()) t->readded_songs << matching_song;
-
-    } else {
-      // The song is on disk but not in the DB
-      SongList song_list =
-          ScanNewFile(file, path, matching_cue, &cues_processed);
-
-      if (song_list.isEmpty()) {
-        continue;
-      }
-
-      qLog(Debug) << file << "created";
-      // choose an image for the song(s)
-      QString image = ImageForSong(file, album_art);
-
-      for (Song song : song_list) {
-        song.set_directory_id(t->dir());
-        if (song.art_automatic().isEmpty()) song.set_art_automatic(image);
-
-        t->new_songs << song;
-      }
+    if (!ScanFile(file, path, songs_in_db, album_art, &cues_processed, t)) {
+      vanished_files << file;
     }
   }
+  for (const QString& file : vanished_files) {
+    files_on_disk.removeAll(file);
+  }
 
   // Look for deleted songs
   for (const Song& song : songs_in_db) {
@@ -408,6 +351,141 @@ void LibraryWatcher::ScanSubdirectory(const QString& path,
   }
 }
 
+bool LibraryWatcher::ScanFile(const QString& file, const QString& path,
+                              const SongList& songs_in_db,
+                              QMap<QString, QStringList>& album_art,
+                              QSet<QString>* cues_processed,
+                              ScanTransaction* t) {
+  TRACE_SPAN("LibraryWatcher::ScanFile");
+  // associated cue
+  QString matching_cue = NoExtensionPart(file) + ".cue";
+
+  Song matching_song;
+  if (FindSongByPath(songs_in_db, file, &matching_song)) {
+    uint matching_cue_mtime = GetMtimeForCue(matching_cue);
+
+    // The song is in the database and still on disk.
+    // Check the mtime to see if it's been changed since it was added.
+    QFileInfo file_info(file);
+
+    if (!file_info.exists()) {
+      // Partially fixes race condition - if file was removed between being
+      // added to the list and now.
+      return false;
+    }
+
+    // cue sheet's path from library (if any)
+    QString song_cue = matching_song.cue_path();
+    uint song_cue_mtime = GetMtimeForCue(song_cue);
+
+    bool cue_deleted = song_cue_mtime == 0 && matching_song.has_cue();
+    bool cue_added = matching_cue_mtime != 0 && !matching_song.has_cue();
+
+    // watch out for cue songs which have their mtime equal to
+    // qMax(media_file_mtime, cue_sheet_mtime)
+    bool changed =
+        (matching_song.mtime() !=
+         qMax(file_info.lastModified().toTime_t(), song_cue_mtime)) ||
+        cue_deleted || cue_added;
+
+    // Also want to look to see whether the album art has changed
+    QString image = ImageForSong(file, album_art);
+    if ((matching_song.art_automatic().isEmpty() && !image.isEmpty()) ||
+        (!matching_song.art_automatic().isEmpty() &&
+         !matching_song.has_embedded_cover() &&
+         !QFile::exists(matching_song.art_automatic()))) {
+      changed = true;
+    }
+
+    // the song's changed - reread the metadata from file
+    if (t->ignores_mtime() || changed) {
+      qLog(Debug) << file << "changed";
+
+      // if cue associated...
+      if (!cue_deleted && (matching_song.has_cue() || cue_added)) {
+        UpdateCueAssociatedSongs(file, path, matching_cue, image, t);
+        // if no cue or it's about to lose it...
+      } else {
+        UpdateNonCueAssociatedSong(file, matching_song, image, cue_deleted,
+                                   t);
+      }
+    }
+
+    // nothing has changed - mark the song available without re-scanning
+    if (matching_song.is_unavailable()) t->readded_songs << matching_song;
+
+  } else {
+    // The song is on disk but not in the DB
+    SongList song_list =
+        ScanNewFile(file, path, matching_cue, cues_processed);
+
+    if (song_list.isEmpty()) {
+      return true;
+    }
+
+    qLog(Debug) << file << "created";
+    // choose an image for the song(s)
+    QString image = ImageForSong(file, album_art);
+
+    for (Song song : song_list) {
+      song.set_directory_id(t->dir());
+      if (song.art_automatic().isEmpty()) song.set_art_automatic(image);
+
+      t->new_songs << song;
+    }
+  }
+
+  return true;
+}
+
+void LibraryWatcher::ScanFiles(const QString& path, const QStringList& files,
+                               ScanTransaction* t) {
+  TRACE_SPAN("LibraryWatcher::ScanFiles");
+
+  // Find the album art in this directory
+  QMap<QString, QStringList> album_art;
+  for (const QString& child :
+       QDir(path).entryList(QDir::Files | QDir::Hidden)) {
+    if (sValidImages.contains(ExtensionPart(child))) {
+      album_art[path] << path + "/" + child;
+    }
+  }
+
+  // Ask the database for a list of files in this directory
+  SongList songs_in_db = t->FindSongsInSubdirectory(path);
+
+  QSet<QString> cues_processed;
+
+  for (const QString& file : files) {
+    if (stop_requested_) return;
+
+    QFileInfo file_info(file);
+    if (file_info.isHidden()) continue;
+
+    if (!file_info.isFile() ||
+        !ScanFile(file, path, songs_in_db, album_art, &cues_processed, t)) {
+      // The file was deleted or moved away
+      for (const Song& song : songs_in_db) {
+        if (!song.is_unavailable() && song.url().toLocalFile() == file) {
+          qLog(Debug) << "Song deleted from disk:" << file;
+          t->deleted_songs << song;
+        }
+      }
+    }
+  }
+
+  // The directory's mtime changes when files are added or removed
+  QFileInfo path_info(path);
+  Subdirectory updated_subdir;
+  updated_subdir.directory_id = t->dir();
+  updated_subdir.mtime =
+      path_info.exists() ? path_info.lastModified().toTime_t() : 0;
+  updated_subdir.path = path;
+  t->touched_subdirs << updated_subdir;
+
+  t->AddToProgress(1);
+}
+
 void LibraryWatcher::UpdateCueAssociatedSongs(const QString& file,
                                               const QString& path,
                                               const QString& matching_cue,
@@ -529,6 +607,12 @@ void LibraryWatcher::PreserveUserSetData(const QString& file,
 
   out->MergeUserSetData(matching_song);
 
+  // If the song moved to a different album the old one might not be a
+  // compilation any more.
+  if (matching_song.album() != out->album()) {
+    t->touched_albums.insert(matching_song.album());
+  }
+
   // The song was deleted from the database (e.g. due to an unmounted
   // filesystem), but has been restored.
   if (matching_song.is_unavailable()) {
@@ -567,12 +651,15 @@ void LibraryWatcher::AddWatch(const Directory& dir, const QString& path) {
 
   connect(fs_watcher_, SIGNAL(PathChanged(const QString&)), this,
           SLOT(DirectoryChanged(const QString&)), Qt::UniqueConnection);
+  connect(fs_watcher_, SIGNAL(FilesChanged(QStringList)), this,
+          SLOT(FilesChanged(QStringList)), Qt::UniqueConnection);
   fs_watcher_->AddPath(path);
   subdir_mapping_[path] = dir;
 }
 
 void LibraryWatcher::RemoveDirectory(const Directory& dir) {
   rescan_queue_.remove(dir.id);
+  rescan_files_queue_.remove(dir.id);
   watched_dirs_.remove(dir.id);
 
   // Stop watching the directory's subdirectories
@@ -612,13 +699,52 @@ void LibraryWatcher::DirectoryChanged(const QString& subdir) {
   if (!rescan_paused_) rescan_timer_->start();
 }
 
+void LibraryWatcher::FilesChanged(const QStringList& files) {
+  for (const QString& file : files) {
+    const QString subdir = DirectoryPart(file);
+
+    // Find what dir it was in
+    QHash<QString, Directory>::const_iterator it =
+        subdir_mapping_.constFind(subdir);
+    if (it == subdir_mapping_.constEnd()) {
+      continue;
+    }
+
+    // Images and cue sheets can change the metadata of other songs in the
+    // directory, so rescan all of it.
+    const QString extension = ExtensionPart(file);
+    if (extension == "cue" || sValidImages.contains(extension)) {
+      DirectoryChanged(subdir);
+      continue;
+    }
+
+    // Queue the file for rescanning
+    rescan_files_queue_[it->id].insert(file);
+  }
+
+  if (!rescan_paused_) rescan_timer_->start();
+}
+
 void LibraryWatcher::RescanPathsNow() {
-  for (int dir : rescan_queue_.keys()) {
+  QSet<int> dirs = rescan_queue_.keys().toSet();
+  dirs.unite(rescan_files_queue_.keys().toSet());
+
+  for (int dir : dirs) {
     if (stop_requested_) return;
+    const QStringList paths = rescan_queue_.value(dir);
+
+    // Group changed files by subdirectory, ignoring any in subdirectories
+    // that are being rescanned completely.
+    QMap<QString, QStringList> files_by_path;
+    for (const QString& file : rescan_files_queue_.value(dir)) {
+      const QString path = DirectoryPart(file);
+      if (!paths.contains(path)) files_by_path[path] << file;
+    }
+
     ScanTransaction transaction(this, dir, false);
-    transaction.AddToProgressMax(rescan_queue_[dir].count());
+    transaction.AddToProgressMax(paths.count() + files_by_path.count());
 
-    for (const QString& path : rescan_queue_[dir]) {
+    for (const QString& path : paths) {
       if (stop_requested_) return;
       Subdirectory subdir;
       subdir.directory_id = dir;
@@ -626,11 +752,25 @@ void LibraryWatcher::RescanPathsNow() {
       subdir.path = path;
       ScanSubdirectory(path, subdir, &transaction);
     }
+
+    for (auto it = files_by_path.constBegin(); it != files_by_path.constEnd();
+         ++it) {
+      if (stop_requested_) return;
+      ScanFiles(it.key(), it.value(), &transaction);
+    }
   }
 
   rescan_queue_.clear();
+  rescan_files_queue_.clear();
 
-  emit CompilationsNeedUpdating();
+  EmitCompilationsNeedUpdating();
+}
+
+void LibraryWatcher::EmitCompilationsNeedUpdating() {
+  if (touched_albums_.isEmpty()) return;
+
+  emit CompilationsNeedUpdating(touched_albums_.toList());
+  touched_albums_.clear();
 }
 
 QString LibraryWatcher::PickBestImage(const QStringList& images) {
@@ -704,6 +844,9 @@ void LibraryWatcher::ReloadSettings() {
   s.beginGroup(kSettingsGroup);
   scan_on_startup_ = s.value("startup_scan", true).toBool();
   monitor_ = s.value("monitor", true).toBool();
+  fs_watcher_->SetCoalesceInterval(
+      s.value("monitor_coalesce_interval", kDefaultCoalesceIntervalMsec)
+          .toInt());
 
   best_image_filters_.clear();
   QStringList filters =
@@ -734,7 +877,10 @@ void LibraryWatcher::SetRescanPausedAsync(bool pause) {
 
 void LibraryWatcher::SetRescanPaused(bool pause) {
   rescan_paused_ = pause;
-  if (!rescan_paused_ && !rescan_queue_.isEmpty()) RescanPathsNow();
+  if (!rescan_paused_ &&
+      (!rescan_queue_.isEmpty() || !rescan_files_queue_.isEmpty())) {
+    RescanPathsNow();
+  }
 }
 
 void LibraryWatcher::IncrementalScanAsync() {
@@ -762,5 +908,5 @@ void LibraryWatcher::PerformScan(bool incremental, bool ignore_mtimes) {
     }
   }
 
-  emit CompilationsNeedUpdating();
+  EmitCompilationsNeedUpdating();
 }
@@ -23,6 +23,7 @@
 
 #include <QHash>
 #include <QObject>
+#include <QSet>
 #include <QStringList>
 #include <QMap>
 
@@ -41,6 +42,8 @@ class LibraryWatcher : public QObject {
   LibraryWatcher(QObject* parent = nullptr);
 
   static const char* kSettingsGroup;
+  // How long filesystem events are collected for before being processed
+  static const int kDefaultCoalesceIntervalMsec;
 
   void set_backend(LibraryBackend* backend) { backend_ = backend; }
   void set_task_manager(TaskManager* task_manager) {
@@ -64,7 +67,7 @@ signals:
   void SongsReadded(const SongList& songs, bool unavailable = false);
   void SubdirsDiscovered(const SubdirectoryList& subdirs);
   void SubdirsMTimeUpdated(const SubdirectoryList& subdirs);
-  void CompilationsNeedUpdating();
+  void CompilationsNeedUpdating(const QStringList& albums);
 
   void ScanStarted(int task_id);
 
@@ -109,6 +112,9 @@ signals:
     SongList touched_songs;
     SubdirectoryList new_subdirs;
     SubdirectoryList touched_subdirs;
+    // Albums that songs were moved out of during this transaction.  The albums
+    // of the songs in the lists above are added automatically on commit.
+    QSet<QString> touched_albums;
 
    private:
     ScanTransaction(const ScanTransaction&) {}
@@ -139,6 +145,7 @@ signals:
 
  private slots:
   void DirectoryChanged(const QString& path);
+  void FilesChanged(const QStringList& files);
   void IncrementalScanNow();
   void FullScanNow();
   void RescanPathsNow();
@@ -157,6 +164,9 @@ signals:
   void AddWatch(const Directory& dir, const QString& path);
   uint GetMtimeForCue(const QString& cue_path);
   void PerformScan(bool incremental, bool ignore_mtimes);
+  // Emits CompilationsNeedUpdating for the albums touched by the scan
+  // transactions since the last call.
+  void EmitCompilationsNeedUpdating();
 
   // Updates the sections of a cue associated and altered (according to mtime)
   // media file during a scan.
@@ -181,6 +191,16 @@ signals:
   SongList ScanNewFile(const QString& file, const QString& path,
                        const QString& matching_cue,
                        QSet<QString>* cues_processed);
+  // Compares a file on disk with the library and adds any changes to the
+  // transaction.  Returns false if the file doesn't exist any more.
+  bool ScanFile(const QString& file, const QString& path,
+                const SongList& songs_in_db,
+                QMap<QString, QStringList>& album_art,
+                QSet<QString>* cues_processed, ScanTransaction* t);
+  // Rescans only the given files in a subdirectory, rather than the whole
+  // subdirectory.
+  void ScanFiles(const QString& path, const QStringList& files,
+                 ScanTransaction* t);
 
  private:
   LibraryBackend* backend_;
@@ -205,10 +225,15 @@ signals:
   QTimer* rescan_timer_;
   QMap<int, QStringList>
       rescan_queue_;  // dir id -> list of subdirs to be scanned
+  QMap<int, QSet<QString>>
+      rescan_files_queue_;  // dir id -> set of files to be scanned
   bool rescan_paused_;
 
   int total_watches_;
 
+  // Albums whose compilation state needs to be recomputed
+  QSet<QString> touched_albums_;
+
   CueParser* cue_parser_;
 
   static QStringList sValidImages;
@@ -0,0 +1,404 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "tagstatisticswriter.h"
+
+#include <QMutexLocker>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QThread>
+#include <QTimerEvent>
+
+#include "librarybackend.h"
+#include "core/closure.h"
+#include "core/database.h"
+#include "core/logging.h"
+#include "core/scopedtransaction.h"
+
+namespace {
+
+// How many written changes can build up before they're cleared from the
+// journal.  Anything that hasn't been cleared when Clementine crashes just
+// gets written again.
+const int kCommitInterval = 100;
+
+QString ColumnName(int field) {
+  return field == TagStatisticsWriter::Field_Statistics ? "statistics"
+                                                         : "rating";
+}
+
+bool WriteSucceeded(TagReaderReply* reply, int field) {
+  if (!reply->is_successful()) return false;
+
+  if (field == TagStatisticsWriter::Field_Statistics) {
+    return reply->message().save_song_statistics_to_file_response().success();
+  }
+  return reply->message().save_song_rating_to_file_response().success();
+}
+
+// The tagreader still has the replies that haven't finished, so they can only
+// be deleted once it's done with them.  It aborts any it has left when it
+// shuts down.
+void DeleteWhenFinished(TagReaderReply* reply) {
+  QObject::connect(reply, SIGNAL(Finished(bool)), reply, SLOT(deleteLater()));
+  if (reply->is_finished()) reply->deleteLater();
+}
+
+}  // namespace
+
+const char* TagStatisticsWriter::kJournalTable = "tag_writeback";
+const int TagStatisticsWriter::kIdleDelayMsec = 10000;  // 10 seconds
+const int TagStatisticsWriter::kMaxDelayMsec = 5 * 60000;  // 5 minutes
+const int TagStatisticsWriter::kFlushTimeoutMsec = 10000;  // 10 seconds
+
+TagStatisticsWriter::TagStatisticsWriter(LibraryBackend* backend,
+                                         TagReaderClient* tag_reader_client,
+                                         QObject* parent)
+    : QObject(parent),
+      backend_(backend),
+      tag_reader_client_(tag_reader_client),
+      writes_in_flight_(0) {}
+
+void TagStatisticsWriter::InitAsync() {
+  metaObject()->invokeMethod(this, "Init", Qt::QueuedConnection);
+}
+
+void TagStatisticsWriter::QueueStatisticsAsync(const SongList& songs) {
+  metaObject()->invokeMethod(this, "QueueStatistics", Qt::QueuedConnection,
+                             Q_ARG(SongList, songs));
+}
+
+void TagStatisticsWriter::QueueRatingAsync(const SongList& songs) {
+  metaObject()->invokeMethod(this, "QueueRating", Qt::QueuedConnection,
+                             Q_ARG(SongList, songs));
+}
+
+void TagStatisticsWriter::SetHeldUrlAsync(const QUrl& url) {
+  metaObject()->invokeMethod(this, "SetHeldUrl", Qt::QueuedConnection,
+                             Q_ARG(QUrl, url));
+}
+
+void TagStatisticsWriter::Init() {
+  {
+    Database* database = backend_->db();
+    QMutexLocker l(database->Mutex());
+    QSqlDatabase db(database->Connect());
+
+    QSqlQuery q(QString("SELECT song_id, statistics, rating FROM %1")
+                    .arg(kJournalTable),
+                db);
+    q.exec();
+    if (database->CheckErrors(q)) return;
+
+    while (q.next()) {
+      int fields = 0;
+      if (q.value(1).toBool()) fields |= Field_Statistics;
+      if (q.value(2).toBool()) fields |= Field_Rating;
+      if (fields) pending_[q.value(0).toInt()] = fields;
+    }
+  }
+
+  if (!pending_.isEmpty()) {
+    qLog(Info) << pending_.count()
+               << "songs have statistics waiting to be written to files";
+  }
+  ScheduleFlush();
+}
+
+void TagStatisticsWriter::Queue(const SongList& songs, Field field) {
+  if (songs.isEmpty()) return;
+
+  {
+    Database* database = backend_->db();
+    QMutexLocker l(database->Mutex());
+    QSqlDatabase db(database->Connect());
+    ScopedTransaction t(&db);
+
+    QSqlQuery insert(
+        QString("INSERT OR IGNORE INTO %1 (song_id) VALUES (:id)")
+            .arg(kJournalTable),
+        db);
+    QSqlQuery update(QString("UPDATE %1 SET %2 = 1 WHERE song_id = :id")
+                         .arg(kJournalTable, ColumnName(field)),
+                     db);
+
+    for (const Song& song : songs) {
+      if (song.id() == -1) continue;
+
+      insert.bindValue(":id", song.id());
+      insert.exec();
+      if (database->CheckErrors(insert)) return;
+
+      update.bindValue(":id", song.id());
+      update.exec();
+      if (database->CheckErrors(update)) return;
+
+      pending_[song.id()] |= field;
+    }
+
+    t.Commit();
+  }
+
+  ScheduleFlush();
+}
+
+void TagStatisticsWriter::SetHeldUrl(const QUrl& url) {
+  if (url == held_url_) return;
+
+  held_url_ = url;
+  ScheduleFlush();
+}
+
+void TagStatisticsWriter::ScheduleFlush() {
+  if (pending_.isEmpty()) return;
+
+  if (!flush_timer_.isActive()) {
+    first_change_.start();
+  } else if (first_change_.elapsed() >= kMaxDelayMsec) {
+    return;
+  }
+
+  flush_timer_.start(
+      qMin<qint64>(kIdleDelayMsec, kMaxDelayMsec - first_change_.elapsed()),
+      this);
+}
+
+void TagStatisticsWriter::timerEvent(QTimerEvent* e) {
+  if (e->timerId() == flush_timer_.timerId()) {
+    Flush();
+  } else {
+    QObject::timerEvent(e);
+  }
+}
+
+void TagStatisticsWriter::Flush() {
+  flush_timer_.stop();
+
+  queued_writes_ << TakePendingWrites();
+  StartWrites();
+}
+
+void TagStatisticsWriter::FlushBlocking() {
+  if (QThread::currentThread() == thread()) {
+    FlushAndWait();
+  } else {
+    metaObject()->invokeMethod(this, "FlushAndWait",
+                               Qt::BlockingQueuedConnection);
+  }
+}
+
+void TagStatisticsWriter::FlushAndWait() {
+  flush_timer_.stop();
+
+  queued_writes_ << TakePendingWrites();
+  if (queued_writes_.isEmpty()) return;
+
+  qLog(Info) << "Writing statistics to" << queued_writes_.count() << "files";
+
+  // The tagreader might not be running at all, so don't wait forever.
+  QElapsedTimer timer;
+  timer.start();
+
+  const int max_in_flight = QThread::idealThreadCount();
+  while (!queued_writes_.isEmpty()) {
+    QList<QPair<TagReaderReply*, Write>> batch;
+    while (batch.count() < max_in_flight && !queued_writes_.isEmpty()) {
+      const Write write = queued_writes_.takeFirst();
+      batch << qMakePair(StartWrite(write), write);
+    }
+
+    for (const QPair<TagReaderReply*, Write>& pair : batch) {
+      TagReaderReply* reply = pair.first;
+      const int remaining = qMax(0, kFlushTimeoutMsec - int(timer.elapsed()));
+      reply->WaitForFinished(remaining);
+
+      if (!reply->is_finished()) {
+        // Timed out - the song stays in the journal.
+        DeleteWhenFinished(reply);
+        continue;
+      }
+
+      reply->deleteLater();
+      WriteDone(reply, pair.second.song.id(), pair.second.field);
+    }
+
+    if (timer.elapsed() >= kFlushTimeoutMsec) {
+      qLog(Warning) << "Timed out writing statistics to files,"
+                    << queued_writes_.count() << "writes left for next time";
+      queued_writes_.clear();
+      break;
+    }
+  }
+
+  CommitWritten();
+}
+
+QList<TagStatisticsWriter::Write> TagStatisticsWriter::TakePendingWrites() {
+  QList<Write> ret;
+  if (pending_.isEmpty()) return ret;
+
+  const QList<int> ids = pending_.keys();
+  const SongList songs = backend_->GetSongsById(ids);
+
+  QMap<int, int> held;
+  QSet<int> found;
+  for (const Song& song : songs) {
+    const int fields = pending_[song.id()];
+    found << song.id();
+
+    if (!held_url_.isEmpty() && song.url() == held_url_) {
+      held[song.id()] = fields;
+      continue;
+    }
+
+    // The song is read again at this point, so however many times it changed
+    // only its latest statistics and rating are written.
+    if (fields & Field_Statistics) {
+      Write write = {song, Field_Statistics};
+      ret << write;
+    }
+    if (fields & Field_Rating) {
+      Write write = {song, Field_Rating};
+      ret << write;
+    }
+  }
+  pending_ = held;
+
+  // Forget about songs that have been removed from the library since.
+  for (int id : ids) {
+    if (!found.contains(id)) {
+      MarkWritten(id, Field_Statistics | Field_Rating);
+    }
+  }
+
+  return ret;
+}
+
+TagReaderReply* TagStatisticsWriter::StartWrite(const Write& write) {
+  if (write.field == Field_Statistics) {
+    return tag_reader_client_->UpdateSongStatistics(write.song);
+  }
+  return tag_reader_client_->UpdateSongRating(write.song);
+}
+
+void TagStatisticsWriter::StartWrites() {
+  // Each tagreader worker handles one request at a time, so keeping one write
+  // going for each of them is as fast as it gets, and doesn't leave thousands
+  // of requests stuck in front of the ones the UI is waiting on.
+  const int max_in_flight = QThread::idealThreadCount();
+
+  while (writes_in_flight_ < max_in_flight && !queued_writes_.isEmpty()) {
+    const Write write = queued_writes_.takeFirst();
+    TagReaderReply* reply = StartWrite(write);
+    writes_in_flight_++;
+
+    NewClosure(reply, SIGNAL(Finished(bool)), this,
+               SLOT(WriteFinished(TagReaderReply*, int, int)), reply,
+               write.song.id(), int(write.field));
+  }
+
+  if (writes_in_flight_ == 0) {
+    CommitWritten();
+  }
+}
+
+void TagStatisticsWriter::WriteFinished(TagReaderReply* reply, int song_id,
+                                        int field) {
+  reply->deleteLater();
+  writes_in_flight_--;
+
+  WriteDone(reply, song_id, field);
+  if (written_.count() >= kCommitInterval) {
+    CommitWritten();
+  }
+
+  StartWrites();
+}
+
+void TagStatisticsWriter::WriteDone(TagReaderReply* reply, int song_id,
+                                    int field) {
+  if (!reply->is_successful()) {
+    // The tagreader went away before it got to this one, which says nothing
+    // about the file.  It stays in the journal and is tried again next time
+    // Clementine starts.
+    qLog(Warning) << "Couldn't write" << ColumnName(field) << "of song"
+                  << song_id << "to its file, will try again later";
+    return;
+  }
+
+  if (!WriteSucceeded(reply, field)) {
+    // Failed writes aren't retried - the file has most likely gone away or
+    // isn't writable, and trying again won't help.
+    qLog(Warning) << "Failed to write" << ColumnName(field) << "of song"
+                  << song_id << "to its file";
+  }
+  MarkWritten(song_id, field);
+}
+
+void TagStatisticsWriter::MarkWritten(int song_id, int fields) {
+  written_[song_id] |= fields;
+}
+
+void TagStatisticsWriter::CommitWritten() {
+  if (written_.isEmpty()) return;
+
+  Database* database = backend_->db();
+  QMutexLocker l(database->Mutex());
+  QSqlDatabase db(database->Connect());
+  ScopedTransaction t(&db);
+
+  QSqlQuery clear_statistics(
+      QString("UPDATE %1 SET statistics = 0 WHERE song_id = :id")
+          .arg(kJournalTable),
+      db);
+  QSqlQuery clear_rating(
+      QString("UPDATE %1 SET rating = 0 WHERE song_id = :id")
+          .arg(kJournalTable),
+      db);
+  QSqlQuery remove(QString("DELETE FROM %1"
+                           " WHERE song_id = :id"
+                           "   AND statistics = 0 AND rating = 0")
+                       .arg(kJournalTable),
+                   db);
+
+  for (QMap<int, int>::const_iterator it = written_.constBegin();
+       it != written_.constEnd(); ++it) {
+    // Anything that changed again while it was being written has to stay in
+    // the journal.
+    const int fields = it.value() & ~pending_.value(it.key());
+
+    if (fields & Field_Statistics) {
+      clear_statistics.bindValue(":id", it.key());
+      clear_statistics.exec();
+      if (database->CheckErrors(clear_statistics)) return;
+    }
+    if (fields & Field_Rating) {
+      clear_rating.bindValue(":id", it.key());
+      clear_rating.exec();
+      if (database->CheckErrors(clear_rating)) return;
+    }
+
+    remove.bindValue(":id", it.key());
+    remove.exec();
+    if (database->CheckErrors(remove)) return;
+  }
+
+  t.Commit();
+  written_.clear();
+}
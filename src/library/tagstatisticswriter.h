@@ -0,0 +1,143 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef LIBRARY_TAGSTATISTICSWRITER_H_
+#define LIBRARY_TAGSTATISTICSWRITER_H_
+
+#include <QBasicTimer>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QUrl>
+
+#include "core/song.h"
+#include "core/tagreaderclient.h"
+
+class LibraryBackend;
+
+// Writes play statistics and ratings from the library back into the files'
+// tags.  Changes are recorded in a journal table and written out once things
+// have been quiet for a while, so a song that's played and rated several times
+// in a row only has its tags rewritten once, and anything that was still
+// waiting when Clementine quit gets written the next time it starts.
+//
+// The writer lives in the database's thread.  Use the Async functions to talk
+// to it from other threads.
+class TagStatisticsWriter : public QObject {
+  Q_OBJECT
+
+ public:
+  TagStatisticsWriter(LibraryBackend* backend,
+                      TagReaderClient* tag_reader_client,
+                      QObject* parent = nullptr);
+
+  static const char* kJournalTable;
+
+  // How long to wait after the last change before writing anything, and the
+  // longest a steady stream of changes can put the write off for.
+  static const int kIdleDelayMsec;
+  static const int kMaxDelayMsec;
+
+  // How long FlushBlocking() waits for the tagreader before giving up.
+  static const int kFlushTimeoutMsec;
+
+  enum Field {
+    Field_Statistics = 0x1,
+    Field_Rating = 0x2,
+  };
+
+  void InitAsync();
+  void QueueStatisticsAsync(const SongList& songs);
+  void QueueRatingAsync(const SongList& songs);
+  void SetHeldUrlAsync(const QUrl& url);
+
+  // The number of songs that have changes waiting to be written.
+  int pending_count() const { return pending_.count(); }
+
+  // Writes everything that's waiting and blocks until it's done, or until
+  // kFlushTimeoutMsec has passed.  Anything that wasn't written by then stays
+  // in the journal for next time.  Must be called from a different thread to
+  // the TagReaderClient's.
+  //
+  // Writes that the tagreader reports as failed are dropped from the journal,
+  // since the file is missing or read-only.  Writes it never answered stay in
+  // the journal.
+  void FlushBlocking();
+
+ public slots:
+  // Loads the changes that hadn't been written yet from the journal.
+  void Init();
+
+  void QueueStatistics(const SongList& songs) {
+    Queue(songs, Field_Statistics);
+  }
+  void QueueRating(const SongList& songs) { Queue(songs, Field_Rating); }
+
+  // Changes to this file are held back until it's set to something else.
+  // Gstreamer doesn't cope well with WMA files being rewritten while they're
+  // being played.
+  void SetHeldUrl(const QUrl& url);
+
+  void Flush();
+
+ protected:
+  void timerEvent(QTimerEvent* e);
+
+ private slots:
+  void WriteFinished(TagReaderReply* reply, int song_id, int field);
+  void FlushAndWait();
+
+ private:
+  struct Write {
+    Song song;
+    Field field;
+  };
+
+  void Queue(const SongList& songs, Field field);
+  void ScheduleFlush();
+  QList<Write> TakePendingWrites();
+  TagReaderReply* StartWrite(const Write& write);
+  void StartWrites();
+  // Clears a finished write from the journal, unless the tagreader gave up on
+  // it without trying.
+  void WriteDone(TagReaderReply* reply, int song_id, int field);
+  void MarkWritten(int song_id, int fields);
+  void CommitWritten();
+
+ private:
+  LibraryBackend* backend_;
+  TagReaderClient* tag_reader_client_;
+
+  // Song ID -> the Fields that are waiting to be written.
+  QMap<int, int> pending_;
+
+  QList<Write> queued_writes_;
+  int writes_in_flight_;
+
+  // Song ID -> the Fields that have been written but are still in the
+  // journal.
+  QMap<int, int> written_;
+
+  QUrl held_url_;
+
+  QBasicTimer flush_timer_;
+  QElapsedTimer first_change_;
+};
+
+#endif  // LIBRARY_TAGSTATISTICSWRITER_H_
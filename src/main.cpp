@@ -47,6 +47,7 @@
 #include "core/commandlineoptions.h"
 #include "core/crashreporting.h"
 #include "core/database.h"
+#include "core/headlessrunner.h"
 #include "core/logging.h"
 #include "core/mac_startup.h"
 #include "core/metatypes.h"
@@ -54,6 +55,7 @@
 #include "core/networkproxyfactory.h"
 #include "core/potranslator.h"
 #include "core/song.h"
+#include "core/tracing.h"
 #include "core/ubuntuunityhack.h"
 #include "core/utilities.h"
 #include "covers/amazoncoverprovider.h"
@@ -224,6 +226,34 @@ void CheckPortable() {
   }
 }
 
+// Runs the batch jobs from the commandline in the QCoreApplication that's
+// already been created, without ever opening a window.
+int RunHeadless(const CommandlineOptions& options) {
+  if (!options.trace_file().isEmpty()) {
+    tracing::SetEnabled(true);
+  }
+
+  SetGstreamerEnvironment();
+
+  ParseAProto();
+  QtConcurrent::run(&ParseAProto);
+
+  Application app(nullptr, Application::Mode_Headless,
+                  options.database_file());
+
+  HeadlessRunner runner(&app, options);
+  QObject::connect(&runner, SIGNAL(Finished()), QCoreApplication::instance(),
+                   SLOT(quit()));
+  runner.Start();
+  QCoreApplication::exec();
+
+  if (!options.trace_file().isEmpty()) {
+    tracing::WriteChromeTrace(options.trace_file());
+  }
+
+  return runner.exit_code();
+}
+
 }  // namespace
 
 #ifdef HAVE_GIO
@@ -303,6 +333,23 @@ int main(int argc, char* argv[]) {
     if (!options.Parse()) return 1;
     logging::SetLevels(options.log_levels());
 
+    if (options.is_headless()) {
+      // A batch job on the default database would be writing to it at the
+      // same time as the running instance, so it needs a --db of its own.
+      if (options.database_file().isEmpty() && a.isRunning()) {
+        qLog(Error) << "Clementine is already running - close it or use --db "
+                       "to run this on a different database";
+        return 1;
+      }
+
+      // Batch jobs don't need an X server and shouldn't hand over to (or be
+      // handed over to from) a running instance, so they never get as far as
+      // the QApplication.  The resources have to be initialised out here
+      // because Q_INIT_RESOURCE can't be used inside a namespace.
+      Q_INIT_RESOURCE(data);
+      return RunHeadless(options);
+    }
+
     if (a.isRunning()) {
       if (options.is_empty()) {
         qLog(Info)
@@ -315,6 +362,10 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  if (!options.trace_file().isEmpty()) {
+    tracing::SetEnabled(true);
+  }
+
 #ifdef Q_OS_DARWIN
   // Must happen after QCoreApplication::setOrganizationName().
   setenv(
@@ -486,6 +537,10 @@ int main(int argc, char* argv[]) {
 
   int ret = a.exec();
 
+  if (!options.trace_file().isEmpty()) {
+    tracing::WriteChromeTrace(options.trace_file());
+  }
+
 #ifdef Q_OS_LINUX
   // The nvidia driver would cause Clementine (or any application that used
   // opengl) to use 100% cpu on shutdown.  See:
@@ -0,0 +1,200 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "moodbarimagecache.h"
+
+#include <QApplication>
+#include <QtConcurrentRun>
+
+#include "moodbarpipeline.h"
+#include "core/application.h"
+#include "core/closure.h"
+
+const int MoodbarImageCache::kMaxImageCost = 16 * 1024 * 1024;  // 16MB
+const int MoodbarImageCache::kMaxColorsCost = 4 * 1024 * 1024;  // 4MB
+const int MoodbarImageCache::kMaxFailedUrls = 10000;
+
+MoodbarImageCache::MoodbarImageCache(Application* app, QObject* parent)
+    : QObject(parent),
+      app_(app),
+      images_(kMaxImageCost),
+      colors_(kMaxColorsCost),
+      cannot_load_(kMaxFailedUrls) {}
+
+MoodbarImageCache::Result MoodbarImageCache::Get(
+    const QUrl& url, const QSize& size, MoodbarRenderer::MoodbarStyle style,
+    QPixmap* pixmap) {
+  if (cannot_load_.contains(url)) {
+    return CannotLoad;
+  }
+
+  if (QPixmap* cached = images_.object(ImageKey(url, size, style))) {
+    *pixmap = *cached;
+    return Loaded;
+  }
+
+  const ColorsKey key(url, style);
+
+  // Show the moodbar at its old size until the new one is ready.
+  if (last_sizes_.contains(key)) {
+    QPixmap* cached = images_.object(ImageKey(url, last_sizes_[key], style));
+    if (cached) {
+      *pixmap = *cached;
+    } else {
+      last_sizes_.remove(key);
+    }
+  }
+
+  const bool started = wanted_sizes_.contains(key);
+  wanted_sizes_[key] = size;
+
+  if (!started) {
+    StartLoading(key);
+  }
+  return WillLoadAsync;
+}
+
+void MoodbarImageCache::StartLoading(const ColorsKey& key) {
+  if (ColorVector* colors = colors_.object(key)) {
+    StartRendering(key, *colors);
+    return;
+  }
+
+  const QUrl& url = key.first;
+  const bool started = waiting_for_data_.contains(url);
+  waiting_for_data_.insert(url, key.second);
+  if (started) {
+    return;
+  }
+
+  QByteArray bytes;
+  MoodbarPipeline* pipeline = nullptr;
+  switch (LoadData(url, &bytes, &pipeline)) {
+    case MoodbarLoader::CannotLoad:
+      LoadFailed(url);
+      break;
+
+    case MoodbarLoader::Loaded:
+      for (int style : waiting_for_data_.values(url)) {
+        StartLoadingColors(ColorsKey(url, style), bytes);
+      }
+      waiting_for_data_.remove(url);
+      break;
+
+    case MoodbarLoader::WillLoadAsync:
+      NewClosure(pipeline, SIGNAL(Finished(bool)), this,
+                 SLOT(DataLoaded(QUrl, MoodbarPipeline*)), url, pipeline);
+      break;
+  }
+}
+
+MoodbarLoader::Result MoodbarImageCache::LoadData(const QUrl& url,
+                                                  QByteArray* data,
+                                                  MoodbarPipeline** pipeline) {
+  return app_->moodbar_loader()->Load(url, data, pipeline);
+}
+
+void MoodbarImageCache::DataLoaded(const QUrl& url,
+                                   MoodbarPipeline* pipeline) {
+  if (!pipeline->success()) {
+    LoadFailed(url);
+    return;
+  }
+
+  for (int style : waiting_for_data_.values(url)) {
+    StartLoadingColors(ColorsKey(url, style), pipeline->data());
+  }
+  waiting_for_data_.remove(url);
+}
+
+void MoodbarImageCache::LoadFailed(const QUrl& url) {
+  for (int style : waiting_for_data_.values(url)) {
+    wanted_sizes_.remove(ColorsKey(url, style));
+  }
+  waiting_for_data_.remove(url);
+  cannot_load_.insert(url, new bool(true));
+
+  emit ImageLoaded(url);
+}
+
+void MoodbarImageCache::MoodbarGenerated(const QUrl& url) {
+  if (cannot_load_.remove(url)) {
+    emit ImageLoaded(url);
+  }
+}
+
+void MoodbarImageCache::StartLoadingColors(const ColorsKey& key,
+                                           const QByteArray& bytes) {
+  QFutureWatcher<ColorVector>* watcher = new QFutureWatcher<ColorVector>();
+  NewClosure(watcher, SIGNAL(finished()), this,
+             SLOT(ColorsLoaded(QUrl, int, QFutureWatcher<ColorVector>*)),
+             key.first, key.second, watcher);
+
+  QFuture<ColorVector> future = QtConcurrent::run(
+      MoodbarRenderer::Colors, bytes,
+      MoodbarRenderer::MoodbarStyle(key.second), qApp->palette());
+  watcher->setFuture(future);
+}
+
+void MoodbarImageCache::ColorsLoaded(const QUrl& url, int style,
+                                     QFutureWatcher<ColorVector>* watcher) {
+  watcher->deleteLater();
+
+  const ColorsKey key(url, style);
+  const ColorVector colors = watcher->result();
+  colors_.insert(key, new ColorVector(colors),
+                 colors.count() * sizeof(QColor));
+
+  StartRendering(key, colors);
+}
+
+void MoodbarImageCache::StartRendering(const ColorsKey& key,
+                                       const ColorVector& colors) {
+  QFutureWatcher<QImage>* watcher = new QFutureWatcher<QImage>();
+  NewClosure(watcher, SIGNAL(finished()), this,
+             SLOT(ImageRendered(QUrl, int, QFutureWatcher<QImage>*)),
+             key.first, key.second, watcher);
+
+  QFuture<QImage> future = QtConcurrent::run(
+      MoodbarRenderer::RenderToImage, colors, wanted_sizes_[key]);
+  watcher->setFuture(future);
+}
+
+void MoodbarImageCache::ImageRendered(const QUrl& url, int style,
+                                      QFutureWatcher<QImage>* watcher) {
+  watcher->deleteLater();
+
+  const ColorsKey key(url, style);
+  const QImage image = watcher->result();
+
+  if (!image.isNull()) {
+    images_.insert(ImageKey(url, image.size(), style),
+                   new QPixmap(QPixmap::fromImage(image)),
+                   image.byteCount());
+    last_sizes_[key] = image.size();
+  }
+
+  if (!image.isNull() && wanted_sizes_[key] != image.size()) {
+    // It was asked for at a different size while this one was rendering.
+    StartLoading(key);
+  } else {
+    wanted_sizes_.remove(key);
+  }
+
+  emit ImageLoaded(url);
+}
@@ -0,0 +1,143 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MOODBAR_MOODBARIMAGECACHE_H_
+#define MOODBAR_MOODBARIMAGECACHE_H_
+
+#include <QCache>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QMultiHash>
+#include <QObject>
+#include <QPair>
+#include <QPixmap>
+#include <QSize>
+#include <QUrl>
+
+#include "moodbarloader.h"
+#include "moodbarrenderer.h"
+#include "core/qhash_qurl.h"
+
+class Application;
+class MoodbarPipeline;
+
+// Moodbars rendered at the sizes they've been asked for, shared between
+// everything that shows them for more than one song.  Loading the data,
+// turning it into colours and rendering the image all happen in the
+// background, and the cache is limited to kMaxImageCost bytes of images and
+// kMaxColorsCost bytes of colours.  The last kMaxFailedUrls songs whose
+// moodbars couldn't be loaded are remembered so they aren't tried again.
+class MoodbarImageCache : public QObject {
+  Q_OBJECT
+
+ public:
+  MoodbarImageCache(Application* app, QObject* parent = nullptr);
+
+  static const int kMaxImageCost;
+  static const int kMaxColorsCost;
+  static const int kMaxFailedUrls;
+
+  enum Result {
+    // The moodbar data for this URL can never be loaded.
+    CannotLoad,
+
+    // The image was in the cache and was returned.
+    Loaded,
+
+    // The image will be rendered in the background and ImageLoaded() emitted
+    // when it's done.  Until then the returned pixmap is the same moodbar at
+    // the last size it was rendered at, or null if there isn't one.
+    WillLoadAsync
+  };
+
+  Result Get(const QUrl& url, const QSize& size,
+             MoodbarRenderer::MoodbarStyle style, QPixmap* pixmap);
+
+ public slots:
+  // Forgets that this URL's moodbar couldn't be loaded, so it's tried again.
+  void MoodbarGenerated(const QUrl& url);
+
+ signals:
+  // Emitted when something finishes loading for this URL, whether it worked
+  // or not.  Calling Get() again says which.
+  void ImageLoaded(const QUrl& url);
+
+ protected:
+  // Loads the moodbar data with the application's MoodbarLoader.
+  virtual MoodbarLoader::Result LoadData(const QUrl& url, QByteArray* data,
+                                         MoodbarPipeline** pipeline);
+
+ private slots:
+  void DataLoaded(const QUrl& url, MoodbarPipeline* pipeline);
+  void ColorsLoaded(const QUrl& url, int style,
+                    QFutureWatcher<ColorVector>* watcher);
+  void ImageRendered(const QUrl& url, int style,
+                     QFutureWatcher<QImage>* watcher);
+
+ private:
+  // A song's moodbar in one style.
+  typedef QPair<QUrl, int> ColorsKey;
+
+  struct ImageKey {
+    ImageKey(const QUrl& _url, const QSize& _size, int _style)
+        : url(_url), size(_size), style(_style) {}
+
+    bool operator==(const ImageKey& other) const {
+      return url == other.url && size == other.size && style == other.style;
+    }
+
+    QUrl url;
+    QSize size;
+    int style;
+  };
+  friend uint qHash(const ImageKey& key);
+
+ private:
+  void StartLoading(const ColorsKey& key);
+  void StartLoadingColors(const ColorsKey& key, const QByteArray& bytes);
+  void StartRendering(const ColorsKey& key, const ColorVector& colors);
+  void LoadFailed(const QUrl& url);
+
+ private:
+  Application* app_;
+
+  QCache<ImageKey, QPixmap> images_;
+  QCache<ColorsKey, ColorVector> colors_;
+
+  // The size each moodbar was last rendered at, for showing while it's
+  // rendered at a new one.
+  QHash<ColorsKey, QSize> last_sizes_;
+
+  // Moodbars that are being loaded or rendered, and the size they were last
+  // asked for.  There's only ever one of these going at a time for each, so
+  // resizing a column doesn't render every size it went through.
+  QHash<ColorsKey, QSize> wanted_sizes_;
+
+  // URL -> styles waiting for its moodbar data to be loaded.
+  QMultiHash<QUrl, int> waiting_for_data_;
+
+  // The values aren't used, this is just a set that forgets the oldest URLs.
+  QCache<QUrl, bool> cannot_load_;
+};
+
+inline uint qHash(const MoodbarImageCache::ImageKey& key) {
+  return qHash(key.url) ^ qHash((key.size.width() << 16) ^ key.size.height()) ^
+         qHash(key.style);
+}
+
+#endif  // MOODBAR_MOODBARIMAGECACHE_H_
@@ -20,13 +20,13 @@
 
 #include "moodbarrenderer.h"
 
-#include <QCache>
+#include <QHash>
 #include <QItemDelegate>
-#include <QFutureWatcher>
+#include <QPersistentModelIndex>
+#include <QSet>
 #include <QUrl>
 
 class Application;
-class MoodbarPipeline;
 class PlaylistView;
 
 class QModelIndex;
@@ -43,46 +43,18 @@ class MoodbarItemDelegate : public QItemDelegate {
 
  private slots:
   void ReloadSettings();
-
-  void DataLoaded(const QUrl& url, MoodbarPipeline* pipeline);
-  void ColorsLoaded(const QUrl& url, QFutureWatcher<ColorVector>* watcher);
-  void ImageLoaded(const QUrl& url, QFutureWatcher<QImage>* watcher);
-
- private:
-  struct Data {
-    Data();
-
-    enum State {
-      State_None,
-      State_CannotLoad,
-      State_LoadingData,
-      State_LoadingColors,
-      State_LoadingImage,
-      State_Loaded
-    };
-
-    QSet<QPersistentModelIndex> indexes_;
-
-    State state_;
-    ColorVector colors_;
-    QSize desired_size_;
-    QPixmap pixmap_;
-  };
+  void ImageLoaded(const QUrl& url);
 
  private:
   QPixmap PixmapForIndex(const QModelIndex& index, const QSize& size);
-  void StartLoadingData(const QUrl& url, Data* data);
-  void StartLoadingColors(const QUrl& url, const QByteArray& bytes, Data* data);
-  void StartLoadingImage(const QUrl& url, Data* data);
-
-  bool RemoveFromCacheIfIndexesInvalid(const QUrl& url, Data* data);
-
-  void ReloadAllColors();
 
  private:
   Application* app_;
   PlaylistView* view_;
-  QCache<QUrl, Data> data_;
+
+  // The images themselves live in the application's MoodbarImageCache, this
+  // just remembers which rows to repaint when they're ready.
+  QHash<QUrl, QSet<QPersistentModelIndex>> waiting_indexes_;
 
   MoodbarRenderer::MoodbarStyle style_;
 };
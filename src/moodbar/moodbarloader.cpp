@@ -184,6 +184,8 @@ void MoodbarLoader::RequestFinished(MoodbarPipeline* request, const QUrl& url) {
         qLog(Warning) << "Error opening mood file for writing" << mood_filename;
       }
     }
+
+    emit MoodbarGenerated(url);
   }
 
   // Remove the request from the active list and delete it
@@ -51,6 +51,10 @@ class MoodbarLoader : public QObject {
   Result Load(const QUrl& url, QByteArray* data,
               MoodbarPipeline** async_pipeline);
 
+ signals:
+  // Emitted when moodbar data has been created and saved for a song.
+  void MoodbarGenerated(const QUrl& url);
+
  private slots:
   void ReloadSettings();
 
@@ -20,6 +20,7 @@
 #include <cmath>
 
 #include "networkremote.h"
+#include "core/closure.h"
 #include "core/logging.h"
 #include "core/timeconstants.h"
 #include "core/utilities.h"
@@ -207,9 +208,8 @@ void OutgoingDataCreator::SetEngineState(
 }
 
 void OutgoingDataCreator::SendAllPlaylists() {
-  // Get all Playlists
-  QList<Playlist*> app_playlists = app_->playlist_manager()->GetAllPlaylists();
-  int active_playlist = app_->playlist_manager()->active_id();
+  PlaylistManager* manager = app_->playlist_manager();
+  int active_playlist = manager->active_id();
 
   // Create message
   pb::remote::Message msg;
@@ -220,8 +220,8 @@ void OutgoingDataCreator::SendAllPlaylists() {
   // Get all playlists, even ones that are hidden in the UI.
   for (const PlaylistBackend::Playlist& p :
        app_->playlist_backend()->GetAllPlaylists()) {
-    bool playlist_open = app_->playlist_manager()->IsPlaylistOpen(p.id);
-    int item_count = playlist_open ? app_playlists.at(p.id)->rowCount() : 0;
+    bool playlist_open = manager->IsPlaylistOpen(p.id);
+    int item_count = playlist_open ? manager->GetPlaylistItemCount(p.id) : 0;
 
     // Create a new playlist
     pb::remote::Playlist* playlist = playlists->add_playlist();
@@ -257,7 +257,8 @@ void OutgoingDataCreator::SendAllActivePlaylists() {
     playlist->set_name(DataCommaSizeFromQString(playlist_name));
     playlist->set_id(p->id());
     playlist->set_active((p->id() == active_playlist));
-    playlist->set_item_count(p->rowCount());
+    playlist->set_item_count(
+        app_->playlist_manager()->GetPlaylistItemCount(p->id()));
     playlist->set_closed(false);
   }
 
@@ -421,6 +422,15 @@ void OutgoingDataCreator::SendPlaylistSongs(int id) {
     return;
   }
 
+  // Playlists that haven't been shown yet might not have been loaded from the
+  // database.  Send the songs once they have been.
+  if (!playlist->is_restored()) {
+    NewClosure(playlist, SIGNAL(RestoreFinished()), this,
+               SLOT(SendPlaylistSongs(int)), id);
+    playlist->Restore();
+    return;
+  }
+
   // Create the message and the playlist
   pb::remote::Message msg;
   msg.set_type(pb::remote::PLAYLIST_SONGS);
@@ -22,17 +22,19 @@
 #include <QFileInfo>
 
 #include "core/application.h"
+#include "core/closure.h"
 #include "core/logging.h"
 #include "core/utilities.h"
 #include "library/librarybackend.h"
 #include "playlist/playlistitem.h"
+#include "transcoder/transcodecache.h"
 
 const quint32 SongSender::kFileChunkSize = 100000;  // in Bytes
 
 SongSender::SongSender(Application* app, RemoteClient* client)
     : app_(app),
       client_(client),
-      transcoder_(new Transcoder(this)) {
+      transcode_cache_(app->transcode_cache()) {
   QSettings s;
   s.beginGroup(NetworkRemote::kSettingsGroup);
 
@@ -40,7 +42,7 @@ SongSender::SongSender(Application* app, RemoteClient* client)
 
   // Load preset
   QString last_output_format = s.value("last_output_format", "audio/x-vorbis").toString();
-  QList<TranscoderPreset> presets = transcoder_->GetAllPresets();
+  QList<TranscoderPreset> presets = Transcoder::GetAllPresets();
   for (int i = 0; i<presets.count(); ++i) {
     if (last_output_format == presets.at(i).codec_mimetype_) {
       transcoder_preset_ = presets.at(i);
@@ -49,18 +51,21 @@ SongSender::SongSender(Application* app, RemoteClient* client)
   }
   qLog(Debug) << "Transcoder preset" << transcoder_preset_.codec_mimetype_;
 
-  connect(transcoder_, SIGNAL(JobComplete(QString, QString, bool)),
-          SLOT(TranscodeJobComplete(QString, QString, bool)));
-  connect(transcoder_, SIGNAL(AllJobsComplete()), SLOT(StartTransfer()));
+  connect(transcode_cache_, SIGNAL(Finished(QString, QString, bool)),
+          SLOT(TranscodeFinished(QString, QString, bool)));
 
   total_transcode_ = 0;
 }
 
 SongSender::~SongSender() {
-  disconnect(transcoder_, SIGNAL(JobComplete(QString, QString, bool)), this,
-          SLOT(TranscodeJobComplete(QString, QString, bool)));
-  disconnect(transcoder_, SIGNAL(AllJobsComplete()), this, SLOT(StartTransfer()));
-  transcoder_->Cancel();
+  disconnect(transcode_cache_, SIGNAL(Finished(QString, QString, bool)), this,
+             SLOT(TranscodeFinished(QString, QString, bool)));
+
+  // Let the cache know we don't need these files any more.  Any transcodes
+  // still running carry on and are kept for the next client.
+  for (const QString& key : transcode_keys_) {
+    transcode_cache_->Release(key);
+  }
 }
 
 void SongSender::SendSongs(const pb::remote::RequestDownloadSongs& request) {
@@ -82,9 +87,20 @@ void SongSender::SendSongs(const pb::remote::RequestDownloadSongs& request) {
         SendAlbum(current_song);
       }
       break;
-    case pb::remote::APlaylist:
+    case pb::remote::APlaylist: {
+      Playlist* playlist =
+          app_->playlist_manager()->playlist(request.playlist_id());
+      if (playlist && !playlist->is_restored()) {
+        // The playlist's songs haven't been loaded from the database yet -
+        // send them once they have been.
+        NewClosure(playlist, SIGNAL(RestoreFinished()), this,
+                   SLOT(SendRestoredPlaylist(int)), request.playlist_id());
+        playlist->Restore();
+        return;
+      }
       SendPlaylist(request.playlist_id());
       break;
+    }
     case pb::remote::Urls:
       SendUrls(request);
       break;
@@ -92,6 +108,15 @@ void SongSender::SendSongs(const pb::remote::RequestDownloadSongs& request) {
       break;
   }
 
+  SendQueuedItems();
+}
+
+void SongSender::SendRestoredPlaylist(int playlist_id) {
+  SendPlaylist(playlist_id);
+  SendQueuedItems();
+}
+
+void SongSender::SendQueuedItems() {
   if (transcode_lossless_files_) {
     TranscodeLosslessFiles();
   } else {
@@ -105,32 +130,45 @@ void SongSender::TranscodeLosslessFiles() {
     if (!item.song_.IsFileLossless())
       continue;
 
-    // Add the file to the transcoder
+    // Ask the cache for a transcoded copy of the file
     QString local_file = item.song_.url().toLocalFile();
+    if (transcode_keys_.contains(local_file)) continue;
 
-    transcoder_->AddTemporaryJob(local_file, transcoder_preset_);
+    const QString key =
+        transcode_cache_->Request(local_file, transcoder_preset_);
+    transcode_keys_.insert(local_file, key);
+    pending_transcodes_.insert(key, local_file);
 
     qLog(Debug) << "transcoding" << local_file;
     total_transcode_++;
   }
 
   if (total_transcode_ > 0) {
-    transcoder_->Start();
     SendTranscoderStatus();
   } else {
     StartTransfer();
   }
 }
 
-void SongSender::TranscodeJobComplete(const QString& input, const QString& output, bool success) {
+void SongSender::TranscodeFinished(const QString& key, const QString& output,
+                                   bool success) {
+  if (!pending_transcodes_.contains(key)) return;
+
+  const QString input = pending_transcodes_.take(key);
   qLog(Debug) << input << "transcoded to" << output << success;
 
   // If it wasn't successful send original file
   if (success) {
     transcoder_map_.insert(input, output);
+  } else {
+    transcode_keys_.remove(input);
   }
 
   SendTranscoderStatus();
+
+  if (pending_transcodes_.isEmpty()) {
+    StartTransfer();
+  }
 }
 
 void SongSender::SendTranscoderStatus() {
@@ -140,7 +178,7 @@ void SongSender::SendTranscoderStatus() {
 
   pb::remote::ResponseTranscoderStatus* status =
       msg.mutable_response_transcoder_status();
-  status->set_processed(transcoder_map_.count());
+  status->set_processed(total_transcode_ - pending_transcodes_.count());
   status->set_total(total_transcode_);
 
   client_->SendData(&msg);
@@ -296,11 +334,12 @@ void SongSender::SendSingleSong(DownloadItem download_item) {
     chunk_number++;
   }
 
-  // If the file was transcoded, delete the temporary one
+  file.close();
+
+  // If the file was transcoded, the cache can have it back
   if (is_transcoded) {
-    file.remove();
-  } else {
-    file.close();
+    transcode_cache_->Release(
+        transcode_keys_.take(download_item.song_.url().toLocalFile()));
   }
 }
 
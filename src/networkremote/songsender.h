@@ -12,7 +12,7 @@
 
 class Application;
 class RemoteClient;
-class Transcoder;
+class TranscodeCache;
 
 struct DownloadItem {
   Song song_;
@@ -35,24 +35,28 @@ class SongSender : public QObject {
   void ResponseSongOffer(bool accepted);
 
  private slots:
-  void TranscodeJobComplete(const QString& input, const QString& output, bool success);
+  void TranscodeFinished(const QString& key, const QString& output, bool success);
   void StartTransfer();
+  void SendRestoredPlaylist(int playlist_id);
 
  private:
   Application* app_;
   RemoteClient* client_;
 
   TranscoderPreset transcoder_preset_;
-  Transcoder* transcoder_;
+  TranscodeCache* transcode_cache_;
   bool transcode_lossless_files_;
 
   QQueue<DownloadItem> download_queue_;
-  QMap<QString, QString> transcoder_map_;
+  QMap<QString, QString> transcoder_map_;     // Input -> transcoded file.
+  QMap<QString, QString> transcode_keys_;     // Input -> cache key.
+  QMap<QString, QString> pending_transcodes_; // Cache key -> input.
   int total_transcode_;
 
   void SendSingleSong(DownloadItem download_item);
   void SendAlbum(const Song& song);
   void SendPlaylist(int playlist_id);
+  void SendQueuedItems();
   void SendUrls(const pb::remote::RequestDownloadSongs& request);
   void OfferNextSong();
   void SendTotalFileSize();
@@ -27,10 +27,10 @@
 #include <QCoreApplication>
 #include <QDirIterator>
 #include <QFileInfo>
-#include <QLinkedList>
 #include <QMimeData>
 #include <QMutableListIterator>
 #include <QSortFilterProxyModel>
+#include <QThread>
 #include <QUndoStack>
 #include <QtConcurrentRun>
 #include <QtDebug>
@@ -46,6 +46,7 @@
 #include "songplaylistitem.h"
 #include "core/application.h"
 #include "core/closure.h"
+#include "core/fileexistencechecker.h"
 #include "core/logging.h"
 #include "core/modelfuturewatcher.h"
 #include "core/qhash_qurl.h"
@@ -64,6 +65,8 @@
 #include "library/librarybackend.h"
 #include "library/librarymodel.h"
 #include "library/libraryplaylistitem.h"
+#include "library/libraryqueryinserter.h"
+#include "library/libraryquerymimedata.h"
 #include "smartplaylists/generator.h"
 #include "smartplaylists/generatorinserter.h"
 #include "smartplaylists/generatormimedata.h"
@@ -103,6 +106,9 @@ Playlist::Playlist(PlaylistBackend* backend, TaskManager* task_manager,
                    bool favorite, QObject* parent)
     : QAbstractListModel(parent),
       is_loading_(false),
+      restore_started_(false),
+      is_restored_(false),
+      save_after_restore_(false),
       proxy_(new PlaylistFilter(this)),
       queue_(new Queue(this)),
       backend_(backend),
@@ -110,6 +116,7 @@ Playlist::Playlist(PlaylistBackend* backend, TaskManager* task_manager,
       library_(library),
       id_(id),
       favorite_(favorite),
+      rows_by_item_dirty_(true),
       current_is_paused_(false),
       current_virtual_index_(-1),
       is_shuffled_(false),
@@ -127,8 +134,6 @@ Playlist::Playlist(PlaylistBackend* backend, TaskManager* task_manager,
   connect(this, SIGNAL(rowsRemoved(const QModelIndex&, int, int)),
           SIGNAL(PlaylistChanged()));
 
-  Restore();
-
   proxy_->setSourceModel(this);
   queue_->setSourceModel(this);
 
@@ -148,6 +153,7 @@ Playlist::Playlist(PlaylistBackend* backend, TaskManager* task_manager,
 Playlist::~Playlist() {
   items_.clear();
   library_items_by_id_.clear();
+  items_by_url_.clear();
 }
 
 template <typename T>
@@ -742,25 +748,16 @@ bool Playlist::dropMimeData(const QMimeData* data, Qt::DropAction action,
     enqueue_now = mime_data->enqueue_now_;
   }
 
-  if (const SongMimeData* song_data = qobject_cast<const SongMimeData*>(data)) {
+  if (const LibraryQueryMimeData* query_data =
+          qobject_cast<const LibraryQueryMimeData*>(data)) {
+    // Dragged from a library before all the songs were loaded
+    LibraryQueryInserter* inserter = new LibraryQueryInserter(task_manager_);
+    inserter->Load(this, row, play_now, enqueue_now, query_data);
+  } else if (const SongMimeData* song_data =
+                 qobject_cast<const SongMimeData*>(data)) {
     // Dragged from a library
-    // We want to check if these songs are from the actual local file backend,
-    // if they are we treat them differently.
-    if (song_data->backend &&
-        song_data->backend->songs_table() == Library::kSongsTable)
-      InsertSongItems<LibraryPlaylistItem>(song_data->songs, row, play_now,
-                                           enqueue_now);
-    else if (song_data->backend &&
-             song_data->backend->songs_table() == MagnatuneService::kSongsTable)
-      InsertSongItems<MagnatunePlaylistItem>(song_data->songs, row, play_now,
-                                             enqueue_now);
-    else if (song_data->backend &&
-             song_data->backend->songs_table() == JamendoService::kSongsTable)
-      InsertSongItems<JamendoPlaylistItem>(song_data->songs, row, play_now,
-                                           enqueue_now);
-    else
-      InsertSongItems<SongPlaylistItem>(song_data->songs, row, play_now,
-                                        enqueue_now);
+    InsertSongsFromBackend(song_data->songs, song_data->backend, row, play_now,
+                           enqueue_now);
   } else if (const InternetMimeData* internet_data =
                  qobject_cast<const InternetMimeData*>(data)) {
     // Dragged from the Internet pane
@@ -902,6 +899,7 @@ void Playlist::MoveItemsWithoutUndo(const QList<int>& source_rows, int pos) {
     moved_items[i - start]->RemoveForegroundColor(kDynamicHistoryPriority);
     items_.insert(i, moved_items[i - start]);
   }
+  rows_by_item_dirty_ = true;
 
   // Update persistent indexes
   for (const QModelIndex& pidx : persistentIndexList()) {
@@ -950,6 +948,7 @@ void Playlist::MoveItemsWithoutUndo(int start, const QList<int>& dest_rows) {
     items_.insert(dest_row, moved_items[offset]);
     offset++;
   }
+  rows_by_item_dirty_ = true;
 
   // Update persistent indexes
   for (const QModelIndex& pidx : persistentIndexList()) {
@@ -980,6 +979,10 @@ void Playlist::InsertItems(const PlaylistItemList& itemsIn, int pos,
                            bool play_now, bool enqueue) {
   if (itemsIn.isEmpty()) return;
 
+  // Songs are being added to a playlist that hasn't been shown yet.  Load its
+  // existing items now so they get saved along with the new ones.
+  if (!restore_started_) Restore();
+
   PlaylistItemList items = itemsIn;
 
   // exercise vetoes
@@ -1045,17 +1048,12 @@ void Playlist::InsertItemsWithoutUndo(const PlaylistItemList& items, int pos,
   const int end = start + items.count() - 1;
 
   beginInsertRows(QModelIndex(), start, end);
+  rows_by_item_dirty_ = true;
   for (int i = start; i <= end; ++i) {
     PlaylistItemPtr item = items[i - start];
     items_.insert(i, item);
     virtual_items_ << virtual_items_.count();
-
-    if (item->type() == "Library") {
-      int id = item->Metadata().id();
-      if (id != -1) {
-        library_items_by_id_.insertMulti(id, item);
-      }
-    }
+    IndexItem(item);
 
     if (item == current_item()) {
       // It's one we removed before that got re-added through an undo
@@ -1100,6 +1098,21 @@ void Playlist::InsertSongsOrLibraryItems(const SongList& songs, int pos,
   InsertItems(items, pos, play_now, enqueue);
 }
 
+void Playlist::InsertSongsFromBackend(const SongList& songs,
+                                      const LibraryBackendInterface* backend,
+                                      int pos, bool play_now, bool enqueue) {
+  // We want to check if these songs are from the actual local file backend,
+  // if they are we treat them differently.
+  if (backend && backend->songs_table() == Library::kSongsTable)
+    InsertSongItems<LibraryPlaylistItem>(songs, pos, play_now, enqueue);
+  else if (backend && backend->songs_table() == MagnatuneService::kSongsTable)
+    InsertSongItems<MagnatunePlaylistItem>(songs, pos, play_now, enqueue);
+  else if (backend && backend->songs_table() == JamendoService::kSongsTable)
+    InsertSongItems<JamendoPlaylistItem>(songs, pos, play_now, enqueue);
+  else
+    InsertSongItems<SongPlaylistItem>(songs, pos, play_now, enqueue);
+}
+
 void Playlist::InsertInternetItems(const InternetModel* model,
                                    const QModelIndexList& items, int pos,
                                    bool play_now, bool enqueue) {
@@ -1142,52 +1155,56 @@ void Playlist::InsertInternetItems(InternetService* service,
 
 void Playlist::UpdateItems(const SongList& songs) {
   qLog(Debug) << "Updating playlist with new tracks' info";
-  // We first convert our songs list into a linked list (a 'real' list),
-  // because removals are faster with QLinkedList.
-  // Next, we walk through the list of playlist's items then the list of songs
-  // we want to update: if an item corresponds to the song (we rely on URL for
-  // this), we update the item with the new metadata, then we remove song from
-  // our list because we will not need to check it again.
-  // And we also update undo actions.
-  QLinkedList<Song> songs_list;
-  for (const Song& song : songs) songs_list.append(song);
-
-  for (int i = 0; i < items_.size(); i++) {
-    // Update current items list
-    QMutableLinkedListIterator<Song> it(songs_list);
-    while (it.hasNext()) {
-      const Song& song = it.next();
-      PlaylistItemPtr& item = items_[i];
-      if (item->Metadata().url() == song.url() &&
-          (item->Metadata().filetype() == Song::Type_Unknown ||
+  // For each song we look up the playlist items with the same URL, and
+  // replace the first one that needs updating with a new item containing the
+  // new metadata.  The replaced items are collected so the undo actions can be
+  // updated in one pass afterwards.
+  QHash<QUrl, PlaylistItemPtr> updated_items;
+
+  for (const Song& song : songs) {
+    int row = -1;
+    for (const PlaylistItemPtr& item : items_by_url_.values(song.url())) {
+      const Song metadata = item->Metadata();
+      if (metadata.url() == song.url() &&
+          (metadata.filetype() == Song::Type_Unknown ||
            // Stream may change and may need to be updated too
-           item->Metadata().filetype() == Song::Type_Stream ||
+           metadata.filetype() == Song::Type_Stream ||
            // And CD tracks as well (tags are loaded in a second step)
-           item->Metadata().filetype() == Song::Type_Cdda)) {
-        PlaylistItemPtr new_item;
-        if (song.is_library_song()) {
-          new_item = PlaylistItemPtr(new LibraryPlaylistItem(song));
-          library_items_by_id_.insertMulti(song.id(), new_item);
-        } else {
-          new_item = PlaylistItemPtr(new SongPlaylistItem(song));
-        }
-        items_[i] = new_item;
-        emit dataChanged(index(i, 0), index(i, ColumnCount - 1));
-        // Also update undo actions
-        for (int i = 0; i < undo_stack_->count(); i++) {
-          QUndoCommand* undo_action =
-              const_cast<QUndoCommand*>(undo_stack_->command(i));
-          PlaylistUndoCommands::InsertItems* undo_action_insert =
-              dynamic_cast<PlaylistUndoCommands::InsertItems*>(undo_action);
-          if (undo_action_insert) {
-            bool found_and_updated = undo_action_insert->UpdateItem(new_item);
-            if (found_and_updated) break;
-          }
-        }
-        it.remove();
-        break;
+           metadata.filetype() == Song::Type_Cdda)) {
+        const int item_row = RowOfItem(item);
+        if (item_row != -1 && (row == -1 || item_row < row)) row = item_row;
       }
     }
+    if (row == -1) continue;
+
+    PlaylistItemPtr new_item;
+    if (song.is_library_song()) {
+      new_item = PlaylistItemPtr(new LibraryPlaylistItem(song));
+    } else {
+      new_item = PlaylistItemPtr(new SongPlaylistItem(song));
+    }
+
+    UnindexItem(items_[row]);
+    rows_by_item_.remove(items_[row].get());
+    items_[row] = new_item;
+    rows_by_item_[new_item.get()] = row;
+    IndexItem(new_item);
+
+    if (!updated_items.contains(song.url())) {
+      updated_items[song.url()] = new_item;
+    }
+    emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+  }
+
+  // Also update undo actions
+  for (int i = 0; i < undo_stack_->count() && !updated_items.isEmpty(); i++) {
+    QUndoCommand* undo_action =
+        const_cast<QUndoCommand*>(undo_stack_->command(i));
+    PlaylistUndoCommands::InsertItems* undo_action_insert =
+        dynamic_cast<PlaylistUndoCommands::InsertItems*>(undo_action);
+    if (undo_action_insert) {
+      undo_action_insert->UpdateItems(&updated_items);
+    }
   }
   Save();
 }
@@ -1424,6 +1441,7 @@ void Playlist::ReOrderWithoutUndo(const PlaylistItemList& new_items) {
 
   PlaylistItemList old_items = items_;
   items_ = new_items;
+  rows_by_item_dirty_ = true;
 
   QMap<const PlaylistItem*, int> new_rows;
   for (int i = 0; i < new_items.length(); ++i) {
@@ -1461,23 +1479,57 @@ void Playlist::SetCurrentIsPaused(bool paused) {
 void Playlist::Save() const {
   if (!backend_ || is_loading_) return;
 
+  if (!is_restored_) {
+    // Don't overwrite the saved playlist with just the items we have so far.
+    if (restore_started_) save_after_restore_ = true;
+    return;
+  }
+
   backend_->SavePlaylistAsync(id_, items_, last_played_row(),
                               dynamic_playlist_);
 }
 
 namespace {
 typedef QFutureWatcher<QList<PlaylistItemPtr>> PlaylistItemFutureWatcher;
+
+QList<PlaylistItemPtr> GetPlaylistItemsAtIdlePriority(PlaylistBackend* backend,
+                                                      int playlist) {
+  QThread* thread = QThread::currentThread();
+  const QThread::Priority old_priority = thread->priority();
+  thread->setPriority(QThread::IdlePriority);
+
+  QList<PlaylistItemPtr> ret = backend->GetPlaylistItems(playlist);
+
+  thread->setPriority(old_priority == QThread::InheritPriority
+                          ? QThread::NormalPriority
+                          : old_priority);
+  return ret;
+}
+
+// The library of an internet service, or nullptr if the service isn't
+// available.
+template <typename T>
+LibraryBackend* ServiceLibraryBackend() {
+  T* service = InternetModel::Service<T>();
+  return service ? service->library_backend() : nullptr;
 }
+}  // namespace
 
-void Playlist::Restore() {
-  if (!backend_) return;
+void Playlist::Restore(bool background) {
+  if (!backend_ || restore_started_) return;
+  restore_started_ = true;
 
   items_.clear();
   virtual_items_.clear();
   library_items_by_id_.clear();
+  items_by_url_.clear();
+  rows_by_item_dirty_ = true;
 
   QFuture<QList<PlaylistItemPtr>> future =
-      QtConcurrent::run(backend_, &PlaylistBackend::GetPlaylistItems, id_);
+      background
+          ? QtConcurrent::run(&GetPlaylistItemsAtIdlePriority, backend_, id_)
+          : QtConcurrent::run(backend_, &PlaylistBackend::GetPlaylistItems,
+                              id_);
   PlaylistItemFutureWatcher* watcher = new PlaylistItemFutureWatcher(this);
   watcher->setFuture(future);
   connect(watcher, SIGNAL(finished()), SLOT(ItemsLoaded()));
@@ -1504,6 +1556,7 @@ void Playlist::ItemsLoaded() {
   is_loading_ = true;
   InsertItems(items, 0);
   is_loading_ = false;
+  is_restored_ = true;
 
   PlaylistBackend::Playlist p = backend_->GetPlaylist(id_);
 
@@ -1521,9 +1574,9 @@ void Playlist::ItemsLoaded() {
       if (p.dynamic_backend == library_->songs_table())
         backend = library_;
       else if (p.dynamic_backend == MagnatuneService::kSongsTable)
-        backend = InternetModel::Service<MagnatuneService>()->library_backend();
+        backend = ServiceLibraryBackend<MagnatuneService>();
       else if (p.dynamic_backend == JamendoService::kSongsTable)
-        backend = InternetModel::Service<JamendoService>()->library_backend();
+        backend = ServiceLibraryBackend<JamendoService>();
 
       if (backend) {
         gen->set_library(backend);
@@ -1535,12 +1588,17 @@ void Playlist::ItemsLoaded() {
 
   emit RestoreFinished();
 
+  if (save_after_restore_) {
+    save_after_restore_ = false;
+    Save();
+  }
+
   QSettings s;
   s.beginGroup(kSettingsGroup);
 
   // should we gray out deleted songs asynchronously on startup?
   if (s.value("greyoutdeleted", false).toBool()) {
-    QtConcurrent::run(this, &Playlist::InvalidateDeletedSongs);
+    InvalidateDeletedSongs();
   }
 }
 
@@ -1624,14 +1682,9 @@ PlaylistItemList Playlist::RemoveItemsWithoutUndo(int row, int count) {
   for (int i = 0; i < count; ++i) {
     PlaylistItemPtr item(items_.takeAt(row));
     ret << item;
-
-    if (item->type() == "Library") {
-      int id = item->Metadata().id();
-      if (id != -1) {
-        library_items_by_id_.remove(id, item);
-      }
-    }
+    UnindexItem(item);
   }
+  rows_by_item_dirty_ = true;
 
   endRemoveRows();
 
@@ -1831,7 +1884,10 @@ void Playlist::ReloadItems(const QList<int>& rows) {
   for (int row : rows) {
     PlaylistItemPtr item = item_at(row);
 
+    // Reloading might change the item's URL or library ID
+    UnindexItem(item);
     item->Reload();
+    IndexItem(item);
 
     if (row == current_row()) {
       InformOfCurrentSongChange();
@@ -2021,6 +2077,40 @@ PlaylistItemList Playlist::library_items_by_id(int id) const {
   return library_items_by_id_.values(id);
 }
 
+void Playlist::IndexItem(const PlaylistItemPtr& item) {
+  items_by_url_.insertMulti(item->Url(), item);
+
+  if (item->type() == "Library") {
+    int id = item->Metadata().id();
+    if (id != -1) {
+      library_items_by_id_.insertMulti(id, item);
+    }
+  }
+}
+
+void Playlist::UnindexItem(const PlaylistItemPtr& item) {
+  items_by_url_.remove(item->Url(), item);
+
+  if (item->type() == "Library") {
+    int id = item->Metadata().id();
+    if (id != -1) {
+      library_items_by_id_.remove(id, item);
+    }
+  }
+}
+
+int Playlist::RowOfItem(const PlaylistItemPtr& item) const {
+  if (rows_by_item_dirty_) {
+    rows_by_item_.clear();
+    rows_by_item_.reserve(items_.count());
+    for (int row = 0; row < items_.count(); ++row) {
+      rows_by_item_[items_[row].get()] = row;
+    }
+    rows_by_item_dirty_ = false;
+  }
+  return rows_by_item_.value(item.get(), -1);
+}
+
 void Playlist::TracksAboutToBeDequeued(const QModelIndex&, int begin, int end) {
   for (int i = begin; i <= end; ++i) {
     temp_dequeue_change_indexes_
@@ -2052,14 +2142,21 @@ void Playlist::QueueLayoutChanged() {
 }
 
 void Playlist::ItemChanged(PlaylistItemPtr item) {
-  for (int row = 0; row < items_.count(); ++row) {
-    if (items_[row] == item) {
-      emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
-      return;
-    }
+  const int row = RowOfItem(item);
+  if (row != -1) {
+    emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
   }
 }
 
+void Playlist::UpdateLibraryItem(PlaylistItemPtr item, const Song& song) {
+  // The new metadata might have a different URL or library ID
+  UnindexItem(item);
+  static_cast<LibraryPlaylistItem*>(item.get())->SetMetadata(song);
+  IndexItem(item);
+
+  ItemChanged(item);
+}
+
 void Playlist::InformOfCurrentSongChange() {
   emit dataChanged(index(current_item_index_.row(), 0),
                    index(current_item_index_.row(), ColumnCount - 1));
@@ -2072,43 +2169,82 @@ void Playlist::InformOfCurrentSongChange() {
   }
 }
 
-void Playlist::InvalidateDeletedSongs() {
-  QList<int> invalidated_rows;
+QStringList Playlist::LocalFilenames() const {
+  QStringList ret;
+  for (const QUrl& url : items_by_url_.uniqueKeys()) {
+    if (url.scheme() == "file") ret << url.toLocalFile();
+  }
+  return ret;
+}
 
-  for (int row = 0; row < items_.count(); ++row) {
-    PlaylistItemPtr item = items_[row];
-    Song song = item->Metadata();
+PlaylistItemList Playlist::LocalFileItems(const QString& filename) const {
+  PlaylistItemList ret;
+  for (const PlaylistItemPtr& item :
+       items_by_url_.values(QUrl::fromLocalFile(filename))) {
+    if (!item->Metadata().is_stream()) ret << item;
+  }
+  return ret;
+}
+
+void Playlist::InvalidateDeletedSongs() {
+  FileExistenceChecker* checker =
+      FileExistenceChecker::Check(LocalFilenames(), this);
+  connect(checker, SIGNAL(FilesChecked(QStringList, QStringList)),
+          SLOT(DeletedSongsChecked(QStringList, QStringList)));
+  NewClosure(checker, SIGNAL(Finished()), [this]() { Save(); });
+}
 
-    if (!song.is_stream()) {
-      bool exists = QFile::exists(song.url().toLocalFile());
+void Playlist::DeletedSongsChecked(const QStringList& existing,
+                                   const QStringList& missing) {
+  QList<int> invalidated_rows;
 
-      if (!exists && !item->HasForegroundColor(kInvalidSongPriority)) {
-        // gray out the song if it's not there
+  for (const QString& filename : missing) {
+    for (const PlaylistItemPtr& item : LocalFileItems(filename)) {
+      // gray out the song if it's not there
+      if (!item->HasForegroundColor(kInvalidSongPriority)) {
         item->SetForegroundColor(kInvalidSongPriority, kInvalidSongColor);
-        invalidated_rows.append(row);
-      } else if (exists && item->HasForegroundColor(kInvalidSongPriority)) {
-        item->RemoveForegroundColor(kInvalidSongPriority);
-        invalidated_rows.append(row);
+        invalidated_rows << RowOfItem(item);
       }
     }
   }
 
-  ReloadItems(invalidated_rows);
-}
+  for (const QString& filename : existing) {
+    for (const PlaylistItemPtr& item : LocalFileItems(filename)) {
+      if (item->HasForegroundColor(kInvalidSongPriority)) {
+        item->RemoveForegroundColor(kInvalidSongPriority);
+        invalidated_rows << RowOfItem(item);
+      }
+    }
+  }
 
-void Playlist::RemoveDeletedSongs() {
-  QList<int> rows_to_remove;
+  // The playlist is saved once every file has been checked
+  for (int row : invalidated_rows) {
+    PlaylistItemPtr item = item_at(row);
 
-  for (int row = 0; row < items_.count(); ++row) {
-    PlaylistItemPtr item = items_[row];
-    Song song = item->Metadata();
+    UnindexItem(item);
+    item->Reload();
+    IndexItem(item);
 
-    if (!song.is_stream() && !QFile::exists(song.url().toLocalFile())) {
-      rows_to_remove.append(row);
+    if (row == current_row()) {
+      InformOfCurrentSongChange();
+    } else {
+      emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
     }
   }
+}
 
-  removeRows(rows_to_remove);
+void Playlist::RemoveDeletedSongs() {
+  FileExistenceChecker* checker =
+      FileExistenceChecker::Check(LocalFilenames(), this);
+  NewClosure(checker, SIGNAL(Finished()), [this, checker]() {
+    QList<int> rows_to_remove;
+    for (const QString& filename : checker->missing()) {
+      for (const PlaylistItemPtr& item : LocalFileItems(filename)) {
+        rows_to_remove << RowOfItem(item);
+      }
+    }
+    removeRows(rows_to_remove);
+  });
 }
 
 struct SongSimilarHash {
@@ -19,15 +19,18 @@
 #define PLAYLIST_H
 
 #include <QAbstractItemModel>
+#include <QHash>
 #include <QList>
 
 #include "playlistitem.h"
 #include "playlistsequence.h"
+#include "core/qhash_qurl.h"
 #include "core/tagreaderclient.h"
 #include "core/song.h"
 #include "smartplaylists/generator_fwd.h"
 
 class LibraryBackend;
+class LibraryBackendInterface;
 class PlaylistBackend;
 class PlaylistFilter;
 class Queue;
@@ -176,7 +179,13 @@ class Playlist : public QAbstractListModel {
 
   // Persistence
   void Save() const;
-  void Restore();
+  // Loads the playlist's items from the database asynchronously.  Playlists
+  // don't do this themselves - PlaylistManager only restores the ones that
+  // are visible straight away, and restores the rest in the background.  If
+  // background is true the items are loaded at idle priority.
+  void Restore(bool background = false);
+  bool restore_started() const { return restore_started_; }
+  bool is_restored() const { return is_restored_; }
 
   // Accessors
   QSortFilterProxyModel* proxy() const;
@@ -242,6 +251,12 @@ class Playlist : public QAbstractListModel {
                    bool enqueue = false);
   void InsertSongsOrLibraryItems(const SongList& items, int pos = -1,
                                  bool play_now = false, bool enqueue = false);
+  // Inserts songs that were read from a library backend, with the right kind
+  // of PlaylistItem for that backend.
+  void InsertSongsFromBackend(const SongList& songs,
+                              const LibraryBackendInterface* backend,
+                              int pos = -1, bool play_now = false,
+                              bool enqueue = false);
   void InsertSmartPlaylist(smart_playlists::GeneratorPtr gen, int pos = -1,
                            bool play_now = false, bool enqueue = false);
   void InsertInternetItems(InternetService* service, const SongList& songs,
@@ -264,8 +279,11 @@ class Playlist : public QAbstractListModel {
   // Grays out and reloads all deleted songs in all playlists. Also, "ungreys"
   // those songs
   // which were once deleted but now got restored somehow.
+  // The files are checked asynchronously and rows are updated as the results
+  // arrive.
   void InvalidateDeletedSongs();
-  // Removes from the playlist all local files that don't exist anymore.
+  // Removes from the playlist all local files that don't exist anymore, once
+  // every file has been checked.
   void RemoveDeletedSongs();
 
   void StopAfter(int row);
@@ -317,6 +335,9 @@ class Playlist : public QAbstractListModel {
   void SetStreamMetadata(const QUrl& url, const Song& song);
   void ItemChanged(PlaylistItemPtr item);
   void UpdateItems(const SongList& songs);
+  // Replaces the metadata of a library item in place, keeping the URL and
+  // library ID indexes up to date.
+  void UpdateLibraryItem(PlaylistItemPtr item, const Song& song);
 
   void Clear();
   void RemoveDuplicateSongs();
@@ -386,6 +407,18 @@ signals:
   // Removes rows with given indices from this playlist.
   bool removeRows(QList<int>& rows);
 
+  // Add or remove an item from items_by_url_ and library_items_by_id_.
+  void IndexItem(const PlaylistItemPtr& item);
+  void UnindexItem(const PlaylistItemPtr& item);
+  // Returns the row of the given item, or -1 if it's not in the playlist.
+  // The row index is rebuilt lazily after the playlist's layout changes.
+  int RowOfItem(const PlaylistItemPtr& item) const;
+
+  // Returns the distinct filenames of all the local files in the playlist.
+  QStringList LocalFilenames() const;
+  // Returns the items (that aren't streams) for the given local file.
+  PlaylistItemList LocalFileItems(const QString& filename) const;
+
  private slots:
   void TracksAboutToBeDequeued(const QModelIndex&, int begin, int end);
   void TracksDequeued();
@@ -396,9 +429,15 @@ signals:
   void ItemReloadComplete();
   void ItemsLoaded();
   void SongInsertVetoListenerDestroyed();
+  void DeletedSongsChecked(const QStringList& existing,
+                           const QStringList& missing);
 
  private:
   bool is_loading_;
+  bool restore_started_;
+  bool is_restored_;
+  // Set if the playlist was changed while it was being restored.
+  mutable bool save_after_restore_;
   PlaylistFilter* proxy_;
   Queue* queue_;
 
@@ -416,7 +455,14 @@ signals:
                               // that they will be played.
   // A map of library ID to playlist item - for fast lookups when library
   // items change.
-  QMultiMap<int, PlaylistItemPtr> library_items_by_id_;
+  QMultiHash<int, PlaylistItemPtr> library_items_by_id_;
+  // A map of URL to playlist item - for fast lookups when metadata for a URL
+  // arrives.
+  QMultiHash<QUrl, PlaylistItemPtr> items_by_url_;
+  // Rows of the items in items_.  Marked dirty whenever items are inserted,
+  // removed or moved.
+  mutable QHash<const PlaylistItem*, int> rows_by_item_;
+  mutable bool rows_by_item_dirty_;
 
   QPersistentModelIndex current_item_index_;
   QPersistentModelIndex last_played_item_index_;
@@ -31,6 +31,7 @@
 #include "core/logging.h"
 #include "core/scopedtransaction.h"
 #include "core/song.h"
+#include "core/tracing.h"
 #include "library/librarybackend.h"
 #include "library/sqlrow.h"
 #include "playlist/songplaylistitem.h"
@@ -47,6 +48,9 @@ const int PlaylistBackend::kSongTableJoins = 4;
 PlaylistBackend::PlaylistBackend(Application* app, QObject* parent)
     : QObject(parent), app_(app), db_(app_->database()) {}
 
+PlaylistBackend::PlaylistBackend(Database* db, QObject* parent)
+    : QObject(parent), app_(nullptr), db_(db) {}
+
 PlaylistBackend::PlaylistList PlaylistBackend::GetAllPlaylists() {
   return GetPlaylists(GetPlaylists_All);
 }
@@ -78,11 +82,17 @@ PlaylistBackend::PlaylistList PlaylistBackend::GetPlaylists(
     condition = " WHERE " + condition_list.join(" OR ");
   }
 
+  // Count the items in one pass over the playlist index rather than loading
+  // them, so playlists that aren't restored yet still know their size.
   QSqlQuery q(
-      "SELECT ROWID, name, last_played, dynamic_playlist_type,"
+      "SELECT playlists.ROWID, name, last_played, dynamic_playlist_type,"
       "       dynamic_playlist_data, dynamic_playlist_backend,"
-      "       special_type, ui_path, is_favorite"
+      "       special_type, ui_path, is_favorite,"
+      "       COALESCE(counts.item_count, 0)"
       " FROM playlists"
+      " LEFT JOIN (SELECT playlist, COUNT(*) AS item_count"
+      "            FROM playlist_items GROUP BY playlist) AS counts"
+      "   ON counts.playlist = playlists.ROWID"
       " " +
           condition + " ORDER BY ui_order",
       db);
@@ -100,6 +110,7 @@ PlaylistBackend::PlaylistList PlaylistBackend::GetPlaylists(
     p.special_type = q.value(6).toString();
     p.ui_path = q.value(7).toString();
     p.favorite = q.value(8).toBool();
+    p.item_count = q.value(9).toInt();
     ret << p;
   }
 
@@ -229,7 +240,7 @@ PlaylistItemPtr PlaylistBackend::RestoreCueData(
     PlaylistItemPtr item, std::shared_ptr<NewSongFromQueryState> state) {
   // we need library to run a CueParser; also, this method applies only to
   // file-type PlaylistItems
-  if (item->type() != "File") {
+  if (item->type() != "File" || !app_) {
     return item;
   }
   CueParser cue_parser(app_->library_backend());
@@ -288,6 +299,7 @@ void PlaylistBackend::SavePlaylistAsync(int playlist,
 
 void PlaylistBackend::SavePlaylist(int playlist, const PlaylistItemList& items,
                                    int last_played, GeneratorPtr dynamic) {
+  TRACE_SPAN_CATEGORY("PlaylistBackend::SavePlaylist", "database");
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
@@ -34,9 +34,12 @@ class PlaylistBackend : public QObject {
 
  public:
   Q_INVOKABLE PlaylistBackend(Application* app, QObject* parent = nullptr);
+  // Uses the given database without an Application.  Songs from CUE sheets
+  // keep the metadata saved in the playlist instead of being re-read.
+  explicit PlaylistBackend(Database* db, QObject* parent = nullptr);
 
   struct Playlist {
-    Playlist() : id(-1), favorite(false), last_played(0) {}
+    Playlist() : id(-1), favorite(false), last_played(0), item_count(0) {}
 
     int id;
     QString name;
@@ -50,6 +53,10 @@ class PlaylistBackend : public QObject {
     // Special playlists have different behaviour, eg. the "spotify-search"
     // type has a spotify search box at the top, replacing the ordinary filter.
     QString special_type;
+
+    // The number of items saved in the playlist.  Only filled in by the
+    // GetAll*Playlists functions.
+    int item_count;
   };
   typedef QList<Playlist> PlaylistList;
 
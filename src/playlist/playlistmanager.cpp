@@ -26,7 +26,6 @@
 #include "core/songloader.h"
 #include "core/utilities.h"
 #include "library/librarybackend.h"
-#include "library/libraryplaylistitem.h"
 #include "playlistparsers/playlistparser.h"
 #include "smartplaylists/generator.h"
 
@@ -35,6 +34,7 @@
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QMessageBox>
+#include <QTimer>
 #include <QtConcurrentRun>
 #include <QtDebug>
 
@@ -49,7 +49,8 @@ PlaylistManager::PlaylistManager(Application* app, QObject* parent)
       parser_(nullptr),
       playlist_container_(nullptr),
       current_(-1),
-      active_(-1) {
+      active_(-1),
+      background_restore_id_(-1) {
   connect(app_->player(), SIGNAL(Paused()), SLOT(SetActivePaused()));
   connect(app_->player(), SIGNAL(Playing()), SLOT(SetActivePlaying()));
   connect(app_->player(), SIGNAL(Stopped()), SLOT(SetActiveStopped()));
@@ -78,9 +79,13 @@ void PlaylistManager::Init(LibraryBackend* library_backend,
   connect(library_backend_, SIGNAL(SongsRatingChanged(SongList)),
           SLOT(SongsDiscovered(SongList)));
 
+  // Only the current and active playlists are restored straight away - the
+  // others are restored one by one in the background after them.
   for (const PlaylistBackend::Playlist& p :
        playlist_backend->GetAllOpenPlaylists()) {
-    AddPlaylist(p.id, p.name, p.special_type, p.ui_path, p.favorite);
+    AddPlaylist(p.id, p.name, p.special_type, p.ui_path, p.favorite,
+                p.item_count);
+    restore_queue_ << p.id;
   }
 
   // If no playlist exists then make a new one
@@ -106,7 +111,8 @@ QItemSelection PlaylistManager::selection(int id) const {
 
 Playlist* PlaylistManager::AddPlaylist(int id, const QString& name,
                                        const QString& special_type,
-                                       const QString& ui_path, bool favorite) {
+                                       const QString& ui_path, bool favorite,
+                                       int item_count) {
   Playlist* ret = new Playlist(playlist_backend_, app_->task_manager(),
                                library_backend_, id, special_type, favorite);
   ret->set_sequence(sequence_);
@@ -121,11 +127,13 @@ Playlist* PlaylistManager::AddPlaylist(int id, const QString& name,
   connect(ret, SIGNAL(LoadTracksError(QString)), SIGNAL(Error(QString)));
   connect(ret, SIGNAL(PlayRequested(QModelIndex)),
           SIGNAL(PlayRequested(QModelIndex)));
+  connect(ret, SIGNAL(RestoreFinished()), SLOT(PlaylistRestored()));
+  connect(ret, SIGNAL(RestoreFinished()), SLOT(UpdateSummaryText()));
   connect(playlist_container_->view(),
           SIGNAL(ColumnAlignmentChanged(ColumnAlignmentMap)), ret,
           SLOT(SetColumnAlignment(ColumnAlignmentMap)));
 
-  playlists_[id] = Data(ret, name);
+  playlists_[id] = Data(ret, name, item_count);
 
   emit PlaylistAdded(id, name, favorite);
 
@@ -177,7 +185,7 @@ void PlaylistManager::Load(const QString& filename) {
 
 void PlaylistManager::Save(int id, const QString& filename,
                            Playlist::Path path_type) {
-  if (playlists_.contains(id)) {
+  if (playlists_.contains(id) && playlist(id)->is_restored()) {
     parser_->Save(playlist(id)->GetAllSongs(), filename, path_type);
   } else {
     // Playlist is not in the playlist manager: probably save action was
@@ -297,6 +305,11 @@ bool PlaylistManager::Close(int id) {
   if (id == active_) SetActivePlaylist(next_id);
   if (id == current_) SetCurrentPlaylist(next_id);
 
+  if (id == background_restore_id_) {
+    background_restore_id_ = -1;
+    QTimer::singleShot(0, this, SLOT(RestoreNextPlaylist()));
+  }
+
   Data data = playlists_.take(id);
   emit PlaylistClosed(id);
 
@@ -325,6 +338,7 @@ void PlaylistManager::OneOfPlaylistsChanged() {
 void PlaylistManager::SetCurrentPlaylist(int id) {
   Q_ASSERT(playlists_.contains(id));
   current_ = id;
+  current()->Restore();
   emit CurrentChanged(current());
   UpdateSummaryText();
 }
@@ -337,6 +351,7 @@ void PlaylistManager::SetActivePlaylist(int id) {
   if (active_ != -1 && active_ != id) active()->set_current_row(-1);
 
   active_ = id;
+  active()->Restore();
   emit ActiveChanged(active());
 
   sequence_->SetUsingDynamicPlaylist(active()->is_dynamic());
@@ -388,7 +403,7 @@ void PlaylistManager::ChangePlaylistOrder(const QList<int>& ids) {
 }
 
 void PlaylistManager::UpdateSummaryText() {
-  int tracks = current()->rowCount();
+  int tracks = GetPlaylistItemCount(current_id());
   quint64 nanoseconds = 0;
   int selected = 0;
 
@@ -420,6 +435,32 @@ void PlaylistManager::UpdateSummaryText() {
   emit SummaryTextChanged(summary);
 }
 
+void PlaylistManager::PlaylistRestored() {
+  Playlist* playlist = qobject_cast<Playlist*>(sender());
+  if (playlist && playlist->id() == background_restore_id_) {
+    background_restore_id_ = -1;
+  }
+
+  // Let the event loop catch up before starting on the next one.
+  QTimer::singleShot(0, this, SLOT(RestoreNextPlaylist()));
+}
+
+void PlaylistManager::RestoreNextPlaylist() {
+  if (background_restore_id_ != -1) return;
+
+  while (!restore_queue_.isEmpty()) {
+    const int id = restore_queue_.takeFirst();
+    if (!playlists_.contains(id)) continue;
+
+    Playlist* playlist = playlists_[id].p;
+    if (playlist->restore_started()) continue;
+
+    background_restore_id_ = id;
+    playlist->Restore(true);
+    return;
+  }
+}
+
 void PlaylistManager::SelectionChanged(const QItemSelection& selection) {
   playlists_[current_id()].selection = selection;
   UpdateSummaryText();
@@ -434,8 +475,7 @@ void PlaylistManager::SongsDiscovered(const SongList& songs) {
       PlaylistItemList items = data.p->library_items_by_id(song.id());
       for (PlaylistItemPtr item : items) {
         if (item->Metadata().directory_id() != song.directory_id()) continue;
-        static_cast<LibraryPlaylistItem*>(item.get())->SetMetadata(song);
-        data.p->ItemChanged(item);
+        data.p->UpdateLibraryItem(item, song);
       }
     }
   }
@@ -548,3 +588,10 @@ void PlaylistManager::SetCurrentOrOpen(int id) {
 }
 
 bool PlaylistManager::IsPlaylistOpen(int id) { return playlists_.contains(id); }
+
+int PlaylistManager::GetPlaylistItemCount(int id) const {
+  QMap<int, Data>::const_iterator it = playlists_.find(id);
+  if (it == playlists_.end()) return 0;
+
+  return it->p->is_restored() ? it->p->rowCount() : it->item_count;
+}
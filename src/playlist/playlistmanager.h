@@ -168,6 +168,9 @@ class PlaylistManager : public PlaylistManagerInterface {
   bool IsPlaylistFavorite(int index) const {
     return playlists_[index].p->is_favorite();
   }
+  // Returns the number of songs in the playlist.  This is the number saved in
+  // the database until the playlist has been restored.
+  int GetPlaylistItemCount(int id) const;
 
   void Init(LibraryBackend* library_backend, PlaylistBackend* playlist_backend,
             PlaylistSequence* sequence, PlaylistContainer* playlist_container);
@@ -237,19 +240,25 @@ class PlaylistManager : public PlaylistManagerInterface {
   void ItemsLoadedForSavePlaylist(QFutureWatcher<SongList>* watcher,
                                   const QString& filename,
                                   Playlist::Path path_type);
+  void PlaylistRestored();
+  void RestoreNextPlaylist();
 
  private:
   Playlist* AddPlaylist(int id, const QString& name,
                         const QString& special_type, const QString& ui_path,
-                        bool favorite);
+                        bool favorite, int item_count = 0);
 
  private:
   struct Data {
-    Data(Playlist* _p = nullptr, const QString& _name = QString())
-        : p(_p), name(_name) {}
+    Data(Playlist* _p = nullptr, const QString& _name = QString(),
+         int _item_count = 0)
+        : p(_p), name(_name), item_count(_item_count) {}
     Playlist* p;
     QString name;
     QItemSelection selection;
+    // Number of items saved in the database, used until the playlist has
+    // been restored.
+    int item_count;
   };
 
   Application* app_;
@@ -264,6 +273,11 @@ class PlaylistManager : public PlaylistManagerInterface {
 
   int current_;
   int active_;
+
+  // Playlists that haven't been shown yet are restored one at a time in the
+  // background after startup.
+  QList<int> restore_queue_;
+  int background_restore_id_;
 };
 
 #endif  // PLAYLISTMANAGER_H
@@ -48,6 +48,17 @@ bool InsertItems::UpdateItem(const PlaylistItemPtr& updated_item) {
   return false;
 }
 
+void InsertItems::UpdateItems(QHash<QUrl, PlaylistItemPtr>* updated_items) {
+  for (int i = 0; i < items_.size() && !updated_items->isEmpty(); i++) {
+    QHash<QUrl, PlaylistItemPtr>::iterator it =
+        updated_items->find(items_[i]->Metadata().url());
+    if (it != updated_items->end()) {
+      items_[i] = it.value();
+      updated_items->erase(it);
+    }
+  }
+}
+
 RemoveItems::RemoveItems(Playlist* playlist, int pos, int count)
     : Base(playlist) {
   setText(tr("remove %n songs", "", count));
@@ -20,8 +20,10 @@
 
 #include <QUndoCommand>
 #include <QCoreApplication>
+#include <QHash>
 
 #include "playlistitem.h"
+#include "core/qhash_qurl.h"
 
 class Playlist;
 
@@ -51,6 +53,9 @@ class InsertItems : public Base {
   // new (completely loaded) one.
   // return true if the was found (and updated), false otherwise
   bool UpdateItem(const PlaylistItemPtr& updated_item);
+  // Like UpdateItem, but for many items at once.  Items that were found are
+  // removed from updated_items.
+  void UpdateItems(QHash<QUrl, PlaylistItemPtr>* updated_items);
 
  private:
   PlaylistItemList items_;
@@ -23,24 +23,33 @@
 
 const char* Queue::kRowsMimetype = "application/x-clementine-queue-rows";
 
-Queue::Queue(QObject* parent) : QAbstractProxyModel(parent) {}
+Queue::Queue(QObject* parent)
+    : QAbstractProxyModel(parent), row_positions_valid_(true) {}
+
+const QHash<int, int>& Queue::RowPositions() const {
+  if (!row_positions_valid_) {
+    row_positions_.clear();
+    row_positions_.reserve(source_indexes_.count());
+    for (int i = 0; i < source_indexes_.count(); ++i) {
+      row_positions_.insert(source_indexes_[i].row(), i);
+    }
+    row_positions_valid_ = true;
+  }
+  return row_positions_;
+}
+
+void Queue::InvalidateRowPositions() { row_positions_valid_ = false; }
 
 QModelIndex Queue::mapFromSource(const QModelIndex& source_index) const {
   if (!source_index.isValid()) return QModelIndex();
 
-  const int source_row = source_index.row();
-  for (int i = 0; i < source_indexes_.count(); ++i) {
-    if (source_indexes_[i].row() == source_row)
-      return index(i, source_index.column());
-  }
-  return QModelIndex();
+  const int position = RowPositions().value(source_index.row(), -1);
+  if (position == -1) return QModelIndex();
+  return index(position, source_index.column());
 }
 
 bool Queue::ContainsSourceRow(int source_row) const {
-  for (int i = 0; i < source_indexes_.count(); ++i) {
-    if (source_indexes_[i].row() == source_row) return true;
-  }
-  return false;
+  return RowPositions().contains(source_row);
 }
 
 QModelIndex Queue::mapToSource(const QModelIndex& proxy_index) const {
@@ -57,6 +66,10 @@ void Queue::setSourceModel(QAbstractItemModel* source_model) {
                SLOT(SourceLayoutChanged()));
     disconnect(sourceModel(), SIGNAL(layoutChanged()), this,
                SLOT(SourceLayoutChanged()));
+    disconnect(sourceModel(), SIGNAL(rowsInserted(QModelIndex, int, int)),
+               this, SLOT(InvalidateRowPositions()));
+    disconnect(sourceModel(), SIGNAL(modelReset()), this,
+               SLOT(InvalidateRowPositions()));
   }
 
   QAbstractProxyModel::setSourceModel(source_model);
@@ -67,6 +80,12 @@ void Queue::setSourceModel(QAbstractItemModel* source_model) {
           SLOT(SourceLayoutChanged()));
   connect(sourceModel(), SIGNAL(layoutChanged()), this,
           SLOT(SourceLayoutChanged()));
+  connect(sourceModel(), SIGNAL(rowsInserted(QModelIndex, int, int)), this,
+          SLOT(InvalidateRowPositions()));
+  connect(sourceModel(), SIGNAL(modelReset()), this,
+          SLOT(InvalidateRowPositions()));
+
+  InvalidateRowPositions();
 }
 
 void Queue::SourceDataChanged(const QModelIndex& top_left,
@@ -80,10 +99,14 @@ void Queue::SourceDataChanged(const QModelIndex& top_left,
 }
 
 void Queue::SourceLayoutChanged() {
+  // The queued items have probably changed rows.
+  InvalidateRowPositions();
+
   for (int i = 0; i < source_indexes_.count(); ++i) {
     if (!source_indexes_[i].isValid()) {
       beginRemoveRows(QModelIndex(), i, i);
       source_indexes_.removeAt(i);
+      InvalidateRowPositions();
       endRemoveRows();
 
       --i;
@@ -140,12 +163,17 @@ void Queue::ToggleTracks(const QModelIndexList& source_indexes) {
       const int row = proxy_index.row();
       beginRemoveRows(QModelIndex(), row, row);
       source_indexes_.removeAt(row);
+      InvalidateRowPositions();
       endRemoveRows();
     } else {
-      // Enqueue the track
+      // Enqueue the track.  Nothing else moves, so the row positions can be
+      // kept up to date.
       const int row = source_indexes_.count();
       beginInsertRows(QModelIndex(), row, row);
       source_indexes_ << QPersistentModelIndex(source_index);
+      if (row_positions_valid_) {
+        row_positions_.insert(source_index.row(), row);
+      }
       endInsertRows();
     }
   }
@@ -162,6 +190,7 @@ void Queue::Clear() {
 
   beginRemoveRows(QModelIndex(), 0, source_indexes_.count() - 1);
   source_indexes_.clear();
+  InvalidateRowPositions();
   endRemoveRows();
 }
 
@@ -183,6 +212,7 @@ void Queue::Move(const QList<int>& proxy_rows, int pos) {
   for (int i = start; i < start + moved_items.count(); ++i) {
     source_indexes_.insert(i, moved_items[i - start]);
   }
+  InvalidateRowPositions();
 
   // Update persistent indexes
   for (const QModelIndex& pidx : persistentIndexList()) {
@@ -280,6 +310,7 @@ bool Queue::dropMimeData(const QMimeData* data, Qt::DropAction action, int row,
       for (int i = 0; i < source_indexes.count(); ++i) {
         source_indexes_.insert(insert_point + i, source_indexes[i]);
       }
+      InvalidateRowPositions();
       endInsertRows();
     }
   }
@@ -308,6 +339,7 @@ int Queue::TakeNext() {
 
   beginRemoveRows(QModelIndex(), 0, 0);
   int ret = source_indexes_.takeFirst().row();
+  InvalidateRowPositions();
   endRemoveRows();
 
   return ret;
@@ -331,6 +363,7 @@ void Queue::Remove(QList<int>& proxy_rows) {
     const int real_row = row - removed_rows;
     beginRemoveRows(QModelIndex(), real_row, real_row);
     source_indexes_.removeAt(real_row);
+    InvalidateRowPositions();
     endRemoveRows();
     removed_rows++;
   }
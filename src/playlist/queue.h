@@ -21,6 +21,7 @@
 #include "playlist.h"
 
 #include <QAbstractProxyModel>
+#include <QHash>
 
 class Queue : public QAbstractProxyModel {
   Q_OBJECT
@@ -69,9 +70,18 @@ class Queue : public QAbstractProxyModel {
   void SourceDataChanged(const QModelIndex& top_left,
                          const QModelIndex& bottom_right);
   void SourceLayoutChanged();
+  void InvalidateRowPositions();
 
  private:
+  // Returns a map of source rows to their position in the queue.  This is
+  // rebuilt lazily after anything changes the rows of the queued items, so
+  // the playlist can look up queue positions of every row it paints cheaply.
+  const QHash<int, int>& RowPositions() const;
+
   QList<QPersistentModelIndex> source_indexes_;
+
+  mutable QHash<int, int> row_positions_;
+  mutable bool row_positions_valid_;
 };
 
 #endif  // QUEUE_H
@@ -0,0 +1,301 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "transcodecache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSettings>
+#include <QStringList>
+#include <QTimerEvent>
+
+#include "core/logging.h"
+#include "core/utilities.h"
+
+const qint64 TranscodeCache::kDefaultMaxSize =
+    Q_INT64_C(2) * 1024 * 1024 * 1024;  // 2GB
+const int TranscodeCache::kProgressInterval = 500;  // msec
+
+TranscodeCache* TranscodeCache::sInstance = nullptr;
+
+TranscodeCache::TranscodeCache(QObject* parent, const QString& cache_dir)
+    : QObject(parent),
+      cache_dir_(cache_dir.isEmpty()
+                     ? Utilities::GetConfigPath(Utilities::Path_TranscodeCache)
+                     : cache_dir),
+      transcoder_(new Transcoder(this)),
+      total_size_(0),
+      max_size_(kDefaultMaxSize) {
+  sInstance = this;
+
+  connect(transcoder_, SIGNAL(JobComplete(QString, QString, bool)),
+          SLOT(JobComplete(QString, QString, bool)));
+
+  LoadExistingFiles();
+}
+
+TranscodeCache::~TranscodeCache() {
+  transcoder_->Cancel();
+
+  // Don't leave half-finished files lying around.
+  for (const QString& filename : jobs_.keys()) {
+    QFile::remove(filename);
+  }
+
+  if (sInstance == this) {
+    sInstance = nullptr;
+  }
+}
+
+void TranscodeCache::LoadExistingFiles() {
+  QDir dir(cache_dir_);
+  if (!dir.exists() && !dir.mkpath(".")) {
+    qLog(Warning) << "Failed to create transcode cache directory" << cache_dir_;
+    return;
+  }
+
+  // Oldest first, so the LRU list starts in roughly the right order.
+  const QFileInfoList files =
+      dir.entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+
+  QMutexLocker l(&mutex_);
+  for (const QFileInfo& info : files) {
+    if (info.suffix() == "part") {
+      // Left over from a transcode that never finished.
+      QFile::remove(info.filePath());
+      continue;
+    }
+
+    Entry entry;
+    entry.state_ = State_Ready;
+    entry.output_ = info.filePath();
+    entry.size_ = info.size();
+
+    const QString key = info.baseName();
+    entries_.insert(key, entry);
+    lru_.append(key);
+    total_size_ += entry.size_;
+  }
+
+  qLog(Debug) << "Transcode cache contains" << entries_.count() << "files,"
+              << total_size_ << "bytes";
+  EvictFiles();
+}
+
+qint64 TranscodeCache::max_size() const {
+  QMutexLocker l(&mutex_);
+  return max_size_;
+}
+
+void TranscodeCache::set_max_size(qint64 bytes) {
+  QMutexLocker l(&mutex_);
+  max_size_ = bytes;
+  EvictFiles();
+}
+
+QString TranscodeCache::KeyFor(const QString& input,
+                               const TranscoderPreset& preset) {
+  const QFileInfo info(input);
+
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  const QString path = info.canonicalFilePath();
+  hash.addData((path.isEmpty() ? input : path).toUtf8());
+  hash.addData(QByteArray::number(info.size()));
+  hash.addData(QByteArray::number(info.lastModified().toTime_t()));
+  hash.addData(preset.codec_mimetype_.toUtf8());
+  hash.addData(preset.muxer_mimetype_.toUtf8());
+  hash.addData(preset.extension_.toUtf8());
+
+  // Changing any of the encoder settings gives a different file.
+  QSettings s;
+  s.beginGroup("Transcoder");
+  QStringList keys = s.allKeys();
+  qSort(keys);
+  for (const QString& key : keys) {
+    hash.addData(key.toUtf8());
+    hash.addData(s.value(key).toString().toUtf8());
+  }
+
+  return hash.result().toHex();
+}
+
+QString TranscodeCache::Request(const QString& input,
+                                const TranscoderPreset& preset) {
+  const QString key = KeyFor(input, preset);
+
+  QMutexLocker l(&mutex_);
+  QHash<QString, Entry>::iterator it = entries_.find(key);
+
+  if (it == entries_.end()) {
+    Entry entry;
+    entry.input_ = input;
+    entry.output_ = cache_dir_ + "/" + key + "." + preset.extension_;
+    entry.preset_ = preset;
+    entry.refs_ = 1;
+    entries_.insert(key, entry);
+
+    // The transcoder has to be used from our own thread.
+    metaObject()->invokeMethod(this, "StartJob", Qt::QueuedConnection,
+                               Q_ARG(QString, key));
+    return key;
+  }
+
+  it->refs_++;
+
+  if (it->state_ == State_Ready) {
+    lru_.removeOne(key);
+    lru_.append(key);
+    metaObject()->invokeMethod(this, "EmitFinished", Qt::QueuedConnection,
+                               Q_ARG(QString, key));
+  }
+
+  // Otherwise it's being transcoded already, and Finished() will be emitted
+  // when that's done.
+  return key;
+}
+
+void TranscodeCache::Release(const QString& key) {
+  QMutexLocker l(&mutex_);
+  QHash<QString, Entry>::iterator it = entries_.find(key);
+  if (it == entries_.end() || it->refs_ == 0) return;
+
+  it->refs_--;
+  if (it->refs_ == 0) {
+    EvictFiles();
+  }
+}
+
+QMap<QString, float> TranscodeCache::GetProgress() const {
+  QMutexLocker l(&mutex_);
+  return progress_;
+}
+
+void TranscodeCache::StartJob(const QString& key) {
+  QString input;
+  QString temporary_output;
+  TranscoderPreset preset;
+
+  {
+    QMutexLocker l(&mutex_);
+    QHash<QString, Entry>::iterator it = entries_.find(key);
+    if (it == entries_.end() || it->state_ != State_Queued) return;
+
+    it->state_ = State_Transcoding;
+    input = it->input_;
+    preset = it->preset_;
+    temporary_output = cache_dir_ + "/" + key + ".part";
+    jobs_[temporary_output] = key;
+  }
+
+  qLog(Debug) << "Transcoding" << input << "into the cache";
+  Transcode(input, preset, temporary_output);
+
+  if (!progress_timer_.isActive()) {
+    progress_timer_.start(kProgressInterval, this);
+  }
+}
+
+void TranscodeCache::Transcode(const QString& input,
+                               const TranscoderPreset& preset,
+                               const QString& output) {
+  transcoder_->AddJob(input, preset, output);
+  transcoder_->Start();
+}
+
+void TranscodeCache::JobComplete(const QString& input, const QString& output,
+                                 bool success) {
+  QString key;
+  QString cached_output;
+
+  {
+    QMutexLocker l(&mutex_);
+    key = jobs_.take(output);
+    progress_.remove(input);
+
+    QHash<QString, Entry>::iterator it = entries_.find(key);
+    if (key.isEmpty() || it == entries_.end()) return;
+
+    // Only move the file into place once it's complete.
+    QFile::remove(it->output_);
+    if (success && QFile::rename(output, it->output_)) {
+      it->state_ = State_Ready;
+      it->size_ = QFileInfo(it->output_).size();
+      total_size_ += it->size_;
+      lru_.append(key);
+      cached_output = it->output_;
+
+      EvictFiles();
+    } else {
+      QFile::remove(output);
+      entries_.erase(it);
+      success = false;
+    }
+
+    if (jobs_.isEmpty()) {
+      progress_timer_.stop();
+      progress_.clear();
+    }
+  }
+
+  emit Finished(key, cached_output, success);
+}
+
+void TranscodeCache::EmitFinished(const QString& key) {
+  QString output;
+  {
+    QMutexLocker l(&mutex_);
+    QHash<QString, Entry>::const_iterator it = entries_.constFind(key);
+    if (it == entries_.constEnd() || it->state_ != State_Ready) return;
+    output = it->output_;
+  }
+
+  emit Finished(key, output, true);
+}
+
+void TranscodeCache::EvictFiles() {
+  QList<QString>::iterator it = lru_.begin();
+  while (total_size_ > max_size_ && it != lru_.end()) {
+    QHash<QString, Entry>::iterator entry = entries_.find(*it);
+    if (entry->refs_ > 0) {
+      // Someone's still using this one.
+      ++it;
+      continue;
+    }
+
+    qLog(Debug) << "Removing" << entry->output_ << "from the transcode cache";
+    QFile::remove(entry->output_);
+    total_size_ -= entry->size_;
+    entries_.erase(entry);
+    it = lru_.erase(it);
+  }
+}
+
+void TranscodeCache::timerEvent(QTimerEvent* e) {
+  if (e->timerId() != progress_timer_.timerId()) {
+    QObject::timerEvent(e);
+    return;
+  }
+
+  const QMap<QString, float> progress = transcoder_->GetProgress();
+
+  QMutexLocker l(&mutex_);
+  progress_ = progress;
+}
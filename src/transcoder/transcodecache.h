@@ -0,0 +1,128 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef TRANSCODER_TRANSCODECACHE_H_
+#define TRANSCODER_TRANSCODECACHE_H_
+
+#include <QBasicTimer>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+
+#include "transcoder/transcoder.h"
+
+// Keeps transcoded copies of files so the same file doesn't have to be
+// transcoded again every time it's sent to a phone or copied to a device.
+// Files are stored under a key made from the source file's path, size and
+// modification time, the preset and the transcoder settings.  When the cache
+// grows over max_size() the least recently used files are deleted.
+//
+// Can be used from any thread.  Request() a file, and Finished() is emitted
+// with its key when the transcoded file is ready - straight away if it was
+// already in the cache.  Requests for a file that is already being transcoded
+// share the same job.  Finished() is emitted to everyone that's connected, so
+// ignore keys you didn't ask for, and don't rely on it only being emitted once
+// per key.
+//
+// A transcoded file stays in the cache until everyone that requested it has
+// called Release().
+class TranscodeCache : public QObject {
+  Q_OBJECT
+
+ public:
+  // cache_dir is used by tests.  By default the files are kept in the user's
+  // cache directory.
+  explicit TranscodeCache(QObject* parent = nullptr,
+                          const QString& cache_dir = QString());
+  ~TranscodeCache();
+
+  static const qint64 kDefaultMaxSize;
+  static const int kProgressInterval;
+
+  static TranscodeCache* Instance() { return sInstance; }
+
+  qint64 max_size() const;
+  void set_max_size(qint64 bytes);
+
+  // Returns the key that will be passed to Finished().
+  QString Request(const QString& input, const TranscoderPreset& preset);
+  void Release(const QString& key);
+
+  // Returns the progress of the files being transcoded at the moment, keyed
+  // by input filename.
+  QMap<QString, float> GetProgress() const;
+
+ signals:
+  // output is empty if success is false.
+  void Finished(const QString& key, const QString& output, bool success);
+
+ protected:
+  void timerEvent(QTimerEvent* e);
+
+  // Starts transcoding input into output.  JobComplete() must be called when
+  // it's done.  Tests override this to avoid running GStreamer.
+  virtual void Transcode(const QString& input, const TranscoderPreset& preset,
+                         const QString& output);
+
+ protected slots:
+  void JobComplete(const QString& input, const QString& output, bool success);
+
+ private slots:
+  void StartJob(const QString& key);
+  void EmitFinished(const QString& key);
+
+ private:
+  enum State { State_Queued, State_Transcoding, State_Ready, };
+
+  struct Entry {
+    Entry() : state_(State_Queued), size_(0), refs_(0) {}
+
+    State state_;
+    QString input_;
+    QString output_;
+    TranscoderPreset preset_;
+    qint64 size_;
+    int refs_;
+  };
+
+  static QString KeyFor(const QString& input, const TranscoderPreset& preset);
+
+  void LoadExistingFiles();
+
+  // Must be called with mutex_ held.
+  void EvictFiles();
+
+  static TranscodeCache* sInstance;
+
+  const QString cache_dir_;
+  Transcoder* transcoder_;
+  QBasicTimer progress_timer_;
+
+  // Protects everything below.
+  mutable QMutex mutex_;
+  QHash<QString, Entry> entries_;
+  QList<QString> lru_;             // Ready entries, least recently used first.
+  QMap<QString, QString> jobs_;    // Temporary output filename -> key.
+  QMap<QString, float> progress_;  // Input filename -> progress.
+  qint64 total_size_;
+  qint64 max_size_;
+};
+
+#endif  // TRANSCODER_TRANSCODECACHE_H_
@@ -47,6 +47,7 @@
 #include <QMessageBox>
 #include <QPainter>
 #include <QProgressBar>
+#include <QScrollBar>
 #include <QSettings>
 #include <QShortcut>
 #include <QTimer>
@@ -68,6 +69,7 @@ AlbumCoverManager::AlbumCoverManager(Application* app,
       cover_exporter_(new AlbumCoverExporter(this)),
       artist_icon_(IconLoader::Load("x-clementine-artist", IconLoader::Base)),
       all_artists_icon_(IconLoader::Load("x-clementine-album", IconLoader::Base)),
+      cover_priority_timer_(new QTimer(this)),
       context_menu_(new QMenu(this)),
       progress_bar_(new QProgressBar(this)),
       abort_progress_(new QPushButton(this)),
@@ -205,6 +207,18 @@ void AlbumCoverManager::Init() {
   connect(app_->album_cover_loader(), SIGNAL(ImageLoaded(quint64, QImage)),
           SLOT(CoverImageLoaded(quint64, QImage)));
 
+  // Thumbnails only, so don't decode the full size images.
+  cover_loader_options_.decode_at_scaled_size_ = true;
+
+  // Covers are all loaded with the lowest priority, and the ones that scroll
+  // into view are bumped up.
+  cover_priority_timer_->setSingleShot(true);
+  cover_priority_timer_->setInterval(50);
+  connect(cover_priority_timer_, SIGNAL(timeout()),
+          SLOT(UpdateCoverPriorities()));
+  connect(ui_->albums->verticalScrollBar(), SIGNAL(valueChanged(int)),
+          SLOT(ScheduleUpdateCoverPriorities()));
+
   cover_searcher_->Init(cover_fetcher_);
 
   new ForceScrollPerPixel(ui_->albums, this);
@@ -338,7 +352,8 @@ void AlbumCoverManager::ArtistChanged(QListWidgetItem* current) {
     if (!info.art_automatic.isEmpty() || !info.art_manual.isEmpty()) {
       quint64 id = app_->album_cover_loader()->LoadImageAsync(
           cover_loader_options_, info.art_automatic, info.art_manual,
-          info.first_url.toLocalFile());
+          info.first_url.toLocalFile(), QImage(),
+          AlbumCoverLoader::Priority_Prefetch);
       item->setData(Role_PathAutomatic, info.art_automatic);
       item->setData(Role_PathManual, info.art_manual);
       cover_loading_tasks_[id] = item;
@@ -348,6 +363,47 @@ void AlbumCoverManager::ArtistChanged(QListWidgetItem* current) {
   UpdateFilter();
 }
 
+void AlbumCoverManager::ScheduleUpdateCoverPriorities() {
+  // Don't restart the timer if it's already running, otherwise it would never
+  // fire while the user is scrolling or covers are arriving.
+  if (!cover_priority_timer_->isActive()) {
+    cover_priority_timer_->start();
+  }
+}
+
+void AlbumCoverManager::UpdateCoverPriorities() {
+  if (cover_loading_tasks_.isEmpty()) return;
+
+  const QRect visible_rect = ui_->albums->viewport()->rect();
+  const QRect near_visible_rect =
+      visible_rect.adjusted(0, -visible_rect.height(), 0,
+                            visible_rect.height());
+
+  QSet<quint64> visible;
+  QSet<quint64> near_visible;
+  QSet<quint64> prefetch;
+
+  for (QMap<quint64, QListWidgetItem*>::const_iterator it =
+           cover_loading_tasks_.constBegin();
+       it != cover_loading_tasks_.constEnd(); ++it) {
+    const QRect rect = it.value()->isHidden()
+                           ? QRect()
+                           : ui_->albums->visualItemRect(it.value());
+    if (rect.intersects(visible_rect)) {
+      visible << it.key();
+    } else if (rect.intersects(near_visible_rect)) {
+      near_visible << it.key();
+    } else {
+      prefetch << it.key();
+    }
+  }
+
+  AlbumCoverLoader* loader = app_->album_cover_loader();
+  loader->SetPriority(visible, AlbumCoverLoader::Priority_Visible);
+  loader->SetPriority(near_visible, AlbumCoverLoader::Priority_NearVisible);
+  loader->SetPriority(prefetch, AlbumCoverLoader::Priority_Prefetch);
+}
+
 void AlbumCoverManager::CoverImageLoaded(quint64 id, const QImage& image) {
   if (!cover_loading_tasks_.contains(id)) return;
 
@@ -389,6 +445,8 @@ void AlbumCoverManager::UpdateFilter() {
 
   ui_->total_albums->setText(QString::number(total_count));
   ui_->without_cover->setText(QString::number(without_cover));
+
+  ScheduleUpdateCoverPriorities();
 }
 
 bool AlbumCoverManager::ShouldHide(const QListWidgetItem& item,
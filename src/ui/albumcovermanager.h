@@ -43,6 +43,7 @@ class QMenu;
 class QNetworkAccessManager;
 class QPushButton;
 class QProgressBar;
+class QTimer;
 
 class AlbumCoverManager : public QMainWindow {
   Q_OBJECT
@@ -104,6 +105,11 @@ signals:
   void UpdateCoverInList(QListWidgetItem* item, const QString& cover);
   void UpdateExportStatus(int exported, int bad, int count);
 
+  // Bumps the covers that are on screen (or about to be) to the front of the
+  // cover loader's queue.
+  void ScheduleUpdateCoverPriorities();
+  void UpdateCoverPriorities();
+
  private:
   enum ArtistItemType { All_Artists, Various_Artists, Specific_Artist, };
 
@@ -148,6 +154,7 @@ signals:
 
   AlbumCoverLoaderOptions cover_loader_options_;
   QMap<quint64, QListWidgetItem*> cover_loading_tasks_;
+  QTimer* cover_priority_timer_;
 
   AlbumCoverFetcher* cover_fetcher_;
   QMap<quint64, QListWidgetItem*> cover_fetching_tasks_;
@@ -1,6 +1,9 @@
 #include "console.h"
 
+#include <QDir>
+#include <QFileDialog>
 #include <QFont>
+#include <QMessageBox>
 #include <QScrollBar>
 #include <QSqlDatabase>
 #include <QSqlQuery>
@@ -8,12 +11,23 @@
 
 #include "core/application.h"
 #include "core/database.h"
+#include "core/tracing.h"
 
 Console::Console(Application* app, QWidget* parent)
     : QDialog(parent), app_(app) {
   ui_.setupUi(this);
   connect(ui_.run, SIGNAL(clicked()), SLOT(RunQuery()));
 
+#ifdef CLEMENTINE_NO_TRACING
+  ui_.record_trace->hide();
+  ui_.save_trace->hide();
+#else
+  ui_.record_trace->setChecked(tracing::IsEnabled());
+  connect(ui_.record_trace, SIGNAL(toggled(bool)),
+          SLOT(RecordTraceToggled(bool)));
+  connect(ui_.save_trace, SIGNAL(clicked()), SLOT(SaveTrace()));
+#endif
+
   QFont font("Monospace");
   font.setStyleHint(QFont::TypeWriter);
 
@@ -45,3 +59,19 @@ void Console::RunQuery() {
   ui_.output->verticalScrollBar()->setValue(
       ui_.output->verticalScrollBar()->maximum());
 }
+
+void Console::RecordTraceToggled(bool enabled) {
+  tracing::SetEnabled(enabled);
+}
+
+void Console::SaveTrace() {
+  QString filename = QFileDialog::getSaveFileName(
+      this, tr("Save trace"), QDir::homePath() + "/clementine-trace.json",
+      tr("Chrome trace files (*.json)"));
+  if (filename.isEmpty()) return;
+
+  if (!tracing::WriteChromeTrace(filename)) {
+    QMessageBox::warning(this, tr("Save trace"),
+                         tr("Could not write to %1").arg(filename));
+  }
+}
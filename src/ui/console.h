@@ -14,6 +14,8 @@ class Console : public QDialog {
 
  private slots:
   void RunQuery();
+  void RecordTraceToggled(bool enabled);
+  void SaveTrace();
 
  private:
   Ui::Console ui_;
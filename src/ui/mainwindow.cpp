@@ -706,9 +706,13 @@ MainWindow::MainWindow(Application* app, SystemTrayIcon* tray_icon, OSD* osd,
   connect(app_->scrobbler(), SIGNAL(ScrobbledRadioStream()),
           SLOT(ScrobbledRadioStream()));
 #endif
-  connect(app_->internet_model()->Service<MagnatuneService>(),
-          SIGNAL(DownloadFinished(QStringList)), osd_,
-          SLOT(MagnatuneDownloadFinished(QStringList)));
+  // Magnatune is created on demand, so connect to it when it appears.
+  connect(app_->internet_model(), SIGNAL(ServiceAdded(InternetService*)),
+          SLOT(InternetServiceAdded(InternetService*)));
+  if (InternetService* magnatune = InternetModel::CreatedServiceByName(
+          MagnatuneService::kServiceName)) {
+    InternetServiceAdded(magnatune);
+  }
   connect(internet_view_->tree(), SIGNAL(AddToPlaylistSignal(QMimeData*)),
           SLOT(AddToPlaylist(QMimeData*)));
 
@@ -2171,6 +2175,13 @@ void MainWindow::ShowLibraryConfig() {
   settings_dialog_->OpenAtPage(SettingsDialog::Page_Library);
 }
 
+void MainWindow::InternetServiceAdded(InternetService* service) {
+  if (MagnatuneService* magnatune = qobject_cast<MagnatuneService*>(service)) {
+    connect(magnatune, SIGNAL(DownloadFinished(QStringList)), osd_,
+            SLOT(MagnatuneDownloadFinished(QStringList)));
+  }
+}
+
 void MainWindow::TaskCountChanged(int count) {
   if (count == 0) {
     ui_->status_bar_stack->setCurrentWidget(ui_->playlist_summary_page);
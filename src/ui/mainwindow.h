@@ -53,6 +53,7 @@ class GlobalSearch;
 class GlobalSearchView;
 class GlobalShortcuts;
 class GroupByDialog;
+class InternetService;
 class Library;
 class LibraryViewContainer;
 class MimeData;
@@ -215,6 +216,8 @@ signals:
   void ScrobbledRadioStream();
 #endif
 
+  void InternetServiceAdded(InternetService* service);
+
   void TaskCountChanged(int count);
 
   void ShowLibraryConfig();
@@ -114,7 +114,10 @@ NotificationsSettingsPage::~NotificationsSettingsPage() {
   delete ui_;
 }
 
-void NotificationsSettingsPage::showEvent(QShowEvent*) { UpdatePopupVisible(); }
+void NotificationsSettingsPage::showEvent(QShowEvent* e) {
+  UpdatePopupVisible();
+  SettingsPage::showEvent(e);
+}
 
 void NotificationsSettingsPage::hideEvent(QHideEvent*) { UpdatePopupVisible(); }
 
@@ -19,4 +19,12 @@
 #include "settingspage.h"
 
 SettingsPage::SettingsPage(SettingsDialog* dialog)
-    : QWidget(dialog), dialog_(dialog) {}
+    : QWidget(dialog), dialog_(dialog), shown_(false) {}
+
+void SettingsPage::showEvent(QShowEvent* e) {
+  if (!shown_) {
+    shown_ = true;
+    FirstShown();
+  }
+  QWidget::showEvent(e);
+}
@@ -42,12 +42,22 @@ class SettingsPage : public QWidget {
   // The dialog that this page belongs to.
   SettingsDialog* dialog() const { return dialog_; }
 
+ protected:
+  // Called the first time the page is shown.  Pages that need something
+  // expensive, like the internet service they configure, can get it here
+  // instead of in their constructor.  Load and Save can be called before this.
+  virtual void FirstShown() {}
+
+  // QWidget
+  void showEvent(QShowEvent* e);
+
 signals:
   void NotificationPreview(OSD::Behaviour, QString, QString);
   void SetWiimotedevInterfaceActived(bool);
 
  private:
   SettingsDialog* dialog_;
+  bool shown_;
 };
 
 #endif  // SETTINGSPAGE_H
@@ -26,6 +26,7 @@ StandardItemIconLoader::StandardItemIconLoader(AlbumCoverLoader* cover_loader,
                                                QObject* parent)
     : QObject(parent), cover_loader_(cover_loader), model_(nullptr) {
   cover_options_.desired_height_ = 16;
+  cover_options_.decode_at_scaled_size_ = true;
 
   connect(cover_loader_, SIGNAL(ImageLoaded(quint64, QImage)),
           SLOT(ImageLoaded(quint64, QImage)));
@@ -0,0 +1,123 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gtest/gtest.h"
+
+#include <QEventLoop>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSignalSpy>
+#include <QTimer>
+#include <QUrl>
+
+#include "core/song.h"
+#include "covers/albumcoverloader.h"
+#include "covers/currentartloader.h"
+
+namespace {
+
+// Records the size the art is requested at instead of asking the tagreader.
+class RecordingCoverLoader : public AlbumCoverLoader {
+ public:
+  RecordingCoverLoader() : requested_size_(-1) {}
+
+  int requested_size() {
+    QMutexLocker l(&mutex_);
+    return requested_size_;
+  }
+
+ protected:
+  QImage LoadEmbeddedArt(const QString&, int max_size) {
+    QMutexLocker l(&mutex_);
+    requested_size_ = max_size;
+
+    const int size = max_size > 0 ? max_size : 4000;
+    QImage image(size, size, QImage::Format_RGB32);
+    image.fill(0);
+    return image;
+  }
+
+ private:
+  QMutex mutex_;
+  int requested_size_;
+};
+
+class AlbumCoverLoaderTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    song_.set_url(QUrl::fromLocalFile("/music/song.mp3"));
+    song_.set_art_automatic(Song::kEmbeddedCover);
+  }
+
+  // Loads the song's embedded art and returns the image that was emitted.
+  QImage Load(const AlbumCoverLoaderOptions& options) {
+    QSignalSpy spy(&loader_, SIGNAL(ImageLoaded(quint64, QImage)));
+
+    QEventLoop loop;
+    QObject::connect(&loader_, SIGNAL(ImageLoaded(quint64, QImage)), &loop,
+                     SLOT(quit()));
+    QTimer::singleShot(5000, &loop, SLOT(quit()));
+    loader_.LoadImageAsync(options, song_);
+    loop.exec();
+
+    if (spy.isEmpty()) return QImage();
+    return spy[0][1].value<QImage>();
+  }
+
+  Song song_;
+  RecordingCoverLoader loader_;
+};
+
+TEST_F(AlbumCoverLoaderTest, FullSizeByDefault) {
+  AlbumCoverLoaderOptions options;
+  options.scale_output_image_ = false;
+  options.pad_output_image_ = false;
+
+  QImage image = Load(options);
+  EXPECT_EQ(0, loader_.requested_size());
+  EXPECT_EQ(QSize(4000, 4000), image.size());
+}
+
+TEST_F(AlbumCoverLoaderTest, ScaledThumbnailsAreDecodedAtTheirSize) {
+  AlbumCoverLoaderOptions options;
+  options.desired_height_ = 100;
+  options.decode_at_scaled_size_ = true;
+
+  Load(options);
+  EXPECT_EQ(100, loader_.requested_size());
+}
+
+TEST_F(AlbumCoverLoaderTest, OriginalIsBounded) {
+  AlbumCoverLoaderOptions options;
+  options.scale_output_image_ = false;
+  options.pad_output_image_ = false;
+  options.max_original_size_ = 500;
+
+  QImage image = Load(options);
+  EXPECT_EQ(500, loader_.requested_size());
+  EXPECT_EQ(QSize(500, 500), image.size());
+}
+
+// The art shown behind the playlist and in the now playing widget.
+TEST_F(AlbumCoverLoaderTest, CurrentArtIsBounded) {
+  QImage image = Load(CurrentArtLoader::DefaultOptions());
+  EXPECT_EQ(CurrentArtLoader::kMaxArtSize, loader_.requested_size());
+  EXPECT_EQ(QSize(CurrentArtLoader::kMaxArtSize, CurrentArtLoader::kMaxArtSize),
+            image.size());
+}
+
+}  // namespace
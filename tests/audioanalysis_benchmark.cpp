@@ -0,0 +1,87 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "config.h"
+#include "benchmark_utils.h"
+#include "analyzers/fht.h"
+
+#ifdef HAVE_MOODBAR
+#include "moodbar/moodbarbuilder.h"
+#endif
+
+namespace {
+
+// One analyzer frame at the size the analyzers use by default.
+TEST(AudioAnalysisBenchmark, FhtLogSpectrum) {
+  const int kExp = 9;
+  const int kFrames = 10000;
+
+  FHT fht(kExp);
+  benchmark::Random random;
+
+  std::vector<float> scope(fht.size());
+  std::vector<float> spectrum(fht.size() / 2);
+
+  benchmark::Run("frames", 5, kFrames, [&] {
+    for (int i = 0; i < kFrames; ++i) {
+      for (int j = 0; j < fht.size(); ++j) {
+        scope[j] = float(sin(j * 0.1 + i)) + float(random.Next(100)) / 1000.0f;
+      }
+      fht.logSpectrum(&spectrum[0], &scope[0]);
+    }
+  });
+}
+
+#ifdef HAVE_MOODBAR
+// Roughly the number of spectrum frames in a four minute song.
+TEST(AudioAnalysisBenchmark, MoodbarBuilderFinish) {
+  const int kBands = 128;
+  const int kFrames = 24000;
+
+  benchmark::Random random;
+  std::vector<double> magnitudes(kBands * kFrames);
+  for (double& magnitude : magnitudes) {
+    magnitude = random.Next(1000) / 1000.0;
+  }
+
+  // Builders keep every frame they're given, so each run needs a new one.
+  std::unique_ptr<MoodbarBuilder> builder;
+  auto add_frames = [&] {
+    builder.reset(new MoodbarBuilder);
+    builder->Init(kBands, 44100);
+    for (int i = 0; i < kFrames; ++i) {
+      builder->AddFrame(&magnitudes[i * kBands], kBands);
+    }
+  };
+
+  benchmark::Run("add_frames", 5, kFrames, add_frames);
+
+  QByteArray data;
+  benchmark::Run("finish", 5, kFrames, add_frames,
+                 [&] { data = builder->Finish(1000); });
+  EXPECT_EQ(1000 * 3, data.size());
+}
+#endif  // HAVE_MOODBAR
+
+}  // namespace
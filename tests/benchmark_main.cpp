@@ -0,0 +1,71 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+
+#include <gmock/gmock.h>
+
+#include <QApplication>
+#include <QFile>
+
+#include "benchmark_utils.h"
+#include "logging_env.h"
+#include "metatypes_env.h"
+#include "resources_env.h"
+
+#ifndef Q_WS_X11
+#include <QtPlugin>
+Q_IMPORT_PLUGIN(qsqlite)
+#endif
+
+int main(int argc, char** argv) {
+  testing::InitGoogleMock(&argc, argv);
+
+  // Anything gtest didn't recognise is left for us.
+  const QString kJsonFlag = "--benchmark_json=";
+  QString json_filename;
+  for (int i = 1; i < argc; ++i) {
+    const QString arg = QString::fromLocal8Bit(argv[i]);
+    if (arg.startsWith(kJsonFlag)) {
+      json_filename = arg.mid(kJsonFlag.length());
+    }
+  }
+
+  testing::AddGlobalTestEnvironment(new MetatypesEnvironment);
+  // The library model and playlist benchmarks need a QApplication for their
+  // icons.
+  QApplication a(argc, argv);
+  testing::AddGlobalTestEnvironment(new ResourcesEnvironment);
+  testing::AddGlobalTestEnvironment(new LoggingEnvironment);
+
+  const int ret = RUN_ALL_TESTS();
+
+  const QByteArray json = benchmark::ResultsJson();
+  if (json_filename.isEmpty()) {
+    std::cout << json.constData() << std::endl;
+  } else {
+    QFile file(json_filename);
+    if (!file.open(QIODevice::WriteOnly) || file.write(json + "\n") == -1) {
+      std::cerr << "Failed to write " << json_filename.toLocal8Bit().constData()
+                << std::endl;
+      return 1;
+    }
+  }
+
+  return ret;
+}
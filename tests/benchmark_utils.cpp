@@ -0,0 +1,216 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "benchmark_utils.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QThread>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QtDebug>
+
+#include <gtest/gtest.h>
+#include <qjson/serializer.h>
+
+#include "version.h"
+
+namespace benchmark {
+
+namespace {
+
+QVariantList sResults;
+
+const char* kWords[] = {
+    "love",  "night", "blue",   "fire",   "dream", "heart",  "road",
+    "rain",  "light", "river",  "summer", "ghost", "city",   "stone",
+    "gold",  "wild",  "silver", "ocean",  "storm", "shadow", "echo",
+    "glass", "north", "moon",   "machine"};
+const int kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+const char* kGenres[] = {"Rock", "Pop", "Jazz", "Electronic", "Classical",
+                         "Folk", "Hip-Hop", "Metal", "Blues", "Ambient"};
+const int kGenreCount = sizeof(kGenres) / sizeof(kGenres[0]);
+
+QString Words(Random* random, int count) {
+  QStringList ret;
+  for (int i = 0; i < count; ++i) {
+    ret << kWords[random->Next(kWordCount)];
+  }
+  ret[0][0] = ret[0][0].toUpper();
+  return ret.join(" ");
+}
+
+QString TestName() {
+  const ::testing::TestInfo* info =
+      ::testing::UnitTest::GetInstance()->current_test_info();
+  if (!info) return QString();
+  return QString("%1.%2").arg(info->test_case_name(), info->name());
+}
+
+double Milliseconds(qint64 ns) { return double(ns) / 1000000.0; }
+
+}  // namespace
+
+void Run(const QString& label, int repetitions, int items,
+         const std::function<void()>& fn) {
+  Run(label, repetitions, items, [] {}, fn);
+}
+
+void Run(const QString& label, int repetitions, int items,
+         const std::function<void()>& setup,
+         const std::function<void()>& fn) {
+  setup();
+  fn();
+
+  QList<qint64> samples;
+  QElapsedTimer timer;
+  for (int i = 0; i < repetitions; ++i) {
+    setup();
+    timer.start();
+    fn();
+    samples << timer.nsecsElapsed();
+  }
+
+  std::sort(samples.begin(), samples.end());
+  qint64 total = 0;
+  for (qint64 sample : samples) {
+    total += sample;
+  }
+  const qint64 median = samples[samples.count() / 2];
+
+  QVariantMap result;
+  result["name"] = TestName() + "/" + label;
+  result["repetitions"] = repetitions;
+  result["items"] = items;
+  result["min_ms"] = Milliseconds(samples.first());
+  result["median_ms"] = Milliseconds(median);
+  result["mean_ms"] = Milliseconds(total / samples.count());
+  result["max_ms"] = Milliseconds(samples.last());
+  if (items > 0 && median > 0) {
+    result["items_per_second"] = items * 1000000000.0 / median;
+  }
+  sResults << result;
+
+  qDebug() << result["name"].toString() << "median"
+           << result["median_ms"].toDouble() << "ms over" << repetitions
+           << "runs";
+}
+
+QByteArray ResultsJson() {
+  QVariantMap ret;
+  ret["version"] = CLEMENTINE_VERSION_DISPLAY;
+  ret["qt_version"] = qVersion();
+  ret["threads"] = QThread::idealThreadCount();
+  ret["date"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+  ret["benchmarks"] = sResults;
+
+  QJson::Serializer serializer;
+  return serializer.serialize(ret);
+}
+
+quint32 Random::Next() {
+  // Numerical Recipes' LCG - plenty for making up metadata.
+  state_ = state_ * 1664525u + 1013904223u;
+  return state_ >> 8;
+}
+
+SongList SyntheticSongs(int count, int directory_id, quint32 seed) {
+  Random random(seed);
+
+  const int artist_count = qMax(1, count / 10);
+  QStringList artists;
+  for (int i = 0; i < artist_count; ++i) {
+    artists << QString("%1 %2").arg(Words(&random, 2)).arg(i);
+  }
+
+  SongList ret;
+  ret.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    const int artist_index = random.Next(artist_count);
+    const QString& artist = artists[artist_index];
+    const int album_index = random.Next(4);
+    const QString album =
+        QString("%1 %2").arg(Words(&random, 2)).arg(artist_index * 4 +
+                                                    album_index);
+    const int track = i % 12 + 1;
+
+    Song song;
+    song.Init(Words(&random, 1 + random.Next(4)), artist, album,
+              qint64(120 + random.Next(300)) * 1000000000ll);
+    song.set_track(track);
+    song.set_disc(1);
+    song.set_year(1960 + (artist_index + album_index) % 55);
+    song.set_genre(kGenres[artist_index % kGenreCount]);
+    song.set_playcount(random.Next(50));
+    song.set_filetype(Song::Type_Mpeg);
+    song.set_bitrate(320);
+    song.set_samplerate(44100);
+    song.set_directory_id(directory_id);
+    song.set_url(QUrl::fromLocalFile(QString("/music/%1/%2/%3 - %4.mp3")
+                                         .arg(artist, album)
+                                         .arg(track, 2, 10, QChar('0'))
+                                         .arg(i)));
+    song.set_mtime(1400000000 + i);
+    song.set_ctime(1400000000 + i);
+    song.set_filesize(5000000 + random.Next(5000000));
+    ret << song;
+  }
+  return ret;
+}
+
+bool WriteWaveFile(const QString& filename, int length_sec, int frequency_hz) {
+  const int kRate = 44100;
+  const int kBytesPerSample = 2;
+  const quint32 data_size = length_sec * kRate * kBytesPerSample;
+
+  QFile file(filename);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+
+  QDataStream s(&file);
+  s.setByteOrder(QDataStream::LittleEndian);
+
+  s.writeRawData("RIFF", 4);
+  s << quint32(36 + data_size);
+  s.writeRawData("WAVEfmt ", 8);
+  s << quint32(16)                        // Size of the fmt chunk
+    << quint16(1)                         // PCM
+    << quint16(1)                         // Channels
+    << quint32(kRate)                     // Sample rate
+    << quint32(kRate * kBytesPerSample)   // Byte rate
+    << quint16(kBytesPerSample)           // Block align
+    << quint16(kBytesPerSample * 8);      // Bits per sample
+  s.writeRawData("data", 4);
+  s << data_size;
+
+  for (int i = 0; i < length_sec * kRate; ++i) {
+    s << qint16(16000 * sin(2 * M_PI * frequency_hz * i / kRate));
+  }
+
+  return s.status() == QDataStream::Ok;
+}
+
+}  // namespace benchmark
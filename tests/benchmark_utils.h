@@ -0,0 +1,79 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef BENCHMARK_UTILS_H
+#define BENCHMARK_UTILS_H
+
+#include <functional>
+
+#include <QByteArray>
+#include <QString>
+
+#include "core/song.h"
+
+// Helpers for the benchmarks in *_benchmark.cpp.  The benchmarks are ordinary
+// gtest tests that are built into a separate clementine_benchmarks executable
+// (run it with "make benchmark"), so they can be filtered with
+// --gtest_filter as usual.  Each test builds its fixtures untimed and then
+// times the interesting part with benchmark::Run().  When all the tests have
+// finished the results are written as JSON to the file given with
+// --benchmark_json, or to standard output.
+
+namespace benchmark {
+
+// Runs fn once to warm up and then repetitions more times, and records how
+// long each of those took under the name of the current test followed by
+// label.  items is how many things (songs, rows, frames...) one run of fn
+// handles, and is used to report throughput.
+void Run(const QString& label, int repetitions, int items,
+         const std::function<void()>& fn);
+
+// Like Run(), but calls setup before every run of fn without timing it, for
+// benchmarks that need fresh state each time.
+void Run(const QString& label, int repetitions, int items,
+         const std::function<void()>& setup,
+         const std::function<void()>& fn);
+
+// Everything recorded so far, as JSON.
+QByteArray ResultsJson();
+
+// A small deterministic random number generator, so the fixtures built from
+// it are the same on every machine and every run.
+class Random {
+ public:
+  explicit Random(quint32 seed = 1) : state_(seed) {}
+
+  quint32 Next();
+  // A number in [0, max).
+  int Next(int max) { return Next() % max; }
+
+ private:
+  quint32 state_;
+};
+
+// A library's worth of songs with plausible looking metadata: count / 10
+// artists with a few albums each, tracks, genres, years, lengths and play
+// counts.  The songs are all in /music and belong to the given directory.
+SongList SyntheticSongs(int count, int directory_id = 1, quint32 seed = 1);
+
+// Writes a mono 16 bit 44.1kHz WAV file containing a sine wave.
+bool WriteWaveFile(const QString& filename, int length_sec, int frequency_hz);
+
+}  // namespace benchmark
+
+#endif  // BENCHMARK_UTILS_H
@@ -0,0 +1,175 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include <QBuffer>
+#include <QFile>
+#include <QImage>
+#include <QMap>
+
+#ifdef Q_OS_UNIX
+#include <sys/time.h>
+#endif
+
+#include "embeddedartcache.h"
+#include "core/utilities.h"
+
+namespace {
+
+// Returns art from a map instead of reading it from the files.
+class FakeEmbeddedArtCache : public EmbeddedArtCache {
+ public:
+  explicit FakeEmbeddedArtCache(int worker_count = 1)
+      : EmbeddedArtCache(nullptr, worker_count), loads_(0) {}
+
+  QMap<QString, QByteArray> art_;
+  int loads_;
+
+ protected:
+  QByteArray LoadArt(const QString& filename) {
+    loads_++;
+    return art_.value(filename);
+  }
+};
+
+class EmbeddedArtCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() { dir_ = Utilities::MakeTempDir(); }
+  void TearDown() { Utilities::RemoveRecursive(dir_); }
+
+  QString MakeFile(const QString& name) {
+    const QString filename = dir_ + "/" + name;
+    QFile file(filename);
+    file.open(QIODevice::WriteOnly);
+    file.write("data");
+    return filename;
+  }
+
+  static QByteArray MakePng(int width, int height) {
+    QImage image(width, height, QImage::Format_RGB32);
+    image.fill(Qt::red);
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    return data;
+  }
+
+  QString dir_;
+};
+
+TEST_F(EmbeddedArtCacheTest, CachesArt) {
+  FakeEmbeddedArtCache cache;
+  const QString filename = MakeFile("a.mp3");
+  cache.art_[filename] = MakePng(10, 10);
+
+  EXPECT_EQ(cache.art_[filename], cache.Data(filename));
+  EXPECT_EQ(cache.art_[filename], cache.Data(filename));
+  EXPECT_EQ(1, cache.loads_);
+}
+
+TEST_F(EmbeddedArtCacheTest, CachesFilesWithoutArt) {
+  FakeEmbeddedArtCache cache;
+  const QString filename = MakeFile("a.mp3");
+
+  EXPECT_TRUE(cache.Data(filename).isEmpty());
+  EXPECT_TRUE(cache.ScaledImage(filename, 50).isNull());
+  EXPECT_TRUE(cache.ScaledImage(filename, 50).isNull());
+  EXPECT_EQ(1, cache.loads_);
+}
+
+#ifdef Q_OS_UNIX
+TEST_F(EmbeddedArtCacheTest, ChangedFileIsReloaded) {
+  FakeEmbeddedArtCache cache;
+  const QString filename = MakeFile("a.mp3");
+  const QByteArray path = QFile::encodeName(filename);
+
+  struct timeval times[2];
+  times[0].tv_sec = times[1].tv_sec = 1000000000;
+  times[0].tv_usec = times[1].tv_usec = 0;
+  ASSERT_EQ(0, utimes(path.constData(), times));
+  cache.Data(filename);
+  cache.Data(filename);
+  EXPECT_EQ(1, cache.loads_);
+
+  // Modifications within the same second change the key too.
+  times[0].tv_usec = times[1].tv_usec = 500000;
+  ASSERT_EQ(0, utimes(path.constData(), times));
+  cache.Data(filename);
+  EXPECT_EQ(2, cache.loads_);
+}
+#endif
+
+TEST_F(EmbeddedArtCacheTest, ScalesImagesDown) {
+  FakeEmbeddedArtCache cache;
+  const QString filename = MakeFile("a.mp3");
+  cache.art_[filename] = MakePng(200, 100);
+
+  QImage image = cache.ScaledImage(filename, 50);
+  EXPECT_EQ(QSize(50, 25), image.size());
+  EXPECT_EQ(QImage::Format_ARGB32, image.format());
+
+  // Each size is cached separately, but the file is only read once.
+  EXPECT_EQ(QSize(100, 50), cache.ScaledImage(filename, 100).size());
+  EXPECT_EQ(QSize(50, 25), cache.ScaledImage(filename, 50).size());
+  EXPECT_EQ(1, cache.loads_);
+}
+
+TEST_F(EmbeddedArtCacheTest, DoesNotScaleImagesUp) {
+  FakeEmbeddedArtCache cache;
+  const QString filename = MakeFile("a.mp3");
+  cache.art_[filename] = MakePng(20, 10);
+
+  EXPECT_EQ(QSize(20, 10), cache.ScaledImage(filename, 50).size());
+}
+
+TEST_F(EmbeddedArtCacheTest, WorkersShareTheBudget) {
+  FakeEmbeddedArtCache one_worker(1);
+  EXPECT_EQ(EmbeddedArtCache::kArtDataBudget,
+            one_worker.art_data_cache_size());
+  EXPECT_EQ(EmbeddedArtCache::kScaledArtBudget,
+            one_worker.scaled_art_cache_size());
+
+  FakeEmbeddedArtCache four_workers(4);
+  EXPECT_EQ(EmbeddedArtCache::kArtDataBudget / 4,
+            four_workers.art_data_cache_size());
+  EXPECT_EQ(EmbeddedArtCache::kScaledArtBudget / 4,
+            four_workers.scaled_art_cache_size());
+}
+
+TEST_F(EmbeddedArtCacheTest, EvictsWhenOverBudget) {
+  // Leaves each worker a few kilobytes.
+  FakeEmbeddedArtCache cache(EmbeddedArtCache::kArtDataBudget / 4096);
+  const QString a = MakeFile("a.mp3");
+  const QString b = MakeFile("b.mp3");
+  cache.art_[a] = QByteArray(3000, 'a');
+  cache.art_[b] = QByteArray(3000, 'b');
+
+  cache.Data(a);
+  cache.Data(b);
+  EXPECT_EQ(2, cache.loads_);
+
+  // a was evicted to make room for b.
+  EXPECT_EQ(cache.art_[a], cache.Data(a));
+  EXPECT_EQ(3, cache.loads_);
+}
+
+}  // namespace
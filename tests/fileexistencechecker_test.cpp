@@ -0,0 +1,109 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gtest/gtest.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSignalSpy>
+#include <QTemporaryFile>
+
+#include "core/fileexistencechecker.h"
+#include "core/waitforsignal.h"
+
+namespace {
+
+class FileExistenceCheckerTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    // Enough files that the directory listing is used
+    for (int i = 0; i < FileExistenceChecker::kMinFilesForListing; ++i) {
+      QTemporaryFile* file = new QTemporaryFile;
+      ASSERT_TRUE(file->open());
+      files_ << file;
+      filenames_ << file->fileName();
+    }
+  }
+
+  void TearDown() { qDeleteAll(files_); }
+
+  QList<QTemporaryFile*> files_;
+  QStringList filenames_;
+};
+
+TEST_F(FileExistenceCheckerTest, ExistingFiles) {
+  FileExistenceChecker* checker = FileExistenceChecker::Check(filenames_);
+  QSignalSpy spy(checker, SIGNAL(FilesChecked(QStringList, QStringList)));
+  WaitForSignal(checker, SIGNAL(Finished()));
+
+  ASSERT_EQ(1, spy.count());
+  EXPECT_EQ(filenames_.toSet(), spy[0][0].toStringList().toSet());
+  EXPECT_TRUE(spy[0][1].toStringList().isEmpty());
+}
+
+TEST_F(FileExistenceCheckerTest, MissingFiles) {
+  const QString missing_file = filenames_[0] + ".missing";
+  const QString missing_dir = filenames_[0] + ".missing/foo.mp3";
+
+  FileExistenceChecker* checker = FileExistenceChecker::Check(
+      QStringList(filenames_) << missing_file << missing_dir);
+  QSignalSpy spy(checker, SIGNAL(FilesChecked(QStringList, QStringList)));
+  WaitForSignal(checker, SIGNAL(Finished()));
+
+  // One batch per directory
+  ASSERT_EQ(2, spy.count());
+  QStringList missing;
+  missing << spy[0][1].toStringList() << spy[1][1].toStringList();
+  EXPECT_EQ(QSet<QString>() << missing_file << missing_dir, missing.toSet());
+}
+
+TEST_F(FileExistenceCheckerTest, NameMissingFromListing) {
+  // "." is never in the listing but it does exist, like a file that the
+  // filesystem lists in a different case or Unicode normalisation.
+  const QString dot = QFileInfo(filenames_[0]).path() + "/.";
+
+  FileExistenceChecker* checker =
+      FileExistenceChecker::Check(QStringList(filenames_) << dot);
+  QSignalSpy spy(checker, SIGNAL(FilesChecked(QStringList, QStringList)));
+  WaitForSignal(checker, SIGNAL(Finished()));
+
+  ASSERT_EQ(1, spy.count());
+  EXPECT_TRUE(spy[0][0].toStringList().contains(dot));
+  EXPECT_TRUE(spy[0][1].toStringList().isEmpty());
+}
+
+TEST_F(FileExistenceCheckerTest, FewFiles) {
+  const QString missing_file = filenames_[0] + ".missing";
+
+  FileExistenceChecker* checker = FileExistenceChecker::Check(
+      QStringList() << filenames_[0] << missing_file);
+  QSignalSpy spy(checker, SIGNAL(FilesChecked(QStringList, QStringList)));
+  WaitForSignal(checker, SIGNAL(Finished()));
+
+  ASSERT_EQ(1, spy.count());
+  EXPECT_EQ(QStringList() << filenames_[0], spy[0][0].toStringList());
+  EXPECT_EQ(QStringList() << missing_file, spy[0][1].toStringList());
+}
+
+TEST_F(FileExistenceCheckerTest, NoFiles) {
+  FileExistenceChecker* checker = FileExistenceChecker::Check(QStringList());
+  QSignalSpy spy(checker, SIGNAL(Finished()));
+  WaitForSignal(checker, SIGNAL(Finished()));
+  EXPECT_EQ(1, spy.count());
+}
+
+}  // namespace
@@ -0,0 +1,222 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include <QIcon>
+#include <QPersistentModelIndex>
+#include <QSignalSpy>
+#include <QStringList>
+
+#include "globalsearch/globalsearchmodel.h"
+#include "globalsearch/searchprovider.h"
+
+namespace {
+
+class FakeSearchProvider : public SearchProvider {
+ public:
+  FakeSearchProvider(const QString& name, const QString& id)
+      : SearchProvider(nullptr) {
+    Init(name, id, QIcon());
+  }
+
+  void SearchAsync(int id, const QString& query) {}
+};
+
+class GlobalSearchModelTest : public ::testing::Test {
+ protected:
+  GlobalSearchModelTest()
+      : provider_("Provider", "provider"),
+        other_provider_("Other", "other"),
+        model_(nullptr) {}
+
+  SearchProvider::Result MakeResult(const QString& artist,
+                                    const QString& album, const QString& title,
+                                    int track = 0) {
+    return MakeResult(&provider_, artist, album, title, track);
+  }
+
+  SearchProvider::Result MakeResult(SearchProvider* provider,
+                                    const QString& artist,
+                                    const QString& album, const QString& title,
+                                    int track = 0) {
+    SearchProvider::Result result(provider);
+    result.metadata_.Init(title, artist, album, 123);
+    result.metadata_.set_track(track);
+    return result;
+  }
+
+  // The display text of each child of parent, in order.
+  QStringList Children(const QModelIndex& parent = QModelIndex()) const {
+    QStringList ret;
+    for (int i = 0; i < model_.rowCount(parent); ++i) {
+      ret << model_.index(i, 0, parent).data().toString();
+    }
+    return ret;
+  }
+
+  QModelIndex Find(const QString& text,
+                   const QModelIndex& parent = QModelIndex()) const {
+    for (int i = 0; i < model_.rowCount(parent); ++i) {
+      const QModelIndex index = model_.index(i, 0, parent);
+      if (index.data().toString() == text) return index;
+    }
+    return QModelIndex();
+  }
+
+  FakeSearchProvider provider_;
+  FakeSearchProvider other_provider_;
+  GlobalSearchModel model_;
+};
+
+TEST_F(GlobalSearchModelTest, SortsFirstBatch) {
+  model_.AddResults(SearchProvider::ResultList()
+                    << MakeResult("Bravo", "Album 2", "Two", 2)
+                    << MakeResult("Alpha", "Album 1", "Three", 3)
+                    << MakeResult("Bravo", "Album 2", "One", 1)
+                    << MakeResult("Alpha", "Album 1", "Four", 1));
+
+  EXPECT_EQ(QStringList() << "Provider"
+                          << "Alpha"
+                          << "Bravo",
+            Children());
+  EXPECT_TRUE(model_.index(0, 0).data(LibraryModel::Role_IsDivider).toBool());
+
+  const QModelIndex album1 = Find("Album 1", Find("Alpha"));
+  const QModelIndex album2 = Find("Album 2", Find("Bravo"));
+  ASSERT_TRUE(album1.isValid());
+  ASSERT_TRUE(album2.isValid());
+  EXPECT_EQ(QStringList() << "Four"
+                          << "Three",
+            Children(album1));
+  EXPECT_EQ(QStringList() << "One"
+                          << "Two",
+            Children(album2));
+}
+
+TEST_F(GlobalSearchModelTest, MergesLaterBatches) {
+  model_.AddResults(SearchProvider::ResultList()
+                    << MakeResult("Alpha", "Album", "Song 1", 1)
+                    << MakeResult("Charlie", "Album", "Song 1", 1));
+  const QPersistentModelIndex charlie = Find("Charlie");
+  const QPersistentModelIndex alpha_song =
+      model_.index(0, 0, Find("Album", Find("Alpha")));
+  ASSERT_TRUE(charlie.isValid());
+  ASSERT_TRUE(alpha_song.isValid());
+
+  model_.AddResults(SearchProvider::ResultList()
+                    << MakeResult("Delta", "Album", "Song 1", 1)
+                    << MakeResult("Bravo", "Album", "Song 1", 1)
+                    << MakeResult("Alpha", "Album", "Song 3", 3)
+                    << MakeResult("Alpha", "Album", "Song 0", 0));
+
+  EXPECT_EQ(QStringList() << "Provider"
+                          << "Alpha"
+                          << "Bravo"
+                          << "Charlie"
+                          << "Delta",
+            Children());
+  EXPECT_EQ(QStringList() << "Song 0"
+                          << "Song 1"
+                          << "Song 3",
+            Children(Find("Album", Find("Alpha"))));
+
+  // Indexes into the model follow the rows that moved.
+  EXPECT_EQ(3, charlie.row());
+  EXPECT_EQ("Charlie", charlie.data().toString());
+  EXPECT_EQ(1, alpha_song.row());
+  EXPECT_EQ("Song 1", alpha_song.data().toString());
+
+  // Every node knows its own row.
+  for (int i = 0; i < model_.rowCount(); ++i) {
+    EXPECT_EQ(i, model_.index(i, 0).row());
+    EXPECT_EQ(QModelIndex(), model_.parent(model_.index(i, 0)));
+  }
+}
+
+TEST_F(GlobalSearchModelTest, InsertsEachRunOfRowsOnce) {
+  model_.AddResults(SearchProvider::ResultList()
+                    << MakeResult("Bravo", "Album", "Song")
+                    << MakeResult("Echo", "Album", "Song"));
+
+  QSignalSpy spy(&model_, SIGNAL(rowsInserted(QModelIndex, int, int)));
+  model_.AddResults(SearchProvider::ResultList()
+                    << MakeResult("Alpha", "Album", "Song")
+                    << MakeResult("Charlie", "Album", "Song")
+                    << MakeResult("Delta", "Album", "Song")
+                    << MakeResult("Foxtrot", "Album", "Song"));
+
+  // Alpha goes between the divider and Bravo, Charlie and Delta go together
+  // before Echo, and Foxtrot goes on the end.
+  ASSERT_EQ(3, spy.count());
+  EXPECT_EQ(1, spy[0][1].toInt());
+  EXPECT_EQ(1, spy[0][2].toInt());
+  EXPECT_EQ(3, spy[1][1].toInt());
+  EXPECT_EQ(4, spy[1][2].toInt());
+  EXPECT_EQ(6, spy[2][1].toInt());
+  EXPECT_EQ(6, spy[2][2].toInt());
+
+  // New containers are inserted with their children already in them.
+  EXPECT_EQ(1, model_.rowCount(Find("Charlie")));
+}
+
+TEST_F(GlobalSearchModelTest, ProvidersAreKeptApart) {
+  model_.set_provider_order(QStringList() << "other"
+                                          << "provider");
+  model_.AddResults(SearchProvider::ResultList()
+                    << MakeResult("Alpha", "Album", "Song"));
+  model_.AddResults(SearchProvider::ResultList()
+                    << MakeResult(&other_provider_, "Bravo", "Album", "Song"));
+
+  EXPECT_EQ(QStringList() << "Other"
+                          << "Bravo"
+                          << "Provider"
+                          << "Alpha",
+            Children());
+}
+
+TEST_F(GlobalSearchModelTest, UngroupedResultsFollowContainers) {
+  SearchProvider::Result ungrouped = MakeResult("Alpha", "Album", "Loose");
+  ungrouped.group_automatically_ = false;
+
+  model_.AddResults(SearchProvider::ResultList()
+                    << ungrouped << MakeResult("Bravo", "Album", "Song"));
+
+  EXPECT_EQ(QStringList() << "Provider"
+                          << "Bravo"
+                          << "Loose",
+            Children());
+}
+
+TEST_F(GlobalSearchModelTest, Clear) {
+  model_.AddResults(SearchProvider::ResultList()
+                    << MakeResult("Alpha", "Album", "Song"));
+  model_.Clear();
+  EXPECT_EQ(0, model_.rowCount());
+
+  // Containers from before aren't reused.
+  model_.AddResults(SearchProvider::ResultList()
+                    << MakeResult("Alpha", "Album", "Song"));
+  EXPECT_EQ(QStringList() << "Provider"
+                          << "Alpha",
+            Children());
+  EXPECT_EQ(1, model_.rowCount(Find("Album", Find("Alpha"))));
+}
+
+}  // namespace
@@ -0,0 +1,138 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <memory>
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include <QDir>
+#include <QFile>
+#include <QList>
+#include <QTemporaryFile>
+#include <QUrl>
+
+#include "core/taskmanager.h"
+#include "engines/gstengine.h"
+#include "engines/gstenginepipeline.h"
+
+namespace {
+
+// Remembers the URL of every pipeline it creates.
+class CountingGstEngine : public GstEngine {
+ public:
+  explicit CountingGstEngine(TaskManager* task_manager)
+      : GstEngine(task_manager) {}
+
+  QList<QUrl> created_;
+
+ protected:
+  std::shared_ptr<GstEnginePipeline> CreatePipeline(const QUrl& url,
+                                                    qint64 end_nanosec) {
+    created_ << url;
+    return GstEngine::CreatePipeline(url, end_nanosec);
+  }
+};
+
+class GstEngineTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    engine_.reset(new CountingGstEngine(&task_manager_));
+    ASSERT_TRUE(engine_->Init());
+    engine_->EnsureInitialised();
+
+    first_.reset(SaveToTempFile());
+    second_.reset(SaveToTempFile());
+  }
+
+  QTemporaryFile* SaveToTempFile() {
+    QFile resource(":/testdata/beep.ogg");
+    resource.open(QIODevice::ReadOnly);
+
+    QTemporaryFile* file =
+        new QTemporaryFile(QDir::tempPath() + "/gstenginetest-XXXXXX.ogg");
+    file->open();
+    file->write(resource.readAll());
+    file->flush();
+    return file;
+  }
+
+  QUrl Url(QTemporaryFile* file) const {
+    return QUrl::fromLocalFile(file->fileName());
+  }
+
+  bool Load(const QUrl& url) {
+    return engine_->Load(url, Engine::Manual, false, 0, 0);
+  }
+
+  TaskManager task_manager_;
+  std::unique_ptr<CountingGstEngine> engine_;
+  std::unique_ptr<QTemporaryFile> first_;
+  std::unique_ptr<QTemporaryFile> second_;
+};
+
+TEST_F(GstEngineTest, RepeatedPrerollsReuseThePipeline) {
+  // The player asks again whenever the playlist changes.
+  engine_->StartPrerolling(Url(first_.get()), false, 0, 0);
+  engine_->StartPrerolling(Url(first_.get()), false, 0, 0);
+  engine_->StartPrerolling(Url(first_.get()), false, 0, 0);
+
+  ASSERT_EQ(1, engine_->created_.count());
+  EXPECT_EQ(Url(first_.get()), engine_->created_[0]);
+}
+
+TEST_F(GstEngineTest, LoadTakesOverThePrerolledPipeline) {
+  engine_->StartPrerolling(Url(first_.get()), false, 0, 0);
+  EXPECT_TRUE(Load(Url(first_.get())));
+  EXPECT_EQ(1, engine_->created_.count());
+
+  // It's only used once.
+  EXPECT_TRUE(Load(Url(first_.get())));
+  EXPECT_EQ(2, engine_->created_.count());
+}
+
+TEST_F(GstEngineTest, LoadOfAnotherTrackIgnoresThePreroll) {
+  engine_->StartPrerolling(Url(first_.get()), false, 0, 0);
+  EXPECT_TRUE(Load(Url(second_.get())));
+
+  ASSERT_EQ(2, engine_->created_.count());
+  EXPECT_EQ(Url(second_.get()), engine_->created_[1]);
+}
+
+TEST_F(GstEngineTest, DifferentSectionIsPrerolledAgain) {
+  engine_->StartPrerolling(Url(first_.get()), true, 0, 1000);
+  engine_->StartPrerolling(Url(first_.get()), true, 0, 2000);
+  EXPECT_EQ(2, engine_->created_.count());
+
+  EXPECT_TRUE(engine_->Load(Url(first_.get()), Engine::Manual, true, 0, 2000));
+  EXPECT_EQ(2, engine_->created_.count());
+}
+
+TEST_F(GstEngineTest, EmptyUrlCancelsThePreroll) {
+  engine_->StartPrerolling(Url(first_.get()), false, 0, 0);
+  engine_->StartPrerolling(QUrl(), false, 0, 0);
+  EXPECT_TRUE(Load(Url(first_.get())));
+
+  EXPECT_EQ(2, engine_->created_.count());
+}
+
+TEST_F(GstEngineTest, StreamsAreNotPrerolled) {
+  engine_->StartPrerolling(QUrl("http://example.com/stream.ogg"), false, 0, 0);
+  EXPECT_TRUE(engine_->created_.isEmpty());
+}
+
+}  // namespace
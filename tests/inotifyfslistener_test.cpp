@@ -0,0 +1,197 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <memory>
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QSignalSpy>
+#include <QStringList>
+#include <QTimer>
+
+#include "core/inotifyfslistener.h"
+#include "core/utilities.h"
+
+namespace {
+
+const int kCoalesceIntervalMsec = 100;
+
+class InotifyFSListenerTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    dir_ = Utilities::MakeTempDir();
+    listener_.reset(new InotifyFSListener);
+    listener_->Init();
+    listener_->SetCoalesceInterval(kCoalesceIntervalMsec);
+    listener_->AddPath(dir_);
+  }
+
+  void TearDown() {
+    listener_.reset();
+    Utilities::RemoveRecursive(dir_);
+  }
+
+  QString WriteFile(const QString& name) {
+    const QString filename = dir_ + "/" + name;
+    QFile file(filename);
+    file.open(QIODevice::WriteOnly);
+    file.write("data");
+    return filename;
+  }
+
+  // Runs the event loop until the listener reports something, or until the
+  // timeout passes.
+  void WaitForChanges(int timeout_msec = kCoalesceIntervalMsec * 20) {
+    QEventLoop loop;
+    QObject::connect(listener_.get(), SIGNAL(PathChanged(QString)), &loop,
+                     SLOT(quit()));
+    QObject::connect(listener_.get(), SIGNAL(FilesChanged(QStringList)),
+                     &loop, SLOT(quit()));
+    QTimer::singleShot(timeout_msec, &loop, SLOT(quit()));
+    loop.exec();
+  }
+
+  // Runs the event loop for long enough that any pending changes would have
+  // been reported.
+  void WaitForNoChanges() { WaitForChanges(kCoalesceIntervalMsec * 3); }
+
+  QString dir_;
+  std::unique_ptr<InotifyFSListener> listener_;
+};
+
+TEST_F(InotifyFSListenerTest, CoalescesFileEvents) {
+  QSignalSpy files_spy(listener_.get(), SIGNAL(FilesChanged(QStringList)));
+  QSignalSpy path_spy(listener_.get(), SIGNAL(PathChanged(QString)));
+
+  const QString a = WriteFile("a.mp3");
+  const QString b = WriteFile("b.mp3");
+  WriteFile("a.mp3");
+  WaitForChanges();
+  WaitForNoChanges();
+
+  ASSERT_EQ(1, files_spy.count());
+  QStringList files = files_spy[0][0].toStringList();
+  files.sort();
+  EXPECT_EQ(QStringList() << a << b, files);
+  EXPECT_EQ(0, path_spy.count());
+}
+
+TEST_F(InotifyFSListenerTest, ReportsDeletedAndMovedFiles) {
+  const QString a = WriteFile("a.mp3");
+  const QString b = WriteFile("b.mp3");
+  WaitForChanges();
+
+  QSignalSpy files_spy(listener_.get(), SIGNAL(FilesChanged(QStringList)));
+  const QString c = dir_ + "/c.mp3";
+  QFile::remove(a);
+  QFile::rename(b, c);
+  WaitForChanges();
+
+  ASSERT_EQ(1, files_spy.count());
+  QStringList files = files_spy[0][0].toStringList();
+  files.sort();
+  EXPECT_EQ(QStringList() << a << b << c, files);
+}
+
+TEST_F(InotifyFSListenerTest, NewSubdirectoryRescansDirectory) {
+  QSignalSpy files_spy(listener_.get(), SIGNAL(FilesChanged(QStringList)));
+  QSignalSpy path_spy(listener_.get(), SIGNAL(PathChanged(QString)));
+
+  // The file doesn't need to be reported separately because the whole
+  // directory is going to be rescanned.
+  WriteFile("a.mp3");
+  QDir(dir_).mkdir("subdir");
+  WaitForChanges();
+  WaitForNoChanges();
+
+  ASSERT_EQ(1, path_spy.count());
+  EXPECT_EQ(dir_, path_spy[0][0].toString());
+  EXPECT_EQ(0, files_spy.count());
+}
+
+TEST_F(InotifyFSListenerTest, RemovedPathIsNotReported) {
+  QSignalSpy files_spy(listener_.get(), SIGNAL(FilesChanged(QStringList)));
+  QSignalSpy path_spy(listener_.get(), SIGNAL(PathChanged(QString)));
+
+  listener_->RemovePath(dir_);
+  WriteFile("a.mp3");
+  WaitForNoChanges();
+
+  EXPECT_EQ(0, files_spy.count());
+  EXPECT_EQ(0, path_spy.count());
+}
+
+TEST_F(InotifyFSListenerTest, ClearDropsPendingEvents) {
+  QSignalSpy files_spy(listener_.get(), SIGNAL(FilesChanged(QStringList)));
+  QSignalSpy path_spy(listener_.get(), SIGNAL(PathChanged(QString)));
+
+  WriteFile("a.mp3");
+  listener_->Clear();
+  WaitForNoChanges();
+
+  EXPECT_EQ(0, files_spy.count());
+  EXPECT_EQ(0, path_spy.count());
+
+  // Watching again reports new changes.
+  listener_->AddPath(dir_);
+  const QString b = WriteFile("b.mp3");
+  WaitForChanges();
+
+  ASSERT_EQ(1, files_spy.count());
+  EXPECT_EQ(QStringList() << b, files_spy[0][0].toStringList());
+}
+
+TEST_F(InotifyFSListenerTest, MovedSubdirectoryIsNoLongerWatched) {
+  const QString outside = Utilities::MakeTempDir();
+  const QString subdir = dir_ + "/subdir";
+  QDir(dir_).mkdir("subdir");
+  listener_->AddPath(subdir);
+  WaitForChanges();
+
+  QSignalSpy path_spy(listener_.get(), SIGNAL(PathChanged(QString)));
+  ASSERT_TRUE(QDir().rename(subdir, outside + "/subdir"));
+  WaitForChanges();
+  WaitForNoChanges();
+
+  // The parent is rescanned to find out where it went.
+  QStringList paths;
+  for (const QList<QVariant>& args : path_spy) {
+    paths << args[0].toString();
+  }
+  EXPECT_TRUE(paths.contains(dir_));
+
+  // Files written in its new location aren't reported under the old path.
+  QSignalSpy files_spy(listener_.get(), SIGNAL(FilesChanged(QStringList)));
+  path_spy.clear();
+  QFile file(outside + "/subdir/a.mp3");
+  file.open(QIODevice::WriteOnly);
+  file.write("data");
+  file.close();
+  WaitForNoChanges();
+
+  EXPECT_EQ(0, files_spy.count());
+  EXPECT_EQ(0, path_spy.count());
+
+  Utilities::RemoveRecursive(outside);
+}
+
+}  // namespace
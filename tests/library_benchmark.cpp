@@ -0,0 +1,211 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <memory>
+
+#include <QSqlQuery>
+#include <QStringList>
+
+#include "gtest/gtest.h"
+
+#include "benchmark_utils.h"
+#include "core/database.h"
+#include "core/preparedstatementcache.h"
+#include "core/song.h"
+#include "library/library.h"
+#include "library/librarybackend.h"
+#include "library/librarymodel.h"
+#include "library/libraryquery.h"
+
+namespace {
+
+const int kLibrarySize = 100000;
+
+// Builds a library of kLibrarySize songs once and shares it between all the
+// benchmarks that only read from it.
+class LibraryBenchmark : public ::testing::Test {
+ protected:
+  static void SetUpTestCase() {
+    songs_ = new SongList(benchmark::SyntheticSongs(kLibrarySize));
+    database_ = new MemoryDatabase(nullptr);
+    backend_ = CreateBackend(database_);
+    backend_->AddOrUpdateSongs(*songs_);
+  }
+
+  static void TearDownTestCase() {
+    delete backend_;
+    delete database_;
+    delete songs_;
+  }
+
+  static LibraryBackend* CreateBackend(Database* database) {
+    LibraryBackend* ret = new LibraryBackend;
+    ret->Init(database, Library::kSongsTable, Library::kDirsTable,
+              Library::kSubdirsTable, Library::kFtsTable);
+    ret->AddDirectory("/music");
+    return ret;
+  }
+
+  static SongList* songs_;
+  static Database* database_;
+  static LibraryBackend* backend_;
+};
+
+SongList* LibraryBenchmark::songs_ = nullptr;
+Database* LibraryBenchmark::database_ = nullptr;
+LibraryBackend* LibraryBenchmark::backend_ = nullptr;
+
+TEST_F(LibraryBenchmark, SongInitFromQuery) {
+  QSqlQuery q(database_->Connect());
+  q.setForwardOnly(true);
+
+  int count = 0;
+  benchmark::Run("songs", 5, kLibrarySize, [&] {
+    ASSERT_TRUE(q.exec(QString("SELECT ROWID, %1 FROM %2")
+                           .arg(Song::kColumnSpec, Library::kSongsTable)));
+    count = 0;
+    while (q.next()) {
+      Song song;
+      song.InitFromQuery(q, true);
+      count++;
+    }
+  });
+
+  EXPECT_EQ(kLibrarySize, count);
+}
+
+TEST_F(LibraryBenchmark, SongBindToQuery) {
+  QSqlQuery q(database_->Connect());
+  q.prepare(QString("UPDATE %1 SET %2 WHERE ROWID = :id")
+                .arg(Library::kSongsTable, Song::kUpdateSpec));
+
+  benchmark::Run("songs", 5, kLibrarySize, [&] {
+    for (const Song& song : *songs_) {
+      song.BindToQuery(&q);
+    }
+  });
+}
+
+TEST_F(LibraryBenchmark, AddOrUpdateSongs) {
+  std::unique_ptr<Database> database;
+  std::unique_ptr<LibraryBackend> backend;
+
+  benchmark::Run("insert", 3, kLibrarySize,
+                 [&] {
+                   backend.reset();
+                   database.reset(new MemoryDatabase(nullptr));
+                   backend.reset(CreateBackend(database.get()));
+                 },
+                 [&] { backend->AddOrUpdateSongs(*songs_); });
+
+  // Songs that are already in the library get updated in place.
+  const SongList existing = backend->GetAllSongs();
+  ASSERT_EQ(kLibrarySize, existing.count());
+  benchmark::Run("update", 3, kLibrarySize,
+                 [&] { backend->AddOrUpdateSongs(existing); });
+}
+
+TEST_F(LibraryBenchmark, UpdateCompilations) {
+  benchmark::Run("full", 3, kLibrarySize,
+                 [&] { backend_->UpdateCompilations(); });
+
+  // What a scan that changed one song in one album does.
+  const QStringList albums = QStringList() << songs_->first().album();
+  benchmark::Run("one album", 10, 1,
+                 [&] { backend_->UpdateCompilationsForAlbums(albums); });
+}
+
+TEST_F(LibraryBenchmark, PreparedStatementCache) {
+  const int kLookups = 20000;
+  const QString sql = QString("SELECT title FROM %1 WHERE ROWID = :id")
+                          .arg(Library::kSongsTable);
+  QSqlDatabase db(database_->Connect());
+
+  // What the backends used to do: build and prepare a new query every time.
+  int uncached_count = 0;
+  benchmark::Run("uncached", 5, kLookups, [&] {
+    uncached_count = 0;
+    for (int i = 0; i < kLookups; ++i) {
+      QSqlQuery q(db);
+      q.prepare(sql);
+      q.bindValue(":id", i % kLibrarySize + 1);
+      q.exec();
+      if (q.next()) uncached_count++;
+    }
+  });
+
+  PreparedStatementCache* cache = database_->StatementCache(db);
+  int cached_count = 0;
+  benchmark::Run("cached", 5, kLookups, [&] {
+    cached_count = 0;
+    for (int i = 0; i < kLookups; ++i) {
+      CachedQuery q(cache, sql);
+      q.bindValue(":id", i % kLibrarySize + 1);
+      q.exec();
+      if (q.next()) cached_count++;
+    }
+  });
+
+  EXPECT_EQ(kLookups, uncached_count);
+  EXPECT_EQ(kLookups, cached_count);
+}
+
+TEST_F(LibraryBenchmark, FtsSearch) {
+  const QStringList kFilters = QStringList() << "love"
+                                             << "night fire"
+                                             << "sha"
+                                             << "Rock"
+                                             << "machine 12";
+
+  for (const QString& filter : kFilters) {
+    int count = 0;
+    benchmark::Run(filter, 10, 1, [&] {
+      QueryOptions options;
+      options.set_filter(filter);
+
+      LibraryQuery q(options);
+      q.SetColumnSpec("ROWID, " + Song::kColumnSpec);
+      ASSERT_TRUE(backend_->ExecQuery(&q));
+
+      count = 0;
+      while (q.Next()) {
+        count++;
+      }
+    });
+    EXPECT_GT(count, 0) << filter.toStdString();
+  }
+}
+
+TEST_F(LibraryBenchmark, LibraryModelReset) {
+  LibraryModel model(backend_, nullptr);
+
+  benchmark::Run("artists", 10, kLibrarySize / 10, [&] { model.Reset(); });
+  EXPECT_GT(model.rowCount(QModelIndex()), 0);
+
+  // Expanding every artist, like "expand all" in the library view.
+  benchmark::Run("albums", 3, kLibrarySize / 10,
+                 [&] { model.Reset(); },
+                 [&] {
+                   for (int i = 0; i < model.rowCount(QModelIndex()); ++i) {
+                     const QModelIndex index = model.index(i, 0);
+                     if (model.canFetchMore(index)) model.fetchMore(index);
+                   }
+                 });
+}
+
+}  // namespace
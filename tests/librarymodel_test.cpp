@@ -24,6 +24,7 @@
 #include "library/librarymodel.h"
 #include "library/librarybackend.h"
 #include "library/library.h"
+#include "library/libraryquerymimedata.h"
 
 #include <QtDebug>
 #include <QThread>
@@ -35,10 +36,11 @@ namespace {
 class LibraryModelTest : public ::testing::Test {
  protected:
   void SetUp() {
-    database_.reset(new MemoryDatabase);
+    database_.reset(new MemoryDatabase(nullptr));
     backend_.reset(new LibraryBackend);
-    backend_->Init(database_, Library::kSongsTable,
-                   Library::kDirsTable, Library::kSubdirsTable, Library::kFtsTable);
+    backend_->Init(database_.get(), Library::kSongsTable,
+                   Library::kDirsTable, Library::kSubdirsTable,
+                   Library::kFtsTable, Library::kGroupsTable);
     model_.reset(new LibraryModel(backend_.get(), nullptr));
 
     added_dir_ = false;
@@ -304,4 +306,82 @@ TEST_F(LibraryModelTest, RemoveEmptyArtists) {
   ASSERT_EQ(0, model_->rowCount(QModelIndex()));
 }
 
+TEST_F(LibraryModelTest, DragUnloadedContainers) {
+  Song songs[4];
+  songs[0].Init("Title 1", "Artist 2", "Album B", 123);
+  songs[1].Init("Title 2", "Artist 1", "Album A", 123);
+  songs[2].Init("Title 3", "Artist 1", "Album A", 123);
+  songs[3].Init("Title 4", "Artist 1", "Album C", 123);
+  songs[1].set_track(2);
+  songs[2].set_track(1);
+  for (int i = 0; i < 4; ++i) AddSong(songs[i]);
+  model_->Init(false);
+
+  // Sorted rows are the "A" divider, then the artists.
+  QModelIndex artist_index =
+      model_sorted_->mapToSource(model_sorted_->index(1, 0, QModelIndex()));
+  ASSERT_EQ("Artist 1", artist_index.data().toString());
+
+  // The artist hasn't been expanded, so the songs come from a query.
+  std::unique_ptr<QMimeData> data(
+      model_->mimeData(QModelIndexList() << artist_index));
+  LibraryQueryMimeData* query_data =
+      qobject_cast<LibraryQueryMimeData*>(data.get());
+  ASSERT_TRUE(query_data);
+
+  QSet<int> song_ids;
+  SongList queried;
+  for (const LibraryQueryMimeData::Part& part : query_data->parts) {
+    queried << LibraryQueryMimeData::ResolvePart(query_data->library(), part,
+                                                 &song_ids);
+  }
+
+  // They should be the same songs in the same order as the model gives once
+  // it's been populated.
+  SongList populated = model_->GetChildSongs(artist_index);
+  ASSERT_EQ(3, queried.count());
+  ASSERT_EQ(populated.count(), queried.count());
+  for (int i = 0; i < populated.count(); ++i) {
+    EXPECT_EQ(populated[i].id(), queried[i].id());
+  }
+
+  // Now everything under it is loaded it's a normal SongMimeData again.
+  data.reset(model_->mimeData(QModelIndexList() << artist_index));
+  EXPECT_FALSE(qobject_cast<LibraryQueryMimeData*>(data.get()));
+  EXPECT_TRUE(qobject_cast<SongMimeData*>(data.get()));
+}
+
+TEST_F(LibraryModelTest, DragAllUnloadedContainers) {
+  AddSong("Title 1", "Artist 1", "Album", 123);
+  AddSong("Title 2", "Artist 2", "Album", 123);
+  AddSong("Title 3", "Artist 3", "Album", 123);
+  model_->Init(false);
+
+  QModelIndexList indexes;
+  for (int i = 0; i < model_->rowCount(QModelIndex()); ++i) {
+    QModelIndex index = model_->index(i, 0, QModelIndex());
+    if (index.data().toString().startsWith("Artist")) indexes << index;
+  }
+  ASSERT_EQ(3, indexes.count());
+
+  // Selecting every artist is a single query for the whole library.
+  std::unique_ptr<QMimeData> data(model_->mimeData(indexes));
+  LibraryQueryMimeData* query_data =
+      qobject_cast<LibraryQueryMimeData*>(data.get());
+  ASSERT_TRUE(query_data);
+  ASSERT_EQ(1, query_data->parts.count());
+
+  QSet<int> song_ids;
+  SongList songs = LibraryQueryMimeData::ResolvePart(
+      query_data->library(), query_data->parts[0], &song_ids);
+  ASSERT_EQ(3, songs.count());
+  EXPECT_EQ("Artist 1", songs[0].artist());
+  EXPECT_EQ("Artist 2", songs[1].artist());
+  EXPECT_EQ("Artist 3", songs[2].artist());
+
+  // External drop targets still get the URLs.
+  EXPECT_TRUE(data->hasUrls());
+  EXPECT_EQ(3, data->urls().count());
+}
+
 } // namespace
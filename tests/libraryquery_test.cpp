@@ -0,0 +1,131 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <memory>
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include <QSet>
+
+#include "core/database.h"
+#include "core/song.h"
+#include "library/library.h"
+#include "library/librarybackend.h"
+#include "library/libraryquery.h"
+
+namespace {
+
+class LibraryQueryTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    database_.reset(new MemoryDatabase(nullptr));
+    backend_.reset(new LibraryBackend);
+    backend_->Init(database_.get(), Library::kSongsTable, Library::kDirsTable,
+                   Library::kSubdirsTable, Library::kFtsTable);
+    backend_->AddDirectory("/tmp");
+  }
+
+  void AddSongs(int count) {
+    SongList songs;
+    for (int i = 0; i < count; ++i) {
+      Song song;
+      song.Init(QString("Title %1").arg(i), "Artist", "Album", 100);
+      song.set_directory_id(1);
+      song.set_url(QUrl::fromLocalFile(QString("/tmp/%1.mp3").arg(i)));
+      song.set_mtime(1);
+      song.set_ctime(1);
+      song.set_filesize(1);
+      songs << song;
+    }
+    backend_->AddOrUpdateSongs(songs);
+  }
+
+  std::shared_ptr<Database> database_;
+  std::unique_ptr<LibraryBackend> backend_;
+};
+
+TEST_F(LibraryQueryTest, RandomSampleOfEmptyLibrary) {
+  LibraryQuery q;
+  q.SetColumnSpec("ROWID");
+  q.AddRandomSample(10);
+
+  ASSERT_TRUE(backend_->ExecQuery(&q));
+  EXPECT_FALSE(q.Next());
+}
+
+TEST_F(LibraryQueryTest, RandomSample) {
+  AddSongs(100);
+
+  LibraryQuery q;
+  q.SetColumnSpec("ROWID");
+  q.AddRandomSample(10);
+  ASSERT_TRUE(backend_->ExecQuery(&q));
+
+  QSet<int> rowids;
+  while (q.Next()) {
+    const int rowid = q.Value(0).toInt();
+    EXPECT_GE(rowid, 1);
+    EXPECT_LE(rowid, 100);
+    rowids << rowid;
+  }
+
+  // Duplicate ROWIDs are only returned once.
+  EXPECT_GE(rowids.count(), 1);
+  EXPECT_LE(rowids.count(), 10);
+}
+
+TEST_F(LibraryQueryTest, Limit) {
+  AddSongs(20);
+
+  LibraryQuery q;
+  q.SetColumnSpec("ROWID");
+  q.SetLimit(5);
+  ASSERT_TRUE(backend_->ExecQuery(&q));
+
+  int count = 0;
+  while (q.Next()) ++count;
+  EXPECT_EQ(5, count);
+}
+
+TEST_F(LibraryQueryTest, InterruptBeforeAttach) {
+  AddSongs(10);
+
+  DatabaseInterrupter interrupter;
+  EXPECT_FALSE(interrupter.is_interrupted());
+  interrupter.Interrupt();
+  EXPECT_TRUE(interrupter.is_interrupted());
+
+  // The query can still be run and the connection isn't left interrupted
+  // after the interrupter is detached.
+  LibraryQuery q;
+  q.SetColumnSpec("ROWID");
+  q.SetInterrupter(&interrupter);
+  backend_->ExecQuery(&q);
+  while (q.Next()) {
+  }
+  interrupter.Detach();
+
+  LibraryQuery q2;
+  q2.SetColumnSpec("ROWID");
+  ASSERT_TRUE(backend_->ExecQuery(&q2));
+  int count = 0;
+  while (q2.Next()) ++count;
+  EXPECT_EQ(10, count);
+}
+
+}  // namespace
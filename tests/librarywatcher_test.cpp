@@ -0,0 +1,189 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <memory>
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSignalSpy>
+#include <QStringList>
+
+#include "core/database.h"
+#include "core/song.h"
+#include "core/taskmanager.h"
+#include "core/utilities.h"
+#include "library/directory.h"
+#include "library/library.h"
+#include "library/librarybackend.h"
+#include "library/librarywatcher.h"
+
+namespace {
+
+class LibraryWatcherTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    path_ = Utilities::MakeTempDir();
+
+    database_.reset(new MemoryDatabase(nullptr));
+    backend_.reset(new LibraryBackend);
+    backend_->Init(database_.get(), Library::kSongsTable, Library::kDirsTable,
+                   Library::kSubdirsTable, Library::kFtsTable,
+                   Library::kGroupsTable);
+
+    QSignalSpy spy(backend_.get(),
+                   SIGNAL(DirectoryDiscovered(Directory, SubdirectoryList)));
+    backend_->AddDirectory(path_);
+    ASSERT_EQ(1, spy.count());
+    dir_ = spy[0][0].value<Directory>();
+
+    watcher_.reset(new LibraryWatcher);
+    watcher_->set_backend(backend_.get());
+    watcher_->set_task_manager(&task_manager_);
+  }
+
+  void TearDown() {
+    watcher_.reset();
+    Utilities::RemoveRecursive(path_);
+  }
+
+  QString Filename(const QString& name) const { return dir_.path + "/" + name; }
+
+  // Creates a file and adds a song for it to the library, so the watcher
+  // doesn't need to read its tags.
+  Song AddSong(const QString& name) {
+    const QString filename = Filename(name);
+    {
+      QFile file(filename);
+      file.open(QIODevice::WriteOnly);
+      file.write("data");
+    }
+    QFileInfo info(filename);
+
+    Song song;
+    song.Init(name, "Artist", "Album", 100);
+    song.set_directory_id(dir_.id);
+    song.set_url(QUrl::fromLocalFile(filename));
+    song.set_mtime(info.lastModified().toTime_t());
+    song.set_ctime(info.created().toTime_t());
+    song.set_filesize(info.size());
+    backend_->AddOrUpdateSongs(SongList() << song);
+
+    SongList songs = backend_->GetSongsByUrl(QUrl::fromLocalFile(filename));
+    return songs.isEmpty() ? Song() : songs[0];
+  }
+
+  // Starts watching the directory without scanning it again.
+  void StartWatching() {
+    Subdirectory subdir;
+    subdir.directory_id = dir_.id;
+    subdir.mtime = QFileInfo(dir_.path).lastModified().toTime_t();
+    subdir.path = dir_.path;
+    watcher_->AddDirectory(dir_, SubdirectoryList() << subdir);
+  }
+
+  // Reports files as changed, like the filesystem watcher would, and rescans
+  // them straight away.
+  void RescanFiles(const QStringList& files) {
+    QMetaObject::invokeMethod(watcher_.get(), "FilesChanged",
+                              Q_ARG(QStringList, files));
+    QMetaObject::invokeMethod(watcher_.get(), "RescanPathsNow");
+  }
+
+  QString path_;
+  Directory dir_;
+  std::shared_ptr<Database> database_;
+  std::unique_ptr<LibraryBackend> backend_;
+  TaskManager task_manager_;
+  std::unique_ptr<LibraryWatcher> watcher_;
+};
+
+TEST_F(LibraryWatcherTest, DeletedFileIsReported) {
+  const Song a = AddSong("a.mp3");
+  const Song b = AddSong("b.mp3");
+  ASSERT_TRUE(a.is_valid());
+  ASSERT_TRUE(b.is_valid());
+  StartWatching();
+
+  QSignalSpy deleted_spy(watcher_.get(), SIGNAL(SongsDeleted(SongList)));
+  QSignalSpy subdirs_spy(watcher_.get(),
+                         SIGNAL(SubdirsMTimeUpdated(SubdirectoryList)));
+
+  // Only the files that were reported are looked at, so b isn't noticed yet.
+  QFile::remove(Filename("a.mp3"));
+  QFile::remove(Filename("b.mp3"));
+  RescanFiles(QStringList() << Filename("a.mp3"));
+
+  ASSERT_EQ(1, deleted_spy.count());
+  SongList deleted = deleted_spy[0][0].value<SongList>();
+  ASSERT_EQ(1, deleted.count());
+  EXPECT_EQ(a.id(), deleted[0].id());
+
+  ASSERT_EQ(1, subdirs_spy.count());
+  SubdirectoryList subdirs = subdirs_spy[0][0].value<SubdirectoryList>();
+  ASSERT_EQ(1, subdirs.count());
+  EXPECT_EQ(dir_.path, subdirs[0].path);
+  EXPECT_EQ(QFileInfo(dir_.path).lastModified().toTime_t(), subdirs[0].mtime);
+}
+
+TEST_F(LibraryWatcherTest, UnchangedFileIsNotUpdated) {
+  AddSong("a.mp3");
+  StartWatching();
+
+  QSignalSpy new_spy(watcher_.get(), SIGNAL(NewOrUpdatedSongs(SongList)));
+  QSignalSpy deleted_spy(watcher_.get(), SIGNAL(SongsDeleted(SongList)));
+  QSignalSpy subdirs_spy(watcher_.get(),
+                         SIGNAL(SubdirsMTimeUpdated(SubdirectoryList)));
+
+  RescanFiles(QStringList() << Filename("a.mp3"));
+
+  EXPECT_EQ(0, new_spy.count());
+  EXPECT_EQ(0, deleted_spy.count());
+  EXPECT_EQ(1, subdirs_spy.count());
+}
+
+TEST_F(LibraryWatcherTest, UnavailableFileIsReadded) {
+  const Song a = AddSong("a.mp3");
+  ASSERT_TRUE(a.is_valid());
+  backend_->MarkSongsUnavailable(SongList() << a);
+  StartWatching();
+
+  QSignalSpy readded_spy(watcher_.get(), SIGNAL(SongsReadded(SongList, bool)));
+  RescanFiles(QStringList() << Filename("a.mp3"));
+
+  ASSERT_EQ(1, readded_spy.count());
+  SongList readded = readded_spy[0][0].value<SongList>();
+  ASSERT_EQ(1, readded.count());
+  EXPECT_EQ(a.id(), readded[0].id());
+}
+
+TEST_F(LibraryWatcherTest, FilesOutsideTheLibraryAreIgnored) {
+  StartWatching();
+
+  const QString other = Utilities::MakeTempDir();
+  QSignalSpy subdirs_spy(watcher_.get(),
+                         SIGNAL(SubdirsMTimeUpdated(SubdirectoryList)));
+  RescanFiles(QStringList() << other + "/a.mp3");
+  Utilities::RemoveRecursive(other);
+
+  EXPECT_EQ(0, subdirs_spy.count());
+}
+
+}  // namespace
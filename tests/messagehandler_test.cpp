@@ -0,0 +1,186 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <memory>
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QtEndian>
+
+#include "core/messagehandler.h"
+#include "tagreadermessages.pb.h"
+
+namespace {
+
+typedef pb::tagreader::Message Message;
+
+class TestHandler : public AbstractMessageHandler<Message> {
+ public:
+  explicit TestHandler(QIODevice* device)
+      : AbstractMessageHandler<Message>(device, nullptr) {}
+
+  QList<Message> messages_;
+
+ protected:
+  void MessageArrived(const Message& message) { messages_ << message; }
+};
+
+Message ArtMessage(int id, int size) {
+  Message message;
+  message.set_id(id);
+
+  std::string* data =
+      message.mutable_load_embedded_art_response()->mutable_data();
+  data->resize(size);
+  for (int i = 0; i < size; ++i) {
+    (*data)[i] = char(i * 7 + id);
+  }
+  return message;
+}
+
+class MessageHandlerTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    const QString name = QString("messagehandler_test-%1").arg(
+        QCoreApplication::applicationPid());
+    QLocalServer::removeServer(name);
+    ASSERT_TRUE(server_.listen(name));
+
+    client_socket_.reset(new QLocalSocket);
+    client_socket_->connectToServer(name);
+    ASSERT_TRUE(server_.waitForNewConnection(5000));
+    server_socket_.reset(server_.nextPendingConnection());
+    ASSERT_TRUE(server_socket_);
+
+    client_.reset(new TestHandler(client_socket_.get()));
+    server_.close();
+    server_handler_.reset(new TestHandler(server_socket_.get()));
+  }
+
+  virtual void TearDown() {
+    client_.reset();
+    server_handler_.reset();
+  }
+
+  // Runs the event loop until handler has received count messages.
+  void WaitForMessages(TestHandler* handler, int count) {
+    QElapsedTimer timer;
+    timer.start();
+    while (handler->messages_.count() < count && timer.elapsed() < 5000) {
+      QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 100);
+    }
+  }
+
+  QLocalServer server_;
+  std::unique_ptr<QLocalSocket> client_socket_;
+  std::unique_ptr<QLocalSocket> server_socket_;
+  std::unique_ptr<TestHandler> client_;
+  std::unique_ptr<TestHandler> server_handler_;
+};
+
+TEST_F(MessageHandlerTest, SendsMessages) {
+  client_->SendMessage(ArtMessage(1, 10));
+  client_->SendMessage(ArtMessage(2, 0));
+  client_->SendMessageAsync(ArtMessage(3, 1000));
+  WaitForMessages(server_handler_.get(), 3);
+
+  ASSERT_EQ(3, server_handler_->messages_.count());
+  EXPECT_EQ(ArtMessage(1, 10).SerializeAsString(),
+            server_handler_->messages_[0].SerializeAsString());
+  EXPECT_EQ(ArtMessage(2, 0).SerializeAsString(),
+            server_handler_->messages_[1].SerializeAsString());
+  EXPECT_EQ(ArtMessage(3, 1000).SerializeAsString(),
+            server_handler_->messages_[2].SerializeAsString());
+}
+
+TEST_F(MessageHandlerTest, ReadsPartialFrames) {
+  const std::string data = ArtMessage(1, 100).SerializeAsString();
+  QByteArray frame(4, '\0');
+  qToBigEndian<quint32>(data.size(), reinterpret_cast<uchar*>(frame.data()));
+  frame.append(data.data(), data.size());
+
+  // Write the frame a few bytes at a time, splitting the header as well.
+  for (int i = 0; i < frame.size(); i += 3) {
+    client_socket_->write(frame.mid(i, 3));
+    client_socket_->flush();
+    QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+  }
+  WaitForMessages(server_handler_.get(), 1);
+
+  ASSERT_EQ(1, server_handler_->messages_.count());
+  EXPECT_EQ(ArtMessage(1, 100).SerializeAsString(),
+            server_handler_->messages_[0].SerializeAsString());
+}
+
+TEST_F(MessageHandlerTest, SendsLargeMessagesThroughSharedMemory) {
+  client_->SetSharedMemoryThreshold(1024);
+
+  // More messages than there are free segments, in both sizes, to make sure
+  // segments get released and reused.
+  QList<Message> sent;
+  for (int i = 0; i < 10; ++i) {
+    sent << ArtMessage(i, i % 2 ? 512 : 200 * 1024 + i);
+    if (i % 3) {
+      client_->SendMessage(sent.last());
+    } else {
+      client_->SendMessageAsync(sent.last());
+    }
+  }
+  WaitForMessages(server_handler_.get(), sent.count());
+
+  // The async messages are written later, so compare them by ID.
+  ASSERT_EQ(sent.count(), server_handler_->messages_.count());
+  for (const Message& message : server_handler_->messages_) {
+    ASSERT_LT(message.id(), sent.count());
+    EXPECT_EQ(sent[message.id()].SerializeAsString(),
+              message.SerializeAsString());
+  }
+
+  // The server should be able to reply normally.
+  server_handler_->SendMessage(ArtMessage(42, 10));
+  WaitForMessages(client_.get(), 1);
+  ASSERT_EQ(1, client_->messages_.count());
+  EXPECT_EQ(42, client_->messages_[0].id());
+}
+
+#ifdef Q_OS_LINUX
+TEST_F(MessageHandlerTest, RemovesSharedMemoryNames) {
+  client_->SetSharedMemoryThreshold(1024);
+
+  for (int i = 0; i < 5; ++i) {
+    client_->SendMessage(ArtMessage(i, 100 * 1024 * (i + 1)));
+  }
+  WaitForMessages(server_handler_.get(), 5);
+  ASSERT_EQ(5, server_handler_->messages_.count());
+
+  // The receiver removes the names once it has the segments mapped, so
+  // nothing would be left behind if either process crashed now.
+  const QString pattern =
+      QString("clem-%1-*").arg(QCoreApplication::applicationPid());
+  EXPECT_TRUE(QDir("/dev/shm").entryList(QStringList() << pattern).isEmpty());
+}
+#endif
+
+}  // namespace
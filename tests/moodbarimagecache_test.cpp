@@ -0,0 +1,205 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QPixmap>
+#include <QSignalSpy>
+
+#include "moodbar/moodbarimagecache.h"
+
+namespace {
+
+// Returns moodbar data from memory instead of using a MoodbarLoader.
+class FakeMoodbarImageCache : public MoodbarImageCache {
+ public:
+  FakeMoodbarImageCache()
+      : MoodbarImageCache(nullptr), result_(MoodbarLoader::Loaded), loads_(0) {
+    for (int i = 0; i < 1000; ++i) {
+      data_.append(char(i % 256));
+      data_.append(char((i * 7) % 256));
+      data_.append(char((i * 13) % 256));
+    }
+  }
+
+  MoodbarLoader::Result result_;
+  QByteArray data_;
+  int loads_;
+
+ protected:
+  MoodbarLoader::Result LoadData(const QUrl& url, QByteArray* data,
+                                 MoodbarPipeline** pipeline) {
+    loads_++;
+    *data = data_;
+    return result_;
+  }
+};
+
+class MoodbarImageCacheTest : public ::testing::Test {
+ protected:
+  MoodbarImageCacheTest()
+      : url_(QUrl::fromLocalFile("/music/a.mp3")),
+        spy_(&cache_, SIGNAL(ImageLoaded(QUrl))) {}
+
+  MoodbarImageCache::Result Get(const QSize& size, QPixmap* pixmap,
+                                MoodbarRenderer::MoodbarStyle style =
+                                    MoodbarRenderer::Style_Normal) {
+    return cache_.Get(url_, size, style, pixmap);
+  }
+
+  // Runs the event loop until ImageLoaded has been emitted count times in
+  // total.  Returns false if it takes too long.
+  bool WaitForImageLoaded(int count) {
+    QElapsedTimer timer;
+    timer.start();
+    while (spy_.count() < count && timer.elapsed() < 5000) {
+      QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
+    }
+    return spy_.count() >= count;
+  }
+
+  // Gives anything else that was started a chance to finish.
+  void WaitForNothingElse() {
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < 200) {
+      QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+    }
+  }
+
+  FakeMoodbarImageCache cache_;
+  QUrl url_;
+  QSignalSpy spy_;
+};
+
+TEST_F(MoodbarImageCacheTest, RendersInTheBackground) {
+  QPixmap pixmap;
+  EXPECT_EQ(MoodbarImageCache::WillLoadAsync, Get(QSize(100, 10), &pixmap));
+  EXPECT_TRUE(pixmap.isNull());
+
+  ASSERT_TRUE(WaitForImageLoaded(1));
+  EXPECT_EQ(url_, spy_[0][0].toUrl());
+
+  EXPECT_EQ(MoodbarImageCache::Loaded, Get(QSize(100, 10), &pixmap));
+  EXPECT_EQ(QSize(100, 10), pixmap.size());
+}
+
+TEST_F(MoodbarImageCacheTest, KeyedBySizeStyleAndUrl) {
+  QPixmap pixmap;
+  Get(QSize(100, 10), &pixmap);
+  ASSERT_TRUE(WaitForImageLoaded(1));
+
+  EXPECT_EQ(MoodbarImageCache::Loaded, Get(QSize(100, 10), &pixmap));
+  EXPECT_EQ(MoodbarImageCache::WillLoadAsync,
+            Get(QSize(100, 10), &pixmap, MoodbarRenderer::Style_Frozen));
+  EXPECT_EQ(MoodbarImageCache::WillLoadAsync,
+            cache_.Get(QUrl::fromLocalFile("/music/b.mp3"), QSize(100, 10),
+                       MoodbarRenderer::Style_Normal, &pixmap));
+  ASSERT_TRUE(WaitForImageLoaded(3));
+
+  EXPECT_EQ(MoodbarImageCache::Loaded,
+            Get(QSize(100, 10), &pixmap, MoodbarRenderer::Style_Frozen));
+}
+
+TEST_F(MoodbarImageCacheTest, ShowsOldSizeWhileRendering) {
+  QPixmap pixmap;
+  Get(QSize(100, 10), &pixmap);
+  ASSERT_TRUE(WaitForImageLoaded(1));
+
+  pixmap = QPixmap();
+  EXPECT_EQ(MoodbarImageCache::WillLoadAsync, Get(QSize(200, 10), &pixmap));
+  EXPECT_EQ(QSize(100, 10), pixmap.size());
+
+  ASSERT_TRUE(WaitForImageLoaded(2));
+  EXPECT_EQ(MoodbarImageCache::Loaded, Get(QSize(200, 10), &pixmap));
+  EXPECT_EQ(QSize(200, 10), pixmap.size());
+}
+
+TEST_F(MoodbarImageCacheTest, OneRenderAtATime) {
+  QPixmap pixmap;
+  Get(QSize(100, 10), &pixmap);
+  ASSERT_TRUE(WaitForImageLoaded(1));
+
+  // The first resize starts rendering straight away because the colours are
+  // cached.  The ones after it only change the size that's wanted next.
+  Get(QSize(150, 10), &pixmap);
+  Get(QSize(200, 10), &pixmap);
+  Get(QSize(250, 10), &pixmap);
+  ASSERT_TRUE(WaitForImageLoaded(3));
+  WaitForNothingElse();
+  EXPECT_EQ(3, spy_.count());
+
+  EXPECT_EQ(MoodbarImageCache::Loaded, Get(QSize(150, 10), &pixmap));
+  EXPECT_EQ(MoodbarImageCache::Loaded, Get(QSize(250, 10), &pixmap));
+  EXPECT_EQ(MoodbarImageCache::WillLoadAsync, Get(QSize(200, 10), &pixmap));
+
+  // The data was only loaded once.
+  EXPECT_EQ(1, cache_.loads_);
+}
+
+TEST_F(MoodbarImageCacheTest, CannotLoadIsRemembered) {
+  cache_.result_ = MoodbarLoader::CannotLoad;
+
+  QPixmap pixmap;
+  Get(QSize(100, 10), &pixmap);
+  EXPECT_EQ(1, spy_.count());
+  EXPECT_EQ(MoodbarImageCache::CannotLoad, Get(QSize(100, 10), &pixmap));
+  EXPECT_EQ(1, cache_.loads_);
+}
+
+TEST_F(MoodbarImageCacheTest, GeneratedMoodbarIsTriedAgain) {
+  cache_.result_ = MoodbarLoader::CannotLoad;
+
+  QPixmap pixmap;
+  Get(QSize(100, 10), &pixmap);
+  EXPECT_EQ(MoodbarImageCache::CannotLoad, Get(QSize(100, 10), &pixmap));
+
+  // Something else created the moodbar, so views should ask again.
+  cache_.result_ = MoodbarLoader::Loaded;
+  cache_.MoodbarGenerated(url_);
+  EXPECT_EQ(2, spy_.count());
+
+  EXPECT_EQ(MoodbarImageCache::WillLoadAsync, Get(QSize(100, 10), &pixmap));
+  ASSERT_TRUE(WaitForImageLoaded(3));
+  EXPECT_EQ(MoodbarImageCache::Loaded, Get(QSize(100, 10), &pixmap));
+}
+
+TEST_F(MoodbarImageCacheTest, FailedUrlsAreBounded) {
+  cache_.result_ = MoodbarLoader::CannotLoad;
+
+  QPixmap pixmap;
+  for (int i = 0; i <= MoodbarImageCache::kMaxFailedUrls; ++i) {
+    cache_.Get(QUrl::fromLocalFile(QString("/music/%1.mp3").arg(i)),
+               QSize(100, 10), MoodbarRenderer::Style_Normal, &pixmap);
+  }
+
+  // The oldest one was forgotten and is tried again, the newest wasn't.
+  const int loads = cache_.loads_;
+  EXPECT_EQ(MoodbarImageCache::WillLoadAsync,
+            cache_.Get(QUrl::fromLocalFile("/music/0.mp3"), QSize(100, 10),
+                       MoodbarRenderer::Style_Normal, &pixmap));
+  EXPECT_EQ(MoodbarImageCache::CannotLoad,
+            cache_.Get(QUrl::fromLocalFile(QString("/music/%1.mp3").arg(
+                           MoodbarImageCache::kMaxFailedUrls)),
+                       QSize(100, 10), MoodbarRenderer::Style_Normal, &pixmap));
+  EXPECT_EQ(loads + 1, cache_.loads_);
+}
+
+}  // namespace
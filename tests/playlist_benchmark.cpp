@@ -0,0 +1,108 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QSortFilterProxyModel>
+#include <QStringList>
+
+#include "gtest/gtest.h"
+
+#include "benchmark_utils.h"
+#include "playlist/playlist.h"
+#include "playlist/queue.h"
+#include "playlist/songplaylistitem.h"
+
+namespace {
+
+const int kPlaylistSize = 100000;
+
+class PlaylistBenchmark : public ::testing::Test {
+ protected:
+  PlaylistBenchmark() : playlist_(nullptr, nullptr, nullptr, 1) {}
+
+  void SetUp() {
+    PlaylistItemList items;
+    for (const Song& song : benchmark::SyntheticSongs(kPlaylistSize)) {
+      items << PlaylistItemPtr(new SongPlaylistItem(song));
+    }
+    playlist_.InsertItems(items);
+  }
+
+  Playlist playlist_;
+};
+
+TEST_F(PlaylistBenchmark, Sort) {
+  const Playlist::Column kColumns[] = {Playlist::Column_Title,
+                                       Playlist::Column_Artist,
+                                       Playlist::Column_Length};
+  const char* kNames[] = {"title", "artist", "length"};
+
+  for (int i = 0; i < 3; ++i) {
+    // Alternate the direction so every run has to move rows around.
+    Qt::SortOrder order = Qt::AscendingOrder;
+    benchmark::Run(kNames[i], 5, kPlaylistSize, [&] {
+      playlist_.sort(kColumns[i], order);
+      order = order == Qt::AscendingOrder ? Qt::DescendingOrder
+                                          : Qt::AscendingOrder;
+    });
+  }
+
+  EXPECT_EQ(kPlaylistSize, playlist_.rowCount());
+}
+
+TEST_F(PlaylistBenchmark, Filter) {
+  const QStringList kFilters = QStringList() << "love"
+                                             << "night fire"
+                                             << "artist:moon"
+                                             << "year:>1990";
+  QSortFilterProxyModel* proxy = playlist_.proxy();
+
+  for (const QString& filter : kFilters) {
+    benchmark::Run(filter, 5, kPlaylistSize,
+                   [&] { proxy->setFilterFixedString(QString()); },
+                   [&] { proxy->setFilterFixedString(filter); });
+    EXPECT_GT(proxy->rowCount(), 0) << filter.toStdString();
+    EXPECT_LT(proxy->rowCount(), kPlaylistSize) << filter.toStdString();
+  }
+}
+
+TEST_F(PlaylistBenchmark, QueuePositions) {
+  const int kQueued = 1000;
+
+  QModelIndexList queued;
+  for (int i = 0; i < kQueued; ++i) {
+    queued << playlist_.index((i * 37) % kPlaylistSize, 0);
+  }
+  playlist_.queue()->ToggleTracks(queued);
+
+  // Look up the queue position of every row, like the queued item delegate
+  // does when it paints the whole playlist.
+  int queued_rows = 0;
+  benchmark::Run("all rows", 5, kPlaylistSize, [&] {
+    queued_rows = 0;
+    for (int row = 0; row < kPlaylistSize; ++row) {
+      const QModelIndex index = playlist_.index(row, Playlist::Column_Title);
+      if (playlist_.data(index, Playlist::Role_QueuePosition).toInt() != -1) {
+        queued_rows++;
+      }
+    }
+  });
+
+  EXPECT_EQ(kQueued, queued_rows);
+}
+
+}  // namespace
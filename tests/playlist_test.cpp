@@ -22,6 +22,8 @@
 
 #include "library/libraryplaylistitem.h"
 #include "playlist/playlist.h"
+#include "playlist/queue.h"
+#include "playlist/songplaylistitem.h"
 #include "mock_settingsprovider.h"
 #include "mock_playlistitem.h"
 
@@ -501,5 +503,133 @@ TEST_F(PlaylistTest, LibraryIdMapMulti) {
   EXPECT_EQ(0, playlist_.library_items_by_id(2).count());
 }
 
+TEST_F(PlaylistTest, UpdateItemsByUrl) {
+  Song one;
+  one.Init("", "", "", 123);
+  one.set_url(QUrl("http://example.com/one"));
+
+  Song two;
+  two.Init("", "", "", 123);
+  two.set_url(QUrl("http://example.com/two"));
+
+  playlist_.InsertItems(PlaylistItemList()
+                        << PlaylistItemPtr(new SongPlaylistItem(one))
+                        << PlaylistItemPtr(new SongPlaylistItem(two))
+                        << PlaylistItemPtr(new SongPlaylistItem(one)));
+
+  Song updated(two);
+  updated.set_title("Two");
+  updated.set_filetype(Song::Type_Mpeg);
+  playlist_.UpdateItems(SongList() << updated);
+
+  EXPECT_EQ("", playlist_.item_at(0)->Metadata().title());
+  EXPECT_EQ("Two", playlist_.item_at(1)->Metadata().title());
+  EXPECT_EQ("", playlist_.item_at(2)->Metadata().title());
+
+  // Only the first matching item is updated for each song
+  updated = one;
+  updated.set_title("One");
+  updated.set_filetype(Song::Type_Mpeg);
+  playlist_.UpdateItems(SongList() << updated);
+
+  EXPECT_EQ("One", playlist_.item_at(0)->Metadata().title());
+  EXPECT_EQ("", playlist_.item_at(2)->Metadata().title());
+}
+
+TEST_F(PlaylistTest, UpdateItemsUpdatesLibraryIdMap) {
+  Song song;
+  song.Init("", "", "", 123);
+  song.set_url(QUrl("http://example.com/one"));
+
+  playlist_.InsertItems(PlaylistItemList()
+                        << PlaylistItemPtr(new SongPlaylistItem(song)));
+  EXPECT_EQ(0, playlist_.library_items_by_id(1).count());
+
+  song.set_id(1);
+  song.set_directory_id(1);
+  song.set_title("Title");
+  playlist_.UpdateItems(SongList() << song);
+
+  ASSERT_EQ(1, playlist_.library_items_by_id(1).count());
+  EXPECT_EQ("Title", playlist_.library_items_by_id(1)[0]->Metadata().title());
+}
+
+TEST_F(PlaylistTest, UpdateLibraryItemReindexes) {
+  Song song;
+  song.Init("", "", "", 123);
+  song.set_id(1);
+  song.set_directory_id(1);
+  song.set_url(QUrl("file:///old.mp3"));
+
+  PlaylistItemPtr item(new LibraryPlaylistItem(song));
+  playlist_.InsertItems(PlaylistItemList() << item);
+
+  // The file was moved in the library
+  Song moved(song);
+  moved.set_url(QUrl("file:///new.mp3"));
+  playlist_.UpdateLibraryItem(item, moved);
+
+  ASSERT_EQ(1, playlist_.library_items_by_id(1).count());
+  EXPECT_EQ(QUrl("file:///new.mp3"), playlist_.item_at(0)->Url());
+
+  // Updates are found through the new URL only
+  Song stale(song);
+  stale.set_title("Stale");
+  playlist_.UpdateItems(SongList() << stale);
+  EXPECT_EQ("", playlist_.item_at(0)->Metadata().title());
+
+  Song fresh(moved);
+  fresh.set_title("Fresh");
+  playlist_.UpdateItems(SongList() << fresh);
+  EXPECT_EQ("Fresh", playlist_.item_at(0)->Metadata().title());
+
+  playlist_.Clear();
+  EXPECT_EQ(0, playlist_.library_items_by_id(1).count());
+}
+
+TEST_F(PlaylistTest, QueuePositions) {
+  PlaylistItemList items;
+  for (int i = 0; i < 6; ++i) {
+    items << MakeMockItemP(QString::number(i));
+  }
+  playlist_.InsertItems(items);
+
+  Queue* queue = playlist_.queue();
+  queue->ToggleTracks(QModelIndexList() << playlist_.index(4, 0)
+                                        << playlist_.index(1, 0));
+  EXPECT_EQ(0, playlist_.data(playlist_.index(4, 0),
+                              Playlist::Role_QueuePosition).toInt());
+  EXPECT_EQ(1, playlist_.data(playlist_.index(1, 0),
+                              Playlist::Role_QueuePosition).toInt());
+  EXPECT_EQ(-1, playlist_.data(playlist_.index(2, 0),
+                               Playlist::Role_QueuePosition).toInt());
+
+  // Removing a row before the queued items moves them up.
+  playlist_.removeRows(0, 1);
+  EXPECT_EQ(0, queue->PositionOf(playlist_.index(3, 0)));
+  EXPECT_EQ(1, queue->PositionOf(playlist_.index(0, 0)));
+  EXPECT_EQ(-1, queue->PositionOf(playlist_.index(4, 0)));
+  EXPECT_TRUE(queue->ContainsSourceRow(3));
+  EXPECT_FALSE(queue->ContainsSourceRow(4));
+
+  // Inserting rows moves them down again.
+  playlist_.InsertItems(PlaylistItemList() << MakeMockItemP("New"), 0);
+  EXPECT_EQ(0, queue->PositionOf(playlist_.index(4, 0)));
+  EXPECT_EQ(1, queue->PositionOf(playlist_.index(1, 0)));
+  EXPECT_EQ(-1, queue->PositionOf(playlist_.index(0, 0)));
+
+  // Moving them around in the queue.
+  queue->MoveDown(0);
+  EXPECT_EQ(0, queue->PositionOf(playlist_.index(1, 0)));
+  EXPECT_EQ(1, queue->PositionOf(playlist_.index(4, 0)));
+
+  // Dequeueing.
+  EXPECT_EQ(1, queue->TakeNext());
+  EXPECT_EQ(-1, queue->PositionOf(playlist_.index(1, 0)));
+  EXPECT_EQ(0, queue->PositionOf(playlist_.index(4, 0)));
+
+  queue->Clear();
+  EXPECT_EQ(-1, queue->PositionOf(playlist_.index(4, 0)));
+}
 
 } // namespace
@@ -0,0 +1,118 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gtest/gtest.h"
+
+#include <memory>
+
+#include <QTemporaryFile>
+
+#include "core/database.h"
+#include "core/waitforsignal.h"
+#include "playlist/playlist.h"
+#include "playlist/playlistbackend.h"
+#include "playlist/songplaylistitem.h"
+
+namespace {
+
+class PlaylistRestoreTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    // The playlist is loaded on another thread, which wouldn't see the
+    // contents of an in-memory database.
+    ASSERT_TRUE(db_file_.open());
+    database_.reset(new Database(nullptr, nullptr, db_file_.fileName()));
+    backend_.reset(new PlaylistBackend(database_.get()));
+    id_ = backend_->CreatePlaylist("Test", QString());
+  }
+
+  void SaveSongs(int count) {
+    PlaylistItemList items;
+    for (int i = 0; i < count; ++i) {
+      Song song;
+      song.Init(QString("Title %1").arg(i), "Artist", "Album", 123);
+      song.set_url(QUrl(QString("http://example.com/%1.mp3").arg(i)));
+      song.set_filetype(Song::Type_Stream);
+      items << PlaylistItemPtr(new SongPlaylistItem(song));
+    }
+    backend_->SavePlaylist(id_, items, -1, smart_playlists::GeneratorPtr());
+  }
+
+  QTemporaryFile db_file_;
+  std::unique_ptr<Database> database_;
+  std::unique_ptr<PlaylistBackend> backend_;
+  int id_;
+};
+
+TEST_F(PlaylistRestoreTest, NotRestoredUntilAsked) {
+  SaveSongs(3);
+
+  Playlist playlist(backend_.get(), nullptr, nullptr, id_);
+  EXPECT_FALSE(playlist.restore_started());
+  EXPECT_FALSE(playlist.is_restored());
+  EXPECT_EQ(0, playlist.rowCount());
+}
+
+TEST_F(PlaylistRestoreTest, Restore) {
+  SaveSongs(3);
+
+  Playlist playlist(backend_.get(), nullptr, nullptr, id_);
+  playlist.Restore();
+  EXPECT_TRUE(playlist.restore_started());
+  WaitForSignal(&playlist, SIGNAL(RestoreFinished()));
+
+  EXPECT_TRUE(playlist.is_restored());
+  ASSERT_EQ(3, playlist.rowCount());
+  EXPECT_EQ("Title 0", playlist.item_at(0)->Metadata().title());
+  EXPECT_EQ("Title 2", playlist.item_at(2)->Metadata().title());
+}
+
+TEST_F(PlaylistRestoreTest, RestoreInBackground) {
+  SaveSongs(2);
+
+  Playlist playlist(backend_.get(), nullptr, nullptr, id_);
+  playlist.Restore(true);
+  WaitForSignal(&playlist, SIGNAL(RestoreFinished()));
+
+  EXPECT_TRUE(playlist.is_restored());
+  EXPECT_EQ(2, playlist.rowCount());
+}
+
+TEST_F(PlaylistRestoreTest, RestoreOnlyOnce) {
+  SaveSongs(2);
+
+  Playlist playlist(backend_.get(), nullptr, nullptr, id_);
+  playlist.Restore();
+  playlist.Restore();
+  WaitForSignal(&playlist, SIGNAL(RestoreFinished()));
+
+  EXPECT_EQ(2, playlist.rowCount());
+}
+
+TEST_F(PlaylistRestoreTest, SaveBeforeRestoreKeepsItems) {
+  SaveSongs(3);
+
+  // Saving a playlist that hasn't been loaded must not replace the stored
+  // items with the empty list it has so far.
+  Playlist playlist(backend_.get(), nullptr, nullptr, id_);
+  playlist.Save();
+
+  EXPECT_EQ(3, backend_->GetPlaylistItems(id_).count());
+}
+
+}  // namespace
@@ -0,0 +1,162 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <memory>
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include <QSqlQuery>
+#include <QTemporaryFile>
+#include <QVariant>
+
+#include "core/database.h"
+#include "core/preparedstatementcache.h"
+#include "core/scopedtransaction.h"
+
+namespace {
+
+const char* kSelectSql = "SELECT value FROM test WHERE ROWID = :id";
+
+class PreparedStatementCacheTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    database_.reset(new MemoryDatabase(nullptr));
+    db_ = database_->Connect();
+
+    QSqlQuery q(db_);
+    ASSERT_TRUE(q.exec("CREATE TABLE test (value INTEGER)"));
+
+    ScopedTransaction t(&db_);
+    q.prepare("INSERT INTO test (value) VALUES (:value)");
+    for (int i = 1; i <= kRows; ++i) {
+      q.bindValue(":value", i * 10);
+      ASSERT_TRUE(q.exec());
+    }
+    t.Commit();
+  }
+
+  int SelectCached(PreparedStatementCache* cache, int id) {
+    CachedQuery q(cache, kSelectSql);
+    q.bindValue(":id", id);
+    q.exec();
+    return q.next() ? q.value(0).toInt() : -1;
+  }
+
+  static const int kRows = 1000;
+
+  std::unique_ptr<Database> database_;
+  QSqlDatabase db_;
+};
+
+TEST_F(PreparedStatementCacheTest, ReusesStatements) {
+  PreparedStatementCache* cache = database_->StatementCache(db_);
+
+  EXPECT_EQ(10, SelectCached(cache, 1));
+  EXPECT_EQ(20, SelectCached(cache, 2));
+  EXPECT_EQ(30, SelectCached(cache, 3));
+
+  EXPECT_EQ(1, cache->count());
+  EXPECT_EQ(1, cache->misses());
+  EXPECT_EQ(2, cache->hits());
+}
+
+TEST_F(PreparedStatementCacheTest, SameCacheForSameConnection) {
+  EXPECT_EQ(database_->StatementCache(db_),
+            database_->StatementCache(database_->Connect()));
+}
+
+TEST_F(PreparedStatementCacheTest, NestedUseGetsItsOwnStatement) {
+  PreparedStatementCache* cache = database_->StatementCache(db_);
+
+  CachedQuery outer(cache, "SELECT value FROM test WHERE ROWID <= :id");
+  outer.bindValue(":id", 3);
+  ASSERT_TRUE(outer.exec());
+  ASSERT_TRUE(outer.next());
+  EXPECT_EQ(10, outer.value(0).toInt());
+
+  // Running the same statement while the outer one is still being read must
+  // not disturb it.
+  {
+    CachedQuery inner(cache, "SELECT value FROM test WHERE ROWID <= :id");
+    inner.bindValue(":id", 1);
+    ASSERT_TRUE(inner.exec());
+    ASSERT_TRUE(inner.next());
+    EXPECT_FALSE(inner.next());
+  }
+
+  ASSERT_TRUE(outer.next());
+  EXPECT_EQ(20, outer.value(0).toInt());
+  ASSERT_TRUE(outer.next());
+  EXPECT_EQ(30, outer.value(0).toInt());
+  EXPECT_FALSE(outer.next());
+
+  EXPECT_EQ(1, cache->count());
+  EXPECT_EQ(2, cache->misses());
+}
+
+TEST_F(PreparedStatementCacheTest, EvictsLeastRecentlyUsed) {
+  PreparedStatementCache cache(db_, 2);
+
+  { CachedQuery q(&cache, "SELECT 1"); }
+  { CachedQuery q(&cache, "SELECT 2"); }
+  { CachedQuery q(&cache, "SELECT 1"); }
+  { CachedQuery q(&cache, "SELECT 3"); }  // Evicts "SELECT 2"
+  EXPECT_EQ(2, cache.count());
+  EXPECT_EQ(1, cache.hits());
+
+  { CachedQuery q(&cache, "SELECT 1"); }
+  EXPECT_EQ(2, cache.hits());
+
+  { CachedQuery q(&cache, "SELECT 2"); }
+  EXPECT_EQ(2, cache.hits());
+  EXPECT_EQ(4, cache.misses());
+}
+
+TEST_F(PreparedStatementCacheTest, InvalidStatementsAreNotCached) {
+  PreparedStatementCache* cache = database_->StatementCache(db_);
+
+  CachedQuery q(cache, "SELECT * FROM no_such_table");
+  EXPECT_FALSE(q.exec());
+  EXPECT_EQ(0, cache->count());
+}
+
+TEST_F(PreparedStatementCacheTest, RecreateAttachedDbReplacesStaleCaches) {
+  QTemporaryFile file;
+  ASSERT_TRUE(file.open());
+  database_->AttachDatabaseOnDbConnection(
+      "extra", Database::AttachedDatabase(file.fileName(), "", true), db_);
+
+  PreparedStatementCache* cache = database_->StatementCache(db_);
+  EXPECT_EQ(10, SelectCached(cache, 1));
+  ASSERT_EQ(1, cache->count());
+
+  // This closes every connection.  The caches are left alone until the thread
+  // that owns them asks for its cache again, and then it gets a fresh one for
+  // the new connection.
+  database_->RecreateAttachedDb("extra");
+  EXPECT_EQ(1, cache->count());
+
+  db_ = database_->Connect();
+  cache = database_->StatementCache(db_);
+  EXPECT_EQ(0, cache->count());
+  EXPECT_EQ(0, cache->misses());
+  EXPECT_EQ(cache, database_->StatementCache(db_));
+}
+
+}  // namespace
@@ -0,0 +1,70 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <memory>
+
+#include <QStringList>
+
+#include "gtest/gtest.h"
+
+#include "benchmark_utils.h"
+#include "core/application.h"
+#include "internet/core/internetmodel.h"
+
+namespace {
+
+// How long the main objects take to be created when Clementine starts.  The
+// database is in memory so the user's library doesn't affect the results.
+TEST(StartupBenchmark, Application) {
+  std::unique_ptr<Application> app;
+
+  benchmark::Run("application", 3, 1, [&] { app.reset(); },
+                 [&] {
+                   app.reset(new Application(nullptr, Application::Mode_Gui,
+                                             ":memory:"));
+                 });
+  ASSERT_TRUE(app->internet_model());
+}
+
+// What startup saves by creating these services the first time they're used.
+TEST(StartupBenchmark, LazyInternetServices) {
+  std::unique_ptr<Application> app;
+  QStringList names;
+
+  benchmark::Run("create all", 3, 1,
+                 [&] {
+                   app.reset();
+                   app.reset(new Application(nullptr, Application::Mode_Gui,
+                                             ":memory:"));
+                   names.clear();
+                   for (const InternetModel::LazyService& lazy_service :
+                        app->internet_model()->lazy_services()) {
+                     names << lazy_service.name_;
+                   }
+                 },
+                 [&] {
+                   for (const QString& name : names) {
+                     InternetModel::ServiceByName(name);
+                   }
+                 });
+
+  EXPECT_FALSE(names.isEmpty());
+  EXPECT_TRUE(app->internet_model()->lazy_services().isEmpty());
+}
+
+}  // namespace
@@ -0,0 +1,95 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gtest/gtest.h"
+
+#include "core/song.h"
+#include "core/stringpool.h"
+#include "tagreadermessages.pb.h"
+#include "test_utils.h"
+
+namespace {
+
+TEST(StringPoolTest, SharesEqualStrings) {
+  StringPool pool;
+
+  // Build the strings separately so they start off with their own data.
+  QString a = pool.Intern(QString("Various ") + "Artists");
+  QString b = pool.Intern(QString("Various Art") + "ists");
+
+  EXPECT_EQ("Various Artists", a);
+  EXPECT_EQ(a.constData(), b.constData());
+
+  StringPool::Stats stats = pool.stats();
+  EXPECT_EQ(1, stats.strings);
+  EXPECT_EQ(2, stats.lookups);
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(qint64(a.size() * sizeof(QChar)), stats.bytes_saved);
+}
+
+TEST(StringPoolTest, DifferentStrings) {
+  StringPool pool;
+
+  QString a = pool.Intern("Foo");
+  QString b = pool.Intern("Bar");
+
+  EXPECT_NE(a.constData(), b.constData());
+  EXPECT_EQ(2, pool.stats().strings);
+  EXPECT_EQ(0, pool.stats().hits);
+}
+
+TEST(StringPoolTest, EmptyStringsAreNotPooled) {
+  StringPool pool;
+
+  EXPECT_TRUE(pool.Intern(QString()).isNull());
+  EXPECT_TRUE(pool.Intern("").isEmpty());
+  EXPECT_EQ(0, pool.stats().strings);
+}
+
+TEST(StringPoolTest, PurgeRemovesUnusedStrings) {
+  StringPool pool;
+
+  QString kept = pool.Intern(QString("Kept") + "");
+  pool.Intern(QString("Dropped") + "");
+  EXPECT_EQ(2, pool.stats().strings);
+
+  pool.Purge();
+
+  StringPool::Stats stats = pool.stats();
+  EXPECT_EQ(1, stats.strings);
+  EXPECT_EQ(qint64(kept.size() * sizeof(QChar)), stats.bytes);
+
+  // The kept string is still the pooled one.
+  EXPECT_EQ(kept.constData(), pool.Intern(QString("Ke") + "pt").constData());
+}
+
+TEST(StringPoolTest, SongsFromProtobufShareStrings) {
+  pb::tagreader::SongMetadata pb;
+  pb.set_artist("Some artist");
+  pb.set_album("Some album");
+  pb.set_title("Title");
+
+  Song a;
+  a.InitFromProtobuf(pb);
+  Song b;
+  b.InitFromProtobuf(pb);
+
+  EXPECT_EQ(a.artist().constData(), b.artist().constData());
+  EXPECT_EQ(a.album().constData(), b.album().constData());
+}
+
+}  // namespace
@@ -0,0 +1,109 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <memory>
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include "core/database.h"
+#include "internet/subsonic/subsonicalbumbackend.h"
+
+namespace {
+
+class SubsonicAlbumBackendTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    database_.reset(new MemoryDatabase(nullptr));
+    backend_.reset(new SubsonicAlbumBackend);
+    backend_->Init(database_.get());
+  }
+
+  SubsonicAlbumBackend::Album MakeAlbum(const QString& id,
+                                        const QString& fingerprint,
+                                        int song_count) {
+    SubsonicAlbumBackend::Album ret;
+    ret.id = id;
+    ret.fingerprint = fingerprint;
+    for (int i = 0; i < song_count; ++i) {
+      ret.song_urls << QUrl(QString("subsonic://%1-%2").arg(id).arg(i));
+    }
+    return ret;
+  }
+
+  std::shared_ptr<Database> database_;
+  std::unique_ptr<SubsonicAlbumBackend> backend_;
+};
+
+TEST_F(SubsonicAlbumBackendTest, EmptyDatabase) {
+  EXPECT_TRUE(backend_->GetFingerprints().isEmpty());
+  EXPECT_TRUE(backend_->GetSongUrls(QStringList() << "1").isEmpty());
+}
+
+TEST_F(SubsonicAlbumBackendTest, UpdateAlbums) {
+  backend_->UpdateAlbums(SubsonicAlbumBackend::AlbumList()
+                         << MakeAlbum("1", "a", 2) << MakeAlbum("2", "b", 3));
+
+  QMap<QString, QString> fingerprints = backend_->GetFingerprints();
+  ASSERT_EQ(2, fingerprints.count());
+  EXPECT_EQ("a", fingerprints["1"]);
+  EXPECT_EQ("b", fingerprints["2"]);
+
+  QList<QUrl> urls = backend_->GetSongUrls(QStringList() << "1");
+  ASSERT_EQ(2, urls.count());
+  EXPECT_TRUE(urls.contains(QUrl("subsonic://1-0")));
+  EXPECT_TRUE(urls.contains(QUrl("subsonic://1-1")));
+
+  EXPECT_EQ(5, backend_->GetSongUrls(QStringList() << "1"
+                                                   << "2").count());
+}
+
+TEST_F(SubsonicAlbumBackendTest, UpdateReplacesSongs) {
+  backend_->UpdateAlbums(SubsonicAlbumBackend::AlbumList()
+                         << MakeAlbum("1", "a", 3));
+  backend_->UpdateAlbums(SubsonicAlbumBackend::AlbumList()
+                         << MakeAlbum("1", "changed", 1));
+
+  EXPECT_EQ("changed", backend_->GetFingerprints()["1"]);
+
+  QList<QUrl> urls = backend_->GetSongUrls(QStringList() << "1");
+  ASSERT_EQ(1, urls.count());
+  EXPECT_EQ(QUrl("subsonic://1-0"), urls[0]);
+}
+
+TEST_F(SubsonicAlbumBackendTest, RemoveAlbums) {
+  backend_->UpdateAlbums(SubsonicAlbumBackend::AlbumList()
+                         << MakeAlbum("1", "a", 2) << MakeAlbum("2", "b", 2));
+  backend_->RemoveAlbums(QStringList() << "1");
+
+  QMap<QString, QString> fingerprints = backend_->GetFingerprints();
+  ASSERT_EQ(1, fingerprints.count());
+  EXPECT_TRUE(fingerprints.contains("2"));
+  EXPECT_TRUE(backend_->GetSongUrls(QStringList() << "1").isEmpty());
+  EXPECT_EQ(2, backend_->GetSongUrls(QStringList() << "2").count());
+}
+
+TEST_F(SubsonicAlbumBackendTest, DeleteAll) {
+  backend_->UpdateAlbums(SubsonicAlbumBackend::AlbumList()
+                         << MakeAlbum("1", "a", 2));
+  backend_->DeleteAll();
+
+  EXPECT_TRUE(backend_->GetFingerprints().isEmpty());
+  EXPECT_TRUE(backend_->GetSongUrls(QStringList() << "1").isEmpty());
+}
+
+}  // namespace
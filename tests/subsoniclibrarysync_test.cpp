@@ -0,0 +1,236 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <memory>
+
+#include "test_utils.h"
+#include "mock_networkaccessmanager.h"
+#include "gtest/gtest.h"
+
+#include <QSignalSpy>
+#include <QXmlStreamReader>
+
+#include "core/database.h"
+#include "internet/subsonic/subsonicalbumbackend.h"
+#include "internet/subsonic/subsoniclibrarysync.h"
+#include "internet/subsonic/subsonicservice.h"
+#include "library/librarybackend.h"
+
+namespace {
+
+class SubsonicLibrarySyncTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    database_.reset(new MemoryDatabase(nullptr));
+    album_backend_.reset(new SubsonicAlbumBackend);
+    album_backend_->Init(database_.get());
+    library_backend_.reset(new LibraryBackend);
+    library_backend_->Init(database_.get(), SubsonicService::kSongsTable,
+                           QString(), QString(), SubsonicService::kFtsTable);
+    sync_.reset(
+        new SubsonicLibrarySync(library_backend_.get(), album_backend_.get()));
+  }
+
+  // Feeds a getAlbum response for an album with these song ids through the
+  // scanner's parser, like it would arrive from the server.
+  void AddAlbum(const QString& id, const QString& fingerprint,
+                const QStringList& song_ids) {
+    QByteArray data =
+        "<subsonic-response status=\"ok\">"
+        "<album id=\"" + id.toUtf8() + "\" artist=\"Artist\">";
+    for (const QString& song_id : song_ids) {
+      data += "<song id=\"" + song_id.toUtf8() + "\" title=\"Song " +
+              song_id.toUtf8() + "\" album=\"Album " + id.toUtf8() +
+              "\" duration=\"100\"/>";
+    }
+    data += "</album></subsonic-response>";
+
+    MockNetworkReply reply(data);
+    reply.Done();
+
+    QXmlStreamReader reader(&reply);
+    SongList songs;
+    ASSERT_TRUE(SubsonicLibraryScanner::ParseAlbum(&reader, &songs));
+    sync_->AddAlbum(id, fingerprint, songs);
+  }
+
+  // Returns song URL -> library ID.
+  QMap<QString, int> LibrarySongs() {
+    QMap<QString, int> ret;
+    for (const Song& song : library_backend_->GetAllSongs()) {
+      ret[song.url().toString()] = song.id();
+    }
+    return ret;
+  }
+
+  void InitialSync() {
+    sync_->Start();
+    AddAlbum("1", "a", QStringList() << "10"
+                                     << "11");
+    AddAlbum("2", "b", QStringList() << "20");
+    sync_->Finish(true, QSet<QString>() << "1"
+                                        << "2");
+  }
+
+  std::shared_ptr<Database> database_;
+  std::unique_ptr<SubsonicAlbumBackend> album_backend_;
+  std::unique_ptr<LibraryBackend> library_backend_;
+  std::unique_ptr<SubsonicLibrarySync> sync_;
+};
+
+TEST_F(SubsonicLibrarySyncTest, AddsSongs) {
+  InitialSync();
+
+  QMap<QString, int> songs = LibrarySongs();
+  ASSERT_EQ(3, songs.count());
+  EXPECT_TRUE(songs.contains("subsonic://10"));
+  EXPECT_TRUE(songs.contains("subsonic://11"));
+  EXPECT_TRUE(songs.contains("subsonic://20"));
+}
+
+TEST_F(SubsonicLibrarySyncTest, RemovesSongsDroppedFromAlbum) {
+  InitialSync();
+
+  sync_->Start();
+  AddAlbum("1", "changed", QStringList() << "10");
+  sync_->Finish(true, QSet<QString>() << "1"
+                                      << "2");
+
+  QMap<QString, int> songs = LibrarySongs();
+  ASSERT_EQ(2, songs.count());
+  EXPECT_FALSE(songs.contains("subsonic://11"));
+}
+
+TEST_F(SubsonicLibrarySyncTest, RemovesDeletedAlbums) {
+  InitialSync();
+
+  sync_->Start();
+  sync_->Finish(true, QSet<QString>() << "1");
+
+  QMap<QString, int> songs = LibrarySongs();
+  ASSERT_EQ(2, songs.count());
+  EXPECT_FALSE(songs.contains("subsonic://20"));
+  EXPECT_FALSE(album_backend_->GetFingerprints().contains("2"));
+}
+
+TEST_F(SubsonicLibrarySyncTest, KeepsSongsMovedToAnotherAlbum) {
+  InitialSync();
+  const QMap<QString, int> before = LibrarySongs();
+
+  // Song 11 moves from album 1 to album 2, which arrives in a later batch.
+  sync_->Start();
+  AddAlbum("1", "changed", QStringList() << "10");
+  sync_->Commit();
+  AddAlbum("2", "changed", QStringList() << "20"
+                                         << "11");
+  sync_->Finish(true, QSet<QString>() << "1"
+                                      << "2");
+
+  EXPECT_EQ(before, LibrarySongs());
+}
+
+TEST_F(SubsonicLibrarySyncTest, KeepsSongsMergedIntoAnotherAlbum) {
+  InitialSync();
+  const QMap<QString, int> before = LibrarySongs();
+
+  // Album 2 is merged into album 1 and disappears from the server.
+  sync_->Start();
+  AddAlbum("1", "changed", QStringList() << "10"
+                                         << "11"
+                                         << "20");
+  sync_->Finish(true, QSet<QString>() << "1");
+
+  EXPECT_EQ(before, LibrarySongs());
+  EXPECT_FALSE(album_backend_->GetFingerprints().contains("2"));
+}
+
+TEST_F(SubsonicLibrarySyncTest, IncompleteScanDeletesNothing) {
+  InitialSync();
+
+  sync_->Start();
+  AddAlbum("1", "changed", QStringList() << "10");
+  sync_->Finish(false, QSet<QString>());
+
+  EXPECT_EQ(3, LibrarySongs().count());
+  EXPECT_TRUE(album_backend_->GetFingerprints().contains("2"));
+}
+
+TEST_F(SubsonicLibrarySyncTest, RemovesSongsFromBeforeAlbumsWereTracked) {
+  Song old_song;
+  old_song.set_url(QUrl("subsonic://99"));
+  old_song.set_title("Old");
+  old_song.set_directory_id(0);
+  old_song.set_mtime(0);
+  old_song.set_ctime(0);
+  library_backend_->AddOrUpdateSongs(SongList() << old_song);
+
+  InitialSync();
+
+  EXPECT_FALSE(LibrarySongs().contains("subsonic://99"));
+}
+
+TEST_F(SubsonicLibrarySyncTest, StartReportsKnownFingerprints) {
+  InitialSync();
+
+  QSignalSpy spy(sync_.get(), SIGNAL(Started(QMap<QString, QString>)));
+  sync_->Start();
+
+  ASSERT_EQ(1, spy.count());
+  QMap<QString, QString> fingerprints =
+      spy[0][0].value<QMap<QString, QString> >();
+  EXPECT_EQ(2, fingerprints.count());
+  EXPECT_EQ("a", fingerprints["1"]);
+  EXPECT_EQ("b", fingerprints["2"]);
+}
+
+TEST_F(SubsonicLibrarySyncTest, OnlyStaleSongsAreDeleted) {
+  InitialSync();
+
+  QSignalSpy deleted_spy(library_backend_.get(),
+                         SIGNAL(SongsDeleted(SongList)));
+  QSignalSpy finished_spy(sync_.get(), SIGNAL(Finished()));
+
+  // Nothing changed, so nothing is deleted.
+  sync_->Start();
+  sync_->Finish(true, QSet<QString>() << "1"
+                                      << "2");
+  EXPECT_EQ(0, deleted_spy.count());
+  EXPECT_EQ(1, finished_spy.count());
+
+  sync_->Start();
+  AddAlbum("1", "changed", QStringList() << "10");
+  sync_->Finish(true, QSet<QString>() << "1"
+                                      << "2");
+
+  ASSERT_EQ(1, deleted_spy.count());
+  SongList deleted = deleted_spy[0][0].value<SongList>();
+  ASSERT_EQ(1, deleted.count());
+  EXPECT_EQ("subsonic://11", deleted[0].url().toString());
+  EXPECT_EQ(2, finished_spy.count());
+}
+
+TEST_F(SubsonicLibrarySyncTest, ClearForgetsEverything) {
+  InitialSync();
+
+  sync_->Clear();
+
+  EXPECT_TRUE(LibrarySongs().isEmpty());
+  EXPECT_TRUE(album_backend_->GetFingerprints().isEmpty());
+}
+
+}  // namespace
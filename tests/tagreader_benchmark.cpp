@@ -0,0 +1,136 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include <QThread>
+#include <QtDebug>
+
+#include "gtest/gtest.h"
+
+#include "benchmark_utils.h"
+#include "core/song.h"
+#include "core/tagreaderclient.h"
+
+namespace {
+
+const int kFileCount = 200;
+
+// The worker is normally installed next to clementine, but the benchmarks run
+// from the build directory, so look for it there too and put it on the PATH
+// where the WorkerPool will find it.
+bool FindTagReader() {
+  const QString name = TagReaderClient::kWorkerExecutableName;
+  const QString app_dir = QCoreApplication::applicationDirPath();
+  const QString path = QString::fromLocal8Bit(qgetenv("PATH"));
+
+  QStringList dirs;
+  dirs << app_dir << app_dir + "/../ext/clementine-tagreader"
+       << path.split(':', QString::SkipEmptyParts);
+
+  for (const QString& dir : dirs) {
+    if (QFile::exists(dir + "/" + name)) {
+      qputenv("PATH", (QDir(dir).absolutePath() + ":" + path).toLocal8Bit());
+      return true;
+    }
+  }
+  return false;
+}
+
+class TagReaderBenchmark : public ::testing::Test {
+ protected:
+  TagReaderBenchmark() : client_(nullptr) {}
+
+  void SetUp() {
+    if (!FindTagReader()) {
+      return;
+    }
+
+    dir_ = QDir::temp().absoluteFilePath(
+        QString("clementine-benchmark-%1")
+            .arg(QCoreApplication::applicationPid()));
+    QDir().mkpath(dir_);
+
+    for (int i = 0; i < kFileCount; ++i) {
+      const QString filename = QString("%1/%2.wav").arg(dir_).arg(i);
+      ASSERT_TRUE(benchmark::WriteWaveFile(filename, 1, 220 + i));
+      filenames_ << filename;
+    }
+
+    client_ = new TagReaderClient;
+    client_->moveToThread(&thread_);
+    thread_.start();
+    client_->Start();
+  }
+
+  void TearDown() {
+    if (client_) {
+      client_->deleteLater();
+      thread_.quit();
+      thread_.wait();
+    }
+
+    for (const QString& filename : filenames_) {
+      QFile::remove(filename);
+    }
+    if (!dir_.isEmpty()) {
+      QDir().rmdir(dir_);
+    }
+  }
+
+  QString dir_;
+  QStringList filenames_;
+
+  QThread thread_;
+  TagReaderClient* client_;
+};
+
+TEST_F(TagReaderBenchmark, RoundTrip) {
+  if (!client_) {
+    qWarning() << TagReaderClient::kWorkerExecutableName
+               << "wasn't found - skipping the tagreader benchmarks";
+    return;
+  }
+
+  const SongList metadata = benchmark::SyntheticSongs(kFileCount);
+
+  benchmark::Run("save", 3, kFileCount, [&] {
+    for (int i = 0; i < kFileCount; ++i) {
+      client_->SaveFileBlocking(filenames_[i], metadata[i]);
+    }
+  });
+
+  Song song;
+  benchmark::Run("read", 5, kFileCount, [&] {
+    for (const QString& filename : filenames_) {
+      song = Song();
+      client_->ReadFileBlocking(filename, &song);
+    }
+  });
+  EXPECT_TRUE(song.is_valid());
+
+  benchmark::Run("is_media_file", 5, kFileCount, [&] {
+    for (const QString& filename : filenames_) {
+      client_->IsMediaFileBlocking(filename);
+    }
+  });
+}
+
+}  // namespace
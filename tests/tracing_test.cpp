@@ -0,0 +1,173 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gtest/gtest.h"
+
+#include <QFutureWatcher>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
+#include "core/concurrentrun.h"
+#include "core/tracing.h"
+#include "test_utils.h"
+
+#ifndef CLEMENTINE_NO_TRACING
+
+namespace {
+
+void RecordSpanOnOtherThread() {
+  TRACE_SPAN("TracingTest other thread span");
+}
+
+class SpanThread : public QThread {
+ public:
+  explicit SpanThread(const QString& name) : wait_before_exiting_(false) {
+    setObjectName(name);
+  }
+
+  bool wait_before_exiting_;
+  QSemaphore recorded_;
+  QSemaphore exit_;
+
+ protected:
+  void run() {
+    { TRACE_SPAN("TracingTest exited thread span"); }
+    recorded_.release();
+    if (wait_before_exiting_) exit_.acquire();
+  }
+};
+
+TEST(TracingTest, DisabledRecordsNothing) {
+  tracing::SetEnabled(false);
+  { TRACE_SPAN("TracingTest disabled span"); }
+  TRACE_COUNTER("TracingTest disabled counter", 42);
+
+  QByteArray json = tracing::ChromeTraceJson();
+  EXPECT_FALSE(json.contains("TracingTest disabled span"));
+  EXPECT_FALSE(json.contains("TracingTest disabled counter"));
+}
+
+TEST(TracingTest, RecordsSpansAndCounters) {
+  tracing::SetEnabled(true);
+  { TRACE_SPAN("TracingTest span"); }
+  TRACE_COUNTER("TracingTest counter", 42);
+  TRACE_FLOW_BEGIN("TracingTest flow", 1234);
+  TRACE_FLOW_END("TracingTest flow", 1234);
+  tracing::SetEnabled(false);
+
+  QByteArray json = tracing::ChromeTraceJson();
+  EXPECT_TRUE(json.startsWith("{"));
+  EXPECT_TRUE(json.trimmed().endsWith("}"));
+  EXPECT_TRUE(json.contains("\"name\":\"TracingTest span\""));
+  EXPECT_TRUE(json.contains("\"ph\":\"X\""));
+  EXPECT_TRUE(json.contains("\"args\":{\"value\":42}"));
+  EXPECT_TRUE(json.contains("\"ph\":\"s\""));
+  EXPECT_TRUE(json.contains("\"ph\":\"f\""));
+  EXPECT_TRUE(json.contains("\"id\":1234"));
+}
+
+TEST(TracingTest, RecordsOtherThreads) {
+  tracing::SetEnabled(true);
+  QThreadPool pool;
+  QFuture<void> future =
+      ConcurrentRun::Run<void>(&pool, &RecordSpanOnOtherThread);
+  future.waitForFinished();
+  tracing::SetEnabled(false);
+
+  QByteArray json = tracing::ChromeTraceJson();
+  EXPECT_TRUE(json.contains("TracingTest other thread span"));
+}
+
+TEST(TracingTest, ManyEvents) {
+  tracing::SetEnabled(true);
+  for (int i = 0; i < 10000; ++i) {
+    TRACE_COUNTER("TracingTest many", i);
+  }
+  tracing::SetEnabled(false);
+
+  QByteArray json = tracing::ChromeTraceJson();
+  EXPECT_TRUE(json.contains("\"args\":{\"value\":9999}"));
+}
+
+TEST(TracingTest, EventsAreOnlyReturnedOnce) {
+  tracing::SetEnabled(true);
+  for (int i = 0; i < 5000; ++i) {
+    TRACE_COUNTER("TracingTest once", 100000 + i);
+  }
+  tracing::SetEnabled(false);
+
+  QByteArray json = tracing::ChromeTraceJson();
+  EXPECT_TRUE(json.contains("\"args\":{\"value\":100000}"));
+  EXPECT_TRUE(json.contains("\"args\":{\"value\":104999}"));
+
+  // The buffers were emptied, including the chunks that were filled up.
+  json = tracing::ChromeTraceJson();
+  EXPECT_FALSE(json.contains("TracingTest once"));
+
+  // Recording carries on after the trace was written out.
+  tracing::SetEnabled(true);
+  for (int i = 0; i < 5000; ++i) {
+    TRACE_COUNTER("TracingTest again", 200000 + i);
+  }
+  tracing::SetEnabled(false);
+
+  json = tracing::ChromeTraceJson();
+  EXPECT_FALSE(json.contains("TracingTest once"));
+  EXPECT_TRUE(json.contains("\"args\":{\"value\":200000}"));
+  EXPECT_TRUE(json.contains("\"args\":{\"value\":204999}"));
+}
+
+TEST(TracingTest, ExitedThreadsAreWrittenThenForgotten) {
+  tracing::SetEnabled(true);
+  SpanThread thread("TracingTest exited thread");
+  thread.start();
+  ASSERT_TRUE(thread.wait(5000));
+  tracing::SetEnabled(false);
+
+  // The thread's events outlive it.
+  QByteArray json = tracing::ChromeTraceJson();
+  EXPECT_TRUE(json.contains("TracingTest exited thread span"));
+  EXPECT_TRUE(json.contains("\"name\":\"TracingTest exited thread\""));
+
+  // But its buffer was freed once they were written.
+  json = tracing::ChromeTraceJson();
+  EXPECT_FALSE(json.contains("TracingTest exited thread"));
+}
+
+TEST(TracingTest, ThreadsExitingAfterBeingWrittenAreForgotten) {
+  tracing::SetEnabled(true);
+  SpanThread thread("TracingTest written thread");
+  thread.wait_before_exiting_ = true;
+  thread.start();
+  thread.recorded_.acquire();
+  tracing::SetEnabled(false);
+
+  QByteArray json = tracing::ChromeTraceJson();
+  EXPECT_TRUE(json.contains("\"name\":\"TracingTest written thread\""));
+
+  // Nothing is left to write when it exits, so the buffer goes straight away.
+  thread.exit_.release();
+  ASSERT_TRUE(thread.wait(5000));
+
+  json = tracing::ChromeTraceJson();
+  EXPECT_FALSE(json.contains("TracingTest written thread"));
+}
+
+}  // namespace
+
+#endif  // CLEMENTINE_NO_TRACING
@@ -0,0 +1,243 @@
+/* This file is part of Clementine.
+   Copyright 2015, David Sansome <me@davidsansome.com>
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <memory>
+
+#include "test_utils.h"
+#include "gtest/gtest.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QSignalSpy>
+#include <QStringList>
+
+#include "core/utilities.h"
+#include "transcoder/transcodecache.h"
+
+namespace {
+
+// Doesn't transcode anything - the test decides when each job finishes and
+// what it writes.
+class FakeTranscodeCache : public TranscodeCache {
+ public:
+  explicit FakeTranscodeCache(const QString& cache_dir)
+      : TranscodeCache(nullptr, cache_dir) {}
+
+  void Finish(int job, const QByteArray& data, bool success = true) {
+    QFile file(outputs_[job]);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    file.close();
+    JobComplete(inputs_[job], outputs_[job], success);
+  }
+
+  QStringList inputs_;
+  QStringList outputs_;
+
+ protected:
+  void Transcode(const QString& input, const TranscoderPreset& preset,
+                 const QString& output) {
+    inputs_ << input;
+    outputs_ << output;
+  }
+};
+
+class TranscodeCacheTest : public ::testing::Test {
+ protected:
+  TranscodeCacheTest()
+      : preset_(Song::Type_OggVorbis, "Ogg Vorbis", "ogg", "audio/x-vorbis",
+                "application/ogg") {}
+
+  void SetUp() {
+    dir_ = Utilities::MakeTempDir();
+    cache_dir_ = dir_ + "/cache";
+    cache_.reset(new FakeTranscodeCache(cache_dir_));
+  }
+
+  void TearDown() {
+    cache_.reset();
+    Utilities::RemoveRecursive(dir_);
+  }
+
+  QString MakeInput(const QString& name, const QByteArray& data = "data") {
+    const QString filename = dir_ + "/" + name;
+    QFile file(filename);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    return filename;
+  }
+
+  // Runs the queued calls to StartJob and EmitFinished.
+  void ProcessEvents() { QCoreApplication::processEvents(); }
+
+  TranscoderPreset preset_;
+  QString dir_;
+  QString cache_dir_;
+  std::unique_ptr<FakeTranscodeCache> cache_;
+};
+
+TEST_F(TranscodeCacheTest, KeyIsSha1OfFileAndPreset) {
+  const QString input = MakeInput("a.flac");
+
+  const QString key = cache_->Request(input, preset_);
+  EXPECT_TRUE(QRegExp("[0-9a-f]{40}").exactMatch(key)) << key;
+  EXPECT_EQ(key, cache_->Request(input, preset_));
+
+  TranscoderPreset mp3(Song::Type_Mpeg, "MP3", "mp3", "audio/mpeg");
+  EXPECT_NE(key, cache_->Request(input, mp3));
+
+  // Changing the file gives a different key.
+  MakeInput("a.flac", "different data");
+  EXPECT_NE(key, cache_->Request(input, preset_));
+}
+
+TEST_F(TranscodeCacheTest, PartFileIsMovedIntoPlace) {
+  QSignalSpy spy(cache_.get(), SIGNAL(Finished(QString, QString, bool)));
+  const QString input = MakeInput("a.flac");
+  const QString key = cache_->Request(input, preset_);
+  ProcessEvents();
+
+  ASSERT_EQ(1, cache_->outputs_.count());
+  EXPECT_EQ(cache_dir_ + "/" + key + ".part", cache_->outputs_[0]);
+  EXPECT_EQ(0, spy.count());
+
+  cache_->Finish(0, "transcoded");
+
+  const QString output = cache_dir_ + "/" + key + ".ogg";
+  ASSERT_EQ(1, spy.count());
+  EXPECT_EQ(key, spy[0][0].toString());
+  EXPECT_EQ(output, spy[0][1].toString());
+  EXPECT_TRUE(spy[0][2].toBool());
+  EXPECT_TRUE(QFile::exists(output));
+  EXPECT_FALSE(QFile::exists(cache_->outputs_[0]));
+
+  // Asking again is answered from the cache.
+  EXPECT_EQ(key, cache_->Request(input, preset_));
+  ProcessEvents();
+  EXPECT_EQ(1, cache_->outputs_.count());
+  ASSERT_EQ(2, spy.count());
+  EXPECT_EQ(output, spy[1][1].toString());
+}
+
+TEST_F(TranscodeCacheTest, FailedJobIsNotCached) {
+  QSignalSpy spy(cache_.get(), SIGNAL(Finished(QString, QString, bool)));
+  const QString input = MakeInput("a.flac");
+  const QString key = cache_->Request(input, preset_);
+  ProcessEvents();
+  cache_->Finish(0, "half a file", false);
+
+  ASSERT_EQ(1, spy.count());
+  EXPECT_FALSE(spy[0][2].toBool());
+  EXPECT_FALSE(QFile::exists(cache_->outputs_[0]));
+  EXPECT_FALSE(QFile::exists(cache_dir_ + "/" + key + ".ogg"));
+
+  // The next request tries again.
+  cache_->Request(input, preset_);
+  ProcessEvents();
+  EXPECT_EQ(2, cache_->outputs_.count());
+}
+
+TEST_F(TranscodeCacheTest, ConcurrentRequestsShareOneJob) {
+  QSignalSpy spy(cache_.get(), SIGNAL(Finished(QString, QString, bool)));
+  const QString input = MakeInput("a.flac");
+
+  const QString key = cache_->Request(input, preset_);
+  ProcessEvents();
+  EXPECT_EQ(key, cache_->Request(input, preset_));
+  EXPECT_EQ(key, cache_->Request(input, preset_));
+  ProcessEvents();
+
+  ASSERT_EQ(1, cache_->outputs_.count());
+  cache_->Finish(0, "transcoded");
+  ProcessEvents();
+
+  // Everyone waiting for the key gets the same signal.
+  ASSERT_EQ(1, spy.count());
+  EXPECT_EQ(key, spy[0][0].toString());
+}
+
+TEST_F(TranscodeCacheTest, EvictsLeastRecentlyUsed) {
+  QStringList inputs;
+  QStringList keys;
+  for (int i = 0; i < 3; ++i) {
+    inputs << MakeInput(QString("%1.flac").arg(i));
+    keys << cache_->Request(inputs[i], preset_);
+    ProcessEvents();
+    cache_->Finish(i, QByteArray(100, 'x'));
+  }
+
+  // Use the first one again so the second is the least recently used.
+  cache_->Request(inputs[0], preset_);
+  ProcessEvents();
+
+  for (const QString& key : keys) {
+    cache_->Release(key);
+  }
+  cache_->Release(keys[0]);
+
+  cache_->set_max_size(250);
+  EXPECT_TRUE(QFile::exists(cache_dir_ + "/" + keys[0] + ".ogg"));
+  EXPECT_FALSE(QFile::exists(cache_dir_ + "/" + keys[1] + ".ogg"));
+  EXPECT_TRUE(QFile::exists(cache_dir_ + "/" + keys[2] + ".ogg"));
+
+  // Then the third, which is older than the first now.
+  cache_->set_max_size(150);
+  EXPECT_TRUE(QFile::exists(cache_dir_ + "/" + keys[0] + ".ogg"));
+  EXPECT_FALSE(QFile::exists(cache_dir_ + "/" + keys[2] + ".ogg"));
+}
+
+TEST_F(TranscodeCacheTest, FilesInUseAreNotEvicted) {
+  const QString key = cache_->Request(MakeInput("a.flac"), preset_);
+  ProcessEvents();
+  cache_->Finish(0, QByteArray(100, 'x'));
+
+  const QString output = cache_dir_ + "/" + key + ".ogg";
+  cache_->set_max_size(10);
+  EXPECT_TRUE(QFile::exists(output));
+
+  // It goes as soon as the last user releases it.
+  cache_->Release(key);
+  EXPECT_FALSE(QFile::exists(output));
+}
+
+TEST_F(TranscodeCacheTest, LoadsExistingFiles) {
+  const QString input = MakeInput("a.flac");
+  const QString key = cache_->Request(input, preset_);
+  ProcessEvents();
+  cache_->Finish(0, "transcoded");
+  cache_->Release(key);
+
+  // A half-finished file from a crash.
+  QFile part(cache_dir_ + "/leftover.part");
+  part.open(QIODevice::WriteOnly);
+  part.close();
+
+  cache_.reset(new FakeTranscodeCache(cache_dir_));
+  EXPECT_FALSE(QFile::exists(cache_dir_ + "/leftover.part"));
+
+  QSignalSpy spy(cache_.get(), SIGNAL(Finished(QString, QString, bool)));
+  EXPECT_EQ(key, cache_->Request(input, preset_));
+  ProcessEvents();
+  EXPECT_EQ(0, cache_->outputs_.count());
+  ASSERT_EQ(1, spy.count());
+  EXPECT_EQ(cache_dir_ + "/" + key + ".ogg", spy[0][1].toString());
+}
+
+}  // namespace